@@ -0,0 +1,76 @@
+/** GID FILTER
+ * File: GIDFilter.h
+ * Membership test of the GIDs kept by the importers.
+ *
+ */
+
+#ifndef IMPORTERS_GIDFILTER_H_
+#define IMPORTERS_GIDFILTER_H_
+
+// C++
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace importers
+{
+  /** \class GIDFilter
+   * \brief Constant time membership test of a set of GIDs: a bitmap over the
+   * GID range, or a sorted vector if the GIDs are too sparse for it. An
+   * empty filter keeps every GID.
+   *
+   */
+  class GIDFilter
+  {
+    public:
+      /** \brief Largest bitmap, in bytes.
+       *
+       */
+      static constexpr uint64_t MAX_BITMAP_BYTES = 64 << 20;
+
+      explicit GIDFilter(const std::vector<uint32_t> &gids)
+      : m_all{gids.empty()}
+      , m_sorted(gids)
+      {
+        if(m_all) return;
+
+        std::sort(m_sorted.begin(), m_sorted.end());
+        m_sorted.erase(std::unique(m_sorted.begin(), m_sorted.end()), m_sorted.end());
+
+        const uint64_t words = (static_cast<uint64_t>(m_sorted.back()) >> 6) + 1;
+        if(words * sizeof(uint64_t) > MAX_BITMAP_BYTES) return;
+
+        m_bits.assign(words, 0);
+        for(const auto gid: m_sorted)
+          m_bits[gid >> 6] |= uint64_t(1) << (gid & 63);
+
+        m_sorted.clear();
+      }
+
+      /** \brief Returns true if the filter keeps every GID.
+       *
+       */
+      bool all() const
+      { return m_all; }
+
+      bool contains(const uint32_t gid) const
+      {
+        if(m_all) return true;
+
+        if(!m_bits.empty())
+        {
+          const auto word = gid >> 6;
+          return word < m_bits.size() && ((m_bits[word] >> (gid & 63)) & 1) != 0;
+        }
+
+        return std::binary_search(m_sorted.cbegin(), m_sorted.cend(), gid);
+      }
+
+    private:
+      bool                  m_all;    /** true if there is no filter.      */
+      std::vector<uint32_t> m_sorted; /** sorted gids, if sparse.          */
+      std::vector<uint64_t> m_bits;   /** gid bitmap, if dense enough.     */
+  };
+}
+
+#endif /* IMPORTERS_GIDFILTER_H_ */
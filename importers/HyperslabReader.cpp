@@ -0,0 +1,91 @@
+/** HYPERSLAB READER
+ * File: HyperslabReader.cpp
+ * Reads two dimensional float HDF5 datasets in blocks of rows.
+ *
+ */
+
+#include "HyperslabReader.h"
+
+// C++
+#include <algorithm>
+#include <stdexcept>
+
+namespace importers
+{
+  HyperslabReader::HyperslabReader(const H5::DataSet &dataSet, size_t blockBytes, bool background)
+  : m_dataSet(dataSet)
+  , m_rows{0}
+  , m_columns{0}
+  , m_blockRows{0}
+  , m_nextRow{0}
+  , m_currentRows{0}
+  , m_pendingRows{0}
+  , m_readAhead{background}
+  {
+    const auto space = m_dataSet.getSpace();
+    if(space.getSimpleExtentNdims() != 2)
+      throw std::runtime_error("HyperslabReader: dataset is not two dimensional");
+
+    hsize_t dims[2]{0,0};
+    space.getSimpleExtentDims(dims);
+    m_rows = dims[0];
+    m_columns = dims[1];
+
+    if(m_rows == 0 || m_columns == 0) return;
+
+    m_blockRows = std::max<hsize_t>(1, blockBytes / (m_columns * sizeof(float)));
+    m_blockRows = std::min(m_blockRows, m_rows);
+
+    m_current.resize(m_blockRows * m_columns);
+    m_pending.resize(m_blockRows * m_columns);
+
+    readAhead(0);
+  }
+
+  HyperslabReader::~HyperslabReader()
+  {
+    // a deferred read hasn't started, waiting would run it.
+    if(m_read.valid() && m_readAhead) m_read.wait();
+  }
+
+  bool HyperslabReader::next()
+  {
+    if(!m_read.valid())
+    {
+      m_currentRows = 0;
+      return false;
+    }
+
+    // rethrows the errors of the read.
+    m_read.get();
+
+    std::swap(m_current, m_pending);
+    m_currentRows = m_pendingRows;
+
+    if(m_nextRow < m_rows) readAhead(m_nextRow);
+
+    return m_currentRows != 0;
+  }
+
+  void HyperslabReader::readAhead(hsize_t firstRow)
+  {
+    m_pendingRows = std::min(m_blockRows, m_rows - firstRow);
+    m_nextRow = firstRow + m_pendingRows;
+
+    const hsize_t rows = m_pendingRows;
+    float *target = m_pending.data();
+
+    const auto policy = m_readAhead ? std::launch::async : std::launch::deferred;
+    m_read = std::async(policy, [this, firstRow, rows, target]()
+    {
+      const hsize_t offset[2]{firstRow, 0};
+      const hsize_t count[2]{rows, m_columns};
+
+      auto fileSpace = m_dataSet.getSpace();
+      fileSpace.selectHyperslab(H5S_SELECT_SET, count, offset);
+
+      const H5::DataSpace memorySpace(2, count);
+      m_dataSet.read(target, H5::PredType::NATIVE_FLOAT, memorySpace, fileSpace);
+    });
+  }
+}
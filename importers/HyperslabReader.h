@@ -0,0 +1,94 @@
+/** HYPERSLAB READER
+ * File: HyperslabReader.h
+ * Reads two dimensional float HDF5 datasets in blocks of rows.
+ *
+ */
+
+#ifndef IMPORTERS_HYPERSLABREADER_H_
+#define IMPORTERS_HYPERSLABREADER_H_
+
+// HDF5
+#include <H5Cpp.h>
+
+// C++
+#include <cstddef>
+#include <future>
+#include <vector>
+
+namespace importers
+{
+  /** \brief Bytes of a dataset read at once.
+   *
+   */
+  constexpr size_t DEFAULT_HYPERSLAB_BYTES = 4 << 20;
+
+  /** \class HyperslabReader
+   * \brief Iterates a two dimensional float dataset in blocks of whole rows.
+   * The next block is read in a separate thread while the current one is
+   * processed, so memory is bounded by two blocks and reading overlaps with
+   * the processing.
+   *
+   * Only the reader thread uses the HDF5 library while the reader is
+   * iterating, don't make HDF5 calls between next() calls. Callers that do,
+   * like those writing each block to another dataset, must disable the
+   * read ahead: blocks are then read by next() in the calling thread.
+   *
+   */
+  class HyperslabReader
+  {
+    public:
+      /** \brief HyperslabReader class constructor.
+       * \param[in] dataSet Dataset to read.
+       * \param[in] blockBytes Approximate size of a block in bytes.
+       * \param[in] background true to read the next block in the background.
+       *
+       */
+      explicit HyperslabReader(const H5::DataSet &dataSet, size_t blockBytes = DEFAULT_HYPERSLAB_BYTES,
+                               bool background = true);
+
+      ~HyperslabReader();
+
+      HyperslabReader(const HyperslabReader &) = delete;
+      HyperslabReader &operator=(const HyperslabReader &) = delete;
+
+      /** \brief Moves to the next block.
+       * \return false when there are no more rows.
+       *
+       */
+      bool next();
+
+      /** \brief Values of the current block, rows() * columns() values in
+       * row major order.
+       *
+       */
+      const float *data() const
+      { return m_current.data(); }
+
+      hsize_t rows() const
+      { return m_currentRows; }
+
+      hsize_t columns() const
+      { return m_columns; }
+
+    private:
+      /** \brief Starts reading the block at the given row in the background,
+       * or prepares it to be read by next() without read ahead.
+       *
+       */
+      void readAhead(hsize_t firstRow);
+
+      const H5::DataSet   m_dataSet;     /** dataset being read.               */
+      hsize_t             m_rows;        /** rows of the dataset.              */
+      hsize_t             m_columns;     /** columns of the dataset.           */
+      hsize_t             m_blockRows;   /** rows read at once.                */
+      hsize_t             m_nextRow;     /** first row of the pending block.   */
+      hsize_t             m_currentRows; /** rows of the current block.        */
+      hsize_t             m_pendingRows; /** rows of the pending block.        */
+      bool                m_readAhead;   /** true if reading in the background.*/
+      std::vector<float>  m_current;     /** block being processed.            */
+      std::vector<float>  m_pending;     /** block being read.                 */
+      std::future<void>   m_read;        /** background read of m_pending.     */
+  };
+}
+
+#endif /* IMPORTERS_HYPERSLABREADER_H_ */
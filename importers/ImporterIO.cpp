@@ -0,0 +1,320 @@
+/** IMPORTER IO
+ * File: ImporterIO.cpp
+ * Shared input/output core of the importer tools.
+ *
+ */
+
+#include "ImporterIO.h"
+
+// C++
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+  // Powers of ten exactly representable as doubles.
+  const double EXACT_POWERS[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                  1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                  1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  inline bool isDigit(const char c)
+  {
+    return c >= '0' && c <= '9';
+  }
+}
+
+namespace importers
+{
+  MappedFile::MappedFile(const std::string &path)
+  : m_data{nullptr}
+  , m_size{0}
+  , m_open{false}
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return;
+
+    struct stat info;
+    if(::fstat(fd, &info) == 0)
+    {
+      m_size = static_cast<size_t>(info.st_size);
+      if(m_size == 0)
+      {
+        m_open = true;
+      }
+      else
+      {
+        void *mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED)
+        {
+          // the files are read once from beginning to end.
+          ::madvise(mapping, m_size, MADV_SEQUENTIAL);
+          m_data = static_cast<const char *>(mapping);
+          m_open = true;
+        }
+      }
+    }
+
+    ::close(fd);
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if(m_data) ::munmap(const_cast<char *>(m_data), m_size);
+  }
+
+  void MappedFile::discard(const char *position) const
+  {
+    if(!m_data || position <= m_data) return;
+
+    const size_t page = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    const size_t bytes = (static_cast<size_t>(position - m_data) / page) * page;
+
+    if(bytes > 0) ::madvise(const_cast<char *>(m_data), bytes, MADV_DONTNEED);
+  }
+
+  BufferedWriter::BufferedWriter(size_t bufferSize)
+  : m_file{nullptr}
+  , m_limit{bufferSize}
+  , m_good{true}
+  {
+    m_buffer.reserve(bufferSize);
+  }
+
+  BufferedWriter::~BufferedWriter()
+  {
+    close();
+  }
+
+  bool BufferedWriter::open(const std::string &path)
+  {
+    close();
+
+    m_file = std::fopen(path.c_str(), "wb");
+    m_good = (m_file != nullptr);
+
+    // the writer does its own buffering.
+    if(m_file) std::setvbuf(m_file, nullptr, _IONBF, 0);
+
+    return m_good;
+  }
+
+  bool BufferedWriter::close()
+  {
+    if(!m_file) return m_good;
+
+    flush();
+    if(std::fclose(m_file) != 0) m_good = false;
+    m_file = nullptr;
+
+    return m_good;
+  }
+
+  void BufferedWriter::write(const char *text, size_t size)
+  {
+    if(m_buffer.size() + size > m_limit)
+    {
+      flush();
+
+      if(size > m_limit)
+      {
+        if(m_file && std::fwrite(text, 1, size, m_file) != size) m_good = false;
+        return;
+      }
+    }
+
+    m_buffer.append(text, size);
+  }
+
+  bool BufferedWriter::flush()
+  {
+    if(m_file && !m_buffer.empty())
+    {
+      if(std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+        m_good = false;
+    }
+
+    m_buffer.clear();
+
+    return m_good;
+  }
+
+  bool parseInt(const char *&it, const char *end, long long &value)
+  {
+    const char *current = it;
+    bool negative = false;
+    if(current != end && (*current == '-' || *current == '+'))
+    {
+      negative = (*current == '-');
+      ++current;
+    }
+
+    if(current == end || !isDigit(*current)) return false;
+
+    unsigned long long result = 0;
+    for(; current != end && isDigit(*current); ++current)
+      result = result * 10 + static_cast<unsigned long long>(*current - '0');
+
+    value = negative ? -static_cast<long long>(result) : static_cast<long long>(result);
+    it = current;
+
+    return true;
+  }
+
+  bool parseDouble(const char *&it, const char *end, double &value)
+  {
+    const char *current = it;
+    bool negative = false;
+    if(current != end && (*current == '-' || *current == '+'))
+    {
+      negative = (*current == '-');
+      ++current;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool any = false;
+
+    for(; current != end && isDigit(*current); ++current, any = true)
+    {
+      if(digits < 19)
+      {
+        mantissa = mantissa * 10 + static_cast<uint64_t>(*current - '0');
+        if(mantissa != 0) ++digits;
+      }
+      else
+      {
+        ++exponent;
+      }
+    }
+
+    if(current != end && *current == '.')
+    {
+      ++current;
+      for(; current != end && isDigit(*current); ++current, any = true)
+      {
+        if(digits < 19)
+        {
+          mantissa = mantissa * 10 + static_cast<uint64_t>(*current - '0');
+          if(mantissa != 0) ++digits;
+          --exponent;
+        }
+      }
+    }
+
+    if(!any) return false;
+
+    if(current != end && (*current == 'e' || *current == 'E'))
+    {
+      const char *exponentIt = current + 1;
+      long long explicitExponent = 0;
+      if(parseInt(exponentIt, end, explicitExponent))
+      {
+        if(explicitExponent > 10000) explicitExponent = 10000;
+        if(explicitExponent < -10000) explicitExponent = -10000;
+        exponent += static_cast<int>(explicitExponent);
+        current = exponentIt;
+      }
+    }
+
+    // Exact mantissa and power of ten give a correctly rounded result,
+    // anything else goes through strtod.
+    const uint64_t MAX_EXACT = uint64_t(1) << 53;
+    if(mantissa <= MAX_EXACT && exponent >= -22 && exponent <= 22)
+    {
+      double result = static_cast<double>(mantissa);
+      result = exponent < 0 ? result / EXACT_POWERS[-exponent] : result * EXACT_POWERS[exponent];
+      value = negative ? -result : result;
+    }
+    else
+    {
+      char number[128];
+      const size_t length = std::min<size_t>(current - it, sizeof(number) - 1);
+      std::memcpy(number, it, length);
+      number[length] = '\0';
+      value = std::strtod(number, nullptr);
+    }
+
+    it = current;
+
+    return true;
+  }
+
+  void appendInt(std::string &text, long long value)
+  {
+    char digits[24];
+    char *last = digits + sizeof(digits);
+    char *first = last;
+
+    unsigned long long magnitude = value < 0 ? 0ull - static_cast<unsigned long long>(value) :
+                                               static_cast<unsigned long long>(value);
+    do
+    {
+      *--first = static_cast<char>('0' + magnitude % 10);
+      magnitude /= 10;
+    }
+    while(magnitude != 0);
+
+    if(value < 0) *--first = '-';
+
+    text.append(first, last - first);
+  }
+
+  void appendDouble(std::string &text, double value)
+  {
+    // integral values, the usual case of times and coordinates, without
+    // going through printf.
+    if(std::abs(value) < 1e6 && !(value == 0 && std::signbit(value)) &&
+       value == static_cast<double>(static_cast<long long>(value)))
+    {
+      appendInt(text, static_cast<long long>(value));
+      return;
+    }
+
+    char number[32];
+    const int length = std::snprintf(number, sizeof(number), "%g", value);
+    if(length > 0) text.append(number, std::min<size_t>(length, sizeof(number) - 1));
+  }
+
+  std::vector<std::pair<const char *, const char *>> splitLines(const char *data,
+                                                               size_t size,
+                                                               size_t chunkSize)
+  {
+    std::vector<std::pair<const char *, const char *>> chunks;
+    if(size == 0) return chunks;
+
+    chunkSize = std::max<size_t>(chunkSize, 1);
+
+    const char *end = data + size;
+    const char *begin = data;
+    while(begin != end)
+    {
+      const char *chunkEnd = (static_cast<size_t>(end - begin) <= chunkSize) ? end : begin + chunkSize;
+      if(chunkEnd != end)
+      {
+        const void *newline = std::memchr(chunkEnd, '\n', end - chunkEnd);
+        chunkEnd = newline ? static_cast<const char *>(newline) + 1 : end;
+      }
+
+      chunks.emplace_back(begin, chunkEnd);
+      begin = chunkEnd;
+    }
+
+    return chunks;
+  }
+
+  unsigned int parserThreads(unsigned int threads)
+  {
+    if(threads != 0) return threads;
+
+    const unsigned int hardware = std::thread::hardware_concurrency();
+    return hardware == 0 ? 1 : hardware;
+  }
+}
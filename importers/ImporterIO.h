@@ -0,0 +1,276 @@
+/** IMPORTER IO
+ * File: ImporterIO.h
+ * Shared input/output core of the importer tools: memory mapped input,
+ * newline aligned chunks parsed in parallel, locale independent number
+ * parsing and formatting, and large buffered output.
+ *
+ */
+
+#ifndef IMPORTERS_IMPORTERIO_H_
+#define IMPORTERS_IMPORTERIO_H_
+
+// C++
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace importers
+{
+  /** \brief Bytes of input parsed at once by a thread.
+   *
+   */
+  constexpr size_t DEFAULT_CHUNK_SIZE = 16 << 20;
+
+  /** \brief Bytes buffered by BufferedWriter before writing to disk.
+   *
+   */
+  constexpr size_t DEFAULT_WRITE_BUFFER = 8 << 20;
+
+  /** \class MappedFile
+   * \brief Read only memory mapping of a whole file.
+   *
+   */
+  class MappedFile
+  {
+    public:
+      /** \brief MappedFile class constructor. Maps the given file, check
+       * isOpen() for errors.
+       * \param[in] path File path.
+       *
+       */
+      explicit MappedFile(const std::string &path);
+
+      ~MappedFile();
+
+      MappedFile(const MappedFile &) = delete;
+      MappedFile &operator=(const MappedFile &) = delete;
+
+      bool isOpen() const
+      { return m_open; }
+
+      const char *data() const
+      { return m_data; }
+
+      size_t size() const
+      { return m_size; }
+
+      /** \brief Releases the resident pages before the given position,
+       * already consumed by a sequential reader.
+       * \param[in] position Position inside the mapped contents.
+       *
+       */
+      void discard(const char *position) const;
+
+    private:
+      const char *m_data; /** mapped contents.                  */
+      size_t      m_size; /** file size in bytes.               */
+      bool        m_open; /** true if mapped (or empty) file.   */
+  };
+
+  /** \class BufferedWriter
+   * \brief Output file written in large blocks, never flushed per line.
+   *
+   */
+  class BufferedWriter
+  {
+    public:
+      explicit BufferedWriter(size_t bufferSize = DEFAULT_WRITE_BUFFER);
+
+      ~BufferedWriter();
+
+      BufferedWriter(const BufferedWriter &) = delete;
+      BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+      /** \brief Opens (truncates) the given file for writing.
+       *
+       */
+      bool open(const std::string &path);
+
+      /** \brief Flushes and closes the file.
+       * \return false if any write failed.
+       *
+       */
+      bool close();
+
+      void write(const char *text, size_t size);
+
+      void write(const std::string &text)
+      { write(text.data(), text.size()); }
+
+      bool good() const
+      { return m_file != nullptr && m_good; }
+
+    private:
+      bool flush();
+
+      std::FILE  *m_file;   /** output file.                   */
+      std::string m_buffer; /** pending bytes.                 */
+      size_t      m_limit;  /** bytes buffered before writing. */
+      bool        m_good;   /** false once a write fails.      */
+  };
+
+  /** \brief Skips the given separator characters.
+   *
+   */
+  inline const char *skip(const char *it, const char *end, const char *separators)
+  {
+    for(; it != end; ++it)
+    {
+      bool separator = false;
+      for(const char *s = separators; *s != '\0' && !separator; ++s)
+        separator = (*it == *s);
+
+      if(!separator) break;
+    }
+
+    return it;
+  }
+
+  /** \brief Returns the end of the line starting at it, without its end of
+   * line characters, and moves it to the beginning of the next line.
+   *
+   */
+  inline const char *takeLine(const char *&it, const char *end)
+  {
+    const char *begin = it;
+    while(it != end && *it != '\n') ++it;
+
+    const char *last = it;
+    if(it != end) ++it;
+    if(last != begin && last[-1] == '\r') --last;
+
+    return last;
+  }
+
+  /** \brief Parses an integer at it, advancing it past the number. Like
+   * std::from_chars, no leading whitespace is skipped.
+   * \return false if there is no number at it.
+   *
+   */
+  bool parseInt(const char *&it, const char *end, long long &value);
+
+  /** \brief Parses a decimal floating point number ([+-]digits[.digits][e[+-]digits])
+   * at it, advancing it past the number. Always uses '.' as decimal point.
+   * \return false if there is no number at it.
+   *
+   */
+  bool parseDouble(const char *&it, const char *end, double &value);
+
+  /** \brief Appends the integer to the text.
+   *
+   */
+  void appendInt(std::string &text, long long value);
+
+  /** \brief Appends the number as the default std::ostream formatting
+   * (printf %g) does, with '.' as decimal point.
+   *
+   */
+  void appendDouble(std::string &text, double value);
+
+  /** \brief Splits [data, data + size) into chunks of about chunkSize bytes
+   * ending at a line end.
+   *
+   */
+  std::vector<std::pair<const char *, const char *>> splitLines(const char *data,
+                                                               size_t size,
+                                                               size_t chunkSize = DEFAULT_CHUNK_SIZE);
+
+  /** \brief Number of parsing threads, hardware concurrency if 0.
+   *
+   */
+  unsigned int parserThreads(unsigned int threads = 0);
+
+  /** \brief Parses the newline aligned chunks of [data, data + size) in
+   * parallel and consumes the results in file order.
+   *
+   * parse(begin, end, result) parses one chunk into a Result, returns false
+   * on error. consume(result) is called from the calling thread in chunk
+   * order. Results are reused between chunks (clear them in parse), at most
+   * two per thread are alive at once so memory stays bounded no matter the
+   * input size.
+   *
+   * \return false if any chunk failed to parse.
+   *
+   */
+  template<typename Result, typename Parse, typename Consume>
+  bool parseChunks(const char *data, size_t size, Parse parse, Consume consume,
+                   unsigned int threads = 0, size_t chunkSize = DEFAULT_CHUNK_SIZE)
+  {
+    const auto chunks = splitLines(data, size, chunkSize);
+    if(chunks.empty()) return true;
+
+    const unsigned int numThreads = std::min<size_t>(parserThreads(threads), chunks.size());
+    const size_t window = 2 * numThreads;
+
+    std::vector<Result> results(window);
+    std::vector<char> ready(window, 0);
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t written = 0;
+    bool failed = false;
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]()
+    {
+      for(size_t i = next++; i < chunks.size(); i = next++)
+      {
+        {
+          // wait for the slot of the chunk to be written.
+          std::unique_lock<std::mutex> lock(mutex);
+          changed.wait(lock, [&](){ return failed || i < written + window; });
+          if(failed) return;
+        }
+
+        const auto slot = i % window;
+        const bool ok = parse(chunks[i].first, chunks[i].second, results[slot]);
+
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          failed |= !ok;
+          ready[slot] = 1;
+        }
+        changed.notify_all();
+
+        if(!ok) return;
+      }
+    };
+
+    std::vector<std::thread> workers;
+    for(unsigned int i = 0; i < numThreads; ++i)
+      workers.emplace_back(worker);
+
+    while(written < chunks.size())
+    {
+      const auto slot = written % window;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&](){ return failed || ready[slot] != 0; });
+        if(failed) break;
+      }
+
+      consume(results[slot]);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready[slot] = 0;
+        ++written;
+      }
+      changed.notify_all();
+    }
+
+    for(auto &thread: workers)
+      thread.join();
+
+    return !failed;
+  }
+}
+
+#endif /* IMPORTERS_IMPORTERIO_H_ */
@@ -7,27 +7,36 @@
 
 // C++
 #include <iostream>
-#include <fstream>
 #include <random>
-#include <locale>
 #include <sys/stat.h>
 #include <dirent.h>
 #include <algorithm>
-#include <cassert>
-
-// Qt5
-#include <QString>
-#include <QStringList>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+
+// Importers
+#include "ImporterIO.h"
 
 std::string NETWORK_FILENAME = "gdf_network.csv";
 std::string ACTiVITY_FILENAME = "gdf_activity.csv";
 
 const double TIME_INTERVAL = 0.1;
 
-struct dotSeparator: std::numpunct<char>
-{
-    char do_decimal_point() const { return '.'; }
-};
+// Consumed input bytes between releases of the file pages.
+const size_t DISCARD_INTERVAL = 64 << 20;
+
+// Parsed chunks of a file waiting for the merge, on top of those being parsed.
+const size_t QUEUED_CHUNKS = 2;
 
 template<class T> void ignore( const T& ) { }
 
@@ -36,54 +45,364 @@ void printUsage(const char *filename)
   const std::string name = (filename ? std::string(filename) : "GDF2CSV");
 
   std::cout << name << '\n';
-  std::cout << "Generates CSV histograms from GDF files." << '\n';
-  std::cout << "Usage: " << name << " <gdf_dir>" << std::endl;
+  std::cout << "Generates CSV network and activity from GDF files." << '\n';
+  std::cout << "Usage: " << name << " <gdf_dir> [options]" << '\n';
+  std::cout << "  --first-gid <id>      First neuron id (default: smallest id in the data)." << '\n';
+  std::cout << "  --last-gid <id>       Last neuron id (default: largest id in the data)." << '\n';
+  std::cout << "  --layers <id,id,...>  Ids after which a new layer begins (default: one" << '\n';
+  std::cout << "                        layer per GDF file)." << '\n';
+  std::cout << "Every GDF file must be sorted by time, as NEST writes them." << std::endl;
   std::exit(-1);
 }
 
+/** \brief Spike of a GDF file: neuron id and time step.
+ *
+ */
+struct GDFSpike
+{
+  long long neuron;
+  long long step;
+};
+
+/** \brief Spikes of a chunk of a GDF file, and what is needed to check
+ * them against the chunks before it.
+ *
+ */
+struct GDFChunk
+{
+  std::vector<GDFSpike> spikes;       /** spikes, in file order.                        */
+  const char           *end;          /** end of the chunk in the file.                 */
+  unsigned long long    lines;        /** lines in the chunk.                           */
+  unsigned long long    firstLine;    /** line of the first spike, from 1.              */
+  unsigned long long    badLine;      /** line that couldn't be parsed, from 1, or 0.   */
+  std::string           badText;      /** contents of that line.                        */
+  unsigned long long    unsortedLine; /** first line out of time order, from 1, or 0.   */
+  long long             minNeuron;    /** smallest neuron id of the chunk.              */
+  long long             maxNeuron;    /** largest neuron id of the chunk.               */
+};
+
+/** \brief Parses the "id<tab>time" lines of [begin, end) into the chunk. Stops
+ * at the first error, recorded in the chunk to be reported with its line
+ * number once the lines of the previous chunks are known.
+ *
+ */
+void parseGDFChunk(const char *begin, const char *end, GDFChunk &chunk)
+{
+  chunk.spikes.clear();
+  chunk.end = end;
+  chunk.lines = 0;
+  chunk.firstLine = 0;
+  chunk.badLine = 0;
+  chunk.badText.clear();
+  chunk.unsortedLine = 0;
+  chunk.minNeuron = std::numeric_limits<long long>::max();
+  chunk.maxNeuron = std::numeric_limits<long long>::min();
+
+  const char *it = begin;
+  while(it != end)
+  {
+    const char *line = it;
+    const char *last = importers::takeLine(it, end);
+    ++chunk.lines;
+
+    const char *field = importers::skip(line, last, "\t ");
+    if(field == last) continue;
+
+    long long neuron = 0;
+    double time = 0;
+    bool ok = importers::parseInt(field, last, neuron);
+    field = importers::skip(field, last, "\t ");
+    ok = ok && importers::parseDouble(field, last, time);
+    ok = ok && importers::skip(field, last, "\t ") == last;
+
+    if(!ok)
+    {
+      chunk.badLine = chunk.lines;
+      chunk.badText.assign(line, last);
+      return;
+    }
+
+    const GDFSpike spike{neuron, static_cast<long long>(time * 10)};
+    if(chunk.spikes.empty())
+    {
+      chunk.firstLine = chunk.lines;
+    }
+    else if(spike.step < chunk.spikes.back().step)
+    {
+      chunk.unsortedLine = chunk.lines;
+      return;
+    }
+
+    chunk.spikes.push_back(spike);
+    chunk.minNeuron = std::min(chunk.minNeuron, neuron);
+    chunk.maxNeuron = std::max(chunk.maxNeuron, neuron);
+  }
+}
+
+/** \class GDFReader
+ * \brief Sequential reader of the spikes of a GDF file ("id<tab>time" lines).
+ * The file is parsed in parallel chunks from a thread of its own, the
+ * parsed chunks wait in a bounded queue until the reader gets to them.
+ *
+ */
+class GDFReader
+{
+  public:
+    /** \brief GDFReader class constructor. Starts parsing the given file,
+     * check isOpen() for errors.
+     * \param[in] path File path.
+     * \param[in] threads Parsing threads of this file.
+     *
+     */
+    GDFReader(const std::string &path, unsigned int threads)
+    : m_path{path}
+    , m_file{path}
+    , m_threads{threads}
+    , m_position{0}
+    , m_spike{0, std::numeric_limits<long long>::min()}
+    , m_lines{0}
+    , m_lastStep{std::numeric_limits<long long>::min()}
+    , m_discarded{m_file.data()}
+    , m_minNeuron{std::numeric_limits<long long>::max()}
+    , m_maxNeuron{std::numeric_limits<long long>::min()}
+    , m_stop{false}
+    , m_done{false}
+    , m_failed{false}
+    {
+      if(m_file.isOpen()) m_thread = std::thread(&GDFReader::parse, this);
+    }
+
+    ~GDFReader()
+    {
+      m_stop = true;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+      }
+      m_changed.notify_all();
+
+      if(m_thread.joinable()) m_thread.join();
+    }
+
+    GDFReader(const GDFReader &) = delete;
+    GDFReader &operator=(const GDFReader &) = delete;
+
+    bool isOpen() const
+    { return m_file.isOpen(); }
+
+    /** \brief Reads the next spike, waiting for its chunk to be parsed.
+     * \return false at the end of the file or on errors, see failed().
+     *
+     */
+    bool next()
+    {
+      while(m_position == m_current.size())
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this](){ return !m_queue.empty() || m_done; });
+
+        if(m_queue.empty())
+        {
+          if(m_failed) std::cerr << m_error << std::endl;
+          return false;
+        }
+
+        m_current = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_position = 0;
+
+        lock.unlock();
+        m_changed.notify_all();
+      }
+
+      m_spike = m_current[m_position++];
+      return true;
+    }
+
+    const GDFSpike &spike() const
+    { return m_spike; }
+
+    /** \brief Returns true on parse or order errors, once next() returned
+     * false.
+     *
+     */
+    bool failed() const
+    { return m_failed; }
+
+    /** \brief Neuron id range of the spikes read, empty if none. Complete
+     * once next() returned false.
+     *
+     */
+    long long minNeuron() const
+    { return m_minNeuron; }
+
+    long long maxNeuron() const
+    { return m_maxNeuron; }
+
+  private:
+    /** \brief Parses the whole file, runs in m_thread.
+     *
+     */
+    void parse()
+    {
+      auto parseChunk = [this](const char *begin, const char *end, GDFChunk &chunk)
+      {
+        if(m_stop) return false;
+
+        parseGDFChunk(begin, end, chunk);
+        return true;
+      };
+
+      auto consumeChunk = [this](GDFChunk &chunk)
+      { consume(chunk); };
+
+      importers::parseChunks<GDFChunk>(m_file.data(), m_file.size(), parseChunk, consumeChunk, m_threads);
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+      }
+      m_changed.notify_all();
+    }
+
+    /** \brief Checks a parsed chunk, in file order, and queues its spikes.
+     * Waits while the queue is full.
+     *
+     */
+    void consume(GDFChunk &chunk)
+    {
+      if(m_stop) return;
+
+      const auto firstLine = m_lines;
+      m_lines += chunk.lines;
+
+      std::string error;
+      if(chunk.badLine != 0)
+      {
+        error = "ERROR: Unable parse line " + std::to_string(firstLine + chunk.badLine) + ": " + chunk.badText +
+                " from file " + m_path;
+      }
+      else if(chunk.unsortedLine != 0 || (!chunk.spikes.empty() && chunk.spikes.front().step < m_lastStep))
+      {
+        const auto line = firstLine + (chunk.unsortedLine != 0 ? chunk.unsortedLine : chunk.firstLine);
+        error = "ERROR: File " + m_path + " is not sorted by time at line " + std::to_string(line);
+      }
+
+      if(!error.empty())
+      {
+        m_stop = true;
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_failed = true;
+          m_error = error;
+        }
+        m_changed.notify_all();
+        return;
+      }
+
+      if(!chunk.spikes.empty())
+      {
+        m_lastStep = chunk.spikes.back().step;
+        m_minNeuron = std::min(m_minNeuron, chunk.minNeuron);
+        m_maxNeuron = std::max(m_maxNeuron, chunk.maxNeuron);
+      }
+
+      if(static_cast<size_t>(chunk.end - m_discarded) > DISCARD_INTERVAL)
+      {
+        m_file.discard(chunk.end);
+        m_discarded = chunk.end;
+      }
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_changed.wait(lock, [this](){ return m_stop || m_queue.size() < QUEUED_CHUNKS; });
+      if(m_stop) return;
+
+      m_queue.push_back(std::move(chunk.spikes));
+
+      lock.unlock();
+      m_changed.notify_all();
+    }
+
+    const std::string                 m_path;      /** file path.                             */
+    const importers::MappedFile       m_file;      /** file contents.                         */
+    const unsigned int                m_threads;   /** parsing threads.                       */
+
+    std::vector<GDFSpike>             m_current;   /** chunk being read.                      */
+    size_t                            m_position;  /** next spike of m_current.               */
+    GDFSpike                          m_spike;     /** current spike.                         */
+
+    unsigned long long                m_lines;     /** lines of the chunks consumed.          */
+    long long                         m_lastStep;  /** last step of the chunks consumed.      */
+    const char                       *m_discarded; /** pages released up to here.             */
+    long long                         m_minNeuron; /** smallest neuron id parsed.             */
+    long long                         m_maxNeuron; /** largest neuron id parsed.              */
+
+    std::mutex                        m_mutex;     /** protects the members below.            */
+    std::condition_variable           m_changed;   /** queue or state changed.                */
+    std::deque<std::vector<GDFSpike>> m_queue;     /** parsed chunks waiting to be read.      */
+    std::atomic<bool>                 m_stop;      /** stop parsing, on errors or destruction.*/
+    bool                              m_done;      /** parsing thread finished.               */
+    bool                              m_failed;    /** true on parse or order errors.         */
+    std::string                       m_error;     /** error message.                         */
+    std::thread                       m_thread;    /** parsing thread.                        */
+};
+
+/** \brief Parses a comma separated list of ids.
+ *
+ */
+bool parseIds(const std::string &text, std::vector<long long> &ids)
+{
+  const char *it = text.data();
+  const char *end = it + text.size();
+  while(it != end)
+  {
+    long long id = 0;
+    if(!importers::parseInt(it, end, id)) return false;
+    ids.push_back(id);
+
+    if(it != end && *it++ != ',') return false;
+  }
+
+  return !ids.empty();
+}
+
 int main(int argc, char* argv[])
 {
   if(argc < 2) printUsage(argv[0]);
 
+  bool hasFirst = false, hasLast = false;
+  long long firstGid = 0, lastGid = 0;
+  std::vector<long long> layers;
+
+  for(int i = 2; i < argc; ++i)
+  {
+    const std::string option = argv[i];
+    if(i + 1 == argc) printUsage(argv[0]);
+
+    const std::string value = argv[++i];
+    const char *it = value.data();
+    const char *end = it + value.size();
+
+    if(option == "--first-gid" && importers::parseInt(it, end, firstGid) && it == end)
+      hasFirst = true;
+    else if(option == "--last-gid" && importers::parseInt(it, end, lastGid) && it == end)
+      hasLast = true;
+    else if(option != "--layers" || !parseIds(value, layers))
+      printUsage(argv[0]);
+  }
+
   std::random_device dev;
   std::mt19937 rng(dev());
   std::uniform_int_distribution<std::mt19937::result_type> dist(1,100);
   std::uniform_int_distribution<std::mt19937::result_type> height(1,40);
 
-  std::ofstream nFile, aFile;
-  nFile.open(NETWORK_FILENAME, std::fstream::out|std::fstream::trunc);
-  aFile.open(ACTiVITY_FILENAME, std::fstream::out|std::fstream::trunc);
+  importers::BufferedWriter nFile, aFile;
 
-  if(nFile.fail() || aFile.fail())
+  if(!nFile.open(NETWORK_FILENAME) || !aFile.open(ACTiVITY_FILENAME))
   {
     std::cerr << "ERROR: Unable to open: " << NETWORK_FILENAME << " or " << ACTiVITY_FILENAME << std::endl;
     std::exit(-1);
   }
 
-  // write floating point numbers with dot separation no matter the locale
-  nFile.imbue(std::locale(nFile.getloc(), new dotSeparator()));
-  aFile.imbue(std::locale(aFile.getloc(), new dotSeparator()));
-
-  std::cout << "Write network file: " << NETWORK_FILENAME << std::endl;
-
-  for(unsigned int i = 2; i <= 78072; ++i)
-  {
-    int level = 1000-height(rng);
-
-    if(i > 20684) level -= 50;
-    if(i > 26518) level -= 50;
-    if(i > 48433) level -= 50;
-    if(i > 53912) level -= 50;
-    if(i > 58762) level -= 50;
-    if(i > 59827) level -= 50;
-    if(i > 74222) level -= 50;
-    if(i > 77170) level -= 50;
-
-    nFile << i << ", " << dist(rng) << ", " << dist(rng) << ", " << level << '\n';
-  }
-  nFile.flush();
-  nFile.close();
-
   auto path = std::string(argv[1]);
   if(path.back() != '/')
     path += '/';
@@ -117,66 +436,152 @@ int main(int argc, char* argv[])
   const int EVENTS = filenames.size();
   std::cout << "Found " << EVENTS << " file(s)" << std::endl;
 
-  unsigned char **buffer = new unsigned char*[100000];
-  for(int i = 0; i < 100000; ++i)
-  {
-    buffer[i] = new unsigned char[78072];
-    memset(buffer[i], 0, sizeof(unsigned char)*78072);
-  }
+  // Every file is sorted by time, a k-way merge on the time step visits the
+  // spikes in time order. The files are parsed in parallel chunks as the
+  // merge goes, keeping a few chunks per file in memory.
+  const unsigned int fileThreads = std::max(1u, importers::parserThreads() / static_cast<unsigned int>(std::max(EVENTS, 1)));
+
+  std::vector<std::unique_ptr<GDFReader>> readers;
+  using Entry = std::pair<long long, size_t>; // step, reader.
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
 
   for(int i = 0; i < EVENTS; ++i)
   {
     const auto file = path + filenames.at(i);
     std::cout << "Processing " << i+1 << ": " << file << std::endl;
 
-    std::ifstream dataFile;
-    dataFile.open(file, std::fstream::in);
+    readers.emplace_back(new GDFReader(file, fileThreads));
+    auto &reader = *readers.back();
 
-    if(dataFile.fail())
+    if(!reader.isOpen())
     {
       std::cerr << "ERROR: Unable to open: " << file << std::endl;
       std::exit(-1);
     }
 
-    unsigned int lineNum = 0;
-    for(std::string line; getline(dataFile,  line); )
+    if(reader.next())
+      heap.emplace(reader.spike().step, readers.size() - 1);
+    else if(reader.failed())
+      std::exit(-1);
+  }
+
+  const auto inRange = [&](const long long neuron)
+  {
+    return (!hasFirst || neuron >= firstGid) && (!hasLast || neuron <= lastGid);
+  };
+
+  std::vector<long long> stepNeurons;
+  std::string line;
+  unsigned long long spikesNumber = 0;
+
+  while(!heap.empty())
+  {
+    const long long step = heap.top().first;
+
+    stepNeurons.clear();
+    while(!heap.empty() && heap.top().first == step)
     {
-      ++lineNum;
-      auto qLine = QString::fromStdString(line);
-      auto parts = qLine.split('\t');
-      parts.removeAll(QString());
-      if(parts.size() != 2)
+      const auto index = heap.top().second;
+      heap.pop();
+
+      auto &reader = *readers[index];
+      bool more = true;
+      while(more && reader.spike().step == step)
       {
-        std::cerr << "ERROR: Unable parse line " << lineNum << ": " << line << " from file " << file << std::endl;
-        std::exit(-1);
+        if(inRange(reader.spike().neuron))
+          stepNeurons.push_back(reader.spike().neuron);
+
+        more = reader.next();
       }
 
-      const auto num = parts.first().toInt();
-      const auto timeval = static_cast<int>(parts.last().toDouble() * 10);
-      buffer[timeval][num] = 1;
-      assert(timeval < 100000);
+      if(!more && reader.failed()) std::exit(-1);
+      if(more) heap.emplace(reader.spike().step, index);
     }
 
-    dataFile.close();
-  }
+    // a neuron fires at most once per step.
+    std::sort(stepNeurons.begin(), stepNeurons.end());
+    stepNeurons.erase(std::unique(stepNeurons.begin(), stepNeurons.end()), stepNeurons.end());
 
-  for(int i = 0; i < 100000; ++i)
-  {
-    const double time = TIME_INTERVAL * i;
-    for(int j = 2; j <= 78072; ++j)
+    const double time = TIME_INTERVAL * step;
+    for(const auto neuron: stepNeurons)
     {
-      if(buffer[i][j] == 1)
-      {
-        aFile << j << ", " << time << '\n';
-      }
+      line.clear();
+      importers::appendInt(line, neuron);
+      line += ", ";
+      importers::appendDouble(line, time);
+      line += '\n';
+      aFile.write(line);
     }
+
+    spikesNumber += stepNeurons.size();
+  }
+
+  if(!aFile.close())
+  {
+    std::cerr << "ERROR: Unable to write: " << ACTiVITY_FILENAME << std::endl;
+    std::exit(-1);
+  }
+
+  std::cout << "Write activity file: " << ACTiVITY_FILENAME << " - " << spikesNumber << " spikes" << std::endl;
+
+  // Network and layout not given are those of the data: the id range of the
+  // spikes, and a layer per file (NEST writes a file per population).
+  std::vector<std::pair<long long, long long>> fileRanges;
+  for(const auto &reader: readers)
+  {
+    if(reader->minNeuron() <= reader->maxNeuron())
+      fileRanges.emplace_back(reader->minNeuron(), reader->maxNeuron());
+  }
+  std::sort(fileRanges.begin(), fileRanges.end());
+
+  if(fileRanges.empty() && (!hasFirst || !hasLast))
+  {
+    std::cerr << "ERROR: No spikes found, give the neuron ids with --first-gid and --last-gid" << std::endl;
+    std::exit(-1);
+  }
+
+  if(!hasFirst) firstGid = fileRanges.front().first;
+  if(!hasLast)
+  {
+    lastGid = fileRanges.front().second;
+    for(const auto &range: fileRanges) lastGid = std::max(lastGid, range.second);
+  }
+
+  if(layers.empty())
+  {
+    for(size_t i = 1; i < fileRanges.size(); ++i)
+      layers.push_back(fileRanges[i].first - 1);
+  }
+  std::sort(layers.begin(), layers.end());
+  layers.erase(std::unique(layers.begin(), layers.end()), layers.end());
+
+  std::cout << "Write network file: " << NETWORK_FILENAME << " - " << (lastGid - firstGid + 1) << " neurons, "
+            << (layers.size() + 1) << " layers" << std::endl;
+
+  for(long long i = firstGid; i <= lastGid; ++i)
+  {
+    const auto layer = std::lower_bound(layers.cbegin(), layers.cend(), i) - layers.cbegin();
+    const long long level = 1000 - static_cast<long long>(height(rng)) - 50 * layer;
+
+    line.clear();
+    importers::appendInt(line, i);
+    line += ", ";
+    importers::appendInt(line, dist(rng));
+    line += ", ";
+    importers::appendInt(line, dist(rng));
+    line += ", ";
+    importers::appendInt(line, level);
+    line += '\n';
+    nFile.write(line);
+  }
+
+  if(!nFile.close())
+  {
+    std::cerr << "ERROR: Unable to write: " << NETWORK_FILENAME << std::endl;
+    std::exit(-1);
   }
-  aFile.flush();
-  aFile.close();
 
-  std::cout << "Write activity file: " << ACTiVITY_FILENAME << std::endl;
   std::cout << "Processed " << filenames.size() << " files successfully" << std::endl;
 
   return 0;
 }
-
@@ -9,18 +9,17 @@
 
 #include <cstring>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <algorithm>
 #include <cassert>
+#include <limits>
 #include <memory>
 #include <sys/stat.h>
 #include <limits.h>
 
-struct dotSeparator: std::numpunct<char>
-{
-    char do_decimal_point() const { return '.'; }
-};
+#include "GIDFilter.h"
+#include "HyperslabReader.h"
+#include "ImporterIO.h"
 
 template<class T> void ignore( const T& ) { }
 
@@ -56,6 +55,8 @@ int main(int argc, char* argv[])
 {
   if(argc < 2) printUsage(argv[0]);
 
+  const importers::GIDFilter filter(toFilter);
+
   struct stat buf;
   if(stat(argv[1], &buf) != 0)
   {
@@ -89,80 +90,101 @@ int main(int argc, char* argv[])
     }
   }
 
-  std::ofstream nFile, cFile;
-  nFile.open(NETWORK_FILENAME, std::fstream::out|std::fstream::trunc);
+  importers::BufferedWriter nFile, cFile;
 
-  if(nFile.fail())
+  if(!nFile.open(NETWORK_FILENAME))
   {
     std::cerr << "Unable to open output filename: " << NETWORK_FILENAME << std::endl;
     std::exit(-1);
   }
 
-  // write floating point numbers with dot separation no matter the locale
-  nFile.imbue(std::locale(nFile.getloc(), new dotSeparator()));
-  nFile << "gid" << SEPARATOR << "type" << SEPARATOR << "x" << SEPARATOR << "y" << SEPARATOR << "z" << NEWLINE;
-  auto dataSet = sourceFile.openDataSet(CELLS_TAG);
+  std::string line;
+  line = std::string("gid") + SEPARATOR + "type" + SEPARATOR + "x" + SEPARATOR + "y" + SEPARATOR + "z" + NEWLINE;
+  nFile.write(line);
 
-  hsize_t dims[2];
-  dataSet.getSpace().getSimpleExtentDims( dims );
-  assert(dataSet.getSpace().getSimpleExtentNdims() == 2);
+  auto dataSet = sourceFile.openDataSet(CELLS_TAG);
   assert(dataSet.getTypeClass() == H5T_FLOAT);
 
-  auto buffer = new float[dims[0]*dims[1]];
-
-  // load positions
-  dataSet.read( reinterpret_cast<void*>(buffer), H5::PredType::IEEE_F32LE);
-
+  // positions are read in blocks, each one formatted while the next is read.
   unsigned long idCount = 0;
-  for(size_t idx = 0; idx < dims[0]*dims[1]; )
   {
-    const auto id = static_cast<uint32_t>(buffer[idx]);
-    const auto type = static_cast<uint32_t>(buffer[idx+1]);
-    bool hasId = toFilter.empty();
-    if(!hasId)
-    {
-      hasId = std::find(toFilter.cbegin(), toFilter.cend(), id) != toFilter.cend();
-    }
+    importers::HyperslabReader positions(dataSet);
+    const auto columns = positions.columns();
+    assert(columns >= 5);
 
-    if(hasId)
+    while(positions.next())
     {
-      ++idCount;
-      nFile << id << SEPARATOR << CELL_TYPES[type] << SEPARATOR;
-      idx += dims[1]-3;
-      nFile << buffer[idx+0] << SEPARATOR << buffer[idx+1] << SEPARATOR << buffer[idx+2] << NEWLINE;
+      line.clear();
+
+      const float *row = positions.data();
+      for(hsize_t r = 0; r < positions.rows(); ++r, row += columns)
+      {
+        const auto id = static_cast<uint32_t>(row[0]);
+        const auto type = static_cast<uint32_t>(row[1]);
+        if(!filter.contains(id)) continue;
+
+        ++idCount;
+        const float *xyz = row + columns - 3;
+        importers::appendInt(line, id);
+        line += SEPARATOR;
+        line += CELL_TYPES[type];
+        for(int i = 0; i < 3; ++i)
+        {
+          line += SEPARATOR;
+          importers::appendDouble(line, xyz[i]);
+        }
+        line += NEWLINE;
+      }
+
+      nFile.write(line);
     }
-    else idx += dims[1]-3;
-    idx+=3;
   }
 
-  delete [] buffer;
-  buffer = nullptr;
   dataSet.close();
 
   std::cout << "Write network file: " << NETWORK_FILENAME << " - " << idCount << " ids" << std::endl;
 
-  nFile.flush();
-  nFile.close();
-
-  cFile.open(CONNECTIONS_FILENAME, std::fstream::out|std::fstream::trunc);
+  if(!nFile.close())
+  {
+    std::cerr << "Unable to write output filename: " << NETWORK_FILENAME << std::endl;
+    std::exit(-1);
+  }
 
-  if(cFile.fail())
+  if(!cFile.open(CONNECTIONS_FILENAME))
   {
     std::cerr << "Unable to open output filename: " << CONNECTIONS_FILENAME << std::endl;
     std::exit(-1);
   }
 
-  // write floating point numbers with dot separation no matter the locale
-  cFile.imbue(std::locale(cFile.getloc(), new dotSeparator()));
-
   if(countConnections)
-    cFile << "source" << SEPARATOR << "target" << SEPARATOR << "count" << SEPARATOR << "type" << NEWLINE;
+    line = std::string("source") + SEPARATOR + "target" + SEPARATOR + "count" + SEPARATOR + "type" + NEWLINE;
   else
-    cFile << "source" << SEPARATOR << "target" << SEPARATOR << "type" << NEWLINE;
+    line = std::string("source") + SEPARATOR + "target" + SEPARATOR + "type" + NEWLINE;
+  cFile.write(line);
 
   auto group = sourceFile.openGroup(CONNECTIONS_TAG);
   const unsigned int objNum = group.getNumObjs( );
 
+  auto hasIds = [&filter](const uint32_t id1, const uint32_t id2)
+  {
+    return filter.contains(id1) && filter.contains(id2);
+  };
+
+  auto appendConnection = [&line](const uint32_t id1, const uint32_t id2, const unsigned long *count, const std::string &name)
+  {
+    importers::appendInt(line, id1);
+    line += SEPARATOR;
+    importers::appendInt(line, id2);
+    line += SEPARATOR;
+    if(count)
+    {
+      importers::appendInt(line, *count);
+      line += SEPARATOR;
+    }
+    line += name;
+    line += NEWLINE;
+  };
+
   idCount = 0;
   for( unsigned int i = 0; i < objNum; i++ )
   {
@@ -178,101 +200,80 @@ int main(int argc, char* argv[])
 
     // Open dataset.
     H5::DataSet innerDs = group.openDataSet( name );
-    memset(dims, 0, 2*sizeof(hsize_t));
-    innerDs.getSpace().getSimpleExtentDims( dims );
-    assert(innerDs.getSpace().getSimpleExtentNdims() == 2);
     assert(innerDs.getTypeClass() == H5T_FLOAT);
 
-    if(dims[0] == 0 || dims[1] == 0)
-      continue;
-
-    buffer = new float[dims[0]*dims[1]];
+    importers::HyperslabReader connections(innerDs);
+    const auto columns = connections.columns();
 
-    innerDs.read( reinterpret_cast<void*>(buffer), H5::PredType::IEEE_F32LE );
+    // runs of the same connection are counted across blocks.
+    uint32_t aid1 = std::numeric_limits<uint32_t>::max();
+    uint32_t aid2 = std::numeric_limits<uint32_t>::max();
+    unsigned long cCount = 0;
 
-    if(countConnections)
+    while(connections.next())
     {
-      uint32_t aid1 = std::numeric_limits<uint32_t>::max();
-      uint32_t aid2 = std::numeric_limits<uint32_t>::max();
-      unsigned long cCount = 0;
+      line.clear();
 
-      for(size_t idx = 0; idx < dims[0]*dims[1]; )
+      const float *row = connections.data();
+      for(hsize_t r = 0; r < connections.rows(); ++r, row += columns)
       {
-        auto id1 = static_cast<uint32_t>(buffer[idx]);
-        auto id2 = static_cast<uint32_t>(buffer[idx+1]);
+        const auto id1 = static_cast<uint32_t>(row[0]);
+        const auto id2 = static_cast<uint32_t>(row[1]);
+
+        if(!countConnections)
+        {
+          if(hasIds(id1, id2))
+          {
+            ++idCount;
+            appendConnection(id1, id2, nullptr, name);
+          }
+          continue;
+        }
 
         if(id1 == aid1 && id2 == aid2)
         {
           ++cCount;
           ++idCount;
-          idx += dims[1];
           continue;
         }
-        else
-        {
-          if(aid1 != std::numeric_limits<uint32_t>::max() && (aid1 != id1 || aid2 != id2))
-          {
-            cFile << aid1 << SEPARATOR << aid2 << SEPARATOR << cCount << SEPARATOR << name << NEWLINE;
-            aid1 = std::numeric_limits<uint32_t>::max();
-            aid2 = std::numeric_limits<uint32_t>::max();
-            cCount = 0;
-          }
-        }
 
-        bool hasIds = toFilter.empty();
-        if(!hasIds)
+        if(aid1 != std::numeric_limits<uint32_t>::max())
         {
-          const auto hasId1 = std::find(toFilter.cbegin(), toFilter.cend(), id1) != toFilter.cend();
-          const auto hasId2 = std::find(toFilter.cbegin(), toFilter.cend(), id2) != toFilter.cend();
-          hasIds = (hasId1 && hasId2);
+          appendConnection(aid1, aid2, &cCount, name);
+          aid1 = std::numeric_limits<uint32_t>::max();
+          aid2 = std::numeric_limits<uint32_t>::max();
+          cCount = 0;
         }
 
-        if(hasIds)
+        if(hasIds(id1, id2))
         {
           ++idCount;
           ++cCount;
           aid1 = id1;
           aid2 = id2;
         }
-
-        idx += dims[1];
       }
 
-      if(aid1 != std::numeric_limits<uint32_t>::max())
-        cFile << aid1 << SEPARATOR << aid2 << SEPARATOR << cCount << SEPARATOR << name << NEWLINE;
+      cFile.write(line);
     }
-    else
-    {
-      for(size_t idx = 0; idx < dims[0]*dims[1]; )
-      {
-        auto id1 = static_cast<uint32_t>(buffer[idx]);
-        auto id2 = static_cast<uint32_t>(buffer[idx+1]);
 
-        bool hasIds = toFilter.empty();
-        if(!hasIds)
-        {
-          const auto hasId1 = std::find(toFilter.cbegin(), toFilter.cend(), id1) != toFilter.cend();
-          const auto hasId2 = std::find(toFilter.cbegin(), toFilter.cend(), id2) != toFilter.cend();
-          hasIds = (hasId1 && hasId2);
-        }
-
-        if(hasIds)
-        {
-          ++idCount;
-          cFile << id1 << SEPARATOR << id2 << SEPARATOR << name << NEWLINE;
-        }
-
-        idx += dims[1];
-      }
+    if(countConnections && aid1 != std::numeric_limits<uint32_t>::max())
+    {
+      line.clear();
+      appendConnection(aid1, aid2, &cCount, name);
+      cFile.write(line);
     }
-    delete [] buffer;
+
     innerDs.close();
   }
 
   std::cout << "Write connections file: " << CONNECTIONS_FILENAME << " - " << idCount << " connections" << std::endl;
 
-  cFile.flush();
-  cFile.close();
+  if(!cFile.close())
+  {
+    std::cerr << "Unable to write output filename: " << CONNECTIONS_FILENAME << std::endl;
+    std::exit(-1);
+  }
 
   sourceFile.close();
 
@@ -14,8 +14,12 @@
 #include <algorithm>
 #include <cassert>
 #include <memory>
+#include <string>
 #include <sys/stat.h>
 
+#include "GIDFilter.h"
+#include "HyperslabReader.h"
+
 // should get this from file, not store it here. Use an include
 const std::vector<std::string> CELL_TYPES = { "granule_cell", "glomerulus", "golgi_cell", "purkinje_cell",
                                               "stellate_cell", "basket_cell", "mossy_fibers" };
@@ -24,7 +28,8 @@ void printUsage(const char *filename)
   const std::string name = (filename ? std::string(filename) : "TXTTOCSV");
 
   std::cout << name << " - Generates HDF5 with filtered ids." << '\n';
-  std::cout << "Usage: " << name << " <hdf5_source_file> <hdf5_target_file>" << std::endl;
+  std::cout << "Usage: " << name << " <hdf5_source_file> <hdf5_target_file> [-z <level>]" << '\n';
+  std::cout << "  -z <level>  Compress positions and connections with shuffle and deflate level [1-9]." << std::endl;
   std::exit(-1);
 }
 
@@ -37,6 +42,12 @@ const char MAPS_TAG[]="cells/type_maps";
 const char CONNECTIONS_TAG[]="cells/connections";
 const char MORPHOLOGIES_TAG[] ="morphologies";
 
+// Rows per chunk of the written positions and connections.
+const hsize_t CHUNK_ROWS = 16384;
+
+// Deflate level of the written positions and connections, 0 to not compress.
+unsigned int deflateLevel = 0;
+
 // to store cell ids, type and coordinates. Has to be double to write to HDF5 dataset.
 struct Coords
 {
@@ -52,26 +63,115 @@ struct Coords
 
 auto checkError = [](const int value) { if(value < 0) { std::cerr << "ERROR: " << __FILE__ << ":" << __LINE__ << std::endl; exit(1); } };
 
+/** \class ChunkedDataset
+ * \brief Two dimensional double dataset with unlimited rows, stored in chunks
+ * of CHUNK_ROWS rows (shuffled and deflated if deflateLevel > 0) and written
+ * by appending rows. The dataset is created on the first append, nothing is
+ * written if no rows are appended.
+ *
+ */
+class ChunkedDataset
+{
+  public:
+    ChunkedDataset(hid_t group, const std::string &name, const hsize_t columns)
+    : m_group{group}
+    , m_name{name}
+    , m_columns{columns}
+    , m_dataset{-1}
+    , m_rows{0}
+    {}
+
+    ~ChunkedDataset()
+    { close(); }
+
+    ChunkedDataset(const ChunkedDataset &) = delete;
+    ChunkedDataset &operator=(const ChunkedDataset &) = delete;
+
+    /** \brief Appends rows to the dataset.
+     * \param[in] values count * columns values in row major order.
+     * \param[in] count Number of rows.
+     *
+     */
+    void append(const double *values, const hsize_t count)
+    {
+      if(count == 0) return;
+      if(m_dataset < 0) create();
+
+      const hsize_t dims[2]{m_rows + count, m_columns};
+      auto status = H5Dset_extent(m_dataset, dims);
+      checkError(status);
+
+      const hsize_t offset[2]{m_rows, 0};
+      const hsize_t size[2]{count, m_columns};
+      auto fileSpace = H5Dget_space(m_dataset);
+      status = H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, nullptr, size, nullptr);
+      checkError(status);
+      auto memorySpace = H5Screate_simple(2, size, nullptr);
+
+      status = H5Dwrite(m_dataset, H5T_NATIVE_DOUBLE, memorySpace, fileSpace, H5P_DEFAULT, values);
+      checkError(status);
+
+      H5Sclose(memorySpace);
+      H5Sclose(fileSpace);
+
+      m_rows += count;
+    }
+
+    void close()
+    {
+      if(m_dataset < 0) return;
+
+      auto status = H5Dclose(m_dataset);
+      checkError(status);
+      m_dataset = -1;
+    }
+
+  private:
+    void create()
+    {
+      const hsize_t dims[2]{0, m_columns};
+      const hsize_t maxDims[2]{H5S_UNLIMITED, m_columns};
+      const hsize_t chunk[2]{CHUNK_ROWS, m_columns};
+
+      auto dspace_id = H5Screate_simple(2, dims, maxDims);
+      auto properties = H5Pcreate(H5P_DATASET_CREATE);
+      auto status = H5Pset_chunk(properties, 2, chunk);
+      checkError(status);
+
+      if(deflateLevel > 0)
+      {
+        status = H5Pset_shuffle(properties);
+        checkError(status);
+        status = H5Pset_deflate(properties, deflateLevel);
+        checkError(status);
+      }
+
+      m_dataset = H5Dcreate2(m_group, m_name.c_str(), H5T_NATIVE_DOUBLE, dspace_id, H5P_DEFAULT, properties, H5P_DEFAULT);
+      checkError(m_dataset);
+
+      H5Pclose(properties);
+      H5Sclose(dspace_id);
+    }
+
+    hid_t       m_group;   /** parent group.          */
+    std::string m_name;    /** dataset name.          */
+    hsize_t     m_columns; /** values per row.        */
+    hid_t       m_dataset; /** dataset, -1 if none.   */
+    hsize_t     m_rows;    /** rows written.          */
+};
+
 void H5WritePositions(hid_t to, const std::vector<Coords> &coords)
 {
   if(coords.empty()) return;
 
-  hsize_t dims[2]{coords.size(), 5};
-
-  // Create a dataset
   auto group_id = H5Gopen2(to, "/cells", H5P_DEFAULT);
-  auto dspace_id = H5Screate_simple(2, dims, NULL);
-  auto dset_id = H5Dcreate2(group_id, "positions", H5T_NATIVE_DOUBLE, dspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-
-  // Write the data
-  auto status = H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, coords.data());
-  checkError(status);
 
-  // Close dataset after writing
-  status = H5Dclose(dset_id);
-  checkError(status);
+  {
+    ChunkedDataset positions(group_id, "positions", 5);
+    positions.append(&coords.front().id, coords.size());
+  }
 
-  status = H5Gclose(group_id);
+  auto status = H5Gclose(group_id);
   checkError(status);
 }
 
@@ -130,50 +230,67 @@ void H5writeMap(hid_t to, std::string name, std::vector<uint32_t> &gids)
   checkError(status);
 }
 
-void H5writeConnections(hid_t to, std::string name, std::vector<std::pair<uint32_t, uint32_t>> connections)
+/** \brief Copies the connections of the source dataset between kept GIDs
+ * to a dataset of the same name, streaming blocks from one to the other.
+ *
+ */
+void H5writeConnections(hid_t to, const H5::DataSet &source, const std::string &name, const importers::GIDFilter &filter)
 {
-  std::vector<std::pair<double, double>> others;
-  for(size_t i = 0; i < connections.size(); ++i)
-  {
-    auto value = connections.at(i);
+  auto group_id = H5Gopen2(to, "/cells/connections", H5P_DEFAULT);
 
-    if(!toFilter.empty())
+  {
+    ChunkedDataset target(group_id, name, 2);
+    // the blocks are written between reads, HDF5 can't be used from two
+    // threads at once.
+    importers::HyperslabReader reader(source, importers::DEFAULT_HYPERSLAB_BYTES, false);
+    const auto columns = reader.columns();
+
+    std::vector<double> kept;
+    while(reader.next())
     {
-      auto it1 = std::find(toFilter.cbegin(), toFilter.cend(), value.first);
-      auto it2 = std::find(toFilter.cbegin(), toFilter.cend(), value.second);
-      if(toFilter.cend() == it1 || toFilter.cend() == it2)
+      kept.clear();
+
+      const float *row = reader.data();
+      for(hsize_t r = 0; r < reader.rows(); ++r, row += columns)
       {
-        continue;
+        const auto sou = static_cast<uint32_t>(row[0]);
+        const auto tar = static_cast<uint32_t>(row[1]);
+
+        if(filter.contains(sou) && filter.contains(tar))
+        {
+          kept.push_back(sou);
+          kept.push_back(tar);
+        }
       }
-    }
 
-    others.emplace_back(value.first, value.second);
+      target.append(kept.data(), kept.size() / 2);
+    }
   }
 
-  if(others.empty()) return;
-
-  hsize_t dims[2]{others.size(), 2};
-
-  auto group_id = H5Gopen2(to, "/cells/connections", H5P_DEFAULT);
-  // Create a dataset
-  auto dspace_id = H5Screate_simple(2, dims, NULL);
-  auto dset_id = H5Dcreate2( group_id, name.c_str(), H5T_NATIVE_DOUBLE, dspace_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-
-  // Write the data
-  auto status = H5Dwrite(dset_id, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, others.data());
-  checkError(status);
-
-  // Close dataset after writing
-  status = H5Dclose(dset_id);
-  checkError(status);
-
-  status = H5Gclose(group_id);
+  auto status = H5Gclose(group_id);
   checkError(status);
 }
 
 int main(int argc, char* argv[])
 {
-  if(argc < 3) printUsage(argv[0]);
+  if(argc != 3 && argc != 5) printUsage(argv[0]);
+
+  if(argc == 5)
+  {
+    const std::string option = argv[3];
+    const int level = std::atoi(argv[4]);
+    if(option != "-z" || level < 1 || level > 9) printUsage(argv[0]);
+
+    if(!H5Zfilter_avail(H5Z_FILTER_DEFLATE) || !H5Zfilter_avail(H5Z_FILTER_SHUFFLE))
+    {
+      std::cerr << "HDF5 library has no deflate or shuffle filter, unable to compress." << std::endl;
+      exit(-1);
+    }
+
+    deflateLevel = static_cast<unsigned int>(level);
+  }
+
+  const importers::GIDFilter filter(toFilter);
 
   struct stat buf;
   if(stat(argv[1], &buf) != 0)
@@ -230,39 +347,30 @@ int main(int argc, char* argv[])
   auto dataSet = sourceFile.openDataSet(CELLS_TAG);
 
   hsize_t dims[2];
-  dataSet.getSpace().getSimpleExtentDims( dims );
   assert(dataSet.getSpace().getSimpleExtentNdims() == 2);
   assert(dataSet.getTypeClass() == H5T_FLOAT);
 
-  auto buffer = new float[dims[0]*dims[1]];
-
   // load positions
-  dataSet.read( reinterpret_cast<void*>(buffer), H5::PredType::IEEE_F32LE );
-
   std::vector<Coords> subset;
-  std::vector<uint32_t> types;
-  for(size_t idx = 0; idx < dims[0]*dims[1]; )
   {
-    const auto id = static_cast<uint32_t>(buffer[idx]);
-    bool hasId = toFilter.empty();
-    if(!hasId)
-    {
-      auto it = std::find(toFilter.cbegin(), toFilter.cend(), id);
-      hasId = it != toFilter.cend();
-    }
+    importers::HyperslabReader positions(dataSet);
+    const auto columns = positions.columns();
 
-    if(hasId)
+    while(positions.next())
     {
-      const auto type = static_cast<uint32_t>(buffer[idx+1]);
-      idx += dims[1]-3;
-      subset.emplace_back(id, type, buffer[idx+0],buffer[idx+1],buffer[idx+2]);
-      idx+=3;
+      const float *row = positions.data();
+      for(hsize_t r = 0; r < positions.rows(); ++r, row += columns)
+      {
+        const auto id = static_cast<uint32_t>(row[0]);
+        if(!filter.contains(id)) continue;
+
+        const auto type = static_cast<uint32_t>(row[1]);
+        const float *xyz = row + columns - 3;
+        subset.emplace_back(id, type, xyz[0], xyz[1], xyz[2]);
+      }
     }
   }
 
-  delete [] buffer;
-  buffer = nullptr;
-
   dataSet.close();
 
   auto sortCoords = [](Coords &lhs, Coords &rhs){ return lhs.id < rhs.id; };
@@ -300,26 +408,18 @@ int main(int argc, char* argv[])
       if(dims[0] == 0)
         continue;
 
-      buffer = new float[dims[0]];
+      std::vector<float> buffer(dims[0]);
 
-      innerDs.read( reinterpret_cast<void*>(buffer), H5::PredType::IEEE_F32LE );
+      innerDs.read( reinterpret_cast<void*>(buffer.data()), H5::PredType::IEEE_F32LE );
 
       std::vector<uint32_t> gids;
-      for(size_t idx = 0; idx < dims[0]; )
+      for(size_t idx = 0; idx < dims[0]; ++idx)
       {
         const auto id = static_cast<uint32_t>(buffer[idx]);
-        bool hasId = toFilter.empty();
-        if(!hasId)
-          hasId = std::find(toFilter.cbegin(), toFilter.cend(), id) != toFilter.cend();
-
-        if(hasId)
+        if(filter.contains(id))
           gids.emplace_back(id);
-
-        ++idx;
       }
 
-      delete [] buffer;
-      buffer = nullptr;
       const auto groupName = "group " + name;
       innerDs.close();
 
@@ -358,37 +458,9 @@ int main(int argc, char* argv[])
       if(dims[0] == 0 || dims[1] == 0)
         continue;
 
-      buffer = new float[dims[0]*dims[1]];
+      H5writeConnections(targetFile, innerDs, name, filter);
 
-      innerDs.read( reinterpret_cast<void*>(buffer), H5::PredType::IEEE_F32LE );
-
-      std::vector<std::pair<uint32_t, uint32_t>> connections;
-
-      std::vector<uint32_t> gids;
-      for(size_t idx = 0; idx < dims[0]*dims[1]; )
-      {
-        auto sou = static_cast<uint32_t>(buffer[idx]);
-        auto tar = static_cast<uint32_t>(buffer[idx+1]);
-        bool hasIds = toFilter.empty();
-        if(!hasIds)
-        {
-          auto it1 = std::find(toFilter.cbegin(), toFilter.cend(), sou);
-          auto it2 = std::find(toFilter.cbegin(), toFilter.cend(), tar);
-
-          hasIds = (it1 != toFilter.cend() && it2 != toFilter.cend());
-        }
-
-        if(hasIds)
-          connections.emplace_back(sou, tar);
-
-        idx += dims[1];
-      }
-      delete [] buffer;
-      buffer = nullptr;
-      const auto groupName = "connection " + name;
       innerDs.close();
-
-      H5writeConnections(targetFile, name, connections);
     }
 
     group.close();
@@ -6,29 +6,19 @@
  */
 
 // C++
-#include <iostream>
-#include <fstream>
-#include <random>
-#include <locale>
-#include <sys/stat.h>
-#include <dirent.h>
 #include <algorithm>
-#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <string>
 
-// Qt5
-#include <QString>
-#include <QStringList>
+// Importers
+#include "ImporterIO.h"
 
 std::string NETWORK_FILENAME = "H5_network.csv";
 std::string ACTiVITY_FILENAME = "H5_activity.csv";
 
 const double TIME_INTERVAL = 0.1;
 
-struct dotSeparator: std::numpunct<char>
-{
-    char do_decimal_point() const { return '.'; }
-};
-
 template<class T> void ignore( const T& ) { }
 
 void printUsage(const char *filename)
@@ -41,73 +31,101 @@ void printUsage(const char *filename)
   std::exit(-1);
 }
 
+/** \brief Parses the records of a chunk of lines "id,discarded,x,y,z" into
+ * CSV network lines "id,x,y,z".
+ *
+ */
+bool parseRecords(const char *begin, const char *end, std::string &output)
+{
+  const char SEPARATOR = ',';
+  output.clear();
+
+  while(begin != end)
+  {
+    const char *line = begin;
+    const char *last = importers::takeLine(begin, end);
+
+    const char *it = importers::skip(line, last, " \t");
+    if(it == last) continue;
+
+    long long id = 0;
+    double coords[3]{0.,0.,0.};
+
+    bool ok = importers::parseInt(it, last, id);
+    it = importers::skip(it, last, " \t");
+    ok = ok && it != last && *it++ == SEPARATOR;
+
+    // discarded field.
+    while(ok && it != last && *it != SEPARATOR) ++it;
+    ok = ok && it != last && *it++ == SEPARATOR;
+
+    for(int i = 0; ok && i < 3; ++i)
+    {
+      it = importers::skip(it, last, " \t");
+      ok = importers::parseDouble(it, last, coords[i]);
+      it = importers::skip(it, last, " \t");
+      if(i < 2) ok = ok && it != last && *it++ == SEPARATOR;
+    }
+
+    if(!ok)
+    {
+      std::cerr << "ERROR: Unable to parse line: " << std::string(line, last) << std::endl;
+      return false;
+    }
+
+    importers::appendInt(output, id);
+    for(int i = 0; i < 3; ++i)
+    {
+      output += SEPARATOR;
+      // coordinates are single precision, written as such.
+      importers::appendDouble(output, static_cast<float>(coords[i]));
+    }
+    output += '\n';
+  }
+
+  return true;
+}
+
 int main(int argc, char* argv[])
 {
   if(argc < 2) printUsage(argv[0]);
 
-  std::ifstream dataFile;
-  dataFile.open(argv[1], std::fstream::in);
+  const importers::MappedFile dataFile(argv[1]);
 
-  if(dataFile.fail())
+  if(!dataFile.isOpen())
   {
     std::cerr << "ERROR: Unable to open input filename: " << argv[1] << std::endl;
     std::exit(-1);
   }
 
-  std::ofstream nFile;
-  nFile.open(NETWORK_FILENAME, std::fstream::out|std::fstream::trunc);
+  importers::BufferedWriter nFile;
 
-  if(nFile.fail())
+  if(!nFile.open(NETWORK_FILENAME))
   {
     std::cerr << "ERROR: Unable to open output filename: " << NETWORK_FILENAME << std::endl;
     std::exit(-1);
   }
 
-  // write floating point numbers with dot separation no matter the locale
-  nFile.imbue(std::locale(nFile.getloc(), new dotSeparator()));
-
-  const char SEPARATOR = ',';
-
-  unsigned int count = 0;
-  unsigned int id = 0;
   unsigned int idsCount = 0;
-  float coords[3]{0.,0.,0.};
-  std::string content;
-  while(dataFile.good() && std::getline(dataFile, content, SEPARATOR))
+  auto writeRecords = [&nFile, &idsCount](const std::string &records)
   {
-    if(!content.empty())
-    {
-      switch(count)
-      {
-        case 0:
-          id = std::stoi(content);
-          break;
-        case 1:
-          break; // discard
-        case 2:
-        case 3:
-        case 4:
-          coords[count-2] = std::stof(content);
-          break;
-      }
-    }
+    nFile.write(records);
+    idsCount += std::count(records.cbegin(), records.cend(), '\n');
+  };
 
-    ++count;
-    if(count == 5)
-    {
-      count = 0;
-      nFile << id << SEPARATOR << coords[0] << SEPARATOR <<  coords[1] << SEPARATOR <<  coords[2] << std::endl;
-      ++idsCount;
-    }
+  if(!importers::parseChunks<std::string>(dataFile.data(), dataFile.size(), parseRecords, writeRecords))
+  {
+    std::cerr << "ERROR: Unable to parse input filename: " << argv[1] << std::endl;
+    std::exit(-1);
+  }
 
-    if(dataFile.eof()) break;
+  if(!nFile.close())
+  {
+    std::cerr << "ERROR: Unable to write output filename: " << NETWORK_FILENAME << std::endl;
+    std::exit(-1);
   }
-  dataFile.close();
 
   std::cout << "Write network file: " << NETWORK_FILENAME << " - " << idsCount << " ids" << std::endl;
 
-  nFile.flush();
-  nFile.close();
-
   return 0;
 }
@@ -251,6 +251,7 @@ MainWindow::openSubsetEventFile( const std::string& filePath , bool append )
   QApplication::setOverrideCursor( Qt::WaitCursor );
 
   if ( !append ) _subsetEventManager->clear( );
+  _correlationComputer = nullptr;
 
   _summary->clearEvents( );
 
@@ -966,22 +967,23 @@ void MainWindow::calculateCorrelations( void )
 {
   if ( !_subsetEventManager ) return;
 
-  // TODO: mirar @gael.
-  auto pdata = dynamic_cast<simil::SpikeData*>(_player->data( ).get( ));
-  visimpl::CorrelationComputer cc( pdata );
+  if ( !_correlationComputer )
+  {
+    // TODO: mirar @gael.
+    auto pdata = dynamic_cast<simil::SpikeData*>(_player->data( ).get( ));
+    _correlationComputer =
+      std::make_shared< visimpl::CorrelationComputer >( pdata );
+  }
+
+  auto& cc = *_correlationComputer;
 
   const auto eventNames = _subsetEventManager->eventNames( );
 
   constexpr double deltaTime = 0.125;
 
-  cc.configureEvents( eventNames , deltaTime );
-
-  auto correlateSubsets = [ &eventNames , &cc ]( const std::string& event )
-  {
-    cc.correlateSubset( event , eventNames , deltaTime , 2600 , 2900 );
-  };
-  std::for_each( _correlations.cbegin( ) , _correlations.cend( ) ,
-                 correlateSubsets );
+  // One spike pass for every subset not in the cache, then all the pairs in
+  // parallel. The events are binned on the first call.
+  cc.correlateAll( _correlations , eventNames , deltaTime , 2600 , 2900 );
 
   const auto names = cc.correlationNames( );
 
@@ -1145,6 +1147,10 @@ void stackviz::MainWindow::loadData( const simil::TDataType type ,
            SLOT( setNetwork( unsigned int )));
   connect( m_loader.get( ) , SIGNAL( spikes( unsigned int )) , m_loaderDialog ,
            SLOT( setSpikesValue( unsigned int )));
+  connect( m_loader.get( ) , SIGNAL( bytesRead( qulonglong , qulonglong )) ,
+           m_loaderDialog , SLOT( setBytesRead( qulonglong , qulonglong )));
+  connect( m_loaderDialog , SIGNAL( cancelRequested( bool )) ,
+           m_loader.get( ) , SLOT( cancel( bool )));
 
   m_loader->start( );
 }
@@ -1210,6 +1216,7 @@ void stackviz::MainWindow::onLoadFinished( )
       closeLoadingDialog( );
       _player->Clear( );
       _subsetEventManager = nullptr;
+      _correlationComputer = nullptr;
       QApplication::restoreOverrideCursor( );
 
       const auto message = QString::fromStdString( errors );
@@ -1219,6 +1226,17 @@ void stackviz::MainWindow::onLoadFinished( )
       m_loader = nullptr;
       return;
     }
+
+    // Nothing was loaded, the loader already released the data.
+    if ( m_loader->cancelled( ))
+    {
+      closeLoadingDialog( );
+      QApplication::restoreOverrideCursor( );
+      m_loader = nullptr;
+
+      showStatusBarMessage( tr( "Loading cancelled." ));
+      return;
+    }
   }
 
   const auto dataType = m_loader->type( );
@@ -1274,6 +1292,7 @@ void stackviz::MainWindow::onLoadFinished( )
   }
 
   _subsetEventManager = _player->data( )->subsetsEvents( );
+  _correlationComputer = nullptr;
 
   updateUIonOpen( m_subsetEventFile );
 
@@ -1309,6 +1328,9 @@ void stackviz::MainWindow::sendZeroEQPlaybackOperation( const unsigned int op )
 
 void stackviz::MainWindow::onDataUpdated( )
 {
+  // New spikes, the cached correlations are stale.
+  _correlationComputer = nullptr;
+
   const float tBegin = _player->startTime( );
   const float tEnd = _player->endTime( );
   const float tCurrent = _player->currentTime( );
@@ -1501,6 +1523,7 @@ void stackviz::MainWindow::closeData( )
   }
 
   _correlations.clear( );
+  _correlationComputer = nullptr;
 
   _ui->actionCloseData->setEnabled( false );
   _dockSimulation->setEnabled( false );
@@ -1548,6 +1571,8 @@ void stackviz::MainWindow::loadRESTData(
            m_loaderDialog , SLOT( setNetwork( unsigned int )));
   connect( m_loader.get( ) , SIGNAL( spikes( unsigned int )) ,
            m_loaderDialog , SLOT( setSpikesValue( unsigned int )));
+  connect( m_loaderDialog , SIGNAL( cancelRequested( bool )) ,
+           m_loader.get( ) , SLOT( cancel( bool )));
 
   m_loader->start( );
 }
@@ -215,6 +215,11 @@ namespace stackviz
 
     std::vector< std::string > _correlations;
 
+    /** Correlations of the loaded data, kept to reuse its cache. Reset when
+     * the data or the subsets change.
+     */
+    std::shared_ptr< visimpl::CorrelationComputer > _correlationComputer;
+
     std::string m_subsetEventFile;
     std::shared_ptr<LoaderThread> m_loader;
     LoadingDialog *m_loaderDialog;
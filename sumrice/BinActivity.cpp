@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "BinActivity.h"
+
+#include <bitset>
+
+namespace visimpl
+{
+  namespace
+  {
+    inline size_t popcount( BinActivity::Word word )
+    {
+#if defined( __GNUC__ ) || defined( __clang__ )
+      // A single POPCNT instruction when the target supports it.
+      return static_cast< size_t >( __builtin_popcountll( word ));
+#else
+      return std::bitset< BinActivity::WORD_BITS >( word ).count( );
+#endif
+    }
+
+    // Bits [first, last) of a word, last being at most WORD_BITS.
+    inline BinActivity::Word bitRange( size_t first , size_t last )
+    {
+      const auto high = last >= BinActivity::WORD_BITS ?
+                        ~BinActivity::Word( 0 ) :
+                        ( BinActivity::Word( 1 ) << last ) - 1;
+      return high & ~(( BinActivity::Word( 1 ) << first ) - 1 );
+    }
+
+    template< typename Combine >
+    size_t countRange( size_t firstBin , size_t lastBin , Combine combine )
+    {
+      if ( firstBin >= lastBin ) return 0;
+
+      const size_t bits = BinActivity::WORD_BITS;
+      const size_t firstWord = firstBin / bits;
+      const size_t lastWord = ( lastBin - 1 ) / bits;
+
+      if ( firstWord == lastWord )
+        return popcount( combine( firstWord ) &
+                         bitRange( firstBin % bits , lastBin - lastWord * bits ));
+
+      size_t result = popcount( combine( firstWord ) &
+                                bitRange( firstBin % bits , bits ));
+
+      // Plain loop over whole words, left for the compiler to vectorize.
+      for ( size_t i = firstWord + 1; i < lastWord; ++i )
+        result += popcount( combine( i ));
+
+      result += popcount( combine( lastWord ) &
+                          bitRange( 0 , lastBin - lastWord * bits ));
+
+      return result;
+    }
+  }
+
+  constexpr size_t BinActivity::WORD_BITS;
+
+  BinActivity::BinActivity( )
+    : _rows( 0 )
+    , _bins( 0 )
+    , _wordsPerRow( 0 )
+    , _words( )
+  { }
+
+  BinActivity::BinActivity( size_t rows_ , size_t bins_ )
+    : BinActivity( )
+  {
+    reset( rows_ , bins_ );
+  }
+
+  void BinActivity::reset( size_t rows_ , size_t bins_ )
+  {
+    _rows = rows_;
+    _bins = bins_;
+    _wordsPerRow = ( bins_ + WORD_BITS - 1 ) / WORD_BITS;
+    _words.assign( _rows * _wordsPerRow , 0 );
+  }
+
+  size_t BinActivity::rows( ) const
+  {
+    return _rows;
+  }
+
+  size_t BinActivity::bins( ) const
+  {
+    return _bins;
+  }
+
+  size_t BinActivity::wordsPerRow( ) const
+  {
+    return _wordsPerRow;
+  }
+
+  bool BinActivity::test( size_t row_ , size_t bin ) const
+  {
+    return ( _words[ row_ * _wordsPerRow + bin / WORD_BITS ] >>
+             ( bin % WORD_BITS )) & 1;
+  }
+
+  const BinActivity::Word* BinActivity::row( size_t row_ ) const
+  {
+    return _words.data( ) + row_ * _wordsPerRow;
+  }
+
+  BinActivity::Word* BinActivity::row( size_t row_ )
+  {
+    return _words.data( ) + row_ * _wordsPerRow;
+  }
+
+  size_t BinActivity::count( const Word* row_ ,
+                             size_t firstBin ,
+                             size_t lastBin )
+  {
+    return countRange( firstBin , lastBin ,
+                       [ row_ ]( size_t i ){ return row_[ i ]; } );
+  }
+
+  size_t BinActivity::countBoth( const Word* a ,
+                                 const Word* b ,
+                                 size_t firstBin ,
+                                 size_t lastBin )
+  {
+    return countRange( firstBin , lastBin ,
+                       [ a , b ]( size_t i ){ return a[ i ] & b[ i ]; } );
+  }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_BIN_ACTIVITY_H__
+#define __VISIMPL_BIN_ACTIVITY_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Activity of a set of rows (neurons or events) along a series of time
+   * bins, as packed bit rows: bit b of row r tells if r was active in bin b.
+   *
+   * Contingency counts between two rows are AND / AND NOT of their words
+   * followed by a population count, 64 bins at a time.
+   */
+  class SUMRICE_API BinActivity
+  {
+  public:
+
+    typedef uint64_t Word;
+
+    static constexpr size_t WORD_BITS = 64;
+
+    BinActivity( );
+
+    BinActivity( size_t rows , size_t bins );
+
+    /**
+     * Resizes the matrix, every bin of every row becomes inactive.
+     */
+    void reset( size_t rows , size_t bins );
+
+    size_t rows( ) const;
+
+    size_t bins( ) const;
+
+    size_t wordsPerRow( ) const;
+
+    void set( size_t row , size_t bin )
+    {
+      _words[ row * _wordsPerRow + bin / WORD_BITS ] |=
+        Word( 1 ) << ( bin % WORD_BITS );
+    }
+
+    bool test( size_t row , size_t bin ) const;
+
+    const Word* row( size_t row ) const;
+
+    Word* row( size_t row );
+
+    /**
+     * Active bins of a row in [firstBin, lastBin).
+     */
+    static size_t count( const Word* row ,
+                         size_t firstBin ,
+                         size_t lastBin );
+
+    /**
+     * Bins in [firstBin, lastBin) active in both rows.
+     */
+    static size_t countBoth( const Word* a ,
+                             const Word* b ,
+                             size_t firstBin ,
+                             size_t lastBin );
+
+  protected:
+
+    size_t _rows;
+    size_t _bins;
+    size_t _wordsPerRow;
+    std::vector< Word > _words;
+  };
+}
+
+#endif /* __VISIMPL_BIN_ACTIVITY_H__ */
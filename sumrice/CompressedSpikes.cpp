@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "CompressedSpikes.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace visimpl
+{
+  namespace
+  {
+    // Unsigned keys ordered as the float times they come from, so sorted
+    // times give non-negative key deltas. -0 is stored as 0.
+    inline uint32_t timeKey( float time )
+    {
+      if ( time == 0.0f ) time = 0.0f;
+
+      uint32_t bits;
+      std::memcpy( &bits , &time , sizeof( bits ));
+      return ( bits & 0x80000000u ) ? ~bits : ( bits | 0x80000000u );
+    }
+
+    inline float keyTime( uint32_t key )
+    {
+      const uint32_t bits = ( key & 0x80000000u ) ? ( key & 0x7FFFFFFFu ) :
+                                                    ~key;
+      float time;
+      std::memcpy( &time , &bits , sizeof( time ));
+      return time;
+    }
+
+    inline uint32_t bitWidth( uint32_t value )
+    {
+      uint32_t width = 0;
+      for ( ; value != 0; value >>= 1 ) ++width;
+      return width;
+    }
+
+    inline void writeVarint( std::vector< uint8_t >& bytes , uint32_t value )
+    {
+      for ( ; value >= 0x80u; value >>= 7 )
+        bytes.push_back( static_cast< uint8_t >( value | 0x80u ));
+      bytes.push_back( static_cast< uint8_t >( value ));
+    }
+
+    inline uint32_t readVarint( const uint8_t*& bytes )
+    {
+      uint32_t value = *bytes & 0x7Fu;
+      for ( unsigned int shift = 7; *bytes++ & 0x80u; shift += 7 )
+        value |= static_cast< uint32_t >( *bytes & 0x7Fu ) << shift;
+      return value;
+    }
+
+    inline void writeBits( std::vector< uint64_t >& words , size_t position ,
+                           uint32_t width , uint32_t value )
+    {
+      if ( width == 0 ) return;
+
+      const size_t word = position >> 6;
+      const unsigned int shift = position & 63;
+      words[ word ] |= static_cast< uint64_t >( value ) << shift;
+      if ( shift + width > 64 )
+        words[ word + 1 ] |= static_cast< uint64_t >( value ) >> ( 64 - shift );
+    }
+
+    inline uint32_t readBits( const uint64_t* words , size_t position ,
+                              uint32_t width )
+    {
+      if ( width == 0 ) return 0;
+
+      const size_t word = position >> 6;
+      const unsigned int shift = position & 63;
+      uint64_t value = words[ word ] >> shift;
+      if ( shift + width > 64 )
+        value |= words[ word + 1 ] << ( 64 - shift );
+
+      return static_cast< uint32_t >( value &
+                                      (( uint64_t( 1 ) << width ) - 1 ));
+    }
+  }
+
+  constexpr size_t CompressedSpikes::DEFAULT_BLOCK_SPIKES;
+
+  CompressedSpikes::const_iterator::const_iterator( )
+    : _owner( nullptr )
+    , _index( 0 )
+    , _block( 0 )
+    , _blockEnd( 0 )
+    , _time( nullptr )
+    , _gidBit( 0 )
+    , _key( 0 )
+    , _spike( 0.0f , 0 )
+  { }
+
+  CompressedSpikes::const_iterator::const_iterator(
+    const CompressedSpikes* owner , size_t block )
+    : _owner( owner )
+    , _index( owner->_size )
+    , _block( block )
+    , _blockEnd( owner->_size )
+    , _time( nullptr )
+    , _gidBit( 0 )
+    , _key( 0 )
+    , _spike( 0.0f , 0 )
+  {
+    if ( block >= owner->_blocks.size( )) return;
+
+    const auto& header = owner->_blocks[ block ];
+    _index = header.first;
+    _blockEnd = owner->blockFirst( block + 1 );
+    _time = owner->_times.data( ) + header.timeOffset;
+    _gidBit = header.gidOffset;
+    _key = header.firstKey;
+    _decode( );
+  }
+
+  CompressedSpikes::const_iterator&
+  CompressedSpikes::const_iterator::operator++( )
+  {
+    if ( ++_index < _blockEnd )
+    {
+      _key += readVarint( _time );
+      _decode( );
+    }
+    else if ( _index < _owner->_size )
+    {
+      *this = const_iterator( _owner , _block + 1 );
+    }
+
+    return *this;
+  }
+
+  CompressedSpikes::const_iterator
+  CompressedSpikes::const_iterator::operator++( int )
+  {
+    const_iterator previous = *this;
+    ++( *this );
+    return previous;
+  }
+
+  void CompressedSpikes::const_iterator::_decode( )
+  {
+    const auto& header = _owner->_blocks[ _block ];
+    _spike.first = keyTime( _key );
+    _spike.second = header.gidBase + readBits( _owner->_gids.data( ) ,
+                                               _gidBit , header.gidBits );
+    _gidBit += header.gidBits;
+  }
+
+  CompressedSpikes::CompressedSpikes( size_t blockSpikes )
+    : _blockSpikes( std::max< size_t >( blockSpikes , 1 ))
+    , _size( 0 )
+  { }
+
+  CompressedSpikes::CompressedSpikes( const simil::Spikes& spikes ,
+                                      size_t blockSpikes )
+    : CompressedSpikes( blockSpikes )
+  {
+    assign( spikes );
+  }
+
+  void CompressedSpikes::clear( )
+  {
+    _size = 0;
+    _blocks.clear( );
+    _times.clear( );
+    _gids.clear( );
+  }
+
+  void CompressedSpikes::assign( const simil::Spikes& spikes )
+  {
+    clear( );
+    append( spikes.cbegin( ) , spikes.cend( ));
+
+    _blocks.shrink_to_fit( );
+    _times.shrink_to_fit( );
+    _gids.shrink_to_fit( );
+  }
+
+  void CompressedSpikes::append( simil::SpikesCIter first ,
+                                 simil::SpikesCIter last )
+  {
+    size_t bit = _blocks.empty( ) ? 0 :
+                 _blocks.back( ).gidOffset +
+                 ( _size - _blocks.back( ).first ) * _blocks.back( ).gidBits;
+    uint32_t previous = _blocks.empty( ) ? 0 : _blocks.back( ).lastKey;
+
+    while ( first != last )
+    {
+      const auto blockEnd = first + std::min< ptrdiff_t >(
+        last - first , static_cast< ptrdiff_t >( _blockSpikes ));
+
+      Block block;
+      block.first = _size;
+      block.timeOffset = _times.size( );
+      block.gidOffset = bit;
+      block.firstKey = timeKey( first->first );
+
+      uint32_t minGid = first->second;
+      uint32_t maxGid = first->second;
+      for ( auto spike = first; spike != blockEnd; ++spike )
+      {
+        minGid = std::min( minGid , spike->second );
+        maxGid = std::max( maxGid , spike->second );
+      }
+      block.gidBase = minGid;
+      block.gidBits = bitWidth( maxGid - minGid );
+
+      const size_t count = blockEnd - first;
+      _gids.resize(( bit + count * block.gidBits ) / 64 + 2 , 0 );
+
+      for ( auto spike = first; spike != blockEnd; ++spike )
+      {
+        const uint32_t key = timeKey( spike->first );
+        if ( key < previous )
+          throw std::invalid_argument( "Spikes must be sorted by time." );
+
+        if ( spike != first ) writeVarint( _times , key - previous );
+        previous = key;
+
+        writeBits( _gids , bit , block.gidBits , spike->second - minGid );
+        bit += block.gidBits;
+      }
+
+      block.lastKey = previous;
+      _blocks.push_back( block );
+      _size += count;
+      first = blockEnd;
+    }
+  }
+
+  size_t CompressedSpikes::size( ) const
+  {
+    return _size;
+  }
+
+  bool CompressedSpikes::empty( ) const
+  {
+    return _size == 0;
+  }
+
+  size_t CompressedSpikes::bytes( ) const
+  {
+    return _times.size( ) + _gids.size( ) * sizeof( uint64_t ) +
+           _blocks.size( ) * sizeof( Block );
+  }
+
+  size_t CompressedSpikes::blockSpikes( ) const
+  {
+    return _blockSpikes;
+  }
+
+  size_t CompressedSpikes::blocks( ) const
+  {
+    return _blocks.size( );
+  }
+
+  size_t CompressedSpikes::blockFirst( size_t block ) const
+  {
+    return block < _blocks.size( ) ? _blocks[ block ].first : _size;
+  }
+
+  float CompressedSpikes::blockStartTime( size_t block ) const
+  {
+    return keyTime( _blocks[ block ].firstKey );
+  }
+
+  float CompressedSpikes::blockEndTime( size_t block ) const
+  {
+    return keyTime( _blocks[ block ].lastKey );
+  }
+
+  CompressedSpikes::const_iterator CompressedSpikes::begin( ) const
+  {
+    return const_iterator( this , 0 );
+  }
+
+  CompressedSpikes::const_iterator CompressedSpikes::end( ) const
+  {
+    return const_iterator( this , _blocks.size( ));
+  }
+
+  CompressedSpikes::const_iterator
+  CompressedSpikes::blockBegin( size_t block ) const
+  {
+    return const_iterator( this , block );
+  }
+
+  void CompressedSpikes::decodeBlock( size_t block ,
+                                      simil::Spikes& result ) const
+  {
+    const auto last = blockBegin( block + 1 );
+    result.reserve( result.size( ) + blockFirst( block + 1 ) -
+                    blockFirst( block ));
+    for ( auto spike = blockBegin( block ); spike != last; ++spike )
+      result.push_back( *spike );
+  }
+
+  simil::Spikes CompressedSpikes::decompress( ) const
+  {
+    simil::Spikes result;
+    result.reserve( _size );
+    for ( size_t block = 0; block < _blocks.size( ); ++block )
+      decodeBlock( block , result );
+
+    return result;
+  }
+
+  CompressedSpikes::const_iterator
+  CompressedSpikes::lowerBound( float time ) const
+  {
+    const uint32_t key = timeKey( time );
+
+    // The first block ending at or after the time holds the bound.
+    const auto block = std::partition_point(
+      _blocks.cbegin( ) , _blocks.cend( ) ,
+      [ key ]( const Block& b ){ return b.lastKey < key; } );
+
+    auto spike = blockBegin( block - _blocks.cbegin( ));
+    const auto last = end( );
+    while ( spike != last && spike->first < time ) ++spike;
+
+    return spike;
+  }
+
+  CompressedSpikes::const_iterator
+  CompressedSpikes::upperBound( float time ) const
+  {
+    const uint32_t key = timeKey( time );
+
+    const auto block = std::partition_point(
+      _blocks.cbegin( ) , _blocks.cend( ) ,
+      [ key ]( const Block& b ){ return b.lastKey <= key; } );
+
+    auto spike = blockBegin( block - _blocks.cbegin( ));
+    const auto last = end( );
+    while ( spike != last && !( time < spike->first )) ++spike;
+
+    return spike;
+  }
+
+  CompressedSpikes::Range
+  CompressedSpikes::spikesBetween( float startTime , float endTime ) const
+  {
+    const auto first = lowerBound( startTime );
+    if ( !( startTime < endTime )) return std::make_pair( first , first );
+
+    return std::make_pair( first , lowerBound( endTime ));
+  }
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_COMPRESSED_SPIKES_H__
+#define __VISIMPL_COMPRESSED_SPIKES_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Lossless compressed copy of a time sorted spike report, for recordings
+   * too large to keep as simil::Spikes (8 bytes per spike).
+   *
+   * Spikes are split into blocks of up to blockSpikes spikes. The times of
+   * a block are stored as varint deltas of their order preserving integer
+   * keys, and its GIDs bit-packed relative to the smallest GID of the
+   * block. Dense reports take 2 to 4 bytes per spike.
+   *
+   * Spikes are decoded on the fly by forward iterators, the block headers
+   * hold the time range of every block so searches and histograms skip
+   * whole blocks without decoding them.
+   */
+  class SUMRICE_API CompressedSpikes
+  {
+  public:
+
+    static constexpr size_t DEFAULT_BLOCK_SPIKES = 4096;
+
+    /**
+     * Forward iterator decoding the spikes one at a time.
+     */
+    class SUMRICE_API const_iterator
+    {
+    public:
+
+      typedef std::forward_iterator_tag iterator_category;
+      typedef simil::Spike value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const simil::Spike* pointer;
+      typedef const simil::Spike& reference;
+
+      const_iterator( );
+
+      reference operator*( ) const { return _spike; }
+      pointer operator->( ) const { return &_spike; }
+
+      const_iterator& operator++( );
+      const_iterator operator++( int );
+
+      bool operator==( const const_iterator& other ) const
+      { return _index == other._index; }
+      bool operator!=( const const_iterator& other ) const
+      { return _index != other._index; }
+
+      /**
+       * Position of the spike in the report.
+       */
+      size_t index( ) const { return _index; }
+
+    protected:
+
+      friend class CompressedSpikes;
+
+      const_iterator( const CompressedSpikes* owner , size_t block );
+
+      void _decode( );
+
+      const CompressedSpikes* _owner;
+      size_t _index;
+      size_t _block;
+      size_t _blockEnd;
+      const uint8_t* _time;
+      size_t _gidBit;
+      uint32_t _key;
+      simil::Spike _spike;
+    };
+
+    typedef std::pair< const_iterator , const_iterator > Range;
+
+    explicit CompressedSpikes( size_t blockSpikes = DEFAULT_BLOCK_SPIKES );
+
+    explicit CompressedSpikes( const simil::Spikes& spikes ,
+                               size_t blockSpikes = DEFAULT_BLOCK_SPIKES );
+
+    void clear( );
+
+    /**
+     * Replaces the contents with the given spikes, sorted by time.
+     */
+    void assign( const simil::Spikes& spikes );
+
+    /**
+     * Appends spikes sorted by time, none before the last one stored, i.e.
+     * the chunks of a streaming load. Each call starts a new block.
+     */
+    void append( simil::SpikesCIter first , simil::SpikesCIter last );
+
+    size_t size( ) const;
+
+    bool empty( ) const;
+
+    /**
+     * Bytes taken by the compressed spikes and the block headers.
+     */
+    size_t bytes( ) const;
+
+    size_t blockSpikes( ) const;
+
+    size_t blocks( ) const;
+
+    /**
+     * Index of the first spike of the block, size( ) past the last block.
+     */
+    size_t blockFirst( size_t block ) const;
+
+    /**
+     * Times of the first and last spikes of the block.
+     */
+    float blockStartTime( size_t block ) const;
+    float blockEndTime( size_t block ) const;
+
+    const_iterator begin( ) const;
+    const_iterator end( ) const;
+
+    /**
+     * First spike of the block, end( ) past the last block.
+     */
+    const_iterator blockBegin( size_t block ) const;
+
+    /**
+     * Appends the spikes of the block to result.
+     */
+    void decodeBlock( size_t block , simil::Spikes& result ) const;
+
+    /**
+     * All the spikes, decompressed.
+     */
+    simil::Spikes decompress( ) const;
+
+    /**
+     * First spike with time >= time, or with time > time.
+     */
+    const_iterator lowerBound( float time ) const;
+    const_iterator upperBound( float time ) const;
+
+    /**
+     * Spikes with startTime <= time < endTime.
+     */
+    Range spikesBetween( float startTime , float endTime ) const;
+
+  protected:
+
+    struct Block
+    {
+      size_t first;
+      size_t timeOffset;
+      size_t gidOffset;
+      uint32_t firstKey;
+      uint32_t lastKey;
+      uint32_t gidBase;
+      uint32_t gidBits;
+    };
+
+    size_t _blockSpikes;
+    size_t _size;
+    std::vector< Block > _blocks;
+    std::vector< uint8_t > _times;
+    std::vector< uint64_t > _gids;
+  };
+}
+
+#endif /* __VISIMPL_COMPRESSED_SPIKES_H__ */
@@ -21,6 +21,13 @@
  */
 
 #include "CorrelationComputer.h"
+#include "BinActivity.h"
+#include "CompressedSpikes.h"
+#include "SpikeCache.h"
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
 
 namespace visimpl
 {
@@ -29,8 +36,36 @@ namespace visimpl
   , _subsetEvents( simData->subsetsEvents( ))
   , _startTime{0}
   , _endTime{-1}
+  , _eventsDeltaTime{0}
+  , _spikeCache( nullptr )
+  , _compressedSpikes( nullptr )
   { }
 
+  void CorrelationComputer::spikeCache( const SpikeCache* cache )
+  {
+    if( cache == _spikeCache ) return;
+
+    _spikeCache = cache;
+    _correlations.clear( );
+    _cache.clear( );
+  }
+
+  void CorrelationComputer::compressedSpikes( const CompressedSpikes* spikes )
+  {
+    if( spikes == _compressedSpikes ) return;
+
+    _compressedSpikes = spikes;
+    _correlations.clear( );
+    _cache.clear( );
+  }
+
+  bool CorrelationComputer::CorrelationKey::operator<( const CorrelationKey& other ) const
+  {
+    return std::tie( subset, event, deltaTime, initTime, endTime ) <
+           std::tie( other.subset, other.event, other.deltaTime,
+                     other.initTime, other.endTime );
+  }
+
   void CorrelationComputer::configureEvents( const std::vector< std::string >& eventsNames,
                                              double deltaTime )
   {
@@ -38,6 +73,7 @@ namespace visimpl
     _endTime   = std::max( _simData->subsetsEvents( )->totalTime( ), _simData->endTime( ));
 
     _eventNames = eventsNames;
+    _eventsDeltaTime = deltaTime;
     _eventTimeBins.clear();
 
     auto insertBin = [this, &deltaTime](const std::string &name)
@@ -61,6 +97,114 @@ namespace visimpl
     return result;
   }
 
+  unsigned int CorrelationComputer::_activityBins( float endTime,
+                                                  float deltaTime ) const
+  {
+    const double invDeltaTime = 1.0 / deltaTime;
+    const unsigned int totalBins = std::ceil( _endTime * invDeltaTime );
+    const unsigned int endBin = std::ceil( endTime / deltaTime );
+
+    return std::max( totalBins, endBin );
+  }
+
+  std::vector< CorrelationComputer::SubsetActivity >
+  CorrelationComputer::_binSubsets( const std::vector< std::string >& subsetNames,
+                                    float deltaTime,
+                                    unsigned int bins ) const
+  {
+    std::vector< SubsetActivity > result( subsetNames.size( ));
+
+    // Neuron rows of every subset, sorted and without repetitions.
+    uint32_t maxGid = 0;
+    size_t entries = 0;
+    for( size_t i = 0; i < subsetNames.size( ); ++i )
+    {
+      auto& subset = result[ i ];
+      subset.name = subsetNames[ i ];
+      subset.gids = _subsetEvents->getSubset( subset.name );
+      std::sort( subset.gids.begin( ), subset.gids.end( ));
+      subset.gids.erase( std::unique( subset.gids.begin( ), subset.gids.end( )),
+                         subset.gids.end( ));
+      subset.activity.reset( subset.gids.size( ), bins );
+
+      if( !subset.gids.empty( ))
+        maxGid = std::max( maxGid, subset.gids.back( ));
+      entries += subset.gids.size( );
+    }
+
+    const double invDeltaTime = 1.0 / deltaTime;
+
+    // The cache indexes the spikes by GID, only those of the subsets are
+    // read.
+    if( _spikeCache )
+    {
+      const auto offsets = _spikeCache->gidOffsets( );
+      const auto times = _spikeCache->gidTimes( );
+      const size_t indexed = std::max< size_t >( _spikeCache->indexSize( ), 1 ) - 1;
+
+      for( auto& subset : result )
+        for( uint32_t row = 0; row < subset.gids.size( ); ++row )
+        {
+          const auto gid = subset.gids[ row ];
+          if( gid >= indexed ) break;
+
+          for( auto i = offsets[ gid ]; i < offsets[ gid + 1 ]; ++i )
+          {
+            if( times[ i ] < 0.0f ) continue;
+
+            const size_t binIdx = std::floor( times[ i ] * invDeltaTime );
+            if( binIdx < bins ) subset.activity.set( row, binIdx );
+          }
+        }
+
+      return result;
+    }
+
+    // GID -> ( subset, row ) entries, as CSR, so overlapping subsets are
+    // all filled by the same spike.
+    std::vector< uint32_t > offsets( static_cast< size_t >( maxGid ) + 2, 0 );
+    for( const auto& subset : result )
+      for( const auto gid : subset.gids )
+        ++offsets[ gid + 1 ];
+
+    for( size_t i = 1; i < offsets.size( ); ++i )
+      offsets[ i ] += offsets[ i - 1 ];
+
+    std::vector< std::pair< uint32_t, uint32_t >> rows( entries );
+    std::vector< uint32_t > cursor( offsets.cbegin( ), offsets.cend( ) - 1 );
+    for( uint32_t i = 0; i < result.size( ); ++i )
+    {
+      const auto& gids = result[ i ].gids;
+      for( uint32_t row = 0; row < gids.size( ); ++row )
+        rows[ cursor[ gids[ row ]]++ ] = std::make_pair( i, row );
+    }
+
+    // Single pass over the spikes for all the subsets.
+    auto binSpike = [ & ]( const simil::Spike& spike )
+    {
+      if( spike.second > maxGid || spike.first < 0.0f ) return;
+
+      const size_t binIdx = std::floor( spike.first * invDeltaTime );
+      if( binIdx >= bins ) return;
+
+      for( uint32_t i = offsets[ spike.second ]; i < offsets[ spike.second + 1 ]; ++i )
+        result[ rows[ i ].first ].activity.set( rows[ i ].second, binIdx );
+    };
+
+    if( _compressedSpikes )
+    {
+      for( const auto& spike : *_compressedSpikes )
+        binSpike( spike );
+    }
+    else
+    {
+      for( const auto& spike : _simData->spikes( ))
+        binSpike( spike );
+    }
+
+    return result;
+  }
+
   Correlation CorrelationComputer::computeCorrelation( const std::string& subset,
                                             const std::string& eventName,
                                             float initTime,
@@ -68,11 +212,9 @@ namespace visimpl
                                             float deltaTime,
                                             float /*selectionThreshold*/ )
   {
-
-    const GIDVec gids = _subsetEvents->getSubset( subset );
     Correlation correlation_;
 
-    if( gids.empty( ))
+    if( _subsetEvents->getSubset( subset ).empty( ))
     {
       std::cout << "Warning: subset " << subset << " NOT found." << std::endl;
       return correlation_;
@@ -85,13 +227,24 @@ namespace visimpl
       return correlation_;
     }
 
-    const TGIDUSet giduset( gids.begin( ), gids.end( ));
+    const auto activity =
+        _binSubsets( { subset }, deltaTime, _activityBins( endTime, deltaTime ));
+
+    return _correlate( activity.front( ), eventName, eventTime->second,
+                       initTime, endTime, deltaTime );
+  }
 
-    const TSpikes& spikes = _simData->spikes( );
+  Correlation CorrelationComputer::_correlate( const SubsetActivity& subset,
+                                               const std::string& eventName,
+                                               const std::vector< float >& eventTime,
+                                               float initTime,
+                                               float endTime,
+                                               float deltaTime ) const
+  {
+    Correlation correlation_;
 
     enum tSRecord { tPatternFiring = 0, tNotPatternFiring, tPatternNotFiring, tNotPatternNotFiring, tTotalFiring };
     typedef std::tuple< unsigned int, unsigned int, unsigned int, unsigned int, unsigned int >  tSpikesRecord;
-    std::unordered_map< uint32_t, tSpikesRecord > neuronSpikes;
 
     // Calculate delta time inverse to avoid further division operations.
     const double invDeltaTime = 1.0 / deltaTime;
@@ -104,121 +257,70 @@ namespace visimpl
     const unsigned int analysisTotalBins =
         std::ceil( ( endTime - initTime ) * invDeltaTime );
 
-    // Initialize vector storing delta time spaced event's activity.
-    std::vector< unsigned int > eventBins( totalBins, 0 );
+    const unsigned int startBin = std::floor( initTime / deltaTime );
+    const unsigned int endBin = std::ceil( endTime / deltaTime );
+
+    const auto& rowGids = subset.gids;
+    const BinActivity& activity = subset.activity;
+
+    BinActivity pattern( 1, activity.bins( ));
 
-    unsigned int totalActiveBins = 0;
     unsigned int analysisActiveBins = 0;
 
-    // Calculate the number of active bins for the current event.
+    // Calculate the active bins for the current event.
+    const unsigned int eventBins =
+        std::min( totalBins, static_cast< unsigned int >( eventTime.size( )));
     double currentTime = 0.0;
-    for( unsigned int i = 0; i < totalBins; ++i, currentTime += deltaTime )
+    for( unsigned int i = 0; i < eventBins; ++i, currentTime += deltaTime )
     {
-      const auto time = eventTime->second[ i ];
-      const bool value = ( time >= threshold );
-
-      if( value )
+      if( eventTime[ i ] >= threshold )
       {
-        eventBins[ i ] = value;
-        totalActiveBins += value;
+        pattern.set( 0, i );
 
         if( currentTime >= initTime && currentTime < endTime )
-          analysisActiveBins += value;
+          ++analysisActiveBins;
       }
-
     }
 
     const double entropyPattern = _entropy( analysisActiveBins, analysisTotalBins );
 
-    std::vector< std::set< uint32_t >> binSpikes( totalBins );
-    std::unordered_map< uint32_t, std::unordered_set< unsigned int >> neuronActiveBins;
+    // Contingency counts of every neuron against the event: popcounts of
+    // the neuron's row alone and ANDed with the event's row.
+    const BinActivity::Word* patternBits = pattern.row( 0 );
+    const unsigned int windowBins = endBin > startBin ? endBin - startBin : 0;
+    const unsigned int patternBins =
+        BinActivity::count( patternBits, startBin, endBin );
 
-    auto insertSpikesAndActiveBins = [&neuronSpikes, &neuronActiveBins](const uint32_t id)
-    {
-      neuronSpikes.insert( std::make_pair( id, std::make_tuple( 0, 0, 0, 0, 0 )));
-      neuronActiveBins.insert(
-          std::make_pair( id, std::unordered_set< unsigned int >( )));
-    };
-    std::for_each(gids.cbegin(), gids.cend(), insertSpikesAndActiveBins);
-
-
-    auto processSpike = [&giduset,&binSpikes,&neuronActiveBins,invDeltaTime](const Spike &s)
-    {
-      const auto id = std::find(giduset.cbegin(), giduset.cend(), s.second);
-      if( id == giduset.cend( ))
-      {
-        std::cerr << "ERROR: can't find id " << __FILE__ << " " << __LINE__ << std::endl;
-        return;
-      }
-
-      unsigned int binIdx = std::floor( s.first * invDeltaTime );
-
-      binSpikes[ binIdx ].insert( s.second );
-
-      auto neuronBinFired = neuronActiveBins.find(s.second);
-      if (neuronBinFired == neuronActiveBins.end())
-      {
-        std::cerr << "ERROR: can't find active bin " << __FILE__ << " " << __LINE__ << std::endl;
-        return;
-      }
-
-      neuronBinFired->second.insert( binIdx );
-    };
-    std::for_each(spikes.cbegin(), spikes.cend(), processSpike);
-
-    const unsigned int startBin = std::floor( initTime / deltaTime );
-    const unsigned int endBin = std::ceil( endTime / deltaTime );
+    std::vector< tSpikesRecord > neuronSpikes( rowGids.size( ));
 
-    auto computeStatistics = [&](const uint32_t id)
+#ifdef VISIMPL_USE_OPENMP
+    #pragma omp parallel for schedule( static )
+#endif
+    for( int row = 0; row < static_cast< int >( rowGids.size( )); ++row )
     {
-      auto neuron = neuronSpikes.find(id);
-      if(neuron == neuronSpikes.end()) return;
+      const BinActivity::Word* firedBits = activity.row( row );
 
-      auto& stats = neuron->second;
-      auto firedBins = neuronActiveBins.find(id);
-      if(firedBins == neuronActiveBins.end()) return;
+      const unsigned int totalFiringBins =
+          BinActivity::count( firedBits, startBin, endBin );
+      const unsigned int firedPattern =
+          BinActivity::countBoth( firedBits, patternBits, startBin, endBin );
 
-      unsigned int totalFiringBins = 0;
-      unsigned int firedPattern = 0;
-      unsigned int firedNotPattern = 0;
-      unsigned int notFiredPattern = 0;
-      unsigned int notFiredNotPattern = 0;
-
-      for( unsigned int i = startBin; i < endBin; ++i )
-      {
-        const auto hasFired = std::find(firedBins->second.cbegin(), firedBins->second.cend(), i);
-        const bool fired = hasFired != firedBins->second.cend( );
-        const bool pattern = eventBins[ i ];
-
-        if( fired )
-        {
-          if( pattern )
-            ++firedPattern;
-          else
-            ++firedNotPattern;
-
-          ++totalFiringBins;
-        }
-        else
-        {
-          if( pattern )
-            ++notFiredPattern;
-          else
-            ++notFiredNotPattern;
-        }
-      }
+      const unsigned int firedNotPattern = totalFiringBins - firedPattern;
+      const unsigned int notFiredPattern = patternBins - firedPattern;
+      const unsigned int notFiredNotPattern =
+          windowBins - totalFiringBins - notFiredPattern;
 
+      auto& stats = neuronSpikes[ row ];
       std::get< tPatternFiring >( stats ) = firedPattern;
       std::get< tPatternNotFiring >( stats ) = notFiredPattern;
       std::get< tNotPatternFiring >( stats ) = firedNotPattern;
       std::get< tNotPatternNotFiring >( stats ) = notFiredNotPattern;
       std::get< tTotalFiring >( stats ) = totalFiringBins;
-    };
-    std::for_each(gids.cbegin(), gids.cend(), computeStatistics);
+    }
 
-    correlation_.subsetName = subset;
+    correlation_.subsetName = subset.name;
     correlation_.eventName = eventName;
-    correlation_.gids = giduset;
+    correlation_.gids = GIDUSet( rowGids.begin( ), rowGids.end( ));
 
     // Calculate normalization factors by the inverse of active/inactive bins.
     const double normBins = 1.0 / analysisTotalBins;
@@ -232,17 +334,16 @@ namespace visimpl
     double avgFHValue = 0.0;
     double avgResValue = 0.0;
 
-    auto computeCorrelation = [&](const uint32_t id)
+    auto computeCorrelation = [&](const size_t row)
     {
-      const auto neuronStats = neuronSpikes.find(id);
-      if(neuronStats == neuronSpikes.end()) return;
+      const auto& neuronStats = neuronSpikes[ row ];
 
-      const unsigned int binsFiringPattern = std::get< tPatternFiring >( neuronStats->second );
-      const unsigned int binsFiringNotPattern = std::get< tNotPatternFiring >( neuronStats->second );
-      const unsigned int binsNotFiringPattern = std::get< tPatternNotFiring >( neuronStats->second );
-      const unsigned int binsNotFiringNotPattern = std::get< tNotPatternNotFiring >( neuronStats->second );
+      const unsigned int binsFiringPattern = std::get< tPatternFiring >( neuronStats );
+      const unsigned int binsFiringNotPattern = std::get< tNotPatternFiring >( neuronStats );
+      const unsigned int binsNotFiringPattern = std::get< tPatternNotFiring >( neuronStats );
+      const unsigned int binsNotFiringNotPattern = std::get< tNotPatternNotFiring >( neuronStats );
 
-      const unsigned int binsTotalFiring = std::get< tTotalFiring >( neuronStats->second );
+      const unsigned int binsTotalFiring = std::get< tTotalFiring >( neuronStats );
 
       // Calculate corresponding values according to current event activity.
       CorrelationValues values;
@@ -290,9 +391,10 @@ namespace visimpl
       avgResValue += values.result;
 
         // Store neuron correlation value.
-      correlation_.values.insert( std::make_pair( id, values ));
+      correlation_.values.insert( std::make_pair( rowGids[ row ], values ));
     };
-    std::for_each(gids.cbegin(), gids.cend(), computeCorrelation);
+    for( size_t row = 0; row < rowGids.size( ); ++row )
+      computeCorrelation( row );
 
     avgHitValue /= neuronSpikes.size( );
     avgFHValue /= neuronSpikes.size( );
@@ -309,37 +411,118 @@ namespace visimpl
                                   float endTime,
                                   float selectionThreshold )
   {
-    const std::vector< uint32_t > gids =
-        _subsetEvents->getSubset( subsetName );
-
     std::vector< Correlation > result;
 
-    if( gids.empty( ))
+    if( _subsetEvents->getSubset( subsetName ).empty( ))
     {
       std::cerr << "Error: Destination GID subset " << subsetName
                 << " is empty or does not exist!" << std::endl;
       return result;
     }
 
-    auto computeAndInsertCorrelation = [&](const std::string &eventName)
+    correlateAll( { subsetName }, eventNames, deltaTime, initTime, endTime,
+                  selectionThreshold );
+
+    for( const auto& eventName : eventNames )
     {
-      const auto composedName = _composeName(subsetName, eventName);
-      auto res = _correlations.find(composedName);
-      if( res == _correlations.end())
+      auto correlation = _cache.find(
+          CorrelationKey{ subsetName, eventName, deltaTime, initTime, endTime });
+
+      if( correlation != _cache.end( ) && !correlation->second.values.empty( ))
+        result.push_back( correlation->second );
+    }
+
+    return result;
+  }
+
+  void CorrelationComputer::correlateAll( const std::vector< std::string >& subsetNames,
+                                          const std::vector< std::string >& eventNames,
+                                          float deltaTime,
+                                          float initTime,
+                                          float endTime,
+                                          float /*selectionThreshold*/ )
+  {
+    // Events are binned with the delta time they were configured with.
+    const bool configured = std::abs( _eventsDeltaTime - deltaTime ) <
+                            std::numeric_limits< float >::epsilon( ) &&
+                            std::all_of( eventNames.cbegin( ), eventNames.cend( ),
+                                         [ this ]( const std::string& name )
+                                         { return _eventTimeBins.count( name ) > 0; } );
+    if( !configured )
+      configureEvents( eventNames, deltaTime );
+
+    // Pairs not in the cache, grouped by subset.
+    std::vector< std::string > pendingSubsets;
+    std::vector< std::pair< size_t, std::string >> pendingPairs;
+    for( const auto& subsetName : subsetNames )
+    {
+      if( _subsetEvents->getSubset( subsetName ).empty( ))
+      {
+        std::cerr << "Error: Destination GID subset " << subsetName
+                  << " is empty or does not exist!" << std::endl;
+        continue;
+      }
+
+      bool pending = false;
+      for( const auto& eventName : eventNames )
       {
-        auto correlation =
-            computeCorrelation( subsetName, eventName, initTime, endTime,
-                                deltaTime, selectionThreshold );
+        const CorrelationKey key{ subsetName, eventName, deltaTime, initTime, endTime };
+        if( _cache.find( key ) != _cache.end( )) continue;
 
-        correlation.fullName = composedName;
+        if( _eventTimeBins.find( eventName ) == _eventTimeBins.end( ))
+        {
+          std::cout << "Event " << eventName << " not configured." << std::endl;
+          continue;
+        }
 
-        if( !correlation.values.empty( ))
-          _correlations.insert( std::make_pair( composedName, correlation ));
+        pendingPairs.emplace_back( pendingSubsets.size( ), eventName );
+        pending = true;
       }
-    };
-    std::for_each(eventNames.cbegin(), eventNames.cend(), computeAndInsertCorrelation);
 
-    return result;
+      if( pending ) pendingSubsets.push_back( subsetName );
+    }
+
+    if( !pendingPairs.empty( ))
+    {
+      const auto activities = _binSubsets( pendingSubsets, deltaTime,
+                                           _activityBins( endTime, deltaTime ));
+
+      std::vector< Correlation > results( pendingPairs.size( ));
+
+#ifdef VISIMPL_USE_OPENMP
+      #pragma omp parallel for schedule( dynamic )
+#endif
+      for( int i = 0; i < static_cast< int >( pendingPairs.size( )); ++i )
+      {
+        const auto& pair = pendingPairs[ i ];
+        results[ i ] = _correlate( activities[ pair.first ], pair.second,
+                                   _eventTimeBins.at( pair.second ),
+                                   initTime, endTime, deltaTime );
+      }
+
+      for( size_t i = 0; i < pendingPairs.size( ); ++i )
+      {
+        const auto& subsetName = pendingSubsets[ pendingPairs[ i ].first ];
+        const auto& eventName = pendingPairs[ i ].second;
+
+        results[ i ].fullName = _composeName( subsetName, eventName );
+        _cache[ CorrelationKey{ subsetName, eventName, deltaTime,
+                                initTime, endTime }] = std::move( results[ i ] );
+      }
+    }
+
+    // Name lookups return the last correlation computed for each pair.
+    for( const auto& subsetName : subsetNames )
+    {
+      for( const auto& eventName : eventNames )
+      {
+        const auto correlation = _cache.find(
+            CorrelationKey{ subsetName, eventName, deltaTime, initTime, endTime });
+
+        if( correlation != _cache.end( ) && !correlation->second.values.empty( ))
+          _correlations[ correlation->second.fullName ] = correlation->second;
+      }
+    }
   }
 
   std::vector< float > CorrelationComputer::_eventTimePerBin( const std::string& eventName,
@@ -24,6 +24,7 @@
 #define __SIMIL_CORRELATIONCOMPUTER__
 
 #include "types.h"
+#include "BinActivity.h"
 
 #include <unordered_map>
 #include <simil/simil.h>
@@ -31,12 +32,29 @@
 
 namespace visimpl
 {
+  class CompressedSpikes;
+  class SpikeCache;
+
   class SUMRICE_API CorrelationComputer
   {
   public:
 
     CorrelationComputer( simil::SpikeData* simData );
 
+    /**
+     * Bins the spikes of the given cache instead of those of the data,
+     * which only holds the resident window of windowed loads. The cache
+     * must outlive the computer, nullptr goes back to the data. Clears
+     * the computed correlations.
+     */
+    void spikeCache( const SpikeCache* cache );
+
+    /**
+     * Same as spikeCache( ) for the spikes of compressed loads, kept as
+     * CompressedSpikes instead of in the data.
+     */
+    void compressedSpikes( const CompressedSpikes* spikes );
+
     void configureEvents( const std::vector< std::string >& events,
                           double deltaTime );
 
@@ -48,6 +66,19 @@ namespace visimpl
                float endTime,
                float selectionThreshold = 0.0f );
 
+    /**
+     * Correlates every subset with every event. The spikes are binned once
+     * for all the subsets and each ( subset, event ) pair is evaluated in
+     * parallel against that shared activity. Results are cached by subset,
+     * event, delta time and time window.
+     */
+    void correlateAll( const std::vector< std::string >& subsets,
+                       const std::vector< std::string >& events,
+                       float deltaTime,
+                       float initTime,
+                       float endTime,
+                       float selectionThreshold = 0.0f );
+
     Correlation computeCorrelation( const std::string& subset,
                   const std::string& event,
                   float initTime,
@@ -63,6 +94,39 @@ namespace visimpl
 
   protected:
 
+    struct CorrelationKey
+    {
+      std::string subset;
+      std::string event;
+      float deltaTime;
+      float initTime;
+      float endTime;
+
+      bool operator<( const CorrelationKey& other ) const;
+    };
+
+    // Bin activity of the neurons of a subset, one row per GID.
+    struct SubsetActivity
+    {
+      std::string name;
+      GIDVec gids;
+      BinActivity activity;
+    };
+
+    unsigned int _activityBins( float endTime, float deltaTime ) const;
+
+    std::vector< SubsetActivity >
+    _binSubsets( const std::vector< std::string >& subsetNames,
+                 float deltaTime,
+                 unsigned int bins ) const;
+
+    Correlation _correlate( const SubsetActivity& subset,
+                            const std::string& eventName,
+                            const std::vector< float >& eventTime,
+                            float initTime,
+                            float endTime,
+                            float deltaTime ) const;
+
     std::vector< float > _eventTimePerBin( const std::string& event,
                                     float startTime,
                                     float endTime,
@@ -76,12 +140,17 @@ namespace visimpl
 
     simil::SubsetEventManager* _subsetEvents;
 
+    const SpikeCache* _spikeCache;
+    const CompressedSpikes* _compressedSpikes;
+
     double _startTime;
     double _endTime;
+    double _eventsDeltaTime;
     std::vector< std::string > _eventNames;
     std::unordered_map< std::string, std::vector< float >> _eventTimeBins;
 
     std::map< std::string, Correlation > _correlations;
+    std::map< CorrelationKey, Correlation > _cache;
   };
 }
 
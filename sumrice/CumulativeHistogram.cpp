@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "CumulativeHistogram.h"
+#include "SpikeHistogram.h"
+
+#include <algorithm>
+
+namespace visimpl
+{
+  constexpr size_t CumulativeHistogram::SPIKES_PER_BASE_BIN;
+  constexpr size_t CumulativeHistogram::MIN_BASE_BINS;
+  constexpr size_t CumulativeHistogram::MAX_BASE_BINS;
+
+  CumulativeHistogram::CumulativeHistogram( )
+    : _spikes( nullptr )
+    , _filter( nullptr )
+    , _spikesSize( 0 )
+    , _startTime( 0.0f )
+    , _endTime( 0.0f )
+    , _limits( )
+    , _localSums( )
+    , _globalSums( )
+  { }
+
+  void CumulativeHistogram::build( const simil::Spikes& spikes ,
+                                   float startTime ,
+                                   float endTime ,
+                                   const std::unordered_set< uint32_t >& filter ,
+                                   size_t baseBins )
+  {
+    // Unfiltered counts are a binary search over the sorted spikes away,
+    // no base bins are needed for them.
+    if ( filter.empty( ))
+      baseBins = 0;
+    else if ( baseBins == 0 )
+      baseBins = defaultBaseBins( spikes.size( ));
+
+    std::vector< unsigned int > local( baseBins , 0 );
+    std::vector< unsigned int > global( baseBins , 0 );
+    if ( baseBins > 0 )
+      buildSpikeHistogram( spikes , startTime , endTime , filter ,
+                           local , global );
+
+    assign( spikes , startTime , endTime , filter , local , global );
+  }
+
+  void CumulativeHistogram::assign( const simil::Spikes& spikes ,
+                                    float startTime ,
+                                    float endTime ,
+                                    const std::unordered_set< uint32_t >& filter ,
+                                    const std::vector< unsigned int >& local ,
+                                    const std::vector< unsigned int >& global )
+  {
+    const size_t baseBins = local.size( );
+
+    _spikes = &spikes;
+    _filter = &filter;
+    _spikesSize = spikes.size( );
+    _startTime = startTime;
+    _endTime = endTime;
+    _limits = histogramLimits( startTime , endTime , baseBins );
+
+    _localSums.resize( baseBins + 1 );
+    _globalSums.resize( baseBins + 1 );
+    _localSums[ 0 ] = 0;
+    _globalSums[ 0 ] = 0;
+    for ( size_t i = 0; i < baseBins; ++i )
+    {
+      _localSums[ i + 1 ] = _localSums[ i ] + local[ i ];
+      _globalSums[ i + 1 ] = _globalSums[ i ] + global[ i ];
+    }
+  }
+
+  size_t CumulativeHistogram::defaultBaseBins( size_t spikes )
+  {
+    return std::min( MAX_BASE_BINS ,
+                     std::max( MIN_BASE_BINS , spikes / SPIKES_PER_BASE_BIN ));
+  }
+
+  void CumulativeHistogram::clear( )
+  {
+    _spikes = nullptr;
+    _filter = nullptr;
+    _spikesSize = 0;
+    _limits.clear( );
+    _localSums.clear( );
+    _globalSums.clear( );
+  }
+
+  bool CumulativeHistogram::empty( ) const
+  {
+    return _spikes == nullptr;
+  }
+
+  bool CumulativeHistogram::isBuiltFor( const simil::Spikes& spikes ,
+                                        float startTime ,
+                                        float endTime ) const
+  {
+    return _spikes == &spikes && _spikesSize == spikes.size( ) &&
+           _startTime == startTime && _endTime == endTime;
+  }
+
+  size_t CumulativeHistogram::baseBins( ) const
+  {
+    return _limits.size( );
+  }
+
+  std::pair< unsigned int , unsigned int >
+  CumulativeHistogram::countUpTo( float limit ) const
+  {
+    if ( empty( )) return std::make_pair( 0u , 0u );
+
+    // Base bin holding the limit. It is _limits.size( ) for limits past the
+    // last base bin, whose spikes were left out of the base bins.
+    const size_t bin = std::lower_bound( _limits.cbegin( ) , _limits.cend( ) ,
+                                         limit ) - _limits.cbegin( );
+
+    unsigned int local = _localSums[ bin ];
+    unsigned int global = _globalSums[ bin ];
+
+    const auto first = _spikes->cbegin( ) + _globalSums[ bin ];
+    const auto last = _spikes->cend( );
+
+    if ( _filter->empty( ))
+    {
+      const auto end = std::upper_bound(
+        first , last , limit ,
+        [ ]( float time , const simil::Spike& s ){ return time < s.first; } );
+      const auto count = static_cast< unsigned int >( end - first );
+      return std::make_pair( local + count , global + count );
+    }
+
+    for ( auto spike = first; spike != last && spike->first <= limit; ++spike )
+    {
+      ++global;
+      if ( _filter->find( spike->second ) != _filter->end( ))
+        ++local;
+    }
+
+    return std::make_pair( local , global );
+  }
+
+  void CumulativeHistogram::histogram( float startTime ,
+                                       float endTime ,
+                                       std::vector< unsigned int >& local ,
+                                       std::vector< unsigned int >& global ) const
+  {
+    const size_t bins = local.size( );
+    if ( bins == 0 ) return;
+
+    if ( global.size( ) < bins )
+      global.resize( bins , 0 );
+
+    const auto limits = histogramLimits( startTime , endTime , bins );
+
+    std::pair< unsigned int , unsigned int > previous( 0 , 0 );
+    for ( size_t i = 0; i < bins; ++i )
+    {
+      const auto current = countUpTo( limits[ i ] );
+      local[ i ] += current.first - previous.first;
+      global[ i ] += current.second - previous.second;
+      previous = current;
+    }
+  }
+}
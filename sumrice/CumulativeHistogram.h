@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_CUMULATIVE_HISTOGRAM_H__
+#define __VISIMPL_CUMULATIVE_HISTOGRAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Precomputed spike counts of a report, used to answer histograms of any
+   * bin count without walking the whole report again.
+   *
+   * The time range is split into many fine base bins, and their running
+   * sums are stored. The count of any interval is then the difference of
+   * two running sums, plus the few raw spikes of the base bins holding
+   * its limits. Histograms match the ones built by buildSpikeHistogram.
+   *
+   * The spikes and the filter given to build must outlive this object, or
+   * it must be cleared or rebuilt before they go away.
+   */
+  class SUMRICE_API CumulativeHistogram
+  {
+  public:
+
+    /**
+     * Spikes per base bin aimed for, and the limits of the base bin count.
+     */
+    static constexpr size_t SPIKES_PER_BASE_BIN = 64;
+    static constexpr size_t MIN_BASE_BINS = 1 << 10;
+    static constexpr size_t MAX_BASE_BINS = 1 << 18;
+
+    CumulativeHistogram( );
+
+    /**
+     * Counts the spikes of the report into the base bins. local only counts
+     * the GIDs in filter, or every spike if the filter is empty.
+     * baseBins = 0 picks a base bin count from the amount of spikes. An
+     * empty filter needs no base bins.
+     */
+    void build( const simil::Spikes& spikes ,
+                float startTime ,
+                float endTime ,
+                const std::unordered_set< uint32_t >& filter ,
+                size_t baseBins = 0 );
+
+    /**
+     * Same as build, with the base bin counts already computed, i.e. by
+     * SubsetHistogramEngine. The amount of base bins is local.size( ),
+     * global counts every spike of each base bin.
+     */
+    void assign( const simil::Spikes& spikes ,
+                 float startTime ,
+                 float endTime ,
+                 const std::unordered_set< uint32_t >& filter ,
+                 const std::vector< unsigned int >& local ,
+                 const std::vector< unsigned int >& global );
+
+    /**
+     * Base bins used by build for the given amount of spikes.
+     */
+    static size_t defaultBaseBins( size_t spikes );
+
+    void clear( );
+
+    bool empty( ) const;
+
+    /**
+     * Whether the object was built from this report and time range and
+     * the report hasn't grown since.
+     */
+    bool isBuiltFor( const simil::Spikes& spikes ,
+                     float startTime ,
+                     float endTime ) const;
+
+    size_t baseBins( ) const;
+
+    /**
+     * Adds the counts of local.size( ) bins splitting [startTime, endTime]
+     * to local and global, binned as buildSpikeHistogram does. global is
+     * resized to match local if needed.
+     */
+    void histogram( float startTime ,
+                    float endTime ,
+                    std::vector< unsigned int >& local ,
+                    std::vector< unsigned int >& global ) const;
+
+    /**
+     * Local and global amount of spikes with time <= limit.
+     */
+    std::pair< unsigned int , unsigned int > countUpTo( float limit ) const;
+
+  protected:
+
+    const simil::Spikes* _spikes;
+    const std::unordered_set< uint32_t >* _filter;
+    size_t _spikesSize;
+    float _startTime;
+    float _endTime;
+
+    std::vector< float > _limits;
+
+    // Spikes in the base bins before each index, so they have one more
+    // element than _limits. Being the spikes sorted, _globalSums also gives
+    // the index of the first spike of every base bin.
+    std::vector< unsigned int > _localSums;
+    std::vector< unsigned int > _globalSums;
+  };
+}
+
+#endif /* __VISIMPL_CUMULATIVE_HISTOGRAM_H__ */
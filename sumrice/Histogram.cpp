@@ -29,12 +29,6 @@
 
 #include <QMouseEvent>
 
-#ifdef VISIMPL_USE_OPENMP
-
-#include <omp.h>
-
-#endif
-
 #include <exception>
 
 namespace visimpl
@@ -58,6 +52,7 @@ namespace visimpl
     , _normRule( T_NORM_MAX )
     , _repMode( T_REP_DENSE )
     , _fillPlots( true )
+    , _spikeWindow( nullptr )
     , _lastMousePosition( nullptr )
     , _regionPercentage( nullptr )
     , _paintRegion( false )
@@ -94,6 +89,7 @@ namespace visimpl
     , _normRule( T_NORM_MAX )
     , _repMode( T_REP_DENSE )
     , _fillPlots( true )
+    , _spikeWindow( nullptr )
     , _lastMousePosition( nullptr )
     , _regionPercentage( nullptr )
     , _paintRegion( false )
@@ -127,6 +123,7 @@ namespace visimpl
     , _normRule( T_NORM_MAX )
     , _repMode( T_REP_DENSE )
     , _fillPlots( true )
+    , _spikeWindow( nullptr )
     , _lastMousePosition( nullptr )
     , _regionPercentage( nullptr )
     , _paintRegion( false )
@@ -148,6 +145,7 @@ namespace visimpl
     _spikes = &spikes;
     _startTime = startTime;
     _endTime = endTime;
+    _cumulative.clear( );
   }
 
   void HistogramWidget::Spikes( const simil::SpikeData& spikeReport )
@@ -155,6 +153,7 @@ namespace visimpl
     _spikes = &spikeReport.spikes( );
     _startTime = spikeReport.startTime( );
     _endTime = spikeReport.endTime( );
+    _cumulative.clear( );
   }
 
   void HistogramWidget::init( unsigned int binsNumber , float zoomFactor_ )
@@ -190,73 +189,27 @@ namespace visimpl
     if ( histogramNumber == T_HIST_FOCUS )
       histogram = &_focusHistogram;
 
-    const unsigned int histogramSize = histogram->size( );
-    std::vector< unsigned int > globalHistogram( histogramSize , 0 );
-
-    float totalTime = _endTime - _startTime;
+    std::vector< unsigned int > globalHistogram( histogram->size( ) , 0 );
 
     bool filter = _filteredGIDs.size( ) > 0;
 
-#ifndef VISIMPL_USE_OPENMP
-
-    const float deltaTime = ( totalTime ) / histogram->size( );
-    float currentTime = _startTime + deltaTime;
-
-    auto globalBin = globalHistogram.begin( );
-    auto spike = _spikes->begin( );
-    for( unsigned int& bin: *histogram )
+    // Windowed loads only keep part of the spikes, the window counts them
+    // from its store.
+    if ( _spikeWindow )
     {
-      while( spike != _spikes->end( ) && spike->first <= currentTime )
-      {
-        if( !filter || _filteredGIDs.find( spike->second ) != _filteredGIDs.end( ))
-        {
-          bin++;
-        }
-        spike++;
-        (*globalBin)++;
-      }
-
-      currentTime += deltaTime;
-      ++globalBin;
+      _spikeWindow->histogram( _startTime , _endTime , _filteredGIDs ,
+                               *histogram , globalHistogram );
     }
-
-#else
-
-    const float invTotalTime = 1.0f / totalTime;
-    unsigned int numThreads = 4;
-
-    omp_set_dynamic( 0 );
-    omp_set_num_threads( numThreads );
-    const auto& references = _spikes->refData( );
-    for ( int i = 0; i < static_cast<int>(references.size( )); i++ )
+    else
     {
-      simil::TSpikes::const_iterator spikeIt = references[ i ];
+      // Re-binning and zooming only query the cumulative counts, the spikes
+      // are walked again only when the report or its time range change.
+      if ( !_cumulative.isBuiltFor( *_spikes , _startTime , _endTime ))
+        _cumulative.build( *_spikes , _startTime , _endTime , _filteredGIDs );
 
-      const float endTime = ( i < ( static_cast<int>(references.size( )) - 1 ))
-                            ?
-                            references[ i + 1 ]->first :
-                            _endTime;
-
-      while ( spikeIt->first < endTime && spikeIt != _spikes->end( ))
-      {
-        const float percentage =
-          std::max( 0.0f ,
-                    std::min( 1.0f ,
-                              ( spikeIt->first - _startTime ) * invTotalTime ));
-
-        const unsigned int bin = percentage * ( histogramSize - 1 );
-
-        if ( !filter ||
-             _filteredGIDs.find( spikeIt->second ) != _filteredGIDs.end( ))
-        {
-          ( *histogram )[ bin ]++;
-        }
-
-        ( globalHistogram )[ bin ]++;
-        ++spikeIt;
-      }
+      _cumulative.histogram( _startTime , _endTime ,
+                             *histogram , globalHistogram );
     }
-#endif // VISIMPL_USE_OPENMP
 
     unsigned int count = 0;
     for ( auto bin: *histogram )
@@ -484,6 +437,7 @@ namespace visimpl
   void HistogramWidget::filteredGIDs( const GIDUSet& gids )
   {
     _filteredGIDs = gids;
+    _cumulative.clear( );
   }
 
   const GIDUSet& HistogramWidget::filteredGIDs( void ) const
@@ -780,6 +734,11 @@ namespace visimpl
     _player = player;
   }
 
+  void HistogramWidget::spikeWindow( const SpikeWindow* window )
+  {
+    _spikeWindow = window;
+  }
+
   void HistogramWidget::regionWidth( float region_ )
   {
     _regionWidth = region_;
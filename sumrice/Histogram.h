@@ -31,6 +31,8 @@
 #include <QFrame>
 
 #include "ColorInterpolator.h"
+#include "CumulativeHistogram.h"
+#include "SpikeWindow.h"
 #include "types.h"
 
 namespace visimpl
@@ -150,6 +152,7 @@ namespace visimpl
     void regionPosition( float* regionPercentage );
 
     void simPlayer( simil::SimulationPlayer* player );
+    void spikeWindow( const SpikeWindow* window );
 
     void regionWidth( float region_ );
     float regionWidth( void );
@@ -218,6 +221,9 @@ signals:
 
     GIDUSet _filteredGIDs;
 
+    CumulativeHistogram _cumulative;
+    const SpikeWindow* _spikeWindow;
+
     QPoint* _lastMousePosition;
     float* _regionPercentage;
 
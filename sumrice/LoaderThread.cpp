@@ -25,7 +25,63 @@
 #include <simil/Network.h>
 #include <simil/SimulationData.h>
 #include <simil/SpikeData.h>
+#include <sumrice/CompressedSpikes.h>
 #include <sumrice/LoaderThread.h>
+#include <sumrice/SpikeCache.h>
+#include <sumrice/SpikeFileReader.h>
+
+#include <QFileInfo>
+#include <QThread>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace
+{
+  // Spikes handed over to the consumer at once on streaming loads, and
+  // read at once when parsing into the cache.
+  constexpr size_t SPIKES_PER_CHUNK = 1 << 18;
+
+  // Neurons read at once when parsing into the cache.
+  constexpr size_t NEURONS_PER_BLOCK = 1 << 16;
+
+  // Interval between cancellation checks while waiting on SimIL.
+  constexpr std::chrono::milliseconds POLL_INTERVAL{ 50 };
+
+  // Thrown at a cancellation point to unwind the load.
+  struct LoadCancelled
+  {
+  };
+
+  // Runs a call that can't be interrupted on a thread of its own. A
+  // cancelled load stops waiting for it, the thread ends on its own and
+  // its result is dropped with the future.
+  template< typename Task >
+  std::future< typename std::result_of< Task( ) >::type >
+  runDetached( Task task )
+  {
+    std::packaged_task< typename std::result_of< Task( ) >::type( ) >
+      packaged( std::move( task ));
+    auto result = packaged.get_future( );
+    std::thread( std::move( packaged )).detach( );
+
+    return result;
+  }
+
+  qulonglong filesSize( const std::vector< std::string >& files )
+  {
+    qulonglong size = 0;
+    for ( const auto& file: files )
+    {
+      if ( file.empty( )) continue;
+      size += QFileInfo( QString::fromStdString( file )).size( );
+    }
+
+    return size;
+  }
+
+}
 
 #ifdef SIMIL_WITH_REST_API
 
@@ -41,6 +97,17 @@ LoaderThread::LoaderThread( )
 #ifdef SIMIL_WITH_REST_API
   , m_rest{ nullptr }
 #endif
+  , m_streaming{ false }
+  , m_streamed{ false }
+  , m_windowed{ false }
+  , m_windowMargin{ 0.f }
+  , m_compressed{ false }
+  , m_window{ nullptr }
+  , m_cancel{ false }
+  , m_keepPartial{ false }
+  , m_cancelled{ false }
+  , m_partial{ false }
+  , m_loadedEndTime{ 0.f }
 {
 }
 
@@ -55,6 +122,116 @@ void LoaderThread::setData( const simil::TDataType type ,
   m_arg2 = arg2;
 }
 
+void LoaderThread::setStreaming( const bool value )
+{
+  m_streaming = value;
+}
+
+bool LoaderThread::canStream( const simil::TDataType type ,
+                              const std::string& arg1 ,
+                              const std::string& arg2 )
+{
+  // BlueConfig can't be cached, see run( ).
+  if ( type != simil::TDataType::TCSV && type != simil::TDataType::THDF5 )
+    return false;
+
+  visimpl::SpikeCache cache;
+  const auto hash = visimpl::SpikeCache::sourceHash( { arg1 , arg2 } ,
+                                                     static_cast< int >( type ));
+  if ( cache.open( visimpl::SpikeCache::cachePath( arg1 ) , hash ))
+    return true;
+
+  return visimpl::SpikeFileReader::open( type , arg1 , arg2 ) != nullptr;
+}
+
+bool LoaderThread::streaming( ) const
+{
+  return m_streamed;
+}
+
+visimpl::SpikeChunkQueue& LoaderThread::spikeChunks( )
+{
+  return m_chunks;
+}
+
+void LoaderThread::setWindowed( const bool value , const float margin )
+{
+  m_windowed = value;
+  m_windowMargin = margin;
+}
+
+void LoaderThread::setCompressed( const bool value )
+{
+  m_compressed = value;
+}
+
+std::shared_ptr< visimpl::SpikeWindow > LoaderThread::spikeWindow( ) const
+{
+  return m_window;
+}
+
+void LoaderThread::cancel( const bool keepPartial )
+{
+  m_keepPartial = keepPartial;
+  m_cancel = true;
+}
+
+bool LoaderThread::cancelled( ) const
+{
+  return m_cancelled;
+}
+
+bool LoaderThread::partial( ) const
+{
+  return m_partial;
+}
+
+float LoaderThread::loadedEndTime( ) const
+{
+  return m_loadedEndTime;
+}
+
+void LoaderThread::cancellationPoint( ) const
+{
+  if ( m_cancel ) throw LoadCancelled( );
+}
+
+template< typename T >
+T LoaderThread::waitFor( std::future< T >& future ) const
+{
+  while ( future.wait_for( POLL_INTERVAL ) != std::future_status::ready )
+    cancellationPoint( );
+
+  return future.get( );
+}
+
+void LoaderThread::reduceToNetwork( simil::SpikeData& data ) const
+{
+  const auto& gids = data.gids( );
+  const uint32_t maxGid = gids.empty( ) ? 0 : *gids.rbegin( );
+  std::vector< bool > inNetwork(
+    gids.empty( ) ? 0 : static_cast< size_t >( maxGid ) + 1 , false );
+  for ( const auto gid: gids )
+    inNetwork[ gid ] = true;
+
+  const auto& spikes = data.spikes( );
+  simil::Spikes reduced;
+  for ( size_t first = 0; first < spikes.size( ); first += SPIKES_PER_CHUNK )
+  {
+    cancellationPoint( );
+
+    const size_t last = std::min( spikes.size( ) , first + SPIKES_PER_CHUNK );
+    for ( size_t i = first; i < last; ++i )
+    {
+      const auto gid = spikes[ i ].second;
+      if ( gid < inNetwork.size( ) && inNetwork[ gid ] )
+        reduced.push_back( spikes[ i ] );
+    }
+  }
+
+  data.setSpikes( std::move( reduced ));
+}
+
 std::shared_ptr< simil::Network >
 LoaderThread::network( ) const
 {
@@ -79,25 +256,193 @@ simil::TDataType LoaderThread::type( ) const
 
 void LoaderThread::run( )
 {
-  emit progress( 25 );
+  m_window = nullptr;
+  m_streamed = false;
+  m_cancelled = false;
+  m_partial = false;
+  m_loadedEndTime = 0.f;
+
+  // Published once the consumer can use the data, from then on a
+  // cancelled load may keep what it got.
+  bool published = false;
 
   try
   {
+    cancellationPoint( );
+
     switch ( m_type )
     {
       case simil::TDataType::TBlueConfig:
       case simil::TDataType::TCSV:
       case simil::TDataType::THDF5:
       {
-        auto spikesData = new simil::SpikeData( m_arg1 , m_type , m_arg2 );
-        spikesData->reduceDataToGIDS( );
-        m_data = std::unique_ptr< simil::SimulationData >( spikesData );
+        // BlueConfig files point to other files, its sources can't be
+        // hashed so it is never cached.
+        const bool cacheable = m_type != simil::TDataType::TBlueConfig;
+        const auto cachePath = visimpl::SpikeCache::cachePath( m_arg1 );
+        const auto hash = cacheable ?
+          visimpl::SpikeCache::sourceHash( { m_arg1 , m_arg2 } ,
+                                           static_cast< int >( m_type )) : 0;
+
+        visimpl::SpikeCache cache;
+        std::unique_ptr< simil::SpikeData > spikesData;
+        qulonglong sourceBytes = 0;
+        qulonglong networkBytes = 0;
+
+        // Windowed loads only keep the network, the spikes stay in the
+        // cache until the player needs them.
+        auto window = std::make_shared< visimpl::SpikeWindow >( );
+        const bool windowed = cacheable && m_windowed;
+
+        // Sources SpikeFileReader reads are parsed a block at a time into
+        // the cache, and loaded from it as if it had been there.
+        const bool cached = windowed ? window->open( cachePath , hash ) :
+                            cacheable && cache.open( cachePath , hash );
+        if ( !cached && cacheable )
+        {
+          auto reader = visimpl::SpikeFileReader::open( m_type , m_arg1 ,
+                                                        m_arg2 );
+          visimpl::SpikeCacheWriter writer( cachePath , hash );
+          if ( reader && writer.open( ))
+          {
+            if ( !parseToCache( *reader , writer ))
+              std::cerr << "LoaderThread: couldn't write spike cache "
+                        << cachePath << std::endl;
+            else if ( windowed )
+              window->open( cachePath , hash );
+            else
+              cache.open( cachePath , hash );
+          }
+        }
+
+        if ( window->isOpen( ))
+        {
+          sourceBytes = filesSize( { cachePath } );
+          spikesData = window->store( ).networkData( );
+        }
+        else if ( cache.isOpen( ))
+        {
+          sourceBytes = filesSize( { cachePath } );
+          networkBytes = sourceBytes - cache.spikesNumber( ) *
+                                       ( sizeof( float ) + sizeof( uint32_t ));
+
+          spikesData = m_streaming || m_compressed ? cache.networkData( ) :
+                                                     cache.spikeData( );
+        }
+        else
+        {
+          if ( cacheable )
+            sourceBytes = filesSize( { m_arg1 , m_arg2 } );
+
+          emit bytesRead( 0 , sourceBytes );
+
+          // SimIL parses the sources in a single call, the load stops
+          // waiting for it if cancelled.
+          const auto type = m_type;
+          const auto arg1 = m_arg1;
+          const auto arg2 = m_arg2;
+          auto parsed = runDetached( [ type , arg1 , arg2 ]( )
+            {
+              return std::unique_ptr< simil::SpikeData >(
+                new simil::SpikeData( arg1 , type , arg2 ));
+            } );
+          spikesData = waitFor( parsed );
 
-        emit progress( 50 );
+          reduceToNetwork( *spikesData );
 
+          if ( cacheable &&
+               !visimpl::SpikeCache::write( cachePath , hash , *spikesData ))
+          {
+            std::cerr << "LoaderThread: couldn't write spike cache "
+                      << cachePath << std::endl;
+          }
+
+          // Parsed whole this once, next loads start from the cache. SimIL
+          // already holds every spike, they aren't streamed.
+          if ( windowed && window->open( cachePath , hash ))
+            spikesData->setSpikes( simil::Spikes( ));
+        }
+
+        // Compressed loads page the spikes in as windowed loads do, from
+        // memory instead of the cache.
+        if ( m_compressed && !window->isOpen( ))
+        {
+          std::shared_ptr< visimpl::CompressedSpikes > compressed;
+          if ( cache.isOpen( ))
+          {
+            const float* times = cache.times( );
+            const uint32_t* gids = cache.gids( );
+            compressed = compressSpikes( [ times , gids ]( size_t i )
+                                         {
+                                           return std::make_pair( times[ i ] ,
+                                                                  gids[ i ] );
+                                         } , cache.spikesNumber( ));
+          }
+          else
+          {
+            const auto& parsedSpikes = spikesData->spikes( );
+            compressed = compressSpikes( [ &parsedSpikes ]( size_t i )
+                                         {
+                                           return parsedSpikes[ i ];
+                                         } , parsedSpikes.size( ));
+            spikesData->setSpikes( simil::Spikes( ));
+          }
+
+          window->open( compressed , spikesData->startTime( ) ,
+                        spikesData->endTime( ));
+        }
+
+        if ( window->isOpen( ))
+        {
+          window->setMargin( m_windowMargin );
+          m_window = window;
+          m_data = std::move( spikesData );
+
+          emit bytesRead( sourceBytes , sourceBytes );
+          emit network( m_data->positions( ).size( ));
+          emit spikes( window->spikesNumber( ));
+          break;
+        }
+
+        // Only the cache is streamed, parsed data is already whole.
+        m_streamed = m_streaming && cache.isOpen( );
+        const size_t spikesNumber = cache.isOpen( ) ? cache.spikesNumber( ) :
+                                    spikesData->spikes( ).size( );
+
+        if ( m_streamed )
+        {
+          // The consumer appends the chunks to the published data. Room for
+          // every spike avoids reallocations while the player iterates them.
+          simil::Spikes reserved;
+          reserved.reserve( spikesNumber );
+          spikesData->setSpikes( std::move( reserved ));
+        }
+
+        cancellationPoint( );
+
+        const auto loadedSpikes = spikesData->spikes( ).size( );
+        m_data = std::move( spikesData );
+
+        emit bytesRead( m_streamed ? networkBytes : sourceBytes ,
+                        sourceBytes );
         emit network( m_data->positions( ).size( ));
-        emit spikes( spikesData->spikes( ).size( ));
 
+        if ( !m_streamed )
+        {
+          emit spikes( loadedSpikes );
+          break;
+        }
+
+        published = true;
+        m_loadedEndTime = m_data->startTime( );
+        emit networkLoaded( );
+
+        const float* times = cache.times( );
+        const uint32_t* gids = cache.gids( );
+        streamSpikes( [ times , gids ]( size_t i )
+                      {
+                        return std::make_pair( times[ i ] , gids[ i ] );
+                      } , spikesNumber , networkBytes , sourceBytes );
       }
         break;
       case simil::TDataType::TREST:
@@ -105,14 +450,22 @@ void LoaderThread::run( )
 #ifdef SIMIL_WITH_REST_API
         if ( m_rest == nullptr )
         {
-          m_rest = std::make_unique< Loader >( );
+          m_rest = std::make_shared< Loader >( );
         }
 
         m_rest->setConfiguration( m_restConfig );
 
+        // The fetches can't be interrupted, the load polls them and stops
+        // waiting if cancelled. They hold the loader until they return.
+        const auto rest = m_rest;
         const auto url = m_restConfig.url;
         const auto port = std::to_string( m_restConfig.port );
-        const auto version = m_rest->getVersion( url , m_restConfig.port );
+        const auto portNumber = m_restConfig.port;
+        auto versionFuture = runDetached( [ rest , url , portNumber ]( )
+          {
+            return rest->getVersion( url , portNumber );
+          } );
+        const auto version = waitFor( versionFuture );
 
         if ( version.api.empty( ) || version.insite.empty( ))
         {
@@ -123,36 +476,26 @@ void LoaderThread::run( )
         }
 
 
-        std::packaged_task< std::unique_ptr< simil::SimulationData >( ) >
-          simulationTask(
-          [ this , url , port ]( )
+        cancellationPoint( );
+
+        auto simulationDataFuture = runDetached( [ rest , url , port ]( )
           {
-            return m_rest->loadSimulationData( url , port );
+            return rest->loadSimulationData( url , port );
           } );
 
-        auto simulationDataFuture = simulationTask.get_future( );
-        std::thread simulationThread( std::move( simulationTask ));
-
         if ( m_network == nullptr )
         {
           // The override network is not defined.
           // Let's load it!
-          std::packaged_task< std::unique_ptr< simil::Network >( ) > networkTask(
-            [ this , url , port ]( )
+          auto networkFuture = runDetached( [ rest , url , port ]( )
             {
-              return m_rest->loadNetwork( url , port );
+              return rest->loadNetwork( url , port );
             } );
-
-          auto networkFuture = networkTask.get_future( );
-          std::thread networkThread( std::move( networkTask ));
-          networkThread.join( );
-          m_network = networkFuture.get( );
+          m_network = waitFor( networkFuture );
         }
 
-        simulationThread.join( );
-        m_data = simulationDataFuture.get( );
+        m_data = waitFor( simulationDataFuture );
 
-        emit progress( 50 );
         emit network( m_data->positions( ).size( ));
 
         if ( auto* ptr = dynamic_cast<simil::SpikeData*>(m_data.get( )))
@@ -171,6 +514,23 @@ void LoaderThread::run( )
         break;
     }
   }
+  catch ( const LoadCancelled& )
+  {
+    m_cancelled = true;
+    m_partial = published && m_keepPartial;
+
+    // Frees the memory now instead of when the loader is destroyed.
+    if ( !m_partial )
+    {
+      m_data = nullptr;
+      m_window = nullptr;
+    }
+
+#ifdef SIMIL_WITH_REST_API
+    // Fetches still running keep using it, the next load gets its own.
+    m_rest = nullptr;
+#endif
+  }
   catch ( const std::exception& ex )
   {
     m_errors = std::string( "sumrice::LoaderThread::run() -> " ) +
@@ -182,7 +542,8 @@ void LoaderThread::run( )
       "sumrice::LoaderThread::run() -> Un-handled exception when loading data. " );
   }
 
-  emit progress( 75 );
+  // Nothing else is coming, also when the load failed half way.
+  m_chunks.close( );
 
   if ( !m_errors.empty( ) && m_type != simil::TDataType::TREST )
   {
@@ -195,6 +556,109 @@ void LoaderThread::run( )
   emit progress( 100 );
 }
 
+bool LoaderThread::parseToCache( visimpl::SpikeFileReader& reader ,
+                                 visimpl::SpikeCacheWriter& writer )
+{
+  emit bytesRead( 0 , reader.totalBytes( ));
+
+  std::vector< uint32_t > gids;
+  std::vector< float > positions;
+  {
+    std::vector< uint32_t > blockGids( NEURONS_PER_BLOCK );
+    std::vector< float > blockPositions( NEURONS_PER_BLOCK * 3 );
+    while ( const size_t count = reader.readNeurons( blockGids.data( ) ,
+                                                     blockPositions.data( ) ,
+                                                     NEURONS_PER_BLOCK ))
+    {
+      cancellationPoint( );
+
+      gids.insert( gids.end( ) , blockGids.cbegin( ) ,
+                   blockGids.cbegin( ) + count );
+      positions.insert( positions.end( ) , blockPositions.cbegin( ) ,
+                        blockPositions.cbegin( ) + count * 3 );
+
+      emit network( static_cast< unsigned int >( gids.size( )));
+      emit bytesRead( reader.bytesRead( ) , reader.totalBytes( ));
+    }
+  }
+
+  writer.setNetwork( gids , positions );
+
+  simil::Spikes block( SPIKES_PER_CHUNK );
+  while ( const size_t count = reader.readSpikes( block.data( ) ,
+                                                  block.size( )))
+  {
+    cancellationPoint( );
+
+    if ( !writer.append( block.data( ) , count ))
+      return false;
+
+    emit spikes( static_cast< unsigned int >( writer.spikesNumber( )));
+    emit bytesRead( reader.bytesRead( ) , reader.totalBytes( ));
+  }
+
+  return writer.finish( [ this ]( uint64_t ){ cancellationPoint( ); } );
+}
+
+template< typename SpikeAt >
+std::shared_ptr< visimpl::CompressedSpikes >
+LoaderThread::compressSpikes( SpikeAt spikeAt , const size_t count ) const
+{
+  auto result = std::make_shared< visimpl::CompressedSpikes >( );
+
+  // A block per call, whole blocks but the last.
+  const size_t blockSpikes = result->blockSpikes( );
+  simil::Spikes block;
+  block.reserve( blockSpikes );
+  for ( size_t first = 0; first < count; first += blockSpikes )
+  {
+    cancellationPoint( );
+
+    const size_t last = std::min( count , first + blockSpikes );
+    block.clear( );
+    for ( size_t i = first; i < last; ++i )
+      block.push_back( spikeAt( i ));
+
+    result->append( block.cbegin( ) , block.cend( ));
+  }
+
+  return result;
+}
+
+template< typename SpikeAt >
+void LoaderThread::streamSpikes( SpikeAt spikeAt , const size_t count ,
+                                 const qulonglong firstByte ,
+                                 const qulonglong totalBytes )
+{
+  const qulonglong spikeBytes = totalBytes - firstByte;
+
+  for ( size_t first = 0; first < count; first += SPIKES_PER_CHUNK )
+  {
+    const size_t last = std::min( count , first + SPIKES_PER_CHUNK );
+
+    cancellationPoint( );
+
+    simil::Spikes chunk;
+    chunk.reserve( last - first );
+    for ( size_t i = first; i < last; ++i )
+      chunk.push_back( spikeAt( i ));
+
+    const float chunkEndTime = chunk.back( ).first;
+    while ( !m_chunks.push( chunk ))
+    {
+      // The consumer may have stopped popping to cancel.
+      cancellationPoint( );
+      QThread::msleep( 1 );
+    }
+
+    m_loadedEndTime = chunkEndTime;
+
+    emit spikeChunksReady( );
+    emit spikes( static_cast< unsigned int >( last ));
+    emit bytesRead( firstByte + spikeBytes * last / count , totalBytes );
+  }
+}
+
 #ifdef SIMIL_WITH_REST_API
 
 simil::LoaderRestData* LoaderThread::RESTLoader( ) const
@@ -25,6 +25,8 @@
 
 // Sumrice
 #include <sumrice/api.h>
+#include <sumrice/SpikeChunkQueue.h>
+#include <sumrice/SpikeWindow.h>
 
 // Simil
 #include <simil/types.h>
@@ -38,6 +40,8 @@
 #include <QTimer>
 
 // C++
+#include <atomic>
+#include <future>
 #include <string>
 #include <memory>
 
@@ -45,6 +49,13 @@ namespace simil
 {
   class Network;
   class SimulationData;
+  class SpikeData;
+}
+
+namespace visimpl
+{
+  class CompressedSpikes;
+  class SpikeFileReader;
 }
 
 
@@ -74,6 +85,89 @@ class SUMRICE_API LoaderThread
                  const std::string &arg1,
                  const std::string &arg2);
 
+    /** \brief Enables the streaming load of spike data. The simulation data
+     * is published with the network and without spikes (networkLoaded()
+     * signal), the spikes follow in time ordered chunks through
+     * spikeChunks() (spikeChunksReady() signal). Only the spike cache is
+     * streamed, sources SimIL parses are loaded whole. Disabled by default.
+     * \param[in] value true to stream the spikes.
+     *
+     */
+    void setStreaming(const bool value);
+
+    /** \brief Returns true if the given sources can be streamed: their
+     * spike cache is valid or visimpl::SpikeFileReader parses them into it.
+     * \param[in] type Data origin type.
+     * \param[in] arg1 Load argument 1.
+     * \param[in] arg2 Load argument 2.
+     *
+     */
+    static bool canStream(const simil::TDataType type,
+                          const std::string &arg1,
+                          const std::string &arg2);
+
+    /** \brief Returns true if the spikes are streamed, false if the sources
+     * couldn't be or a windowed load has taken precedence. Only valid after
+     * networkLoaded() or finished() signals.
+     *
+     */
+    bool streaming() const;
+
+    /** \brief Returns the queue of spike chunks of a streaming load. Only
+     * the thread that receives the spikeChunksReady() signal may pop them.
+     *
+     */
+    visimpl::SpikeChunkQueue &spikeChunks();
+
+    /** \brief Enables the windowed load of spike data, for recordings
+     * larger than memory. The simulation data is published with the network
+     * and without spikes, and the spikes are paged in from the spike cache
+     * through spikeWindow(). Takes precedence over streaming. Sources
+     * without a cache are parsed into it first, a block at a time if
+     * visimpl::SpikeFileReader reads them. Disabled by default.
+     * \param[in] value true to page the spikes in.
+     * \param[in] margin Time resident around the playback time.
+     *
+     */
+    void setWindowed(const bool value, const float margin = 0.f);
+
+    /** \brief Keeps the spikes in memory as visimpl::CompressedSpikes, 2 to
+     * 4 bytes per spike instead of 8. The simulation data is published with
+     * the network and without spikes, and the spikes are paged in through
+     * spikeWindow() with the margin of setWindowed(). Takes precedence over
+     * streaming, windowed loads take precedence over it. Disabled by
+     * default.
+     * \param[in] value true to compress the spikes.
+     *
+     */
+    void setCompressed(const bool value);
+
+    /** \brief Returns the spike window of a windowed or compressed load, or
+     * nullptr if the spikes are all in the simulation data. Only valid after
+     * finished() signal.
+     *
+     */
+    std::shared_ptr<visimpl::SpikeWindow> spikeWindow() const;
+
+    /** \brief Returns true if the load was cancelled. Only valid after
+     * finished() signal.
+     *
+     */
+    bool cancelled() const;
+
+    /** \brief Returns true if a cancelled streaming load kept the spikes
+     * handed over until then, simulationData() holds the time prefix up to
+     * loadedEndTime(). Only valid after finished() signal.
+     *
+     */
+    bool partial() const;
+
+    /** \brief Returns the time of the last spike handed over by a
+     * streaming load.
+     *
+     */
+    float loadedEndTime() const;
+
     /** \brief Returns the loaded network data. Only valid after finished() signal.
      *
      */
@@ -112,6 +206,19 @@ class SUMRICE_API LoaderThread
     simil::LoaderRestData *RESTLoader() const;
 #endif
 
+  public slots:
+    /** \brief Stops the load at its next cancellation point, the data is
+     * released and finished() is emitted with cancelled() true. Can be
+     * called from any thread. Sources read by visimpl::SpikeFileReader and
+     * the network filter stop between blocks. SimIL parses the others and
+     * fetches from REST in a single call each, the load stops waiting for
+     * them and they end on their own.
+     * \param[in] keepPartial true to keep the spikes already handed over
+     * by a streaming load, see partial().
+     *
+     */
+    void cancel(const bool keepPartial = false);
+
   protected:
     virtual void run();
 
@@ -120,7 +227,77 @@ class SUMRICE_API LoaderThread
     void spikes(unsigned int);
     void network(unsigned int);
 
+    /** \brief Bytes of the source files read, and their total size (0 if
+     * unknown).
+     *
+     */
+    void bytesRead(qulonglong, qulonglong);
+
+    /** \brief Streaming load: network and time range are available in
+     * simulationData(), the spikes are still to come.
+     *
+     */
+    void networkLoaded();
+
+    /** \brief Streaming load: chunks have been pushed to spikeChunks().
+     *
+     */
+    void spikeChunksReady();
+
   private:
+    /** \brief Hands the spikes over to the consumer in chunks, waiting while
+     * the queue is full.
+     * \param[in] spikeAt Returns the i-th spike, spikes sorted by time.
+     * \param[in] count Number of spikes.
+     * \param[in] firstByte Bytes read before the spikes.
+     * \param[in] totalBytes Bytes read after the spikes.
+     *
+     */
+    template<typename SpikeAt>
+    void streamSpikes(SpikeAt spikeAt, const size_t count,
+                      const qulonglong firstByte, const qulonglong totalBytes);
+
+    /** \brief Compresses the spikes a block at a time, stopping if
+     * cancelled between blocks.
+     * \param[in] spikeAt Returns the i-th spike, spikes sorted by time.
+     * \param[in] count Number of spikes.
+     *
+     */
+    template<typename SpikeAt>
+    std::shared_ptr<visimpl::CompressedSpikes>
+    compressSpikes(SpikeAt spikeAt, const size_t count) const;
+
+    /** \brief Reads the sources a block at a time into the spike cache,
+     * reporting the progress and stopping if cancelled between blocks.
+     * \param[in] reader Reader of the sources.
+     * \param[in] writer Opened writer of the cache.
+     * \return false if the cache couldn't be written.
+     *
+     */
+    bool parseToCache(visimpl::SpikeFileReader &reader,
+                      visimpl::SpikeCacheWriter &writer);
+
+    /** \brief Unwinds the load if it has been cancelled.
+     *
+     */
+    void cancellationPoint() const;
+
+    /** \brief Waits for the result of a call run on another thread,
+     * unwinding the load if it is cancelled meanwhile.
+     * \param[in] future Result of the call.
+     *
+     */
+    template<typename T>
+    T waitFor(std::future<T> &future) const;
+
+    /** \brief Drops the spikes of GIDs outside the network, as
+     * simil::SpikeData::reduceDataToGIDS() does, a block at a time to
+     * stop if cancelled.
+     * \param[in] data Parsed data.
+     *
+     */
+    void reduceToNetwork(simil::SpikeData &data) const;
+
     simil::TDataType       m_type;       /** data origin type.                    */
     std::string            m_arg1;       /** argument 1, meaning depends on type. */
     std::string            m_arg2;       /** argument 2, meaning depends on type. */
@@ -131,10 +308,22 @@ class SUMRICE_API LoaderThread
 #ifdef SIMIL_WITH_REST_API
     using Loader = simil::LoaderRestData;
 
-    std::unique_ptr<Loader> m_rest;       /** rest data importer.                  */
+    std::shared_ptr<Loader> m_rest;       /** rest data importer.                  */
     Loader::Configuration   m_restConfig; /** rest connnection configuration.      */
 #endif
     std::string             m_errors;     /** error messages or empty if success.  */
+    bool                    m_streaming;  /** true to stream the spikes.           */
+    bool                    m_streamed;   /** true if the spikes are streamed.     */
+    visimpl::SpikeChunkQueue m_chunks;    /** streamed spike chunks.               */
+    bool                    m_windowed;   /** true to page the spikes in.          */
+    float                   m_windowMargin; /** resident time around playback.     */
+    bool                    m_compressed; /** true to compress the spikes.         */
+    std::shared_ptr<visimpl::SpikeWindow> m_window; /** spike window or nullptr.   */
+    std::atomic<bool>       m_cancel;     /** true once cancel() is called.        */
+    std::atomic<bool>       m_keepPartial; /** true to keep the streamed spikes.   */
+    bool                    m_cancelled;  /** true if the load was cancelled.      */
+    bool                    m_partial;    /** true if the streamed spikes were kept. */
+    float                   m_loadedEndTime; /** time of the last spike handed over. */
 };
 
 #endif /* SUMRICE_LOADERTHREAD_H_ */
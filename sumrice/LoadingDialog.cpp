@@ -12,6 +12,8 @@
 #include <QVBoxLayout>
 #include <QProgressBar>
 #include <QLabel>
+#include <QCheckBox>
+#include <QPushButton>
 #include <QApplication>
 #include <QMainWindow>
 #include <QWindow>
@@ -19,12 +21,16 @@
 
 const QString NETWORK_STRING = QString("Network: %1");
 const QString SPIKES_STRING  = QString("Spikes: %1");
+const QString BYTES_STRING   = QString("Read: %1 of %2 MB");
 
 LoadingDialog::LoadingDialog(QWidget *p, Qt::WindowFlags f)
 : QDialog(p,f)
 , m_progressBar{nullptr}
 , m_networkLabel{nullptr}
 , m_spikesLabel{nullptr}
+, m_bytesLabel{nullptr}
+, m_keepPartial{nullptr}
+, m_cancelButton{nullptr}
 {
   initializeGUI();
 
@@ -47,6 +53,36 @@ void LoadingDialog::setSpikesValue(unsigned int value)
   if(value > 0) m_spikesLabel->setText(SPIKES_STRING.arg(value));
 }
 
+void LoadingDialog::setBytesRead(qulonglong value, qulonglong total)
+{
+  if(total == 0) return;
+
+  setProgress(static_cast<int>(value * 100 / total));
+
+  const double megabyte = 1024. * 1024.;
+  m_bytesLabel->setText(BYTES_STRING.arg(value / megabyte, 0, 'f', 1)
+                                    .arg(total / megabyte, 0, 'f', 1));
+  m_bytesLabel->show();
+}
+
+void LoadingDialog::setKeepPartialVisible(bool value)
+{
+  m_keepPartial->setVisible(value);
+  adjustSize();
+}
+
+void LoadingDialog::reject()
+{
+  // the dialog stays until the loader stops.
+  if(!m_cancelButton->isEnabled()) return;
+
+  m_cancelButton->setEnabled(false);
+  m_cancelButton->setText(tr("Cancelling..."));
+  m_keepPartial->setEnabled(false);
+
+  emit cancelRequested(m_keepPartial->isVisible() && m_keepPartial->isChecked());
+}
+
 void LoadingDialog::initializeGUI()
 {
   auto layout = new QVBoxLayout();
@@ -61,6 +97,19 @@ void LoadingDialog::initializeGUI()
   m_spikesLabel = new QLabel(SPIKES_STRING.arg(0), this);
   layout->addWidget(m_spikesLabel);
 
+  m_bytesLabel = new QLabel(BYTES_STRING.arg(0).arg(0), this);
+  m_bytesLabel->hide();
+  layout->addWidget(m_bytesLabel);
+
+  m_keepPartial = new QCheckBox(tr("Keep the spikes loaded when cancelling"), this);
+  m_keepPartial->hide();
+  layout->addWidget(m_keepPartial);
+
+  m_cancelButton = new QPushButton(tr("Cancel"), this);
+  layout->addWidget(m_cancelButton, 0, Qt::AlignRight);
+
+  connect(m_cancelButton, SIGNAL(clicked()), this, SLOT(reject()));
+
   setLayout(layout);
 
   setFixedWidth(300);
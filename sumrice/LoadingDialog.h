@@ -14,8 +14,10 @@
 // Qt
 #include <QDialog>
 
+class QCheckBox;
 class QLabel;
 class QProgressBar;
+class QPushButton;
 
 /** \class LoadingDialog
  * \brief Dialog that shows data loading progress.
@@ -56,6 +58,33 @@ class SUMRICE_API LoadingDialog
      */
     void setSpikesValue(unsigned int value);
 
+    /** \brief Updates the progress from the bytes read.
+     * \param[in] value Bytes read.
+     * \param[in] total Total bytes to read, 0 if unknown.
+     *
+     */
+    void setBytesRead(qulonglong value, qulonglong total);
+
+    /** \brief Shows the option to keep the spikes loaded when cancelling,
+     * for loads that hand them over as they are read. Hidden by default.
+     * \param[in] value true to show the option.
+     *
+     */
+    void setKeepPartialVisible(bool value);
+
+    /** \brief Requests the cancellation of the load, same as the cancel
+     * button or closing the dialog.
+     *
+     */
+    virtual void reject() override;
+
+  signals:
+    /** \brief Emitted once when the user cancels the load.
+     * \param[in] keepPartial true to keep the spikes already loaded.
+     *
+     */
+    void cancelRequested(bool keepPartial);
+
   private:
     /** \brief Helper method to initialize the gui elements.
      *
@@ -65,6 +94,9 @@ class SUMRICE_API LoadingDialog
     QProgressBar *m_progressBar;  /** dialog progress bar.    */
     QLabel       *m_networkLabel; /** network ids read label. */
     QLabel       *m_spikesLabel;  /** spikes ids read label.  */
+    QLabel       *m_bytesLabel;   /** bytes read label.       */
+    QCheckBox    *m_keepPartial;  /** keep loaded spikes.     */
+    QPushButton  *m_cancelButton; /** cancel load button.     */
 };
 
 #endif /* SUMRICE_LOADINGDIALOG_H_ */
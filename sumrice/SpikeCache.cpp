@@ -0,0 +1,835 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SpikeCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+
+#include <QtGlobal>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFileInfo>
+
+namespace visimpl
+{
+  namespace
+  {
+    constexpr char MAGIC[ 8 ] = { 'V' , 'S' , 'P' , 'K' , 'C' , 'A' , 'C' , 'H' };
+
+    // Bytes of each end of a source file that enter the hash.
+    constexpr qint64 HASHED_BYTES = 1 << 20;
+
+    constexpr uint64_t FNV_OFFSET = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+    void hashBytes( uint64_t& hash , const void* data , size_t size )
+    {
+      const auto bytes = static_cast< const unsigned char* >( data );
+      for ( size_t i = 0; i < size; ++i )
+      {
+        hash ^= bytes[ i ];
+        hash *= FNV_PRIME;
+      }
+    }
+
+    template< typename T >
+    void hashValue( uint64_t& hash , const T& value )
+    {
+      hashBytes( hash , &value , sizeof( T ));
+    }
+
+    uint64_t align( uint64_t offset )
+    {
+      return ( offset + 7 ) & ~uint64_t( 7 );
+    }
+
+    /**
+     * Checks that a section of count elements of the given size starts,
+     * aligned, at or after begin and ends within fileSize, without
+     * overflowing. On success begin is moved to the end of the section.
+     */
+    bool checkSection( uint64_t offset , uint64_t count , uint64_t elementSize ,
+                       uint64_t fileSize , uint64_t& begin )
+    {
+      if ( offset < begin || offset > fileSize || offset % 8 != 0 )
+        return false;
+
+      if ( count > ( fileSize - offset ) / elementSize )
+        return false;
+
+      begin = offset + count * elementSize;
+      return true;
+    }
+
+    // Spikes moved to the cache columns at once.
+    constexpr size_t BLOCK_SPIKES = 1 << 16;
+
+    template< typename T >
+    bool writeAt( QFile& file , uint64_t offset , const T* data , size_t size )
+    {
+      const qint64 bytes = static_cast< qint64 >( size * sizeof( T ));
+      return bytes == 0 ||
+             ( file.seek( static_cast< qint64 >( offset )) &&
+               file.write( reinterpret_cast< const char* >( data ) , bytes ) ==
+               bytes );
+    }
+
+    // Moves the written file over the cache, replacing it atomically where
+    // the system can.
+    bool replaceFile( const QString& temporary , const QString& target )
+    {
+#ifdef Q_OS_UNIX
+      return std::rename( QFile::encodeName( temporary ).constData( ) ,
+                          QFile::encodeName( target ).constData( )) == 0;
+#else
+      QFile::remove( target );
+      return QFile::rename( temporary , target );
+#endif
+    }
+  }
+
+  struct SpikeCache::Header
+  {
+    char magic[ 8 ];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t sourceHash;
+
+    uint64_t spikes;
+    uint64_t neurons;
+    uint64_t indexSize;
+    float startTime;
+    float endTime;
+
+    // Byte offsets of the sections from the beginning of the file.
+    uint64_t timesOffset;
+    uint64_t gidsOffset;
+    uint64_t neuronsOffset;
+    uint64_t positionsOffset;
+    uint64_t indexOffset;
+    uint64_t indexTimesOffset;
+    uint64_t fileSize;
+  };
+
+  constexpr uint32_t SpikeCache::VERSION;
+
+  SpikeCache::SpikeCache( )
+    : _file( )
+    , _data( nullptr )
+    , _header( nullptr )
+  { }
+
+  SpikeCache::~SpikeCache( )
+  {
+    close( );
+  }
+
+  std::string SpikeCache::cachePath( const std::string& source )
+  {
+    return source + ".visimpl-cache";
+  }
+
+  uint64_t SpikeCache::sourceHash( const std::vector< std::string >& sources ,
+                                   int dataType )
+  {
+    uint64_t hash = FNV_OFFSET;
+    hashValue( hash , VERSION );
+    hashValue( hash , dataType );
+
+    for ( const auto& source: sources )
+    {
+      if ( source.empty( )) continue;
+
+      hashBytes( hash , source.data( ) , source.size( ));
+
+      const QFileInfo info( QString::fromStdString( source ));
+      const qint64 size = info.size( );
+      const qint64 modified = info.lastModified( ).toMSecsSinceEpoch( );
+      hashValue( hash , size );
+      hashValue( hash , modified );
+
+      QFile file( info.absoluteFilePath( ));
+      if ( !file.open( QIODevice::ReadOnly )) continue;
+
+      const auto head = file.read( HASHED_BYTES );
+      hashBytes( hash , head.constData( ) , head.size( ));
+
+      if ( size > HASHED_BYTES && file.seek( std::max( HASHED_BYTES ,
+                                                       size - HASHED_BYTES )))
+      {
+        const auto tail = file.read( HASHED_BYTES );
+        hashBytes( hash , tail.constData( ) , tail.size( ));
+      }
+    }
+
+    return hash;
+  }
+
+  bool SpikeCache::writeFile( const std::string& path ,
+                              uint64_t hash ,
+                              float startTime ,
+                              float endTime ,
+                              const std::vector< uint32_t >& neurons ,
+                              const std::vector< float >& positions ,
+                              const std::vector< uint64_t >& counts ,
+                              const SpikeReader& read )
+  {
+    uint64_t spikesNumber = 0;
+    for ( const auto count: counts )
+      spikesNumber += count;
+
+    // CSR offsets of every GID, one more than GIDs.
+    std::vector< uint64_t > offsets( spikesNumber == 0 ? 0 : counts.size( ) + 1 ,
+                                     0 );
+    for ( size_t gid = 1; gid < offsets.size( ); ++gid )
+      offsets[ gid ] = offsets[ gid - 1 ] + counts[ gid - 1 ];
+
+    Header header;
+    std::memset( &header , 0 , sizeof( Header ));
+    std::memcpy( header.magic , MAGIC , sizeof( MAGIC ));
+    header.version = VERSION;
+    header.sourceHash = hash;
+    header.spikes = spikesNumber;
+    header.neurons = neurons.size( );
+    header.indexSize = offsets.size( );
+    header.startTime = startTime;
+    header.endTime = endTime;
+
+    header.timesOffset = align( sizeof( Header ));
+    header.gidsOffset = header.timesOffset + align( spikesNumber * sizeof( float ));
+    header.neuronsOffset = header.gidsOffset +
+                           align( spikesNumber * sizeof( uint32_t ));
+    header.positionsOffset = header.neuronsOffset +
+                             align( neurons.size( ) * sizeof( uint32_t ));
+    header.indexOffset = header.positionsOffset +
+                         align( positions.size( ) * sizeof( float ));
+    header.indexTimesOffset = header.indexOffset +
+                              align( offsets.size( ) * sizeof( uint64_t ));
+    header.fileSize = header.indexTimesOffset +
+                      align( spikesNumber * sizeof( float ));
+
+    // Written next to the cache and moved over it once complete. The file
+    // is sized up front, so the padding between sections is already zero.
+    const QString target = QString::fromStdString( path );
+    const QString temporary = QString( "%1.%2.tmp" ).arg( target )
+      .arg( QCoreApplication::applicationPid( ));
+
+    QFile file( temporary );
+    if ( !file.open( QIODevice::ReadWrite | QIODevice::Truncate ))
+      return false;
+
+    bool written = file.resize( static_cast< qint64 >( header.fileSize )) &&
+                   writeAt( file , 0 , &header , 1 ) &&
+                   writeAt( file , header.neuronsOffset , neurons.data( ) ,
+                            neurons.size( )) &&
+                   writeAt( file , header.positionsOffset , positions.data( ) ,
+                            positions.size( )) &&
+                   writeAt( file , header.indexOffset , offsets.data( ) ,
+                            offsets.size( ));
+
+    // The spikes come in time order a block at a time: the columns are
+    // written block by block and the per-GID times scattered through a
+    // mapping of their section, the system pages it out as needed.
+    float* gidTimes = nullptr;
+    if ( written && spikesNumber > 0 )
+    {
+      written = file.flush( );
+      gidTimes = reinterpret_cast< float* >(
+        file.map( static_cast< qint64 >( header.indexTimesOffset ) ,
+                  static_cast< qint64 >( spikesNumber * sizeof( float ))));
+      written = written && gidTimes != nullptr;
+    }
+
+    // read may throw to stop, the partial file goes away.
+    try
+    {
+      if ( written && spikesNumber > 0 )
+      {
+        std::vector< uint64_t > cursor( offsets.cbegin( ) ,
+                                        offsets.cend( ) - 1 );
+        std::vector< simil::Spike > block( BLOCK_SPIKES );
+        std::vector< float > times( BLOCK_SPIKES );
+        std::vector< uint32_t > gids( BLOCK_SPIKES );
+
+        uint64_t first = 0;
+        while ( written )
+        {
+          const size_t count = read( block.data( ) , block.size( ));
+          if ( count == 0 ) break;
+
+          for ( size_t i = 0; i < count && written; ++i )
+          {
+            const auto gid = block[ i ].second;
+            written = gid < counts.size( ) &&
+                      cursor[ gid ] < offsets[ gid + 1 ];
+            if ( !written ) break;
+
+            times[ i ] = block[ i ].first;
+            gids[ i ] = gid;
+            gidTimes[ cursor[ gid ]++ ] = block[ i ].first;
+          }
+
+          written =
+            written && first + count <= spikesNumber &&
+            writeAt( file , header.timesOffset + first * sizeof( float ) ,
+                     times.data( ) , count ) &&
+            writeAt( file , header.gidsOffset + first * sizeof( uint32_t ) ,
+                     gids.data( ) , count );
+          first += count;
+        }
+
+        // Exactly the spikes counted.
+        written = written && first == spikesNumber;
+      }
+    }
+    catch ( ... )
+    {
+      if ( gidTimes != nullptr )
+        file.unmap( reinterpret_cast< uchar* >( gidTimes ));
+      file.close( );
+      QFile::remove( temporary );
+      throw;
+    }
+
+    if ( gidTimes != nullptr )
+      written = file.unmap( reinterpret_cast< uchar* >( gidTimes )) && written;
+
+    written = written && file.flush( );
+    file.close( );
+
+    if ( !written || !replaceFile( temporary , target ))
+    {
+      QFile::remove( temporary );
+      return false;
+    }
+
+    return true;
+  }
+
+  bool SpikeCache::write( const std::string& path ,
+                          uint64_t hash ,
+                          const simil::SpikeData& data )
+  {
+    const auto& spikes = data.spikes( );
+    const auto& neuronGids = data.gids( );
+    const auto& neuronPositions = data.positions( );
+
+    const std::vector< uint32_t > neurons( neuronGids.begin( ) ,
+                                           neuronGids.end( ));
+
+    std::vector< float > positions;
+    positions.reserve( neuronPositions.size( ) * 3 );
+    for ( const auto& position: neuronPositions )
+    {
+      positions.push_back( position.x( ));
+      positions.push_back( position.y( ));
+      positions.push_back( position.z( ));
+    }
+
+    // Counting pass for the per-GID index, the spikes aren't copied.
+    std::vector< uint64_t > counts;
+    for ( const auto& spike: spikes )
+    {
+      if ( spike.second >= counts.size( ))
+        counts.resize( static_cast< size_t >( spike.second ) + 1 , 0 );
+      ++counts[ spike.second ];
+    }
+
+    size_t next = 0;
+    auto read = [ &spikes , &next ]( simil::Spike* block , size_t capacity )
+    {
+      const size_t count = std::min( capacity , spikes.size( ) - next );
+      std::copy( spikes.cbegin( ) + next , spikes.cbegin( ) + next + count ,
+                 block );
+      next += count;
+      return count;
+    };
+
+    return writeFile( path , hash , data.startTime( ) , data.endTime( ) ,
+                      neurons , positions , counts , read );
+  }
+
+  bool SpikeCache::open( const std::string& path , uint64_t hash )
+  {
+    close( );
+
+    _file.setFileName( QString::fromStdString( path ));
+    if ( !_file.exists( ) || !_file.open( QIODevice::ReadOnly ))
+      return false;
+
+    const qint64 size = _file.size( );
+    if ( size < static_cast< qint64 >( sizeof( Header )))
+    {
+      close( );
+      return false;
+    }
+
+    _data = _file.map( 0 , size );
+    if ( _data == nullptr )
+    {
+      close( );
+      return false;
+    }
+
+    _header = reinterpret_cast< const Header* >( _data );
+
+    const uint64_t fileSize = static_cast< uint64_t >( size );
+
+    // Every section within the file, in the order they are written and
+    // without overlapping.
+    uint64_t end = sizeof( Header );
+    bool valid =
+      std::memcmp( _header->magic , MAGIC , sizeof( MAGIC )) == 0 &&
+      _header->version == VERSION &&
+      _header->sourceHash == hash &&
+      _header->fileSize == fileSize &&
+      checkSection( _header->timesOffset , _header->spikes ,
+                    sizeof( float ) , fileSize , end ) &&
+      checkSection( _header->gidsOffset , _header->spikes ,
+                    sizeof( uint32_t ) , fileSize , end ) &&
+      checkSection( _header->neuronsOffset , _header->neurons ,
+                    sizeof( uint32_t ) , fileSize , end ) &&
+      checkSection( _header->positionsOffset , _header->neurons ,
+                    3 * sizeof( float ) , fileSize , end ) &&
+      checkSection( _header->indexOffset , _header->indexSize ,
+                    sizeof( uint64_t ) , fileSize , end ) &&
+      checkSection( _header->indexTimesOffset , _header->spikes ,
+                    sizeof( float ) , fileSize , end );
+
+    // The index covers all the spikes, or there are none.
+    if ( valid )
+    {
+      const auto offsets =
+        reinterpret_cast< const uint64_t* >( _data + _header->indexOffset );
+      valid = _header->indexSize == 0 ?
+              _header->spikes == 0 :
+              offsets[ 0 ] == 0 &&
+              offsets[ _header->indexSize - 1 ] == _header->spikes;
+    }
+
+    if ( !valid )
+    {
+      close( );
+      return false;
+    }
+
+    return true;
+  }
+
+  void SpikeCache::close( )
+  {
+    if ( _data != nullptr )
+      _file.unmap( const_cast< uchar* >( _data ));
+
+    _data = nullptr;
+    _header = nullptr;
+
+    if ( _file.isOpen( ))
+      _file.close( );
+  }
+
+  bool SpikeCache::isOpen( ) const
+  {
+    return _header != nullptr;
+  }
+
+  template< typename T >
+  const T* SpikeCache::_section( uint64_t offset ) const
+  {
+    return _header ? reinterpret_cast< const T* >( _data + offset ) : nullptr;
+  }
+
+  size_t SpikeCache::spikesNumber( ) const
+  {
+    return _header ? _header->spikes : 0;
+  }
+
+  size_t SpikeCache::neuronsNumber( ) const
+  {
+    return _header ? _header->neurons : 0;
+  }
+
+  float SpikeCache::startTime( ) const
+  {
+    return _header ? _header->startTime : 0.0f;
+  }
+
+  float SpikeCache::endTime( ) const
+  {
+    return _header ? _header->endTime : 0.0f;
+  }
+
+  const float* SpikeCache::times( ) const
+  {
+    return _section< float >( _header ? _header->timesOffset : 0 );
+  }
+
+  const uint32_t* SpikeCache::gids( ) const
+  {
+    return _section< uint32_t >( _header ? _header->gidsOffset : 0 );
+  }
+
+  const uint32_t* SpikeCache::neurons( ) const
+  {
+    return _section< uint32_t >( _header ? _header->neuronsOffset : 0 );
+  }
+
+  const float* SpikeCache::positions( ) const
+  {
+    return _section< float >( _header ? _header->positionsOffset : 0 );
+  }
+
+  size_t SpikeCache::indexSize( ) const
+  {
+    return _header ? _header->indexSize : 0;
+  }
+
+  const uint64_t* SpikeCache::gidOffsets( ) const
+  {
+    return _section< uint64_t >( _header ? _header->indexOffset : 0 );
+  }
+
+  const float* SpikeCache::gidTimes( ) const
+  {
+    return _section< float >( _header ? _header->indexTimesOffset : 0 );
+  }
+
+  void SpikeCache::prefetch( size_t firstSpike , size_t lastSpike ) const
+  {
+#ifdef Q_OS_UNIX
+    lastSpike = std::min( lastSpike , spikesNumber( ));
+    if ( !_header || firstSpike >= lastSpike ) return;
+
+    const uint64_t page = static_cast< uint64_t >( sysconf( _SC_PAGESIZE ));
+    auto advise = [ this , page ]( uint64_t first , uint64_t last )
+    {
+      const uint64_t begin = first & ~( page - 1 );
+      madvise( const_cast< uchar* >( _data ) + begin , last - begin ,
+               MADV_WILLNEED );
+    };
+
+    advise( _header->timesOffset + firstSpike * sizeof( float ) ,
+            _header->timesOffset + lastSpike * sizeof( float ));
+    advise( _header->gidsOffset + firstSpike * sizeof( uint32_t ) ,
+            _header->gidsOffset + lastSpike * sizeof( uint32_t ));
+#else
+    Q_UNUSED( firstSpike );
+    Q_UNUSED( lastSpike );
+#endif
+  }
+
+  std::unique_ptr< simil::SpikeData > SpikeCache::spikeData( ) const
+  {
+    auto data = networkData( );
+    if ( !data ) return nullptr;
+
+    const size_t spikesNumber_ = spikesNumber( );
+    const float* times_ = times( );
+    const uint32_t* gids_ = gids( );
+
+    simil::Spikes spikes;
+    spikes.reserve( spikesNumber_ );
+    for ( size_t i = 0; i < spikesNumber_; ++i )
+      spikes.push_back( std::make_pair( times_[ i ] , gids_[ i ] ));
+
+    data->setSpikes( std::move( spikes ));
+
+    return data;
+  }
+
+  std::unique_ptr< simil::SpikeData > SpikeCache::networkData( ) const
+  {
+    if ( !isOpen( )) return nullptr;
+
+    std::unique_ptr< simil::SpikeData > data( new simil::SpikeData( ));
+
+    const size_t neuronsNumber_ = neuronsNumber( );
+    const uint32_t* neurons_ = neurons( );
+    const float* positions_ = positions( );
+
+    simil::TGIDSet gidSet( neurons_ , neurons_ + neuronsNumber_ );
+
+    simil::TPosVect positionVector;
+    positionVector.reserve( neuronsNumber_ );
+    for ( size_t i = 0; i < neuronsNumber_; ++i )
+      positionVector.emplace_back( positions_[ 3 * i ] ,
+                                   positions_[ 3 * i + 1 ] ,
+                                   positions_[ 3 * i + 2 ] );
+
+    data->setGids( gidSet );
+    data->setPositions( positionVector );
+    data->setStartTime( startTime( ));
+    data->setEndTime( endTime( ));
+
+    return data;
+  }
+
+  SpikeCacheWriter::SpikeCacheWriter( const std::string& path ,
+                                      uint64_t hash ,
+                                      size_t runSpikes )
+    : _path( path )
+    , _hash( hash )
+    , _runSpikes( std::max< size_t >( runSpikes , 1 ))
+    , _spikesNumber( 0 )
+    , _startTime( 0.0f )
+    , _endTime( 0.0f )
+    , _sorted( true )
+  { }
+
+  SpikeCacheWriter::~SpikeCacheWriter( )
+  { }
+
+  bool SpikeCacheWriter::open( )
+  {
+    _runsFile.reset( new QTemporaryFile(
+      QString::fromStdString( _path ) + ".runs.XXXXXX" ));
+    if ( !_runsFile->open( ))
+    {
+      _runsFile = nullptr;
+      return false;
+    }
+
+    _runs.clear( );
+    _run.clear( );
+    _run.reserve( _runSpikes );
+    return true;
+  }
+
+  void SpikeCacheWriter::setNetwork( const std::vector< uint32_t >& gids ,
+                                     const std::vector< float >& positions )
+  {
+    // Sorted by GID as SimIL keeps them, the first of repeated GIDs.
+    std::vector< size_t > order( std::min( gids.size( ) ,
+                                           positions.size( ) / 3 ));
+    for ( size_t i = 0; i < order.size( ); ++i )
+      order[ i ] = i;
+    std::stable_sort( order.begin( ) , order.end( ) ,
+                      [ &gids ]( size_t a , size_t b )
+                      { return gids[ a ] < gids[ b ]; } );
+
+    _neurons.clear( );
+    _positions.clear( );
+    _inNetwork.clear( );
+    for ( const auto i: order )
+    {
+      if ( !_neurons.empty( ) && _neurons.back( ) == gids[ i ] ) continue;
+
+      _neurons.push_back( gids[ i ] );
+      _positions.insert( _positions.end( ) , positions.begin( ) + i * 3 ,
+                         positions.begin( ) + i * 3 + 3 );
+    }
+
+    if ( !_neurons.empty( ))
+    {
+      _inNetwork.resize( static_cast< size_t >( _neurons.back( )) + 1 , false );
+      for ( const auto gid: _neurons )
+        _inNetwork[ gid ] = true;
+    }
+  }
+
+  bool SpikeCacheWriter::append( const simil::Spike* spikes , size_t count )
+  {
+    if ( !_runsFile ) return false;
+
+    for ( size_t i = 0; i < count; ++i )
+    {
+      const auto& spike = spikes[ i ];
+      const auto gid = spike.second;
+      if ( gid >= _inNetwork.size( ) || !_inNetwork[ gid ]) continue;
+
+      if ( _spikesNumber == 0 )
+      {
+        _startTime = _endTime = spike.first;
+      }
+      else
+      {
+        _sorted = _sorted && spike.first >= _endTime;
+        _startTime = std::min( _startTime , spike.first );
+        _endTime = std::max( _endTime , spike.first );
+      }
+
+      if ( gid >= _counts.size( ))
+        _counts.resize( static_cast< size_t >( gid ) + 1 , 0 );
+      ++_counts[ gid ];
+      ++_spikesNumber;
+
+      _run.push_back( spike );
+      if ( _run.size( ) == _runSpikes && !_spill( ))
+        return false;
+    }
+
+    return true;
+  }
+
+  bool SpikeCacheWriter::_spill( )
+  {
+    // Stable, spikes of the same time keep the order they came in.
+    if ( !_sorted )
+      std::stable_sort( _run.begin( ) , _run.end( ) ,
+                        []( const simil::Spike& a , const simil::Spike& b )
+                        { return a.first < b.first; } );
+
+    const qint64 bytes = static_cast< qint64 >( _run.size( ) *
+                                                sizeof( simil::Spike ));
+    if ( _runsFile->write( reinterpret_cast< const char* >( _run.data( )) ,
+                           bytes ) != bytes )
+      return false;
+
+    _runs.push_back(( _runs.empty( ) ? 0 : _runs.back( )) + _run.size( ));
+    _run.clear( );
+    return true;
+  }
+
+  uint64_t SpikeCacheWriter::spikesNumber( ) const
+  {
+    return _spikesNumber;
+  }
+
+  float SpikeCacheWriter::startTime( ) const
+  {
+    return _startTime;
+  }
+
+  float SpikeCacheWriter::endTime( ) const
+  {
+    return _endTime;
+  }
+
+  bool SpikeCacheWriter::finish(
+    const std::function< void( uint64_t ) >& progress )
+  {
+    if ( !_runsFile ) return false;
+
+    // A single run is merged from memory, the others are read back in
+    // blocks. Runs in time order, all if the spikes came sorted, are
+    // read in sequence.
+    if ( !_runs.empty( ) && !_run.empty( ) && !_spill( ))
+      return false;
+    if ( _runs.empty( ) && !_sorted )
+      std::stable_sort( _run.begin( ) , _run.end( ) ,
+                        []( const simil::Spike& a , const simil::Spike& b )
+                        { return a.first < b.first; } );
+
+    struct Run
+    {
+      uint64_t next;
+      uint64_t end;
+      simil::Spikes buffer;
+      size_t position;
+    };
+
+    std::vector< Run > runs;
+    if ( _sorted && !_runs.empty( ))
+    {
+      runs.push_back( Run{ 0 , _runs.back( ) , simil::Spikes( ) , 0 } );
+    }
+    else
+    {
+      for ( size_t i = 0; i < _runs.size( ); ++i )
+        runs.push_back( Run{ i == 0 ? 0 : _runs[ i - 1 ] , _runs[ i ] ,
+                             simil::Spikes( ) , 0 } );
+    }
+
+    // Refills the buffer of a run, false once it is over.
+    const size_t runBlock = std::max< size_t >( BLOCK_SPIKES / std::max<
+      size_t >( runs.size( ) , 1 ) , 1024 );
+    auto refill = [ this , runBlock ]( Run& run )
+    {
+      const size_t count = static_cast< size_t >(
+        std::min< uint64_t >( runBlock , run.end - run.next ));
+      run.buffer.resize( count );
+      run.position = 0;
+      if ( count == 0 ) return false;
+
+      const qint64 bytes = static_cast< qint64 >( count *
+                                                  sizeof( simil::Spike ));
+      if ( !_runsFile->seek( static_cast< qint64 >(
+             run.next * sizeof( simil::Spike ))) ||
+           _runsFile->read( reinterpret_cast< char* >( run.buffer.data( )) ,
+                            bytes ) != bytes )
+        throw std::runtime_error( "SpikeCacheWriter: error reading runs" );
+
+      run.next += count;
+      return true;
+    };
+
+    // Earliest head first, the earlier run on ties.
+    typedef std::pair< float , size_t > Head;
+    std::priority_queue< Head , std::vector< Head > , std::greater< Head >>
+      heads;
+    for ( size_t i = 0; i < runs.size( ); ++i )
+    {
+      if ( refill( runs[ i ] ))
+        heads.emplace( runs[ i ].buffer.front( ).first , i );
+    }
+
+    size_t next = 0;
+    uint64_t written = 0;
+    auto read = [ & ]( simil::Spike* block , size_t capacity )
+    {
+      size_t count = 0;
+      if ( _runs.empty( ))
+      {
+        count = std::min( capacity , _run.size( ) - next );
+        std::copy( _run.cbegin( ) + next , _run.cbegin( ) + next + count ,
+                   block );
+        next += count;
+      }
+      else
+      {
+        while ( count < capacity && !heads.empty( ))
+        {
+          const auto index = heads.top( ).second;
+          heads.pop( );
+
+          auto& run = runs[ index ];
+          block[ count++ ] = run.buffer[ run.position++ ];
+
+          if ( run.position < run.buffer.size( ) || refill( run ))
+            heads.emplace( run.buffer[ run.position ].first , index );
+        }
+      }
+
+      written += count;
+      if ( progress && count > 0 ) progress( written );
+      return count;
+    };
+
+    const bool result =
+      SpikeCache::writeFile( _path , _hash , _startTime , _endTime ,
+                             _neurons , _positions , _counts , read );
+
+    _runsFile = nullptr;
+    _runs.clear( );
+    simil::Spikes( ).swap( _run );
+
+    return result;
+  }
+}
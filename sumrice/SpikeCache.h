@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SPIKE_CACHE_H__
+#define __VISIMPL_SPIKE_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QFile>
+#include <QTemporaryFile>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Binary sidecar of a loaded spike dataset, written next to its source
+   * files after the first successful load so later loads skip parsing and
+   * reduceDataToGIDS( ).
+   *
+   * The file holds a header, the spike times (sorted) and GIDs as separate
+   * columns, the network GIDs and positions, and a per-GID index (CSR
+   * offsets over the spike times of every GID). It is memory mapped when
+   * opened, the accessors return views into the mapping.
+   *
+   * The header stores a hash of the source files, a cache is only opened
+   * if it matches the current sources.
+   */
+  class SUMRICE_API SpikeCache
+  {
+  public:
+
+    static constexpr uint32_t VERSION = 1;
+
+    SpikeCache( );
+
+    ~SpikeCache( );
+
+    SpikeCache( const SpikeCache& ) = delete;
+
+    SpikeCache& operator=( const SpikeCache& ) = delete;
+
+    /**
+     * Path of the sidecar of the given source file.
+     */
+    static std::string cachePath( const std::string& source );
+
+    /**
+     * Hash identifying the given sources: the data type, and the size,
+     * modification time and first and last megabyte of every file. Empty
+     * paths are skipped.
+     */
+    static uint64_t sourceHash( const std::vector< std::string >& sources ,
+                                int dataType );
+
+    /**
+     * Writes the cache of the loaded data, whose spikes are sorted by time.
+     * The file is replaced atomically. Only a block of the spikes is copied
+     * at a time, the per-GID index is counted first and filled in place.
+     *
+     * @return false if the file couldn't be written.
+     */
+    static bool write( const std::string& path ,
+                       uint64_t hash ,
+                       const simil::SpikeData& data );
+
+    /**
+     * Maps the cache file. Fails if it doesn't exist, is corrupted or was
+     * written from other sources.
+     */
+    bool open( const std::string& path , uint64_t hash );
+
+    void close( );
+
+    bool isOpen( ) const;
+
+    size_t spikesNumber( ) const;
+
+    size_t neuronsNumber( ) const;
+
+    float startTime( ) const;
+
+    float endTime( ) const;
+
+    /**
+     * Spike columns, spikesNumber( ) elements each, sorted by time.
+     */
+    const float* times( ) const;
+    const uint32_t* gids( ) const;
+
+    /**
+     * Network GIDs, sorted, and their positions (x, y, z per neuron).
+     */
+    const uint32_t* neurons( ) const;
+    const float* positions( ) const;
+
+    /**
+     * Spike times of every GID: those of gid are
+     * gidTimes( )[ gidOffsets( )[ gid ] ] to
+     * gidTimes( )[ gidOffsets( )[ gid + 1 ] ], for gid < indexSize( ) - 1.
+     */
+    size_t indexSize( ) const;
+    const uint64_t* gidOffsets( ) const;
+    const float* gidTimes( ) const;
+
+    /**
+     * Hints the system to read the times and GIDs of the spikes
+     * [firstSpike, lastSpike) into memory in the background.
+     */
+    void prefetch( size_t firstSpike , size_t lastSpike ) const;
+
+    /**
+     * Builds the simulation data from the mapped file. SimIL owns its
+     * containers, so this is a copy of the columns, without parsing.
+     */
+    std::unique_ptr< simil::SpikeData > spikeData( ) const;
+
+    /**
+     * Same as spikeData( ) without the spikes: the network and the time
+     * range of the simulation, for loads that stream the spikes afterwards.
+     */
+    std::unique_ptr< simil::SpikeData > networkData( ) const;
+
+  protected:
+
+    friend class SpikeCacheWriter;
+
+    struct Header;
+
+    /**
+     * Fills the given buffer with up to capacity spikes, the next ones in
+     * time order, and returns how many. 0 once they are over.
+     */
+    typedef std::function< size_t( simil::Spike* , size_t ) > SpikeReader;
+
+    /**
+     * Writes a cache whose spikes, counts[ gid ] of every GID, are given
+     * by read.
+     */
+    static bool writeFile( const std::string& path ,
+                           uint64_t hash ,
+                           float startTime ,
+                           float endTime ,
+                           const std::vector< uint32_t >& neurons ,
+                           const std::vector< float >& positions ,
+                           const std::vector< uint64_t >& counts ,
+                           const SpikeReader& read );
+
+    template< typename T >
+    const T* _section( uint64_t offset ) const;
+
+    QFile _file;
+    const uchar* _data;
+    const Header* _header;
+  };
+
+  /**
+   * Writes a SpikeCache from spikes given a block at a time, as they are
+   * parsed, without holding them all in memory.
+   *
+   * The spikes are buffered in runs, sorted by time and spilled to a
+   * temporary file next to the cache. finish( ) merges the runs into the
+   * cache, spikes appended in time order are only copied. The per-GID
+   * counts of the index are kept while appending.
+   */
+  class SUMRICE_API SpikeCacheWriter
+  {
+  public:
+
+    // Spikes sorted in memory at once, 32 MB.
+    static constexpr size_t DEFAULT_RUN_SPIKES = 1 << 22;
+
+    SpikeCacheWriter( const std::string& path ,
+                      uint64_t hash ,
+                      size_t runSpikes = DEFAULT_RUN_SPIKES );
+
+    ~SpikeCacheWriter( );
+
+    SpikeCacheWriter( const SpikeCacheWriter& ) = delete;
+
+    SpikeCacheWriter& operator=( const SpikeCacheWriter& ) = delete;
+
+    /**
+     * Creates the temporary file of the runs.
+     *
+     * @return false if it can't be created.
+     */
+    bool open( );
+
+    /**
+     * Network of the cache, x, y and z per GID. Spikes of other GIDs are
+     * dropped, as reduceDataToGIDS( ) does. Set before appending.
+     */
+    void setNetwork( const std::vector< uint32_t >& gids ,
+                     const std::vector< float >& positions );
+
+    /**
+     * Appends spikes in any order.
+     *
+     * @return false if a run couldn't be spilled.
+     */
+    bool append( const simil::Spike* spikes , size_t count );
+
+    /**
+     * Spikes appended and kept.
+     */
+    uint64_t spikesNumber( ) const;
+
+    /**
+     * Time range of the spikes kept, 0 to 0 without spikes.
+     */
+    float startTime( ) const;
+    float endTime( ) const;
+
+    /**
+     * Merges the runs into the cache. progress, if given, is called with
+     * the spikes written after every block and may throw to stop.
+     *
+     * @return false if the cache couldn't be written.
+     */
+    bool finish( const std::function< void( uint64_t ) >& progress = nullptr );
+
+  protected:
+
+    bool _spill( );
+
+    std::string _path;
+    uint64_t _hash;
+    size_t _runSpikes;
+    std::unique_ptr< QTemporaryFile > _runsFile;
+    std::vector< uint64_t > _runs;
+    simil::Spikes _run;
+    std::vector< uint32_t > _neurons;
+    std::vector< float > _positions;
+    std::vector< bool > _inNetwork;
+    std::vector< uint64_t > _counts;
+    uint64_t _spikesNumber;
+    float _startTime;
+    float _endTime;
+    bool _sorted;
+  };
+}
+
+#endif /* __VISIMPL_SPIKE_CACHE_H__ */
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SpikeChunkQueue.h"
+
+#include <utility>
+
+namespace visimpl
+{
+  namespace
+  {
+    size_t roundUpToPowerOfTwo( size_t value )
+    {
+      size_t result = 1;
+      while ( result < value )
+        result <<= 1;
+
+      return result;
+    }
+  }
+
+  constexpr size_t SpikeChunkQueue::DEFAULT_CAPACITY;
+
+  SpikeChunkQueue::SpikeChunkQueue( size_t capacity )
+    : _chunks( roundUpToPowerOfTwo( capacity ))
+    , _mask( _chunks.size( ) - 1 )
+    , _head( 0 )
+    , _tail( 0 )
+    , _closed( false )
+  { }
+
+  bool SpikeChunkQueue::push( simil::Spikes& chunk )
+  {
+    const size_t tail = _tail.load( std::memory_order_relaxed );
+    if ( tail - _head.load( std::memory_order_acquire ) == _chunks.size( ))
+      return false;
+
+    _chunks[ tail & _mask ] = std::move( chunk );
+    _tail.store( tail + 1 , std::memory_order_release );
+
+    return true;
+  }
+
+  void SpikeChunkQueue::close( )
+  {
+    _closed.store( true , std::memory_order_release );
+  }
+
+  bool SpikeChunkQueue::pop( simil::Spikes& chunk )
+  {
+    const size_t head = _head.load( std::memory_order_relaxed );
+    if ( head == _tail.load( std::memory_order_acquire ))
+      return false;
+
+    chunk = std::move( _chunks[ head & _mask ] );
+    _chunks[ head & _mask ] = simil::Spikes( );
+    _head.store( head + 1 , std::memory_order_release );
+
+    return true;
+  }
+
+  bool SpikeChunkQueue::finished( ) const
+  {
+    // Closed is read first: chunks pushed before closing are visible once
+    // the close is.
+    return _closed.load( std::memory_order_acquire ) && empty( );
+  }
+
+  bool SpikeChunkQueue::empty( ) const
+  {
+    return _head.load( std::memory_order_acquire ) ==
+           _tail.load( std::memory_order_acquire );
+  }
+
+  size_t SpikeChunkQueue::capacity( ) const
+  {
+    return _chunks.size( );
+  }
+}
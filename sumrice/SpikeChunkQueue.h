@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SPIKE_CHUNK_QUEUE_H__
+#define __VISIMPL_SPIKE_CHUNK_QUEUE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Bounded lock-free queue handing chunks of spikes from a single producer
+   * (the loader thread) to a single consumer (the GUI thread). Chunks are
+   * time ordered, the spikes of a chunk come after those of every previous
+   * one. Neither side ever blocks: push fails when the queue is full and
+   * pop when it is empty.
+   *
+   * The producer closes the queue once the last chunk is pushed, the stream
+   * is over when the queue is closed and empty.
+   */
+  class SUMRICE_API SpikeChunkQueue
+  {
+  public:
+
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    /**
+     * The capacity is rounded up to a power of two.
+     */
+    explicit SpikeChunkQueue( size_t capacity = DEFAULT_CAPACITY );
+
+    SpikeChunkQueue( const SpikeChunkQueue& ) = delete;
+
+    SpikeChunkQueue& operator=( const SpikeChunkQueue& ) = delete;
+
+    /**
+     * Producer side. Moves the chunk into the queue, leaves it untouched and
+     * returns false if the queue is full.
+     */
+    bool push( simil::Spikes& chunk );
+
+    /**
+     * Producer side. No chunk may be pushed after closing the queue.
+     */
+    void close( );
+
+    /**
+     * Consumer side. Moves the oldest chunk out of the queue, returns false
+     * if there is none.
+     */
+    bool pop( simil::Spikes& chunk );
+
+    /**
+     * True once the producer closed the queue and every chunk was popped.
+     */
+    bool finished( ) const;
+
+    bool empty( ) const;
+
+    size_t capacity( ) const;
+
+  protected:
+
+    std::vector< simil::Spikes > _chunks;
+    const size_t _mask;
+
+    // Each index is written by one side only, kept on separate cache lines
+    // so they don't bounce between the producer and consumer cores.
+    alignas( 64 ) std::atomic< size_t > _head;
+    alignas( 64 ) std::atomic< size_t > _tail;
+    alignas( 64 ) std::atomic< bool > _closed;
+  };
+}
+
+#endif /* __VISIMPL_SPIKE_CHUNK_QUEUE_H__ */
@@ -0,0 +1,713 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SpikeFileReader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <hdf5.h>
+
+namespace visimpl
+{
+  namespace
+  {
+    // Bytes of a CSV file read at once, grown for longer lines.
+    constexpr size_t CSV_BUFFER = 1 << 20;
+
+    // Powers of ten exactly representable as doubles.
+    const double EXACT_POWERS[ ] = { 1e0 , 1e1 , 1e2 , 1e3 , 1e4 , 1e5 , 1e6 ,
+                                     1e7 , 1e8 , 1e9 , 1e10 , 1e11 , 1e12 ,
+                                     1e13 , 1e14 , 1e15 , 1e16 , 1e17 , 1e18 ,
+                                     1e19 , 1e20 , 1e21 , 1e22 };
+
+    uint64_t fileSize( const std::string& path )
+    {
+      std::FILE* file = std::fopen( path.c_str( ) , "rb" );
+      if ( !file ) return 0;
+
+      std::fseek( file , 0 , SEEK_END );
+      const long size = std::ftell( file );
+      std::fclose( file );
+
+      return size > 0 ? static_cast< uint64_t >( size ) : 0;
+    }
+
+    bool isDigit( char c )
+    {
+      return c >= '0' && c <= '9';
+    }
+
+    const char* skipBlanks( const char* it , const char* end )
+    {
+      while ( it != end && ( *it == ' ' || *it == '\t' )) ++it;
+      return it;
+    }
+
+    // Unsigned integer of a whole field, blanks around it allowed.
+    bool parseGid( const char* it , const char* end , uint32_t& gid )
+    {
+      it = skipBlanks( it , end );
+      if ( it != end && *it == '+' ) ++it;
+      if ( it == end || !isDigit( *it )) return false;
+
+      uint64_t value = 0;
+      for ( ; it != end && isDigit( *it ); ++it )
+      {
+        value = value * 10 + static_cast< uint64_t >( *it - '0' );
+        if ( value > std::numeric_limits< uint32_t >::max( )) return false;
+      }
+
+      gid = static_cast< uint32_t >( value );
+      return skipBlanks( it , end ) == end;
+    }
+
+    // Decimal number of a whole field with '.' as decimal point, whatever
+    // the application locale.
+    bool parseNumber( const char* it , const char* end , float& number )
+    {
+      it = skipBlanks( it , end );
+      const char* first = it;
+
+      bool negative = false;
+      if ( it != end && ( *it == '-' || *it == '+' ))
+        negative = *it++ == '-';
+
+      uint64_t mantissa = 0;
+      int digits = 0;
+      int exponent = 0;
+      bool any = false;
+
+      for ( ; it != end && isDigit( *it ); ++it , any = true )
+      {
+        if ( digits < 19 )
+        {
+          mantissa = mantissa * 10 + static_cast< uint64_t >( *it - '0' );
+          if ( mantissa != 0 ) ++digits;
+        }
+        else
+          ++exponent;
+      }
+
+      if ( it != end && *it == '.' )
+      {
+        for ( ++it; it != end && isDigit( *it ); ++it , any = true )
+        {
+          if ( digits < 19 )
+          {
+            mantissa = mantissa * 10 + static_cast< uint64_t >( *it - '0' );
+            if ( mantissa != 0 ) ++digits;
+            --exponent;
+          }
+        }
+      }
+
+      if ( !any ) return false;
+
+      if ( it != end && ( *it == 'e' || *it == 'E' ))
+      {
+        ++it;
+        bool negativeExponent = false;
+        if ( it != end && ( *it == '-' || *it == '+' ))
+          negativeExponent = *it++ == '-';
+        if ( it == end || !isDigit( *it )) return false;
+
+        int value = 0;
+        for ( ; it != end && isDigit( *it ); ++it )
+          value = std::min( value * 10 + ( *it - '0' ) , 100000 );
+        exponent += negativeExponent ? -value : value;
+      }
+
+      const char* last = it;
+      if ( skipBlanks( it , end ) != end ) return false;
+
+      // Exact mantissa and power of ten round once, anything else goes
+      // through the classic locale stream.
+      double value;
+      if ( mantissa <= ( uint64_t( 1 ) << 53 ) && exponent >= -22 &&
+           exponent <= 22 )
+      {
+        value = static_cast< double >( mantissa );
+        value = exponent < 0 ? value / EXACT_POWERS[ -exponent ] :
+                               value * EXACT_POWERS[ exponent ];
+        if ( negative ) value = -value;
+      }
+      else
+      {
+        std::istringstream stream( std::string( first , last ));
+        stream.imbue( std::locale::classic( ));
+        if ( !( stream >> value )) return false;
+      }
+
+      number = static_cast< float >( value );
+      return true;
+    }
+
+    /**
+     * Lines of a text file, read in large blocks.
+     */
+    class LineReader
+    {
+    public:
+
+      LineReader( )
+        : _file( nullptr )
+        , _buffer( CSV_BUFFER )
+        , _begin( 0 )
+        , _end( 0 )
+        , _bytesRead( 0 )
+        , _line( 0 )
+      { }
+
+      ~LineReader( )
+      {
+        close( );
+      }
+
+      bool open( const std::string& path )
+      {
+        close( );
+        _path = path;
+        _file = std::fopen( path.c_str( ) , "rb" );
+        return _file != nullptr;
+      }
+
+      void close( )
+      {
+        if ( _file ) std::fclose( _file );
+        _file = nullptr;
+        _begin = _end = 0;
+      }
+
+      /**
+       * Next line, without its end of line characters. false at the end of
+       * the file.
+       */
+      bool next( const char*& begin , const char*& end )
+      {
+        while ( _file || _begin != _end )
+        {
+          char* first = _buffer.data( ) + _begin;
+          char* last = _buffer.data( ) + _end;
+          char* newline = static_cast< char* >(
+            std::memchr( first , '\n' , _end - _begin ));
+
+          if ( newline || !_file )
+          {
+            char* lineEnd = newline ? newline : last;
+            _begin = newline ? newline + 1 - _buffer.data( ) : _end;
+            _bytesRead += static_cast< uint64_t >( lineEnd - first ) +
+                          ( newline ? 1 : 0 );
+            ++_line;
+
+            if ( lineEnd != first && lineEnd[ -1 ] == '\r' ) --lineEnd;
+            begin = first;
+            end = lineEnd;
+            return true;
+          }
+
+          // Partial line, moved to the front before reading more.
+          std::memmove( _buffer.data( ) , first , _end - _begin );
+          _end -= _begin;
+          _begin = 0;
+          if ( _end == _buffer.size( )) _buffer.resize( _buffer.size( ) * 2 );
+
+          const size_t read = std::fread( _buffer.data( ) + _end , 1 ,
+                                          _buffer.size( ) - _end , _file );
+          _end += read;
+          if ( read == 0 )
+          {
+            if ( std::ferror( _file ))
+              throw std::runtime_error( "SpikeFileReader: error reading " +
+                                        _path );
+            std::fclose( _file );
+            _file = nullptr;
+          }
+        }
+
+        return false;
+      }
+
+      uint64_t bytesRead( ) const
+      {
+        return _bytesRead;
+      }
+
+      // Line number of the last line returned, from 1.
+      uint64_t line( ) const
+      {
+        return _line;
+      }
+
+      const std::string& path( ) const
+      {
+        return _path;
+      }
+
+    protected:
+
+      std::FILE* _file;
+      std::string _path;
+      std::vector< char > _buffer;
+      size_t _begin;
+      size_t _end;
+      uint64_t _bytesRead;
+      uint64_t _line;
+    };
+
+
+    [[noreturn]] void malformed( const LineReader& reader )
+    {
+      throw std::runtime_error( "SpikeFileReader: malformed row " +
+                                std::to_string( reader.line( )) + " of " +
+                                reader.path( ));
+    }
+
+    class CSVReader : public SpikeFileReader
+    {
+    public:
+
+      bool open( const std::string& network , const std::string& activity )
+      {
+        _totalBytes = fileSize( network ) + fileSize( activity );
+        return _network.open( network ) && _activity.open( activity );
+      }
+
+      size_t readNeurons( uint32_t* gids , float* positions ,
+                          size_t capacity ) override
+      {
+        size_t count = 0;
+        const char* begin;
+        const char* end;
+        while ( count < capacity && _network.next( begin , end ))
+        {
+          _fields.clear( );
+          for ( const char* field = begin; ; )
+          {
+            const char* comma = std::find( field , end , ',' );
+            _fields.emplace_back( field , comma );
+            if ( comma == end ) break;
+            field = comma + 1;
+          }
+
+          // Headers and blank rows.
+          uint32_t gid;
+          if ( !parseGid( _fields[ 0 ].first , _fields[ 0 ].second , gid ))
+          {
+            if ( skipBlanks( begin , end ) == end ||
+                 !isDigit( *skipBlanks( begin , end )))
+              continue;
+            malformed( _network );
+          }
+
+          const size_t fields = _fields.size( );
+          if ( fields < 4 ) malformed( _network );
+
+          float* position = positions + count * 3;
+          for ( size_t i = 0; i < 3; ++i )
+          {
+            const auto& field = _fields[ fields - 3 + i ];
+            if ( !parseNumber( field.first , field.second , position[ i ] ))
+              malformed( _network );
+          }
+
+          gids[ count++ ] = gid;
+        }
+
+        _bytesRead = _network.bytesRead( );
+        return count;
+      }
+
+      size_t readSpikes( simil::Spike* spikes , size_t capacity ) override
+      {
+        size_t count = 0;
+        const char* begin;
+        const char* end;
+        while ( count < capacity && _activity.next( begin , end ))
+        {
+          const char* comma = std::find( begin , end , ',' );
+
+          uint32_t gid;
+          if ( !parseGid( begin , comma , gid ))
+          {
+            if ( skipBlanks( begin , end ) == end ||
+                 !isDigit( *skipBlanks( begin , end )))
+              continue;
+            malformed( _activity );
+          }
+
+          float time;
+          if ( comma == end || !parseNumber( comma + 1 , end , time ))
+            malformed( _activity );
+
+          spikes[ count++ ] = std::make_pair( time , gid );
+        }
+
+        _bytesRead = _network.bytesRead( ) + _activity.bytesRead( );
+        return count;
+      }
+
+    protected:
+
+      LineReader _network;
+      LineReader _activity;
+      std::vector< std::pair< const char* , const char* >> _fields;
+    };
+
+    /**
+     * Rows [first, first + rows) of a one or two dimensional dataset, in
+     * the given memory type.
+     */
+    bool readRows( hid_t dataset , hid_t memoryType , hsize_t first ,
+                   hsize_t rows , hsize_t columns , void* data )
+    {
+      const hid_t fileSpace = H5Dget_space( dataset );
+      const int rank = H5Sget_simple_extent_ndims( fileSpace );
+
+      const hsize_t offset[ 2 ] = { first , 0 };
+      const hsize_t count[ 2 ] = { rows , columns };
+      bool ok = fileSpace >= 0 &&
+                H5Sselect_hyperslab( fileSpace , H5S_SELECT_SET , offset ,
+                                     nullptr , count , nullptr ) >= 0;
+
+      const hid_t memorySpace = H5Screate_simple( rank , count , nullptr );
+      ok = ok && memorySpace >= 0 &&
+           H5Dread( dataset , memoryType , memorySpace , fileSpace ,
+                    H5P_DEFAULT , data ) >= 0;
+
+      if ( memorySpace >= 0 ) H5Sclose( memorySpace );
+      if ( fileSpace >= 0 ) H5Sclose( fileSpace );
+
+      return ok;
+    }
+
+    // Dimensions of the dataset, empty if its rank isn't the given one.
+    std::vector< hsize_t > datasetDims( hid_t dataset , int rank )
+    {
+      std::vector< hsize_t > dims;
+      const hid_t space = H5Dget_space( dataset );
+      if ( space < 0 ) return dims;
+
+      if ( H5Sget_simple_extent_ndims( space ) == rank )
+      {
+        dims.resize( static_cast< size_t >( rank ));
+        H5Sget_simple_extent_dims( space , dims.data( ) , nullptr );
+      }
+      H5Sclose( space );
+
+      return dims;
+    }
+
+    bool linkExists( hid_t location , const std::string& path )
+    {
+      // Every link of the path, H5Lexists fails on missing intermediates.
+      size_t slash = 0;
+      do
+      {
+        slash = path.find( '/' , slash + 1 );
+        if ( H5Lexists( location , path.substr( 0 , slash ).c_str( ) ,
+                        H5P_DEFAULT ) <= 0 )
+          return false;
+      } while ( slash != std::string::npos );
+
+      return true;
+    }
+
+    herr_t collectGroup( hid_t , const char* name , const H5L_info_t* ,
+                         void* names )
+    {
+      static_cast< std::vector< std::string >* >( names )->push_back( name );
+      return 0;
+    }
+
+    class HDF5Reader : public SpikeFileReader
+    {
+    public:
+
+      HDF5Reader( )
+        : _networkFile( -1 )
+        , _activityFile( -1 )
+        , _cells( -1 )
+        , _nodeIds( -1 )
+        , _timestamps( -1 )
+        , _cellRows( 0 )
+        , _cellColumns( 0 )
+        , _nextCell( 0 )
+        , _population( 0 )
+        , _populationRows( 0 )
+        , _nextSpike( 0 )
+        , _spikesRead( 0 )
+        , _spikesNumber( 0 )
+        , _networkBytes( 0 )
+        , _activityBytes( 0 )
+      { }
+
+      ~HDF5Reader( )
+      {
+        _closePopulation( );
+        if ( _cells >= 0 ) H5Dclose( _cells );
+        if ( _networkFile >= 0 ) H5Fclose( _networkFile );
+        if ( _activityFile >= 0 ) H5Fclose( _activityFile );
+      }
+
+      bool open( const std::string& network , const std::string& activity )
+      {
+        if ( H5Fis_hdf5( network.c_str( )) <= 0 ||
+             H5Fis_hdf5( activity.c_str( )) <= 0 )
+          return false;
+
+        _networkFile = H5Fopen( network.c_str( ) , H5F_ACC_RDONLY ,
+                                H5P_DEFAULT );
+        _activityFile = H5Fopen( activity.c_str( ) , H5F_ACC_RDONLY ,
+                                 H5P_DEFAULT );
+        if ( _networkFile < 0 || _activityFile < 0 ||
+             !linkExists( _networkFile , "cells/positions" ) ||
+             !linkExists( _activityFile , "spikes" ))
+          return false;
+
+        _cells = H5Dopen2( _networkFile , "cells/positions" , H5P_DEFAULT );
+        const auto dims = datasetDims( _cells , 2 );
+        if ( dims.empty( ) || dims[ 1 ] < 4 ) return false;
+        _cellRows = dims[ 0 ];
+        _cellColumns = dims[ 1 ];
+
+        // Every population with both columns, in link order.
+        std::vector< std::string > groups;
+        const hid_t spikes = H5Gopen2( _activityFile , "spikes" , H5P_DEFAULT );
+        if ( spikes < 0 ) return false;
+        H5Literate( spikes , H5_INDEX_NAME , H5_ITER_INC , nullptr ,
+                    collectGroup , &groups );
+        H5Gclose( spikes );
+
+        for ( const auto& group: groups )
+        {
+          const auto path = "spikes/" + group;
+          if ( !linkExists( _activityFile , path + "/node_ids" ) ||
+               !linkExists( _activityFile , path + "/timestamps" ))
+            continue;
+
+          const hid_t nodeIds = H5Dopen2( _activityFile ,
+                                          ( path + "/node_ids" ).c_str( ) ,
+                                          H5P_DEFAULT );
+          const auto dims = datasetDims( nodeIds , 1 );
+          if ( nodeIds >= 0 ) H5Dclose( nodeIds );
+          if ( dims.empty( )) continue;
+
+          _populations.push_back( path );
+          _spikesNumber += dims[ 0 ];
+        }
+
+        _networkBytes = fileSize( network );
+        _activityBytes = fileSize( activity );
+        _totalBytes = _networkBytes + _activityBytes;
+
+        return !_populations.empty( );
+      }
+
+      size_t readNeurons( uint32_t* gids , float* positions ,
+                          size_t capacity ) override
+      {
+        const size_t count = static_cast< size_t >(
+          std::min< hsize_t >( capacity , _cellRows - _nextCell ));
+        if ( count == 0 ) return 0;
+
+        _rows.resize( count * _cellColumns );
+        if ( !readRows( _cells , H5T_NATIVE_FLOAT , _nextCell , count ,
+                        _cellColumns , _rows.data( )))
+          throw std::runtime_error( "SpikeFileReader: error reading cells" );
+
+        // GID first, position last, as the importers read them.
+        for ( size_t i = 0; i < count; ++i )
+        {
+          const float* row = &_rows[ i * _cellColumns ];
+          if ( !( row[ 0 ] >= 0.0f ) ||
+               row[ 0 ] > static_cast< float >(
+                 std::numeric_limits< uint32_t >::max( )))
+            throw std::runtime_error( "SpikeFileReader: invalid cell GID" );
+
+          gids[ i ] = static_cast< uint32_t >( row[ 0 ] );
+          std::copy( row + _cellColumns - 3 , row + _cellColumns ,
+                     positions + i * 3 );
+        }
+
+        _nextCell += count;
+        _updateBytesRead( );
+        return count;
+      }
+
+      size_t readSpikes( simil::Spike* spikes , size_t capacity ) override
+      {
+        while ( _nodeIds < 0 || _nextSpike == _populationRows )
+        {
+          if ( !_openNextPopulation( )) return 0;
+        }
+
+        const size_t count = static_cast< size_t >(
+          std::min< hsize_t >( capacity , _populationRows - _nextSpike ));
+
+        _ids.resize( count );
+        _times.resize( count );
+        if ( !readRows( _nodeIds , H5T_NATIVE_UINT64 , _nextSpike , count , 1 ,
+                        _ids.data( )) ||
+             !readRows( _timestamps , H5T_NATIVE_DOUBLE , _nextSpike , count ,
+                        1 , _times.data( )))
+          throw std::runtime_error( "SpikeFileReader: error reading spikes" );
+
+        for ( size_t i = 0; i < count; ++i )
+        {
+          if ( _ids[ i ] > std::numeric_limits< uint32_t >::max( ))
+            throw std::runtime_error( "SpikeFileReader: invalid spike GID" );
+
+          spikes[ i ] = std::make_pair( static_cast< float >( _times[ i ] ) ,
+                                        static_cast< uint32_t >( _ids[ i ] ));
+        }
+
+        _nextSpike += count;
+        _spikesRead += count;
+        _updateBytesRead( );
+        return count;
+      }
+
+    protected:
+
+      bool _openNextPopulation( )
+      {
+        _closePopulation( );
+        if ( _population == _populations.size( )) return false;
+
+        const auto& path = _populations[ _population++ ];
+        _nodeIds = H5Dopen2( _activityFile , ( path + "/node_ids" ).c_str( ) ,
+                             H5P_DEFAULT );
+        _timestamps = H5Dopen2( _activityFile ,
+                                ( path + "/timestamps" ).c_str( ) ,
+                                H5P_DEFAULT );
+
+        const auto ids = datasetDims( _nodeIds , 1 );
+        const auto times = datasetDims( _timestamps , 1 );
+        if ( ids.empty( ) || times.empty( ) || ids[ 0 ] != times[ 0 ] )
+          throw std::runtime_error( "SpikeFileReader: invalid population " +
+                                    path );
+
+        _populationRows = ids[ 0 ];
+        _nextSpike = 0;
+        return true;
+      }
+
+      void _closePopulation( )
+      {
+        if ( _nodeIds >= 0 ) H5Dclose( _nodeIds );
+        if ( _timestamps >= 0 ) H5Dclose( _timestamps );
+        _nodeIds = _timestamps = -1;
+      }
+
+      // Proportional to the rows read, the datasets may be compressed.
+      void _updateBytesRead( )
+      {
+        _bytesRead = _cellRows == 0 ? 0 :
+                     _networkBytes * _nextCell / _cellRows;
+        if ( _spikesNumber > 0 )
+          _bytesRead += _activityBytes * _spikesRead / _spikesNumber;
+      }
+
+      hid_t _networkFile;
+      hid_t _activityFile;
+      hid_t _cells;
+      hid_t _nodeIds;
+      hid_t _timestamps;
+      hsize_t _cellRows;
+      hsize_t _cellColumns;
+      hsize_t _nextCell;
+      std::vector< std::string > _populations;
+      size_t _population;
+      hsize_t _populationRows;
+      hsize_t _nextSpike;
+      uint64_t _spikesRead;
+      uint64_t _spikesNumber;
+      uint64_t _networkBytes;
+      uint64_t _activityBytes;
+      std::vector< float > _rows;
+      std::vector< uint64_t > _ids;
+      std::vector< double > _times;
+    };
+  }
+
+  SpikeFileReader::SpikeFileReader( )
+    : _bytesRead( 0 )
+    , _totalBytes( 0 )
+  { }
+
+  SpikeFileReader::~SpikeFileReader( )
+  { }
+
+  std::unique_ptr< SpikeFileReader >
+  SpikeFileReader::open( simil::TDataType type , const std::string& network ,
+                         const std::string& activity )
+  {
+    if ( network.empty( ) || activity.empty( )) return nullptr;
+
+    switch ( type )
+    {
+      case simil::TCSV:
+      {
+        std::unique_ptr< CSVReader > reader( new CSVReader( ));
+        if ( reader->open( network , activity ))
+          return std::unique_ptr< SpikeFileReader >( reader.release( ));
+      }
+        break;
+      case simil::THDF5:
+      {
+        // Other layouts are left to SimIL, quietly.
+        H5E_auto2_t function;
+        void* data;
+        H5Eget_auto2( H5E_DEFAULT , &function , &data );
+        H5Eset_auto2( H5E_DEFAULT , nullptr , nullptr );
+
+        std::unique_ptr< HDF5Reader > reader( new HDF5Reader( ));
+        const bool opened = reader->open( network , activity );
+
+        H5Eset_auto2( H5E_DEFAULT , function , data );
+        if ( opened )
+          return std::unique_ptr< SpikeFileReader >( reader.release( ));
+      }
+        break;
+      default:
+        break;
+    }
+
+    return nullptr;
+  }
+
+  uint64_t SpikeFileReader::bytesRead( ) const
+  {
+    return _bytesRead;
+  }
+
+  uint64_t SpikeFileReader::totalBytes( ) const
+  {
+    return _totalBytes;
+  }
+}
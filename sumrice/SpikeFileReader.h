@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SPIKE_FILE_READER_H__
+#define __VISIMPL_SPIKE_FILE_READER_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Reads the network and the spikes of CSV and HDF5 sources a block at a
+   * time, instead of SimIL parsing them whole. The loaders stop, report
+   * progress and write the spike cache between blocks.
+   *
+   * Reads the layouts the importers and SyntheticDataset write:
+   * - CSV: "gid,x,y,z" network rows, the position being the last three
+   *   fields (so "gid,type,x,y,z" also reads), and "gid,time" activity
+   *   rows. Rows that don't start with a number, headers, are skipped.
+   * - HDF5: a "cells/positions" network dataset of gid, type, x, y, z
+   *   rows, and a SONATA spike report, "spikes/<population>/node_ids"
+   *   and "timestamps" of every population.
+   *
+   * Malformed rows throw std::runtime_error.
+   */
+  class SUMRICE_API SpikeFileReader
+  {
+  public:
+
+    /**
+     * Reader of the given sources, nullptr if they aren't in a layout it
+     * reads, SimIL loads them then.
+     */
+    static std::unique_ptr< SpikeFileReader >
+    open( simil::TDataType type , const std::string& network ,
+          const std::string& activity );
+
+    virtual ~SpikeFileReader( );
+
+    SpikeFileReader( const SpikeFileReader& ) = delete;
+
+    SpikeFileReader& operator=( const SpikeFileReader& ) = delete;
+
+    /**
+     * Reads up to capacity neurons, in file order: their GIDs and x, y, z
+     * positions.
+     *
+     * @return neurons read, 0 once they are over.
+     */
+    virtual size_t readNeurons( uint32_t* gids , float* positions ,
+                                size_t capacity ) = 0;
+
+    /**
+     * Reads up to capacity spikes, in file order. The neurons are read
+     * first.
+     *
+     * @return spikes read, 0 once they are over.
+     */
+    virtual size_t readSpikes( simil::Spike* spikes , size_t capacity ) = 0;
+
+    /**
+     * Bytes of the sources read so far, an estimate for HDF5, and their
+     * total size.
+     */
+    uint64_t bytesRead( ) const;
+    uint64_t totalBytes( ) const;
+
+  protected:
+
+    SpikeFileReader( );
+
+    uint64_t _bytesRead;
+    uint64_t _totalBytes;
+  };
+}
+
+#endif /* __VISIMPL_SPIKE_FILE_READER_H__ */
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SpikeHistogram.h"
+
+#include <algorithm>
+
+#ifdef VISIMPL_USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace visimpl
+{
+  namespace
+  {
+    void countChunk( simil::SpikesCIter first ,
+                     simil::SpikesCIter last ,
+                     const std::vector< float >& limits ,
+                     const std::unordered_set< uint32_t >& filter ,
+                     unsigned int* local ,
+                     unsigned int* global )
+    {
+      if ( first == last ) return;
+
+      const size_t bins = limits.size( );
+      const bool filtered = !filter.empty( );
+
+      size_t bin = std::lower_bound( limits.cbegin( ) , limits.cend( ) ,
+                                     first->first ) - limits.cbegin( );
+
+      auto spike = first;
+      for ( ; bin < bins && spike != last; ++bin )
+      {
+        const float limit = limits[ bin ];
+
+        if ( !filtered )
+        {
+          // Every spike counts, so each bin is just a binary search away.
+          const auto binEnd = std::upper_bound(
+            spike , last , limit ,
+            [ ]( float time , const simil::Spike& s ){ return time < s.first; } );
+
+          const auto count = static_cast< unsigned int >( binEnd - spike );
+          local[ bin ] += count;
+          global[ bin ] += count;
+          spike = binEnd;
+          continue;
+        }
+
+        unsigned int localCount = 0;
+        unsigned int globalCount = 0;
+        for ( ; spike != last && spike->first <= limit; ++spike )
+        {
+          ++globalCount;
+          if ( filter.find( spike->second ) != filter.end( ))
+            ++localCount;
+        }
+
+        local[ bin ] += localCount;
+        global[ bin ] += globalCount;
+      }
+    }
+
+    void countBlocks( const CompressedSpikes& spikes ,
+                      size_t firstBlock ,
+                      size_t lastBlock ,
+                      const std::vector< float >& limits ,
+                      const std::unordered_set< uint32_t >& filter ,
+                      unsigned int* local ,
+                      unsigned int* global )
+    {
+      const size_t bins = limits.size( );
+      const bool filtered = !filter.empty( );
+
+      size_t bin = 0;
+      for ( size_t block = firstBlock; block < lastBlock; ++block )
+      {
+        bin = std::lower_bound( limits.cbegin( ) + bin , limits.cend( ) ,
+                                spikes.blockStartTime( block )) -
+              limits.cbegin( );
+        if ( bin >= bins ) return;
+
+        if ( !filtered && spikes.blockEndTime( block ) <= limits[ bin ] )
+        {
+          const auto count = static_cast< unsigned int >(
+            spikes.blockFirst( block + 1 ) - spikes.blockFirst( block ));
+          local[ bin ] += count;
+          global[ bin ] += count;
+          continue;
+        }
+
+        const auto last = spikes.blockBegin( block + 1 );
+        for ( auto spike = spikes.blockBegin( block ); spike != last; ++spike )
+        {
+          while ( limits[ bin ] < spike->first )
+            if ( ++bin == bins ) return;
+
+          ++global[ bin ];
+          if ( !filtered || filter.find( spike->second ) != filter.end( ))
+            ++local[ bin ];
+        }
+      }
+    }
+
+    unsigned int histogramThreads( unsigned int threads , size_t spikes )
+    {
+      unsigned int numThreads = 1;
+#ifdef VISIMPL_USE_OPENMP
+      numThreads = threads == 0 ?
+                   static_cast< unsigned int >( omp_get_max_threads( )) :
+                   threads;
+#else
+      ( void ) threads;
+#endif
+
+      return spikes < HISTOGRAM_PARALLEL_MIN_SPIKES ? 1 : numThreads;
+    }
+  }
+
+  std::vector< float > histogramLimits( float startTime ,
+                                        float endTime ,
+                                        size_t bins )
+  {
+    // Accumulated instead of multiplied so spikes lying on a limit fall
+    // where they always did.
+    std::vector< float > limits( bins );
+    const float deltaTime = ( endTime - startTime ) / bins;
+    float currentTime = startTime + deltaTime;
+    for ( auto& limit: limits )
+    {
+      limit = currentTime;
+      currentTime += deltaTime;
+    }
+
+    return limits;
+  }
+
+  void buildSpikeHistogram( const simil::Spikes& spikes ,
+                            float startTime ,
+                            float endTime ,
+                            const std::unordered_set< uint32_t >& filter ,
+                            std::vector< unsigned int >& local ,
+                            std::vector< unsigned int >& global ,
+                            unsigned int threads )
+  {
+    const size_t bins = local.size( );
+    if ( bins == 0 ) return;
+
+    if ( global.size( ) < bins )
+      global.resize( bins , 0 );
+
+    const auto limits = histogramLimits( startTime , endTime , bins );
+
+    const size_t total = spikes.size( );
+    const unsigned int numThreads = histogramThreads( threads , total );
+
+    if ( numThreads <= 1 )
+    {
+      countChunk( spikes.cbegin( ) , spikes.cend( ) , limits , filter ,
+                  local.data( ) , global.data( ));
+      return;
+    }
+
+#ifdef VISIMPL_USE_OPENMP
+    // Spikes are sorted by time, so equal sized chunks of spikes are
+    // contiguous time chunks with the same amount of work.
+    std::vector< unsigned int > partials( 2 * numThreads * bins , 0 );
+    const int chunks = static_cast< int >( numThreads );
+
+    #pragma omp parallel for schedule( static ) num_threads( numThreads )
+    for ( int chunk = 0; chunk < chunks; ++chunk )
+    {
+      const size_t begin = total * chunk / chunks;
+      const size_t end = total * ( chunk + 1 ) / chunks;
+      unsigned int* partialLocal = &partials[ 2 * chunk * bins ];
+      unsigned int* partialGlobal = partialLocal + bins;
+
+      countChunk( spikes.cbegin( ) + begin , spikes.cbegin( ) + end ,
+                  limits , filter , partialLocal , partialGlobal );
+    }
+
+    const int binsNumber = static_cast< int >( bins );
+
+    #pragma omp parallel for schedule( static ) num_threads( numThreads )
+    for ( int bin = 0; bin < binsNumber; ++bin )
+    {
+      for ( int chunk = 0; chunk < chunks; ++chunk )
+      {
+        local[ bin ] += partials[ 2 * chunk * bins + bin ];
+        global[ bin ] += partials[ ( 2 * chunk + 1 ) * bins + bin ];
+      }
+    }
+#endif // VISIMPL_USE_OPENMP
+  }
+
+  void buildSpikeHistogram( const CompressedSpikes& spikes ,
+                            float startTime ,
+                            float endTime ,
+                            const std::unordered_set< uint32_t >& filter ,
+                            std::vector< unsigned int >& local ,
+                            std::vector< unsigned int >& global ,
+                            unsigned int threads )
+  {
+    const size_t bins = local.size( );
+    if ( bins == 0 ) return;
+
+    if ( global.size( ) < bins )
+      global.resize( bins , 0 );
+
+    const auto limits = histogramLimits( startTime , endTime , bins );
+
+    const size_t blocks = spikes.blocks( );
+    const unsigned int numThreads = std::min< size_t >(
+      histogramThreads( threads , spikes.size( )) , blocks );
+
+    if ( numThreads <= 1 )
+    {
+      countBlocks( spikes , 0 , blocks , limits , filter ,
+                   local.data( ) , global.data( ));
+      return;
+    }
+
+#ifdef VISIMPL_USE_OPENMP
+    std::vector< unsigned int > partials( 2 * numThreads * bins , 0 );
+    const int chunks = static_cast< int >( numThreads );
+
+    #pragma omp parallel for schedule( static ) num_threads( numThreads )
+    for ( int chunk = 0; chunk < chunks; ++chunk )
+    {
+      unsigned int* partialLocal = &partials[ 2 * chunk * bins ];
+      unsigned int* partialGlobal = partialLocal + bins;
+
+      countBlocks( spikes , blocks * chunk / chunks ,
+                   blocks * ( chunk + 1 ) / chunks , limits , filter ,
+                   partialLocal , partialGlobal );
+    }
+
+    const int binsNumber = static_cast< int >( bins );
+
+    #pragma omp parallel for schedule( static ) num_threads( numThreads )
+    for ( int bin = 0; bin < binsNumber; ++bin )
+    {
+      for ( int chunk = 0; chunk < chunks; ++chunk )
+      {
+        local[ bin ] += partials[ 2 * chunk * bins + bin ];
+        global[ bin ] += partials[ ( 2 * chunk + 1 ) * bins + bin ];
+      }
+    }
+#endif // VISIMPL_USE_OPENMP
+  }
+}
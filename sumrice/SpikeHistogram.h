@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SPIKE_HISTOGRAM_H__
+#define __VISIMPL_SPIKE_HISTOGRAM_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+#include <sumrice/CompressedSpikes.h>
+
+namespace visimpl
+{
+  /**
+   * Spikes below which the histogram is always built in a single thread.
+   */
+  constexpr size_t HISTOGRAM_PARALLEL_MIN_SPIKES = 1 << 16;
+
+  /**
+   * Upper time limit of each of the bins splitting [startTime, endTime].
+   */
+  SUMRICE_API std::vector< float > histogramLimits( float startTime ,
+                                                    float endTime ,
+                                                    size_t bins );
+
+  /**
+   * Counts the spikes of [startTime, endTime] into local.size( ) bins of the
+   * same width. Bin k holds the spikes with
+   * start + k * delta < time <= start + ( k + 1 ) * delta, spikes at or
+   * before startTime fall into the first bin and spikes after the last
+   * bin are dropped.
+   *
+   * local only counts the spikes whose GID is in filter (every spike if the
+   * filter is empty), global counts them all. The counts are added to the
+   * given vectors, global is resized to match local if needed.
+   *
+   * Spikes must be sorted by time. The spikes are split into contiguous
+   * time chunks that are counted in parallel into per-thread partial
+   * histograms and then reduced. threads = 0 takes the thread count from
+   * the OpenMP environment (OMP_NUM_THREADS), threads = 1 is serial.
+   */
+  SUMRICE_API void buildSpikeHistogram(
+    const simil::Spikes& spikes ,
+    float startTime ,
+    float endTime ,
+    const std::unordered_set< uint32_t >& filter ,
+    std::vector< unsigned int >& local ,
+    std::vector< unsigned int >& global ,
+    unsigned int threads = 0 );
+
+  /**
+   * Same as above for compressed spikes. Threads count contiguous runs of
+   * blocks, and the blocks lying in a single bin are counted from their
+   * headers without decoding them when there is no filter.
+   */
+  SUMRICE_API void buildSpikeHistogram(
+    const CompressedSpikes& spikes ,
+    float startTime ,
+    float endTime ,
+    const std::unordered_set< uint32_t >& filter ,
+    std::vector< unsigned int >& local ,
+    std::vector< unsigned int >& global ,
+    unsigned int threads = 0 );
+
+}
+
+#endif /* __VISIMPL_SPIKE_HISTOGRAM_H__ */
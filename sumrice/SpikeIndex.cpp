@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SpikeIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace visimpl
+{
+  SpikeIndex::SpikeIndex( )
+    : _offsets( )
+    , _times( )
+  { }
+
+  void SpikeIndex::build( const simil::SpikesCRange& spikes )
+  {
+    clear( );
+
+    uint32_t maxGid = 0;
+    size_t total = 0;
+    for ( auto spike = spikes.first; spike != spikes.second; ++spike )
+    {
+      maxGid = std::max( maxGid , spike->second );
+      ++total;
+    }
+
+    if ( total == 0 ) return;
+
+    // Counting sort by GID. Spikes come sorted by time, so every
+    // neuron's run ends up sorted too.
+    _offsets.assign( static_cast< size_t >( maxGid ) + 2 , 0 );
+    for ( auto spike = spikes.first; spike != spikes.second; ++spike )
+      ++_offsets[ spike->second + 1 ];
+
+    for ( size_t i = 1; i < _offsets.size( ); ++i )
+      _offsets[ i ] += _offsets[ i - 1 ];
+
+    _times.resize( total );
+    std::vector< uint64_t > cursor( _offsets.cbegin( ) , _offsets.cend( ) - 1 );
+    for ( auto spike = spikes.first; spike != spikes.second; ++spike )
+      _times[ cursor[ spike->second ]++ ] = spike->first;
+  }
+
+  void SpikeIndex::clear( )
+  {
+    _offsets.clear( );
+    _times.clear( );
+  }
+
+  bool SpikeIndex::empty( ) const
+  {
+    return _times.empty( );
+  }
+
+  size_t SpikeIndex::size( ) const
+  {
+    return _times.size( );
+  }
+
+  SpikeIndex::TimeRange SpikeIndex::spikesOf( uint32_t gid ) const
+  {
+    if ( static_cast< size_t >( gid ) + 1 >= _offsets.size( ))
+      return TimeRange( nullptr , nullptr );
+
+    const float* base = _times.data( );
+    return TimeRange( base + _offsets[ gid ] , base + _offsets[ gid + 1 ] );
+  }
+
+  float SpikeIndex::lastSpike( uint32_t gid , float startTime ,
+                               float endTime ) const
+  {
+    const auto range = spikesOf( gid );
+    const float* last = std::upper_bound( range.first , range.second ,
+                                          endTime );
+
+    if ( last == range.first || *( last - 1 ) <= startTime )
+      return -std::numeric_limits< float >::infinity( );
+
+    return *( last - 1 );
+  }
+}
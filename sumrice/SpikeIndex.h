@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SPIKEINDEX__
+#define __VISIMPL_SPIKEINDEX__
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Per-neuron spike times in CSR form: the spikes of GID g are
+   * _times[ _offsets[ g ] ] .. _times[ _offsets[ g + 1 ] ], sorted by time.
+   *
+   * Built once after loading, it answers "last spike of a neuron before a
+   * given time" with one binary search, regardless of the spike density.
+   */
+  class SUMRICE_API SpikeIndex
+  {
+  public:
+
+    typedef std::pair< const float* , const float* > TimeRange;
+
+    SpikeIndex( );
+
+    /**
+     * Builds the index from a time-sorted spike range.
+     */
+    void build( const simil::SpikesCRange& spikes );
+
+    void clear( );
+
+    bool empty( ) const;
+
+    /**
+     * Amount of indexed spikes.
+     */
+    size_t size( ) const;
+
+    TimeRange spikesOf( uint32_t gid ) const;
+
+    /**
+     * Time of the last spike of the given neuron in the interval
+     * ( startTime , endTime ]. -infinity if there is none.
+     */
+    float lastSpike( uint32_t gid , float startTime , float endTime ) const;
+
+  protected:
+
+    std::vector< uint64_t > _offsets;
+    std::vector< float > _times;
+  };
+}
+
+#endif /* __VISIMPL_SPIKEINDEX__ */
@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SpikeWindow.h"
+#include "SpikeHistogram.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace visimpl
+{
+  constexpr size_t SpikeWindow::DEFAULT_BLOCKS;
+  constexpr unsigned int SpikeWindow::DEFAULT_READ_AHEAD;
+
+  SpikeWindow::SpikeWindow( )
+    : _cache( )
+    , _compressed( nullptr )
+    , _startTime( 0.0f )
+    , _blockDuration( 1.0f )
+    , _blockOffsets( )
+    , _margin( 0.0f )
+    , _decay( 0.0f )
+    , _readAhead( DEFAULT_READ_AHEAD )
+    , _firstBlock( 0 )
+    , _lastBlock( 0 )
+    , _lastTime( 0.0f )
+  { }
+
+  bool SpikeWindow::open( const std::string& path , uint64_t hash ,
+                          size_t blocks )
+  {
+    close( );
+
+    if ( !_cache.open( path , hash )) return false;
+
+    _split( _cache.startTime( ) , _cache.endTime( ) , blocks );
+
+    return true;
+  }
+
+  bool SpikeWindow::open( std::shared_ptr< const CompressedSpikes > spikes ,
+                          float startTime , float endTime , size_t blocks )
+  {
+    close( );
+
+    if ( !spikes ) return false;
+
+    _compressed = std::move( spikes );
+    _split( startTime , endTime , blocks );
+
+    return true;
+  }
+
+  void SpikeWindow::close( )
+  {
+    _cache.close( );
+    _compressed = nullptr;
+    _blockOffsets.clear( );
+    _firstBlock = _lastBlock = 0;
+  }
+
+  bool SpikeWindow::isOpen( ) const
+  {
+    return _cache.isOpen( ) || _compressed;
+  }
+
+  const SpikeCache& SpikeWindow::store( ) const
+  {
+    return _cache;
+  }
+
+  const CompressedSpikes* SpikeWindow::compressed( ) const
+  {
+    return _compressed.get( );
+  }
+
+  size_t SpikeWindow::spikesNumber( ) const
+  {
+    return _compressed ? _compressed->size( ) : _cache.spikesNumber( );
+  }
+
+  void SpikeWindow::setMargin( float margin )
+  {
+    _margin = std::max( margin , 0.0f );
+  }
+
+  float SpikeWindow::margin( ) const
+  {
+    return _margin;
+  }
+
+  void SpikeWindow::setDecay( float decay )
+  {
+    _decay = std::max( decay , 0.0f );
+  }
+
+  float SpikeWindow::decay( ) const
+  {
+    return _decay;
+  }
+
+  void SpikeWindow::setReadAhead( unsigned int blocks )
+  {
+    _readAhead = blocks;
+  }
+
+  unsigned int SpikeWindow::readAhead( ) const
+  {
+    return _readAhead;
+  }
+
+  size_t SpikeWindow::blocks( ) const
+  {
+    return _blockOffsets.empty( ) ? 0 : _blockOffsets.size( ) - 1;
+  }
+
+  float SpikeWindow::blockDuration( ) const
+  {
+    return _blockDuration;
+  }
+
+  size_t SpikeWindow::blockSpikes( size_t block ) const
+  {
+    return block < blocks( ) ?
+           _blockOffsets[ block + 1 ] - _blockOffsets[ block ] : 0;
+  }
+
+  bool SpikeWindow::update( float time , simil::Spikes& resident )
+  {
+    if ( !isOpen( )) return false;
+
+    const bool forward = !( time < _lastTime );
+    _lastTime = time;
+
+    const size_t blocks_ = blocks( );
+    size_t first = _blockOf( time - _decay - _margin );
+    size_t last = _blockOf( time + _margin ) + 1;
+
+    if ( _firstBlock < _lastBlock && first >= _firstBlock && last <= _lastBlock )
+      return false;
+
+    // Blocks of the playback direction come along, so the window moves
+    // once every few blocks instead of on every one.
+    if ( forward )
+      last = std::min< size_t >( blocks_ , last + _readAhead );
+    else
+      first = first > _readAhead ? first - _readAhead : 0;
+
+    _firstBlock = first;
+    _lastBlock = last;
+
+    const size_t begin = _blockOffsets[ first ];
+    const size_t end = _blockOffsets[ last ];
+
+    resident.clear( );
+    resident.reserve( end - begin );
+
+    if ( _compressed )
+    {
+      // The first and last blocks also hold the spikes out of the range.
+      const float infinity = std::numeric_limits< float >::infinity( );
+      const auto range = _compressed->spikesBetween(
+        first == 0 ? -infinity : _blockStart( first ) ,
+        last == blocks_ ? infinity : _blockStart( last ));
+      for ( auto spike = range.first; spike != range.second; ++spike )
+        resident.push_back( *spike );
+
+      return true;
+    }
+
+    const float* times = _cache.times( );
+    const uint32_t* gids = _cache.gids( );
+    for ( size_t i = begin; i < end; ++i )
+      resident.push_back( std::make_pair( times[ i ] , gids[ i ] ));
+
+    // The blocks that come next are read while these are played.
+    if ( forward )
+      _cache.prefetch( end , _blockOffsets[ std::min< size_t >(
+        blocks_ , last + _readAhead ) ] );
+    else
+      _cache.prefetch( _blockOffsets[ first > _readAhead ? first - _readAhead : 0 ] ,
+                       begin );
+
+    return true;
+  }
+
+  float SpikeWindow::residentStartTime( ) const
+  {
+    return _blockStart( _firstBlock );
+  }
+
+  float SpikeWindow::residentEndTime( ) const
+  {
+    return _blockStart( _lastBlock );
+  }
+
+  void SpikeWindow::histogram( float startTime ,
+                               float endTime ,
+                               const std::unordered_set< uint32_t >& filter ,
+                               std::vector< unsigned int >& local ,
+                               std::vector< unsigned int >& global ) const
+  {
+    const size_t bins = local.size( );
+    if ( bins == 0 || !isOpen( )) return;
+
+    if ( _compressed )
+    {
+      buildSpikeHistogram( *_compressed , startTime , endTime , filter ,
+                           local , global );
+      return;
+    }
+
+    if ( global.size( ) < bins )
+      global.resize( bins , 0 );
+
+    const auto limits = histogramLimits( startTime , endTime , bins );
+
+    // Every spike up to a limit is one binary search away.
+    size_t previous = 0;
+    for ( size_t bin = 0; bin < bins; ++bin )
+    {
+      const size_t upTo = _countUpTo( limits[ bin ] );
+      const auto count = static_cast< unsigned int >( upTo - previous );
+      global[ bin ] += count;
+      if ( filter.empty( )) local[ bin ] += count;
+      previous = upTo;
+    }
+
+    if ( filter.empty( )) return;
+
+    // Only the spikes of the filtered GIDs are read, from the GID index.
+    const size_t indexSize = _cache.indexSize( );
+    const uint64_t* offsets = _cache.gidOffsets( );
+    const float* gidTimes = _cache.gidTimes( );
+    for ( const auto gid: filter )
+    {
+      if ( static_cast< size_t >( gid ) + 1 >= indexSize ) continue;
+
+      for ( auto i = offsets[ gid ]; i < offsets[ gid + 1 ]; ++i )
+      {
+        const size_t bin = std::lower_bound( limits.cbegin( ) , limits.cend( ) ,
+                                             gidTimes[ i ] ) - limits.cbegin( );
+        if ( bin < bins ) ++local[ bin ];
+      }
+    }
+  }
+
+  void SpikeWindow::_split( float startTime , float endTime , size_t blocks )
+  {
+    blocks = std::max< size_t >( blocks , 1 );
+    _startTime = startTime;
+    _blockDuration = ( endTime - _startTime ) / blocks;
+    if ( !( _blockDuration > 0.0f ))
+    {
+      blocks = 1;
+      _blockDuration = 1.0f;
+    }
+
+    // Spikes before the start time belong to the first block and those
+    // after the end time to the last one.
+    _blockOffsets.assign( blocks + 1 , 0 );
+    for ( size_t block = 1; block < blocks; ++block )
+    {
+      _blockOffsets[ block ] = _lowerBound( _blockStart( block ) ,
+                                            _blockOffsets[ block - 1 ] );
+    }
+    _blockOffsets[ blocks ] = spikesNumber( );
+
+    _lastTime = _startTime;
+  }
+
+  size_t SpikeWindow::_lowerBound( float time , size_t from ) const
+  {
+    if ( _compressed )
+      return _compressed->lowerBound( time ).index( );
+
+    const float* times = _cache.times( );
+    return std::lower_bound( times + from , times + _cache.spikesNumber( ) ,
+                             time ) - times;
+  }
+
+  size_t SpikeWindow::_blockOf( float time ) const
+  {
+    if ( !( time > _startTime )) return 0;
+
+    const float block = ( time - _startTime ) / _blockDuration;
+    const size_t last = blocks( ) - 1;
+    return block < static_cast< float >( last ) ? static_cast< size_t >( block ) : last;
+  }
+
+  float SpikeWindow::_blockStart( size_t block ) const
+  {
+    return _startTime + _blockDuration * block;
+  }
+
+  size_t SpikeWindow::_countUpTo( float limit ) const
+  {
+    // _blockOf may round the limit into a neighbour block.
+    const size_t block = _blockOf( limit );
+    const size_t first = _blockOffsets[ block > 0 ? block - 1 : 0 ];
+    const size_t last = _blockOffsets[ std::min( blocks( ) , block + 2 ) ];
+
+    const float* times = _cache.times( );
+    return std::upper_bound( times + first , times + last , limit ) - times;
+  }
+}
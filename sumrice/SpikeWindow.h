@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SPIKE_WINDOW_H__
+#define __VISIMPL_SPIKE_WINDOW_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+#include <sumrice/CompressedSpikes.h>
+#include <sumrice/SpikeCache.h>
+
+namespace visimpl
+{
+  /**
+   * Time windowed view of a SpikeCache, for recordings that don't fit in
+   * memory. Only the spikes around the current playback time are resident:
+   * the decay and a margin before it, and a margin after it. The recording
+   * is split into time blocks, the resident spikes are whole blocks copied
+   * from the memory mapped cache, and the next blocks in the playback
+   * direction are read ahead in the background.
+   *
+   * Histograms are counted from the cache with the per-block spike offsets
+   * and per-GID index, never from the resident spikes.
+   *
+   * The window may page in CompressedSpikes held in memory instead of a
+   * cache, for recordings that fit compressed but not as simil::Spikes.
+   */
+  class SUMRICE_API SpikeWindow
+  {
+  public:
+
+    /**
+     * Time blocks of a recording, and blocks read ahead of the window.
+     */
+    static constexpr size_t DEFAULT_BLOCKS = 1024;
+    static constexpr unsigned int DEFAULT_READ_AHEAD = 2;
+
+    SpikeWindow( );
+
+    SpikeWindow( const SpikeWindow& ) = delete;
+
+    SpikeWindow& operator=( const SpikeWindow& ) = delete;
+
+    /**
+     * Opens the cache as SpikeCache::open does and splits its time range
+     * into the given amount of blocks.
+     */
+    bool open( const std::string& path , uint64_t hash ,
+               size_t blocks = DEFAULT_BLOCKS );
+
+    /**
+     * Pages in the given compressed spikes of the recording from startTime
+     * to endTime instead of a cache.
+     */
+    bool open( std::shared_ptr< const CompressedSpikes > spikes ,
+               float startTime , float endTime ,
+               size_t blocks = DEFAULT_BLOCKS );
+
+    void close( );
+
+    bool isOpen( ) const;
+
+    /**
+     * Cache of the window, closed if it pages in compressed spikes.
+     */
+    const SpikeCache& store( ) const;
+
+    /**
+     * Compressed spikes of the window, nullptr if it pages in a cache.
+     */
+    const CompressedSpikes* compressed( ) const;
+
+    /**
+     * Spikes of the recording.
+     */
+    size_t spikesNumber( ) const;
+
+    /**
+     * Time kept resident before (besides the decay) and after the current
+     * time. At least the block of the current time is always resident.
+     */
+    void setMargin( float margin );
+    float margin( ) const;
+
+    /**
+     * Decay of the particles, the spikes of the last decay time are needed
+     * to rebuild the scene after a seek.
+     */
+    void setDecay( float decay );
+    float decay( ) const;
+
+    void setReadAhead( unsigned int blocks );
+    unsigned int readAhead( ) const;
+
+    size_t blocks( ) const;
+
+    float blockDuration( ) const;
+
+    /**
+     * Spikes of the given block.
+     */
+    size_t blockSpikes( size_t block ) const;
+
+    /**
+     * Moves the window to the given time. Returns true and fills resident
+     * with the spikes of the new window, sorted by time, if it changed.
+     * Playback is assumed to go forward while the time grows and backwards
+     * otherwise.
+     */
+    bool update( float time , simil::Spikes& resident );
+
+    /**
+     * Time range of the resident blocks.
+     */
+    float residentStartTime( ) const;
+    float residentEndTime( ) const;
+
+    /**
+     * Same as buildSpikeHistogram over every spike of the recording.
+     */
+    void histogram( float startTime ,
+                    float endTime ,
+                    const std::unordered_set< uint32_t >& filter ,
+                    std::vector< unsigned int >& local ,
+                    std::vector< unsigned int >& global ) const;
+
+  protected:
+
+    /**
+     * Splits [startTime, endTime] into the given amount of blocks.
+     */
+    void _split( float startTime , float endTime , size_t blocks );
+
+    /**
+     * First spike with time >= time, from the given one on.
+     */
+    size_t _lowerBound( float time , size_t from ) const;
+
+    size_t _blockOf( float time ) const;
+
+    float _blockStart( size_t block ) const;
+
+    /**
+     * Spikes with time <= limit.
+     */
+    size_t _countUpTo( float limit ) const;
+
+    SpikeCache _cache;
+    std::shared_ptr< const CompressedSpikes > _compressed;
+
+    float _startTime;
+    float _blockDuration;
+
+    // Index of the first spike of every block, one more than blocks.
+    std::vector< uint64_t > _blockOffsets;
+
+    float _margin;
+    float _decay;
+    unsigned int _readAhead;
+
+    // Resident blocks [_firstBlock, _lastBlock), none if equal.
+    size_t _firstBlock;
+    size_t _lastBlock;
+    float _lastTime;
+  };
+}
+
+#endif /* __VISIMPL_SPIKE_WINDOW_H__ */
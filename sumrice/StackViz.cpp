@@ -42,8 +42,11 @@ StackViz::StackViz( QWidget *parent_ )
   , _simulationType( simil::TSimNetwork )
   , _summary( nullptr )
   , _player( nullptr )
+  , _spikeWindow( nullptr )
   , _subsetEventManager( nullptr )
   , _autoCalculateCorrelations( false )
+  , _deferCorrelations( false )
+  , _pendingCorrelations( false )
   , _followPlayhead( false )
   , _displayManager( nullptr )
 {
@@ -59,6 +62,7 @@ void StackViz::init( simil::SimulationPlayer* player, simil::SubsetEventManager
   _player = player;
   _simulationType = _player->data( )->simulationType( );
   _subsetEventManager = manager;
+  _correlationComputer = nullptr;
 
   // TODO: events file.
   initSummaryWidget( );
@@ -66,8 +70,18 @@ void StackViz::init( simil::SimulationPlayer* player, simil::SubsetEventManager
   QApplication::restoreOverrideCursor( );
 }
 
+void StackViz::spikeWindow( std::shared_ptr< SpikeWindow > window )
+{
+  _spikeWindow = window;
+  _correlationComputer = nullptr;
+
+  if ( _summary ) _summary->spikeWindow( window );
+}
+
 void StackViz::openSubsetEventsFile( bool fromH5 )
 {
+  _correlationComputer = nullptr;
+
   if(_summary)
   {
     _summary->clearEvents();
@@ -122,6 +136,7 @@ void StackViz::initSummaryWidget( )
   {
     auto spikesPlayer = dynamic_cast< simil::SpikesPlayer * >( _player );
 
+    _summary->spikeWindow( _spikeWindow );
     _summary->Init( spikesPlayer->data( ));
     _summary->simulationPlayer( _player );
   }
@@ -195,23 +210,49 @@ void StackViz::removeSubset(const unsigned int i)
   }
 }
 
+void StackViz::deferCorrelations(const bool value)
+{
+  _deferCorrelations = value;
+
+  if(!value && _pendingCorrelations)
+  {
+    _pendingCorrelations = false;
+    calculateCorrelations();
+  }
+}
+
 void StackViz::calculateCorrelations(void)
 {
   if(!_player || !_subsetEventManager) return;
 
-  visimpl::CorrelationComputer cc(dynamic_cast<simil::SpikeData*>(_player->data()->get()));
+  if(_deferCorrelations)
+  {
+    _pendingCorrelations = true;
+    return;
+  }
+
+  if(!_correlationComputer)
+  {
+    auto spikeData = dynamic_cast<simil::SpikeData*>(_player->data()->get());
+    _correlationComputer = std::make_shared<visimpl::CorrelationComputer>(spikeData);
+
+    // Windowed and compressed loads only hold the resident spikes, bin
+    // all of those of the window.
+    if(_spikeWindow && _spikeWindow->compressed())
+      _correlationComputer->compressedSpikes(_spikeWindow->compressed());
+    else if(_spikeWindow && _spikeWindow->isOpen())
+      _correlationComputer->spikeCache(&_spikeWindow->store());
+  }
+
+  auto &cc = *_correlationComputer;
 
   const auto eventNames = _subsetEventManager->eventNames();
 
   constexpr double deltaTime = 0.125;
 
-  cc.configureEvents(eventNames, deltaTime);
-
-  auto correlateSubsets = [&eventNames, &cc](const std::string &event)
-  {
-    cc.correlateSubset( event, eventNames, deltaTime, 2600, 2900 );
-  };
-  std::for_each(_correlations.cbegin(), _correlations.cend(), correlateSubsets);
+  // One spike pass for every subset not in the cache, then all the pairs in
+  // parallel. The events are binned on the first call.
+  cc.correlateAll( _correlations, eventNames, deltaTime, 2600, 2900 );
 
   const auto names = cc.correlationNames();
 
@@ -242,6 +283,9 @@ void visimpl::StackViz::setHistogramVisible(const unsigned idx, const bool state
 
 void visimpl::StackViz::updateHistograms( )
 {
+  // New spikes, the cached correlations are stale.
+  _correlationComputer = nullptr;
+
   if ( _summary ) _summary->UpdateHistograms( );
 
   if ( _followPlayhead ) _summary->focusPlayback( );
@@ -285,6 +329,7 @@ void visimpl::StackViz::repaintHistograms()
 void visimpl::StackViz::closeData()
 {
   _player = nullptr;
+  _spikeWindow = nullptr;
   _subsetEventManager = nullptr;
 
   // remove histograms
@@ -306,4 +351,7 @@ void visimpl::StackViz::closeData()
   }
 
   _correlations.clear();
+  _correlationComputer = nullptr;
+  _deferCorrelations = false;
+  _pendingCorrelations = false;
 }
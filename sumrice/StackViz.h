@@ -55,6 +55,13 @@ namespace visimpl
 
     void init( simil::SimulationPlayer* p, simil::SubsetEventManager *m );
 
+    /** \brief Sets the spike window of a windowed load, used by the
+     * histograms instead of the resident spikes. Call before init().
+     * \param[in] window Spike window or nullptr.
+     *
+     */
+    void spikeWindow( std::shared_ptr< SpikeWindow > window );
+
     /** \brief Adds an histogram for the given ids.
      * \param[in] selection Selected indexes.
      */
@@ -80,6 +87,14 @@ namespace visimpl
      */
     void setHistogramVisible(const unsigned idx, const bool state);
 
+    /** \brief Holds the correlations back while the spikes are still
+     * streaming in, they are computed once it is cleared.
+     * \param[in] value True to defer them and false to compute those
+     * deferred.
+     *
+     */
+    void deferCorrelations(const bool value);
+
     /** \brief Removes histograms and resets interface.
      *
      */
@@ -127,9 +142,12 @@ namespace visimpl
     visimpl::Summary* _summary;
 
     simil::SimulationPlayer* _player;
+    std::shared_ptr< SpikeWindow > _spikeWindow;
     simil::SubsetEventManager* _subsetEventManager;
 
     bool _autoCalculateCorrelations;
+    bool _deferCorrelations;
+    bool _pendingCorrelations;
     bool _followPlayhead;
 
     DisplayManagerWidget* _displayManager;
@@ -137,6 +155,11 @@ namespace visimpl
   private:
 
     std::vector< std::string > _correlations;
+
+    /** Correlations of the current data, kept to reuse its cache. Reset
+     * when the data or the subsets change.
+     */
+    std::shared_ptr< visimpl::CorrelationComputer > _correlationComputer;
   };
 
 
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SubsetHistogramEngine.h"
+#include "SpikeHistogram.h"
+
+#include <algorithm>
+
+#ifdef VISIMPL_USE_OPENMP
+#include <omp.h>
+#endif
+
+namespace visimpl
+{
+  SubsetHistogramEngine::SubsetHistogramEngine( )
+    : _offsets( )
+    , _memberships( )
+    , _local( )
+    , _global( )
+  { }
+
+  void SubsetHistogramEngine::_buildMemberships(
+    const std::vector< const GIDSet* >& subsets )
+  {
+    uint32_t maxGid = 0;
+    size_t total = 0;
+    for ( const auto subset: subsets )
+    {
+      for ( const auto gid: *subset )
+        maxGid = std::max( maxGid , gid );
+      total += subset->size( );
+    }
+
+    _offsets.assign( static_cast< size_t >( maxGid ) + 2 , 0 );
+    for ( const auto subset: subsets )
+      for ( const auto gid: *subset )
+        ++_offsets[ gid + 1 ];
+
+    for ( size_t i = 1; i < _offsets.size( ); ++i )
+      _offsets[ i ] += _offsets[ i - 1 ];
+
+    _memberships.resize( total );
+    std::vector< uint32_t > cursor( _offsets.cbegin( ) , _offsets.cend( ) - 1 );
+    for ( uint32_t index = 0; index < subsets.size( ); ++index )
+      for ( const auto gid: *subsets[ index ] )
+        _memberships[ cursor[ gid ]++ ] = index;
+  }
+
+  void SubsetHistogramEngine::compute(
+    const simil::Spikes& spikes ,
+    float startTime ,
+    float endTime ,
+    const std::vector< const GIDSet* >& subsets ,
+    size_t bins ,
+    unsigned int threads )
+  {
+    _buildMemberships( subsets );
+
+    _local.assign( subsets.size( ) , std::vector< unsigned int >( bins , 0 ));
+    _global.assign( bins , 0 );
+
+    if ( bins == 0 || spikes.empty( )) return;
+
+    const auto limits = histogramLimits( startTime , endTime , bins );
+    const uint32_t gidsNumber = static_cast< uint32_t >( _offsets.size( ) - 1 );
+
+    const auto byTime =
+      [ ]( float time , const simil::Spike& s ){ return time < s.first; };
+
+    unsigned int numThreads = 1;
+#ifdef VISIMPL_USE_OPENMP
+    numThreads = threads == 0 ?
+                 static_cast< unsigned int >( omp_get_max_threads( )) :
+                 threads;
+#else
+    ( void ) threads;
+#endif
+
+    if ( spikes.size( ) < HISTOGRAM_PARALLEL_MIN_SPIKES )
+      numThreads = 1;
+
+    // A few ranges per thread, so bursts of activity get balanced.
+    const int ranges = static_cast< int >(
+      std::min( bins , static_cast< size_t >( numThreads ) * 8 ));
+
+#ifdef VISIMPL_USE_OPENMP
+    #pragma omp parallel for schedule( dynamic ) num_threads( numThreads )
+#endif
+    for ( int range = 0; range < ranges; ++range )
+    {
+      const size_t firstBin = bins * range / ranges;
+      const size_t lastBin = bins * ( range + 1 ) / ranges;
+
+      const auto first = firstBin == 0 ? spikes.cbegin( ) :
+                         std::upper_bound( spikes.cbegin( ) , spikes.cend( ) ,
+                                           limits[ firstBin - 1 ] , byTime );
+      const auto last = std::upper_bound( first , spikes.cend( ) ,
+                                          limits[ lastBin - 1 ] , byTime );
+
+      size_t bin = firstBin;
+      for ( auto spike = first; spike != last; ++spike )
+      {
+        while ( spike->first > limits[ bin ] )
+          ++bin;
+
+        ++_global[ bin ];
+
+        const uint32_t gid = spike->second;
+        if ( gid >= gidsNumber ) continue;
+
+        for ( uint32_t i = _offsets[ gid ]; i < _offsets[ gid + 1 ]; ++i )
+          ++_local[ _memberships[ i ]][ bin ];
+      }
+    }
+  }
+
+  size_t SubsetHistogramEngine::subsetsNumber( ) const
+  {
+    return _local.size( );
+  }
+
+  size_t SubsetHistogramEngine::bins( ) const
+  {
+    return _global.size( );
+  }
+
+  const std::vector< unsigned int >&
+  SubsetHistogramEngine::local( size_t subset ) const
+  {
+    return _local[ subset ];
+  }
+
+  const std::vector< unsigned int >& SubsetHistogramEngine::global( ) const
+  {
+    return _global;
+  }
+}
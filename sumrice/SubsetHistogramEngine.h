@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SUBSET_HISTOGRAM_ENGINE_H__
+#define __VISIMPL_SUBSET_HISTOGRAM_ENGINE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include <simil/simil.h>
+#include <sumrice/api.h>
+
+namespace visimpl
+{
+  /**
+   * Counts the spikes of many GID subsets in a single pass over a report.
+   *
+   * Every GID is mapped to the list of subsets holding it (CSR layout, so
+   * subsets may overlap), and each spike adds one to the bin of all of
+   * them. The bins are split into ranges that are counted in parallel, a
+   * range only touches its own bins so no partial histograms or reduction
+   * are needed.
+   *
+   * Bins follow buildSpikeHistogram: bin k holds the spikes in
+   * ( start + k * delta, start + ( k + 1 ) * delta ], the first one also
+   * takes the spikes before startTime.
+   */
+  class SUMRICE_API SubsetHistogramEngine
+  {
+  public:
+
+    typedef std::unordered_set< uint32_t > GIDSet;
+
+    SubsetHistogramEngine( );
+
+    /**
+     * Counts the spikes into bins histograms for every subset.
+     * threads = 0 takes the thread count from the OpenMP environment.
+     */
+    void compute( const simil::Spikes& spikes ,
+                  float startTime ,
+                  float endTime ,
+                  const std::vector< const GIDSet* >& subsets ,
+                  size_t bins ,
+                  unsigned int threads = 0 );
+
+    size_t subsetsNumber( ) const;
+
+    size_t bins( ) const;
+
+    /**
+     * Spikes of the given subset in each bin.
+     */
+    const std::vector< unsigned int >& local( size_t subset ) const;
+
+    /**
+     * Spikes of every GID in each bin.
+     */
+    const std::vector< unsigned int >& global( ) const;
+
+  protected:
+
+    void _buildMemberships( const std::vector< const GIDSet* >& subsets );
+
+    // GID -> subsets, as CSR.
+    std::vector< uint32_t > _offsets;
+    std::vector< uint32_t > _memberships;
+
+    std::vector< std::vector< unsigned int >> _local;
+    std::vector< unsigned int > _global;
+  };
+}
+
+#endif /* __VISIMPL_SUBSET_HISTOGRAM_ENGINE_H__ */
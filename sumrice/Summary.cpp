@@ -21,6 +21,7 @@
  */
 
 #include "Summary.h"
+#include "SubsetHistogramEngine.h"
 
 #include <QMouseEvent>
 #include <QComboBox>
@@ -75,6 +76,7 @@ namespace visimpl
   , _simData( nullptr )
   , _spikeReport( nullptr )
   , _player( nullptr )
+  , _spikeWindow( nullptr )
   , _mainHistogram( nullptr )
   , _focusedHistogram( nullptr )
   , _mousePressed( false )
@@ -83,6 +85,7 @@ namespace visimpl
   , _colorScaleGlobal( visimpl::T_COLOR_LOGARITHMIC )
   , _colorLocal( 0, 0, 128, 50 )
   , _colorGlobal( 255, 0, 0, 100 )
+  , _deferHistogramInit( false )
   , _focusWidget( nullptr )
   , _spinBoxScaleHorizontal( nullptr )
   , _spinBoxScaleVertical( nullptr )
@@ -526,6 +529,7 @@ namespace visimpl
     _mainHistogram->firstHistogram( true );
     _mainHistogram->setMinimumWidth( _sizeChartHorizontal );
     _mainHistogram->simPlayer( _player );
+    _mainHistogram->spikeWindow( _spikeWindow.get());
 
     ColorInterpolator colorMapper;
     colorMapper.insert( 0.0f, glm::vec4( 157, 206, 111, 255 ));
@@ -668,11 +672,25 @@ namespace visimpl
   {
     auto subsets = _spikeReport->subsetsEvents()->subsets();
 
+    const auto first = _histogramWidgets.size();
+
+    // Widgets are initialized after counting all the subsets at once.
+    _deferHistogramInit = true;
     for( auto it = subsets.first; it != subsets.second; ++it )
     {
       GIDUSet subset( it->second.begin(), it->second.end());
       insertSubset( it->first, subset );
     }
+    _deferHistogramInit = false;
+
+    const std::vector< HistogramWidget* > inserted(
+      _histogramWidgets.begin() + first, _histogramWidgets.end());
+
+    _computeSubsetHistograms( inserted, _spikeReport->startTime(),
+                              _spikeReport->endTime());
+
+    for( auto histogram : inserted )
+      histogram->init( _bins, _zoomFactor );
   }
 
   void Summary::AddNewHistogram( const visimpl::Selection& selection
@@ -742,9 +760,16 @@ namespace visimpl
 
   void Summary::UpdateHistograms( void )
   {
+    for( auto h : _histogramWidgets )
+      h->Spikes(*_spikeReport);
+
+    // Same range the widgets bin, see importSubsetsFromSubsetMngr.
+    if( _spikeReport )
+      _computeSubsetHistograms( _histogramWidgets, _spikeReport->startTime(),
+                                _spikeReport->endTime());
+
     auto updateHistogram = [&](HistogramWidget *h)
     {
-      h->Spikes(*_spikeReport);
       h->Update();
       h->update();
     };
@@ -753,6 +778,40 @@ namespace visimpl
     update();
   }
 
+  void Summary::_computeSubsetHistograms(
+    const std::vector< HistogramWidget* >& widgets,
+    float startTime, float endTime )
+  {
+    // The window counts each subset from its own per neuron index.
+    if( !_spikeReport || _spikeWindow ) return;
+
+    std::vector< HistogramWidget* > filtered;
+    std::vector< const SubsetHistogramEngine::GIDSet* > subsets;
+    for( auto histogram : widgets )
+    {
+      if( histogram->_filteredGIDs.empty()) continue;
+
+      filtered.push_back( histogram );
+      subsets.push_back( &histogram->_filteredGIDs );
+    }
+
+    // A lone subset costs the same pass when its widget builds it.
+    if( filtered.size() < 2 ) return;
+
+    const auto& spikes = _spikeReport->spikes();
+
+    SubsetHistogramEngine engine;
+    engine.compute( spikes, startTime, endTime, subsets,
+                    CumulativeHistogram::defaultBaseBins( spikes.size()));
+
+    for( size_t i = 0; i < filtered.size(); ++i )
+    {
+      filtered[ i ]->_cumulative.assign( spikes, startTime, endTime,
+                                         filtered[ i ]->_filteredGIDs,
+                                         engine.local( i ), engine.global());
+    }
+  }
+
   void Summary::insertSubset( const Selection& selection )
   {
     insertSubset( selection.name, selection.gids );
@@ -776,13 +835,15 @@ namespace visimpl
     histogram->regionWidth( _regionWidth );
     histogram->gridLinesNumber( _gridLinesNumber );
 
-    histogram->init( _bins, _zoomFactor );
+    if( !_deferHistogramInit )
+      histogram->init( _bins, _zoomFactor );
 
     histogram->setMinimumHeight( _heightPerRow );
     histogram->setMaximumHeight( _heightPerRow );
     histogram->setMinimumWidth( _sizeChartHorizontal );
 
     histogram->simPlayer( _player );
+    histogram->spikeWindow( _spikeWindow.get());
 
     histogram->_events = &_events;
 
@@ -1480,6 +1541,17 @@ namespace visimpl
     std::for_each(_histogramWidgets.begin(), _histogramWidgets.end(), assignPlayer);
   }
 
+  void Summary::spikeWindow( std::shared_ptr< SpikeWindow > window )
+  {
+    _spikeWindow = window;
+
+    auto assignWindow = [&window](HistogramWidget *w)
+    {
+      w->spikeWindow(window.get());
+    };
+    std::for_each(_histogramWidgets.begin(), _histogramWidgets.end(), assignWindow);
+  }
+
   void Summary::repaintHistograms( void )
   {
     auto updateHistograms = [](HistogramWidget *w)
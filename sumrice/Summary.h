@@ -123,6 +123,13 @@ namespace visimpl
 
     void simulationPlayer( simil::SimulationPlayer* player );
 
+    /** \brief Sets the spike window of a windowed load, the histograms
+     * count its spikes instead of the resident ones.
+     * \param[in] window Spike window or nullptr.
+     *
+     */
+    void spikeWindow( std::shared_ptr< SpikeWindow > window );
+
     void repaintHistograms( void );
 
     /** \brief Changes the name of the histogram.
@@ -267,6 +274,14 @@ namespace visimpl
     void insertSubset( const Selection& selection );
     void insertSubset( const std::string& name, const GIDUSet& subset );
 
+    /** \brief Fills the histograms of the given subset widgets with a
+     * single pass over the spikes.
+     *
+     */
+    void _computeSubsetHistograms(
+      const std::vector< visimpl::HistogramWidget* >& widgets ,
+      float startTime , float endTime );
+
     void CreateSummarySpikes( );
     void InsertSummarySpikes( const GIDUSet& gids );
 
@@ -311,6 +326,7 @@ namespace visimpl
     std::shared_ptr<simil::SpikeData> _spikeReport;
 
     simil::SimulationPlayer* _player;
+    std::shared_ptr< SpikeWindow > _spikeWindow;
 
     GIDUSet _gids;
 
@@ -331,6 +347,8 @@ namespace visimpl
     std::vector< visimpl::HistogramWidget* > _histogramWidgets;
     std::vector< HistogramRow > _histogramRows;
 
+    bool _deferHistogramInit;
+
     FocusFrame* _focusWidget;
 
     QDoubleSpinBox* _spinBoxScaleHorizontal;
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#define BOOST_TEST_MODULE importers_gid_filter
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <importers/GIDFilter.h>
+
+namespace
+{
+  // Every GID in [first, last] and the given ones against a set.
+  void checkFilter( const std::vector< uint32_t >& gids , uint32_t first ,
+                    uint32_t last , const std::vector< uint32_t >& probes )
+  {
+    const importers::GIDFilter filter( gids );
+    const std::set< uint32_t > expected( gids.cbegin( ) , gids.cend( ));
+
+    BOOST_CHECK( !filter.all( ));
+    for ( uint64_t gid = first; gid <= last; ++gid )
+    {
+      const auto gid32 = static_cast< uint32_t >( gid );
+      BOOST_REQUIRE_EQUAL( filter.contains( gid32 ) , expected.count( gid32 ) > 0 );
+    }
+
+    for ( const auto gid: probes )
+      BOOST_REQUIRE_EQUAL( filter.contains( gid ) , expected.count( gid ) > 0 );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( importers_gid_filter_empty )
+{
+  const importers::GIDFilter filter( { } );
+
+  BOOST_CHECK( filter.all( ));
+  BOOST_CHECK( filter.contains( 0 ));
+  BOOST_CHECK( filter.contains( 12345 ));
+  BOOST_CHECK( filter.contains( std::numeric_limits< uint32_t >::max( )));
+}
+
+BOOST_AUTO_TEST_CASE( importers_gid_filter_bitmap )
+{
+  const uint32_t max = std::numeric_limits< uint32_t >::max( );
+
+  // Dense GIDs, unsorted and repeated, around the 64 bit word boundaries.
+  std::vector< uint32_t > gids = { 130 , 0 , 63 , 64 , 65 , 127 , 128 , 5 , 64 , 0 , 1000 };
+  checkFilter( gids , 0 , 2000 , { 1001 , 1024 , 100000 , max } );
+
+  std::mt19937 generator( 3 );
+  std::uniform_int_distribution< uint32_t > distribution( 0 , 1 << 16 );
+  gids.clear( );
+  for ( int i = 0; i < 5000; ++i )
+    gids.push_back( distribution( generator ));
+  checkFilter( gids , 0 , ( 1 << 16 ) + 100 , { max } );
+
+  // The largest GID a bitmap is built for.
+  const uint32_t largest = static_cast< uint32_t >(
+    importers::GIDFilter::MAX_BITMAP_BYTES * 8 - 1 );
+  checkFilter( { 1 , largest } , 0 , 100 ,
+               { largest - 1 , largest , largest + 1 , max } );
+}
+
+BOOST_AUTO_TEST_CASE( importers_gid_filter_sorted )
+{
+  const uint32_t max = std::numeric_limits< uint32_t >::max( );
+
+  // GIDs too sparse for a bitmap fall back to the sorted vector.
+  const uint32_t sparse = static_cast< uint32_t >(
+    importers::GIDFilter::MAX_BITMAP_BYTES * 8 );
+  checkFilter( { sparse , 7 , 3 , 7 , max } , 0 , 100 ,
+               { sparse - 1 , sparse , sparse + 1 , max - 1 , max } );
+
+  std::mt19937 generator( 5 );
+  std::uniform_int_distribution< uint32_t > distribution( 0 , max );
+  std::vector< uint32_t > gids;
+  for ( int i = 0; i < 5000; ++i )
+    gids.push_back( distribution( generator ));
+  gids.push_back( max );
+
+  std::vector< uint32_t > probes( gids );
+  for ( int i = 0; i < 5000; ++i )
+    probes.push_back( distribution( generator ));
+  for ( const auto gid: gids )
+  {
+    probes.push_back( gid - 1 );
+    probes.push_back( gid + 1 );
+  }
+  checkFilter( gids , 0 , 1000 , probes );
+}
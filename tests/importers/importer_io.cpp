@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#define BOOST_TEST_MODULE importers_importer_io
+
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <importers/ImporterIO.h>
+
+namespace
+{
+  bool parseIntText( const std::string& text , long long& value ,
+                     size_t& consumed )
+  {
+    const char* it = text.data( );
+    const bool parsed = importers::parseInt( it , text.data( ) + text.size( ) ,
+                                             value );
+    consumed = it - text.data( );
+    return parsed;
+  }
+
+  bool parseDoubleText( const std::string& text , double& value ,
+                        size_t& consumed )
+  {
+    const char* it = text.data( );
+    const bool parsed = importers::parseDouble( it , text.data( ) + text.size( ) ,
+                                                value );
+    consumed = it - text.data( );
+    return parsed;
+  }
+
+  // The number as strtod reads it, the reference of parseDouble.
+  void checkDouble( const std::string& text )
+  {
+    double value = 0.0;
+    size_t consumed = 0;
+    BOOST_REQUIRE_MESSAGE( parseDoubleText( text , value , consumed ) , text );
+
+    char* strtodEnd = nullptr;
+    const double expected = std::strtod( text.c_str( ) , &strtodEnd );
+    BOOST_CHECK_MESSAGE( value == expected , text << ": " << value
+                         << " != " << expected );
+    BOOST_CHECK_EQUAL( consumed , static_cast< size_t >( strtodEnd - text.c_str( )));
+  }
+
+  std::string printfG( double value )
+  {
+    char number[ 32 ];
+    std::snprintf( number , sizeof( number ) , "%g" , value );
+    return number;
+  }
+
+  std::string appendDouble( double value )
+  {
+    std::string text;
+    importers::appendDouble( text , value );
+    return text;
+  }
+
+  // Lines with their own index, "index\n", as many as given.
+  std::string numberedLines( size_t lines )
+  {
+    std::string text;
+    for ( size_t i = 0; i < lines; ++i )
+    {
+      importers::appendInt( text , static_cast< long long >( i ));
+      text += '\n';
+    }
+    return text;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( importers_parse_int )
+{
+  long long value = 0;
+  size_t consumed = 0;
+
+  BOOST_CHECK( parseIntText( "0" , value , consumed ));
+  BOOST_CHECK_EQUAL( value , 0 );
+  BOOST_CHECK( parseIntText( "12345,6" , value , consumed ));
+  BOOST_CHECK_EQUAL( value , 12345 );
+  BOOST_CHECK_EQUAL( consumed , 5u );
+  BOOST_CHECK( parseIntText( "-42 " , value , consumed ));
+  BOOST_CHECK_EQUAL( value , -42 );
+  BOOST_CHECK_EQUAL( consumed , 3u );
+  BOOST_CHECK( parseIntText( "+7" , value , consumed ));
+  BOOST_CHECK_EQUAL( value , 7 );
+  BOOST_CHECK( parseIntText( "9223372036854775807" , value , consumed ));
+  BOOST_CHECK_EQUAL( value , 9223372036854775807ll );
+
+  // No leading whitespace, no lone signs. The position doesn't move.
+  BOOST_CHECK( !parseIntText( "" , value , consumed ));
+  BOOST_CHECK( !parseIntText( " 1" , value , consumed ));
+  BOOST_CHECK_EQUAL( consumed , 0u );
+  BOOST_CHECK( !parseIntText( "-" , value , consumed ));
+  BOOST_CHECK_EQUAL( consumed , 0u );
+  BOOST_CHECK( !parseIntText( "x1" , value , consumed ));
+}
+
+BOOST_AUTO_TEST_CASE( importers_parse_double )
+{
+  // Fast path: exact mantissa and power of ten.
+  for ( const auto& text: { "0" , "1" , "-1" , "+1" , "0.5" , "-0.125" ,
+                            "3.14159" , "12.", ".75" , "1e3" , "1E-3" ,
+                            "-2.5e+10" , "123456789012345" , "1e22" ,
+                            "1e-22" , "0.000001" , "9007199254740992" } )
+    checkDouble( text );
+
+  // Fallback: exponents beyond the exact powers and long mantissas.
+  for ( const auto& text: { "1e23" , "1e-23" , "4.9e-324" , "1.7976931348623157e308" ,
+                            "9007199254740993" , "1234567890123456789" ,
+                            "12345678901234567890123" , "-98765432109876543210.5" ,
+                            "0.12345678901234567890123" ,
+                            "1.00000000000000000000001e5" ,
+                            "123456789012345678901e-30" } )
+    checkDouble( text );
+
+  // Stops at the first character not in the number.
+  double value = 0.0;
+  size_t consumed = 0;
+  BOOST_CHECK( parseDoubleText( "2.5,3" , value , consumed ));
+  BOOST_CHECK_EQUAL( value , 2.5 );
+  BOOST_CHECK_EQUAL( consumed , 3u );
+  BOOST_CHECK( parseDoubleText( "2e" , value , consumed ));
+  BOOST_CHECK_EQUAL( value , 2.0 );
+  BOOST_CHECK_EQUAL( consumed , 1u );
+
+  BOOST_CHECK( !parseDoubleText( "" , value , consumed ));
+  BOOST_CHECK( !parseDoubleText( "-" , value , consumed ));
+  BOOST_CHECK( !parseDoubleText( "." , value , consumed ));
+  BOOST_CHECK( !parseDoubleText( "e5" , value , consumed ));
+  BOOST_CHECK_EQUAL( consumed , 0u );
+
+  // Random numbers as the exporters print them.
+  std::mt19937 generator( 42 );
+  std::uniform_real_distribution< double > mantissa( -1.0 , 1.0 );
+  std::uniform_int_distribution< int > exponent( -40 , 40 );
+  for ( int i = 0; i < 10000; ++i )
+  {
+    char text[ 64 ];
+    const double number = mantissa( generator ) * std::pow( 10.0 , exponent( generator ));
+    std::snprintf( text , sizeof( text ) , i % 2 ? "%.17g" : "%.6f" , number );
+    checkDouble( text );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( importers_append_double )
+{
+  for ( const double value: { 0.0 , -0.0 , 1.0 , -1.0 , 0.5 , 123456.0 ,
+                              999999.0 , 1e6 , -1e6 , 1234567.0 , 0.1 ,
+                              1.0 / 3.0 , 1e-5 , 1e-4 , 123.456789 ,
+                              1e300 , -2.5e-300 } )
+    BOOST_CHECK_EQUAL( appendDouble( value ) , printfG( value ));
+
+  std::mt19937 generator( 7 );
+  std::uniform_real_distribution< double > uniform( -1e7 , 1e7 );
+  for ( int i = 0; i < 10000; ++i )
+  {
+    const double value = uniform( generator );
+    BOOST_REQUIRE_EQUAL( appendDouble( value ) , printfG( value ));
+
+    // Integral values take the fast path.
+    const double integral = std::trunc( value / 16.0 );
+    BOOST_REQUIRE_EQUAL( appendDouble( integral ) , printfG( integral ));
+  }
+
+  std::string text = "x=";
+  importers::appendDouble( text , 2.5 );
+  BOOST_CHECK_EQUAL( text , "x=2.5" );
+}
+
+BOOST_AUTO_TEST_CASE( importers_split_lines )
+{
+  BOOST_CHECK( importers::splitLines( nullptr , 0 , 16 ).empty( ));
+
+  for ( const std::string& text: { std::string( "1,2\r\n3,4\r\n5,6\r\n7,8\r\n" ) ,
+                                   std::string( "1,2\n3,4\n5,6\n7,8" ) ,
+                                   std::string( "1,2\r\n3,4\r\n5,6\r\n7,8" ) ,
+                                   numberedLines( 1000 ) } )
+  {
+    for ( const size_t chunkSize: { size_t( 1 ) , size_t( 3 ) , size_t( 5 ) ,
+                                    size_t( 64 ) , text.size( ) , size_t( 1 << 20 ) } )
+    {
+      const auto chunks =
+        importers::splitLines( text.data( ) , text.size( ) , chunkSize );
+      BOOST_REQUIRE( !chunks.empty( ));
+
+      // Contiguous, covering the whole text, and ending at line ends.
+      BOOST_CHECK( chunks.front( ).first == text.data( ));
+      BOOST_CHECK( chunks.back( ).second == text.data( ) + text.size( ));
+      for ( size_t i = 0; i < chunks.size( ); ++i )
+      {
+        BOOST_REQUIRE( chunks[ i ].first < chunks[ i ].second );
+        if ( i + 1 < chunks.size( ))
+        {
+          BOOST_CHECK( chunks[ i ].second == chunks[ i + 1 ].first );
+          BOOST_CHECK_EQUAL( chunks[ i ].second[ -1 ] , '\n' );
+        }
+      }
+
+      // The lines of the chunks, without the end of line characters, are
+      // those of the text.
+      std::vector< std::string > lines;
+      for ( const auto& chunk: chunks )
+      {
+        const char* it = chunk.first;
+        while ( it != chunk.second )
+        {
+          const char* begin = it;
+          const char* end = importers::takeLine( it , chunk.second );
+          lines.emplace_back( begin , end );
+        }
+      }
+
+      std::vector< std::string > expected;
+      size_t begin = 0;
+      while ( begin < text.size( ))
+      {
+        size_t end = text.find( '\n' , begin );
+        if ( end == std::string::npos ) end = text.size( );
+
+        size_t last = end;
+        if ( last > begin && text[ last - 1 ] == '\r' ) --last;
+        expected.push_back( text.substr( begin , last - begin ));
+        begin = end + 1;
+      }
+
+      BOOST_CHECK( lines == expected );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( importers_parse_chunks )
+{
+  const std::string text = numberedLines( 20000 );
+  const size_t chunkSize = 256;
+  const unsigned int threads = 4;
+
+  const auto chunks =
+    importers::splitLines( text.data( ) , text.size( ) , chunkSize );
+  BOOST_REQUIRE( chunks.size( ) > 8 * threads );
+
+  auto chunkIndex = [ &chunks ]( const char* begin )
+  {
+    size_t i = 0;
+    while ( chunks[ i ].first != begin ) ++i;
+    return i;
+  };
+
+  // Chunks are parsed at most one window, two per thread, ahead of the
+  // consumer and consumed in file order.
+  std::atomic< size_t > consumedChunks( 0 );
+  std::atomic< size_t > maxAhead( 0 );
+
+  auto parse = [ & ]( const char* begin , const char* end ,
+                      std::vector< long long >& result )
+  {
+    const size_t ahead = chunkIndex( begin ) - consumedChunks;
+    size_t previous = maxAhead;
+    while ( ahead > previous && !maxAhead.compare_exchange_weak( previous , ahead ));
+
+    result.clear( );
+    while ( begin != end )
+    {
+      long long value;
+      if ( !importers::parseInt( begin , end , value )) return false;
+      result.push_back( value );
+      ++begin;
+    }
+    return true;
+  };
+
+  std::vector< long long > values;
+  auto consume = [ & ]( const std::vector< long long >& result )
+  {
+    values.insert( values.end( ) , result.cbegin( ) , result.cend( ));
+    ++consumedChunks;
+  };
+
+  BOOST_REQUIRE( importers::parseChunks< std::vector< long long >>(
+    text.data( ) , text.size( ) , parse , consume , threads , chunkSize ));
+
+  BOOST_CHECK_EQUAL( consumedChunks , chunks.size( ));
+  BOOST_CHECK( maxAhead < 2 * threads );
+  BOOST_REQUIRE_EQUAL( values.size( ) , 20000u );
+  for ( size_t i = 0; i < values.size( ); ++i )
+    BOOST_REQUIRE_EQUAL( values[ i ] , static_cast< long long >( i ));
+}
+
+BOOST_AUTO_TEST_CASE( importers_parse_chunks_failure )
+{
+  // A line that isn't a number in the middle of the text.
+  std::string text = numberedLines( 10000 );
+  const size_t broken = text.find( "\n5000\n" ) + 1;
+  text[ broken ] = 'x';
+
+  const size_t chunkSize = 256;
+  const auto chunks =
+    importers::splitLines( text.data( ) , text.size( ) , chunkSize );
+
+  size_t failedChunk = 0;
+  while ( chunks[ failedChunk ].second <= text.data( ) + broken ) ++failedChunk;
+
+  for ( const unsigned int threads: { 1u , 4u } )
+  {
+    std::mutex mutex;
+    std::vector< const char* > consumed;
+
+    auto parse = [ ]( const char* begin , const char* end ,
+                      const char*& result )
+    {
+      result = begin;
+      while ( begin != end )
+      {
+        long long value;
+        if ( !importers::parseInt( begin , end , value )) return false;
+        ++begin;
+      }
+      return true;
+    };
+
+    auto consume = [ & ]( const char* result )
+    {
+      std::lock_guard< std::mutex > lock( mutex );
+      consumed.push_back( result );
+    };
+
+    BOOST_CHECK( !importers::parseChunks< const char* >(
+      text.data( ) , text.size( ) , parse , consume , threads , chunkSize ));
+
+    // Only chunks before the failing one are consumed, in order.
+    BOOST_CHECK( consumed.size( ) <= failedChunk );
+    for ( size_t i = 0; i < consumed.size( ); ++i )
+      BOOST_CHECK( consumed[ i ] == chunks[ i ].first );
+  }
+}
@@ -0,0 +1,428 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SyntheticDataset.h"
+
+#include <sumrice/SpikeCache.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <locale>
+
+#include <hdf5.h>
+
+namespace visimpl
+{
+  namespace
+  {
+    // Distance between neighbour neurons of the grid layout.
+    constexpr float GRID_SPACING = 10.0f;
+
+    // Height of each layer and vertical gap between layers.
+    constexpr float LAYER_HEIGHT = 40.0f;
+    constexpr float LAYER_GAP = 10.0f;
+
+    // Population name of the SONATA spike report.
+    constexpr char POPULATION[ ] = "synthetic";
+
+    /**
+     * SplitMix64 generator, fast and the same on every platform.
+     */
+    class Random
+    {
+    public:
+
+      explicit Random( uint64_t seed )
+        : _state( seed )
+      { }
+
+      uint64_t next( )
+      {
+        uint64_t z = ( _state += 0x9E3779B97F4A7C15ull );
+        z = ( z ^ ( z >> 30 )) * 0xBF58476D1CE4E5B9ull;
+        z = ( z ^ ( z >> 27 )) * 0x94D049BB133111EBull;
+        return z ^ ( z >> 31 );
+      }
+
+      // Uniform in [0, 1).
+      double uniform( )
+      {
+        return static_cast< double >( next( ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+      }
+
+      double exponential( double rate )
+      {
+        return -std::log( 1.0 - uniform( )) / rate;
+      }
+
+      // Box-Muller, one of the pair is enough here.
+      double normal( )
+      {
+        const double u = 1.0 - uniform( );
+        const double v = uniform( );
+        return std::sqrt( -2.0 * std::log( u )) * std::cos( 6.283185307179586 * v );
+      }
+
+    protected:
+
+      uint64_t _state;
+    };
+
+    // Independent stream of each neuron, the spikes of a neuron don't
+    // depend on how many neurons come before it.
+    Random neuronRandom( uint64_t seed , uint32_t gid )
+    {
+      Random mix( seed ^ ( static_cast< uint64_t >( gid ) * 0xD1B54A32D192ED03ull ));
+      return Random( mix.next( ));
+    }
+
+    void classicStream( std::ofstream& stream )
+    {
+      // Dot as decimal separator no matter the application locale, and
+      // enough digits to read back the same floats.
+      stream.imbue( std::locale::classic( ));
+      stream.precision( std::numeric_limits< float >::max_digits10 );
+    }
+
+    template< typename T >
+    bool writeDataset( hid_t location , const char* name , hid_t fileType ,
+                       hid_t memoryType , const std::vector< hsize_t >& dims ,
+                       const T* data )
+    {
+      const hid_t space = H5Screate_simple( static_cast< int >( dims.size( )) ,
+                                            dims.data( ) , nullptr );
+      const hid_t dataset = H5Dcreate2( location , name , fileType , space ,
+                                        H5P_DEFAULT , H5P_DEFAULT , H5P_DEFAULT );
+
+      bool ok = space >= 0 && dataset >= 0;
+      if ( ok && dims.front( ) > 0 )
+        ok = H5Dwrite( dataset , memoryType , H5S_ALL , H5S_ALL ,
+                       H5P_DEFAULT , data ) >= 0;
+
+      if ( dataset >= 0 ) H5Dclose( dataset );
+      if ( space >= 0 ) H5Sclose( space );
+
+      return ok;
+    }
+  }
+
+  SyntheticDataset::SyntheticDataset( const SyntheticDatasetConfig& config )
+    : _config( config )
+  {
+    _generatePositions( );
+    _generateSpikes( );
+    _generateSubsetsAndEvents( );
+  }
+
+  const SyntheticDatasetConfig& SyntheticDataset::config( ) const
+  {
+    return _config;
+  }
+
+  const std::vector< float >& SyntheticDataset::positions( ) const
+  {
+    return _positions;
+  }
+
+  const simil::Spikes& SyntheticDataset::spikes( ) const
+  {
+    return _spikes;
+  }
+
+  const std::vector< SyntheticDataset::Subset >&
+  SyntheticDataset::subsets( ) const
+  {
+    return _subsets;
+  }
+
+  const std::vector< SyntheticEvent >& SyntheticDataset::events( ) const
+  {
+    return _events;
+  }
+
+  void SyntheticDataset::_generatePositions( )
+  {
+    const uint32_t neurons = _config.neurons;
+    const auto side = static_cast< uint32_t >(
+      std::ceil( std::cbrt( static_cast< double >( neurons )) - 1e-9 ));
+    const float extent = side * GRID_SPACING;
+    const float offset = ( side - 1 ) * GRID_SPACING * 0.5f;
+    const unsigned int layers = std::max( _config.layers , 1u );
+
+    Random random( _config.seed );
+
+    _positions.resize( static_cast< size_t >( neurons ) * 3 );
+    for ( uint32_t gid = 0; gid < neurons; ++gid )
+    {
+      float* position = &_positions[ static_cast< size_t >( gid ) * 3 ];
+
+      switch ( _config.layout )
+      {
+        case SpatialLayout::Grid:
+          position[ 0 ] = ( gid % side ) * GRID_SPACING - offset;
+          position[ 1 ] = (( gid / side ) % side ) * GRID_SPACING - offset;
+          position[ 2 ] = ( gid / ( side * side )) * GRID_SPACING - offset;
+          break;
+        case SpatialLayout::Random:
+          for ( int i = 0; i < 3; ++i )
+            position[ i ] = static_cast< float >( random.uniform( )) * extent -
+                            extent * 0.5f;
+          break;
+        case SpatialLayout::Layers:
+        {
+          const auto layer = static_cast< uint64_t >( gid ) * layers / neurons;
+          position[ 0 ] = static_cast< float >( random.uniform( )) * extent;
+          position[ 1 ] = -( LAYER_HEIGHT + LAYER_GAP ) * layer -
+                          static_cast< float >( random.uniform( )) * LAYER_HEIGHT;
+          position[ 2 ] = static_cast< float >( random.uniform( )) * extent;
+        }
+          break;
+      }
+    }
+  }
+
+  void SyntheticDataset::_generateSpikes( )
+  {
+    const double mean = std::max( _config.meanRate , 0.0f );
+    const double spread = std::max( _config.rateSpread , 0.0f );
+
+    // Keeps the mean of the log-normal rates at the given one.
+    const double logMean = std::log( std::max( mean , 1e-30 )) - spread * spread * 0.5;
+
+    _spikes.clear( );
+    _spikes.reserve( static_cast< size_t >( mean * _config.duration *
+                                            _config.neurons * 1.05 ));
+
+    for ( uint32_t gid = 0; gid < _config.neurons; ++gid )
+    {
+      auto random = neuronRandom( _config.seed , gid );
+
+      double rate = mean;
+      switch ( _config.rateDistribution )
+      {
+        case RateDistribution::Constant:
+          break;
+        case RateDistribution::Uniform:
+          rate = mean * ( 1.0 + spread * ( 2.0 * random.uniform( ) - 1.0 ));
+          break;
+        case RateDistribution::LogNormal:
+          rate = std::exp( logMean + spread * random.normal( ));
+          break;
+      }
+
+      if ( !( rate > 0.0 )) continue;
+
+      for ( double time = random.exponential( rate ); time < _config.duration;
+            time += random.exponential( rate ))
+      {
+        _spikes.push_back( std::make_pair( static_cast< float >( time ) , gid ));
+      }
+    }
+
+    std::sort( _spikes.begin( ) , _spikes.end( ));
+  }
+
+  void SyntheticDataset::_generateSubsetsAndEvents( )
+  {
+    const uint32_t subsets = std::min( _config.subsets , _config.neurons );
+    for ( uint32_t i = 0; i < subsets; ++i )
+    {
+      const auto first = static_cast< uint64_t >( _config.neurons ) * i / subsets;
+      const auto last = static_cast< uint64_t >( _config.neurons ) * ( i + 1 ) / subsets;
+
+      Subset subset;
+      subset.first = "Subset " + std::to_string( i );
+      for ( auto gid = first; gid < last; ++gid )
+        subset.second.push_back( static_cast< uint32_t >( gid ));
+
+      _subsets.push_back( std::move( subset ));
+    }
+
+    // The middle half of each of events equal slots of the simulation.
+    const float slot = _config.events > 0 ? _config.duration / _config.events : 0.0f;
+    for ( unsigned int i = 0; i < _config.events; ++i )
+    {
+      _events.push_back( SyntheticEvent{ "Event " + std::to_string( i ) ,
+                                         slot * i + slot * 0.25f ,
+                                         slot * i + slot * 0.75f } );
+    }
+  }
+
+  std::unique_ptr< simil::SpikeData > SyntheticDataset::spikeData( ) const
+  {
+    std::unique_ptr< simil::SpikeData > data( new simil::SpikeData( ));
+
+    simil::TGIDSet gidSet;
+    simil::TPosVect positionVector;
+    positionVector.reserve( _config.neurons );
+    for ( uint32_t gid = 0; gid < _config.neurons; ++gid )
+    {
+      gidSet.insert( gidSet.end( ) , gid );
+      positionVector.emplace_back( _positions[ 3 * gid ] ,
+                                   _positions[ 3 * gid + 1 ] ,
+                                   _positions[ 3 * gid + 2 ] );
+    }
+
+    data->setGids( gidSet );
+    data->setPositions( positionVector );
+    data->setSpikes( _spikes );
+    data->setStartTime( _spikes.empty( ) ? 0.0f : _spikes.front( ).first );
+    data->setEndTime( _spikes.empty( ) ? _config.duration : _spikes.back( ).first );
+
+    return data;
+  }
+
+  bool SyntheticDataset::writeCSV( const std::string& networkPath ,
+                                   const std::string& activityPath ) const
+  {
+    std::ofstream network( networkPath );
+    classicStream( network );
+    for ( uint32_t gid = 0; gid < _config.neurons && network; ++gid )
+    {
+      const float* position = &_positions[ static_cast< size_t >( gid ) * 3 ];
+      network << gid << ',' << position[ 0 ] << ',' << position[ 1 ] << ','
+              << position[ 2 ] << '\n';
+    }
+    network.close( );
+
+    std::ofstream activity( activityPath );
+    classicStream( activity );
+    for ( const auto& spike: _spikes )
+    {
+      if ( !activity ) break;
+      activity << spike.second << ',' << spike.first << '\n';
+    }
+    activity.close( );
+
+    return !network.fail( ) && !activity.fail( );
+  }
+
+  bool SyntheticDataset::writeHDF5( const std::string& networkPath ,
+                                    const std::string& activityPath ) const
+  {
+    const unsigned int layers = std::max( _config.layers , 1u );
+
+    std::vector< float > cells;
+    cells.reserve( static_cast< size_t >( _config.neurons ) * 5 );
+    for ( uint32_t gid = 0; gid < _config.neurons; ++gid )
+    {
+      const float* position = &_positions[ static_cast< size_t >( gid ) * 3 ];
+      const auto layer = _config.layout == SpatialLayout::Layers ?
+        static_cast< uint64_t >( gid ) * layers / _config.neurons : 0;
+
+      cells.push_back( static_cast< float >( gid ));
+      cells.push_back( static_cast< float >( layer ));
+      cells.insert( cells.end( ) , position , position + 3 );
+    }
+
+    const hid_t network = H5Fcreate( networkPath.c_str( ) , H5F_ACC_TRUNC ,
+                                     H5P_DEFAULT , H5P_DEFAULT );
+    if ( network < 0 ) return false;
+
+    bool ok = false;
+    const hid_t cellsGroup = H5Gcreate2( network , "cells" , H5P_DEFAULT ,
+                                         H5P_DEFAULT , H5P_DEFAULT );
+    if ( cellsGroup >= 0 )
+    {
+      ok = writeDataset( cellsGroup , "positions" , H5T_IEEE_F32LE ,
+                         H5T_NATIVE_FLOAT , { _config.neurons , 5 } ,
+                         cells.data( ));
+      H5Gclose( cellsGroup );
+    }
+    ok = H5Fclose( network ) >= 0 && ok;
+
+    if ( !ok ) return false;
+
+    std::vector< uint64_t > nodeIds( _spikes.size( ));
+    std::vector< double > timestamps( _spikes.size( ));
+    for ( size_t i = 0; i < _spikes.size( ); ++i )
+    {
+      nodeIds[ i ] = _spikes[ i ].second;
+      timestamps[ i ] = _spikes[ i ].first;
+    }
+
+    const hid_t activity = H5Fcreate( activityPath.c_str( ) , H5F_ACC_TRUNC ,
+                                      H5P_DEFAULT , H5P_DEFAULT );
+    if ( activity < 0 ) return false;
+
+    const std::string populationPath = std::string( "spikes/" ) + POPULATION;
+    const hid_t linkProperties = H5Pcreate( H5P_LINK_CREATE );
+    H5Pset_create_intermediate_group( linkProperties , 1 );
+    const hid_t population = H5Gcreate2( activity , populationPath.c_str( ) ,
+                                         linkProperties , H5P_DEFAULT ,
+                                         H5P_DEFAULT );
+    H5Pclose( linkProperties );
+
+    ok = false;
+    if ( population >= 0 )
+    {
+      const hsize_t spikes = _spikes.size( );
+      ok = writeDataset( population , "node_ids" , H5T_STD_U64LE ,
+                         H5T_NATIVE_UINT64 , { spikes } , nodeIds.data( )) &&
+           writeDataset( population , "timestamps" , H5T_IEEE_F64LE ,
+                         H5T_NATIVE_DOUBLE , { spikes } , timestamps.data( ));
+      H5Gclose( population );
+    }
+
+    return H5Fclose( activity ) >= 0 && ok;
+  }
+
+  bool SyntheticDataset::writeSubsetEvents( const std::string& path ) const
+  {
+    std::ofstream file( path );
+    classicStream( file );
+
+    file << "{\n  \"subsets\": [";
+    for ( size_t i = 0; i < _subsets.size( ); ++i )
+    {
+      file << ( i == 0 ? "\n" : ",\n" )
+           << "    { \"name\": \"" << _subsets[ i ].first << "\", \"gids\": [";
+      const auto& gids = _subsets[ i ].second;
+      for ( size_t j = 0; j < gids.size( ); ++j )
+        file << ( j == 0 ? "" : ", " ) << gids[ j ];
+      file << "] }";
+    }
+
+    file << "\n  ],\n  \"timeframes\": [";
+    for ( size_t i = 0; i < _events.size( ); ++i )
+    {
+      file << ( i == 0 ? "\n" : ",\n" )
+           << "    { \"name\": \"" << _events[ i ].name << "\", \"timeFrames\": [ "
+           << "{ \"start\": " << _events[ i ].start
+           << ", \"end\": " << _events[ i ].end << " } ] }";
+    }
+    file << "\n  ]\n}\n";
+
+    file.close( );
+    return !file.fail( );
+  }
+
+  bool SyntheticDataset::writeCache( const std::string& networkPath ,
+                                     const std::string& activityPath ) const
+  {
+    const auto hash = SpikeCache::sourceHash( { networkPath , activityPath } ,
+                                              static_cast< int >( simil::TCSV ));
+
+    return SpikeCache::write( SpikeCache::cachePath( networkPath ) , hash ,
+                              *spikeData( ));
+  }
+}
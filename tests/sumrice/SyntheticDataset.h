@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef __VISIMPL_SYNTHETIC_DATASET_H__
+#define __VISIMPL_SYNTHETIC_DATASET_H__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <simil/simil.h>
+
+namespace visimpl
+{
+  /**
+   * Distribution of the firing rates of the neurons around the mean rate.
+   */
+  enum class RateDistribution
+  {
+    Constant ,
+    Uniform ,   // mean * ( 1 +- spread ).
+    LogNormal   // sigma = spread, with the given mean.
+  };
+
+  /**
+   * Spatial layout of the neurons.
+   */
+  enum class SpatialLayout
+  {
+    Grid ,      // cubic grid, 10 units apart, centered on the origin.
+    Random ,    // uniform in the cube of the grid.
+    Layers      // stacked horizontal layers of consecutive GIDs.
+  };
+
+  /**
+   * Scale and shape of a synthetic dataset. Times are in simulation units,
+   * rates in spikes per neuron and unit of time.
+   */
+  struct SyntheticDatasetConfig
+  {
+    uint32_t neurons = 1000;
+    float duration = 1000.0f;
+    float meanRate = 0.01f;
+    RateDistribution rateDistribution = RateDistribution::LogNormal;
+    float rateSpread = 0.5f;
+    SpatialLayout layout = SpatialLayout::Grid;
+    unsigned int layers = 5;
+    unsigned int subsets = 0;
+    unsigned int events = 0;
+    uint64_t seed = 42;
+  };
+
+  /**
+   * Time frame of a synthetic event.
+   */
+  struct SyntheticEvent
+  {
+    std::string name;
+    float start;
+    float end;
+  };
+
+  /**
+   * Network and spike trains generated from a SyntheticDatasetConfig, to
+   * exercise the loaders at any scale without real data.
+   *
+   * Neurons have GIDs 0 to neurons - 1. Every neuron fires as a Poisson
+   * process of its own rate. The generator doesn't use the standard library
+   * distributions, whose output differs between implementations: the same
+   * configuration gives the same dataset on every platform.
+   *
+   * Subsets are contiguous GID ranges of about the same size, events are
+   * evenly spaced time frames.
+   */
+  class SyntheticDataset
+  {
+  public:
+
+    typedef std::pair< std::string , std::vector< uint32_t >> Subset;
+
+    explicit SyntheticDataset( const SyntheticDatasetConfig& config );
+
+    const SyntheticDatasetConfig& config( ) const;
+
+    /**
+     * Position of every neuron, x, y and z per GID.
+     */
+    const std::vector< float >& positions( ) const;
+
+    /**
+     * Spikes sorted by time, and by GID at the same time.
+     */
+    const simil::Spikes& spikes( ) const;
+
+    const std::vector< Subset >& subsets( ) const;
+
+    const std::vector< SyntheticEvent >& events( ) const;
+
+    /**
+     * Simulation data of the dataset, as the loaders build it.
+     */
+    std::unique_ptr< simil::SpikeData > spikeData( ) const;
+
+    /**
+     * Writes the "gid,x,y,z" network and "gid,time" activity CSV files.
+     *
+     * @return false if a file couldn't be written.
+     */
+    bool writeCSV( const std::string& networkPath ,
+                   const std::string& activityPath ) const;
+
+    /**
+     * Writes the network as a "cells/positions" dataset of id, type (layer),
+     * x, y, z rows, the layout the importers read, and the activity as a
+     * SONATA spike report: "spikes/<population>/node_ids" and "timestamps".
+     *
+     * @return false if a file couldn't be written.
+     */
+    bool writeHDF5( const std::string& networkPath ,
+                    const std::string& activityPath ) const;
+
+    /**
+     * Writes the subsets and events as a JSON subset events file.
+     *
+     * @return false if the file couldn't be written.
+     */
+    bool writeSubsetEvents( const std::string& path ) const;
+
+    /**
+     * Writes the SpikeCache of the given CSV files, previously written by
+     * writeCSV( ), so loading them takes the binary path.
+     *
+     * @return false if the cache couldn't be written.
+     */
+    bool writeCache( const std::string& networkPath ,
+                     const std::string& activityPath ) const;
+
+  protected:
+
+    void _generatePositions( );
+
+    void _generateSpikes( );
+
+    void _generateSubsetsAndEvents( );
+
+    SyntheticDatasetConfig _config;
+    std::vector< float > _positions;
+    simil::Spikes _spikes;
+    std::vector< Subset > _subsets;
+    std::vector< SyntheticEvent > _events;
+  };
+}
+
+#endif /* __VISIMPL_SYNTHETIC_DATASET_H__ */
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_bin_activity
+
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/BinActivity.h>
+
+BOOST_AUTO_TEST_CASE( sumrice_bin_activity_counts )
+{
+  const size_t bins = 1000;
+  visimpl::BinActivity activity( 2 , bins );
+
+  BOOST_CHECK_EQUAL( activity.rows( ) , 2u );
+  BOOST_CHECK_EQUAL( activity.bins( ) , bins );
+  BOOST_CHECK_EQUAL( activity.wordsPerRow( ) , 16u );
+
+  std::mt19937 generator( 7 );
+  std::bernoulli_distribution active( 0.3 );
+
+  std::vector< bool > a( bins ) , b( bins );
+  for ( size_t i = 0; i < bins; ++i )
+  {
+    a[ i ] = active( generator );
+    b[ i ] = active( generator );
+    if ( a[ i ] ) activity.set( 0 , i );
+    if ( b[ i ] ) activity.set( 1 , i );
+  }
+
+  for ( size_t i = 0; i < bins; ++i )
+  {
+    BOOST_CHECK_EQUAL( activity.test( 0 , i ) , a[ i ] );
+    BOOST_CHECK_EQUAL( activity.test( 1 , i ) , b[ i ] );
+  }
+
+  // Ranges inside a word, across words and over the whole row.
+  const std::vector< std::pair< size_t , size_t >> ranges =
+    {{ 0 , 0 } , { 3 , 17 } , { 60 , 70 } , { 64 , 128 } , { 1 , 999 } ,
+     { 0 , bins } , { 500 , 400 }};
+
+  for ( const auto& range: ranges )
+  {
+    size_t expectedA = 0;
+    size_t expectedBoth = 0;
+    for ( size_t i = range.first; i < range.second; ++i )
+    {
+      expectedA += a[ i ];
+      expectedBoth += a[ i ] && b[ i ];
+    }
+
+    BOOST_CHECK_EQUAL( visimpl::BinActivity::count(
+      activity.row( 0 ) , range.first , range.second ) , expectedA );
+    BOOST_CHECK_EQUAL( visimpl::BinActivity::countBoth(
+      activity.row( 0 ) , activity.row( 1 ) , range.first , range.second ) ,
+                       expectedBoth );
+  }
+}
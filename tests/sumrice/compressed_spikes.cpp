@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_compressed_spikes
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/CompressedSpikes.h>
+#include <sumrice/SpikeHistogram.h>
+
+namespace
+{
+  simil::Spikes randomSpikes( size_t amount , uint32_t gids , float endTime )
+  {
+    std::mt19937 generator( 42 );
+    std::uniform_real_distribution< float > time( 0.0f , endTime );
+    std::uniform_int_distribution< uint32_t > gid( 0 , gids - 1 );
+
+    std::vector< float > times( amount );
+    for ( auto& t: times ) t = time( generator );
+    std::sort( times.begin( ) , times.end( ));
+
+    simil::Spikes spikes;
+    spikes.reserve( amount );
+    for ( auto t: times )
+      spikes.push_back( std::make_pair( t , gid( generator )));
+
+    return spikes;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_compressed_spikes_roundtrip )
+{
+  simil::Spikes spikes;
+  spikes.push_back( std::make_pair( -2.5f , 7u ));
+  spikes.push_back( std::make_pair( -1.0f , 3u ));
+  spikes.push_back( std::make_pair( 0.0f , 4000000000u ));
+  spikes.push_back( std::make_pair( 0.0f , 0u ));
+  spikes.push_back( std::make_pair( 1.0f , 5u ));
+  spikes.push_back( std::make_pair( 1.0f , 5u ));
+  spikes.push_back( std::make_pair( 1e6f , 12u ));
+
+  // Blocks of 3 spikes also cover the block boundaries.
+  const visimpl::CompressedSpikes compressed( spikes , 3 );
+
+  BOOST_CHECK_EQUAL( compressed.size( ) , spikes.size( ));
+  BOOST_CHECK_EQUAL( compressed.blocks( ) , 3 );
+  BOOST_CHECK( compressed.decompress( ) == spikes );
+  BOOST_CHECK( std::equal( compressed.begin( ) , compressed.end( ) ,
+                           spikes.begin( )));
+
+  BOOST_CHECK_EQUAL( compressed.blockStartTime( 1 ) , 0.0f );
+  BOOST_CHECK_EQUAL( compressed.blockEndTime( 1 ) , 1.0f );
+
+  visimpl::CompressedSpikes chunks( 3 );
+  chunks.append( spikes.cbegin( ) , spikes.cbegin( ) + 4 );
+  chunks.append( spikes.cbegin( ) + 4 , spikes.cend( ));
+  BOOST_CHECK( chunks.decompress( ) == spikes );
+
+  simil::Spikes unsorted( spikes.rbegin( ) , spikes.rend( ));
+  BOOST_CHECK_THROW( visimpl::CompressedSpikes{ unsorted } ,
+                     std::invalid_argument );
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_compressed_spikes_search )
+{
+  const auto spikes = randomSpikes( 100000 , 1000 , 100.0f );
+  const visimpl::CompressedSpikes compressed( spikes , 512 );
+
+  const auto time = [ ]( float t , const simil::Spike& s ){ return t < s.first; };
+  const auto spikeTime = [ ]( const simil::Spike& s , float t ){ return s.first < t; };
+
+  for ( float t : { -1.0f , 0.0f , 12.5f , spikes[ 777 ].first , 99.99f , 200.0f } )
+  {
+    const size_t lower = std::lower_bound( spikes.cbegin( ) , spikes.cend( ) ,
+                                           t , spikeTime ) - spikes.cbegin( );
+    const size_t upper = std::upper_bound( spikes.cbegin( ) , spikes.cend( ) ,
+                                           t , time ) - spikes.cbegin( );
+
+    BOOST_CHECK_EQUAL( compressed.lowerBound( t ).index( ) , lower );
+    BOOST_CHECK_EQUAL( compressed.upperBound( t ).index( ) , upper );
+  }
+
+  const auto range = compressed.spikesBetween( 10.0f , 20.0f );
+  BOOST_CHECK( std::all_of( range.first , range.second ,
+    [ ]( const simil::Spike& s ){ return s.first >= 10.0f && s.first < 20.0f; } ));
+  BOOST_CHECK_EQUAL( range.first.index( ) ,
+                     compressed.lowerBound( 10.0f ).index( ));
+  BOOST_CHECK_EQUAL( range.second.index( ) ,
+                     compressed.lowerBound( 20.0f ).index( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_compressed_spikes_histogram )
+{
+  const auto spikes = randomSpikes( 200000 , 100000 , 1000.0f );
+  const visimpl::CompressedSpikes compressed( spikes );
+
+  // 17 bits of GID and a byte or two of time delta per spike.
+  BOOST_CHECK_LT( compressed.bytes( ) , spikes.size( ) * 4 );
+
+  std::unordered_set< uint32_t > filter;
+  for ( uint32_t i = 0; i < 100000; i += 7 )
+    filter.insert( i );
+
+  for ( const auto& f : { filter , std::unordered_set< uint32_t >( ) } )
+  {
+    for ( unsigned int threads : { 1u , 4u } )
+    {
+      std::vector< unsigned int > local( 300 , 0 );
+      std::vector< unsigned int > global;
+      std::vector< unsigned int > expectedLocal( 300 , 0 );
+      std::vector< unsigned int > expectedGlobal;
+
+      visimpl::buildSpikeHistogram( spikes , 50.0f , 900.0f , f ,
+                                    expectedLocal , expectedGlobal , 1 );
+      visimpl::buildSpikeHistogram( compressed , 50.0f , 900.0f , f ,
+                                    local , global , threads );
+
+      BOOST_CHECK( local == expectedLocal );
+      BOOST_CHECK( global == expectedGlobal );
+    }
+  }
+}
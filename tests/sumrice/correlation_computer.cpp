@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#define BOOST_TEST_MODULE sumrice_correlation_computer
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/CompressedSpikes.h>
+#include <sumrice/CorrelationComputer.h>
+#include <sumrice/SpikeCache.h>
+
+#include "SyntheticDataset.h"
+
+namespace
+{
+  const std::string EVENTS_PATH = "correlation_computer_test.json";
+  const std::string CACHE_PATH = "correlation_computer_test.cache";
+
+  // Exposes the size of the cache to tell hits from misses.
+  class CountingComputer: public visimpl::CorrelationComputer
+  {
+  public:
+
+    explicit CountingComputer( simil::SpikeData* data )
+      : visimpl::CorrelationComputer( data )
+    { }
+
+    size_t cached( ) const
+    {
+      return _cache.size( );
+    }
+  };
+
+  struct Fixture
+  {
+    Fixture( )
+      : dataset( config( ))
+      , data( dataset.spikeData( ))
+    {
+      BOOST_REQUIRE( dataset.writeSubsetEvents( EVENTS_PATH ));
+      data->subsetsEvents( )->loadJSON( EVENTS_PATH );
+      std::remove( EVENTS_PATH.c_str( ));
+
+      for ( const auto& subset: dataset.subsets( ))
+        subsets.push_back( subset.first );
+      for ( const auto& event: dataset.events( ))
+        events.push_back( event.name );
+    }
+
+    static visimpl::SyntheticDatasetConfig config( )
+    {
+      visimpl::SyntheticDatasetConfig result;
+      result.neurons = 400;
+      result.duration = 200.0f;
+      result.meanRate = 0.05f;
+      result.subsets = 4;
+      result.events = 3;
+      return result;
+    }
+
+    visimpl::SyntheticDataset dataset;
+    std::unique_ptr< simil::SpikeData > data;
+    std::vector< std::string > subsets;
+    std::vector< std::string > events;
+  };
+}
+
+BOOST_FIXTURE_TEST_CASE( sumrice_correlation_computer_all_matches_subset , Fixture )
+{
+  const float deltaTime = 0.125f;
+
+  CountingComputer all( data.get( ));
+  all.correlateAll( subsets , events , deltaTime , 0.0f , 200.0f );
+  BOOST_CHECK_EQUAL( all.cached( ) , subsets.size( ) * events.size( ));
+
+  for ( const auto& subset: subsets )
+  {
+    CountingComputer single( data.get( ));
+    const auto correlations =
+      single.correlateSubset( subset , events , deltaTime , 0.0f , 200.0f );
+    BOOST_REQUIRE_EQUAL( correlations.size( ) , events.size( ));
+
+    for ( size_t i = 0; i < correlations.size( ); ++i )
+    {
+      const auto& expected = correlations[ i ];
+      BOOST_CHECK_EQUAL( expected.subsetName , subset );
+      BOOST_CHECK_EQUAL( expected.eventName , events[ i ] );
+
+      const auto correlation = all.correlation( expected.fullName );
+      BOOST_REQUIRE( correlation );
+      BOOST_CHECK( correlation->gids == expected.gids );
+      BOOST_CHECK_EQUAL( correlation->values.size( ) , expected.values.size( ));
+      BOOST_CHECK( correlation->values == expected.values );
+    }
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE( sumrice_correlation_computer_cache , Fixture )
+{
+  const size_t pairs = subsets.size( ) * events.size( );
+
+  CountingComputer computer( data.get( ));
+  computer.correlateAll( subsets , events , 0.125f , 0.0f , 200.0f );
+  BOOST_REQUIRE_EQUAL( computer.cached( ) , pairs );
+
+  // Same parameters, every pair hits.
+  computer.correlateAll( subsets , events , 0.125f , 0.0f , 200.0f );
+  BOOST_CHECK_EQUAL( computer.cached( ) , pairs );
+  computer.correlateSubset( subsets.front( ) , events , 0.125f , 0.0f , 200.0f );
+  BOOST_CHECK_EQUAL( computer.cached( ) , pairs );
+
+  // Another delta time misses every pair.
+  computer.correlateAll( subsets , events , 0.25f , 0.0f , 200.0f );
+  BOOST_CHECK_EQUAL( computer.cached( ) , 2 * pairs );
+
+  // So do another start or end of the window.
+  computer.correlateAll( subsets , events , 0.25f , 50.0f , 200.0f );
+  BOOST_CHECK_EQUAL( computer.cached( ) , 3 * pairs );
+  computer.correlateAll( subsets , events , 0.25f , 50.0f , 150.0f );
+  BOOST_CHECK_EQUAL( computer.cached( ) , 4 * pairs );
+
+  // And going back to the first parameters hits again.
+  computer.correlateAll( subsets , events , 0.125f , 0.0f , 200.0f );
+  BOOST_CHECK_EQUAL( computer.cached( ) , 4 * pairs );
+}
+
+BOOST_FIXTURE_TEST_CASE( sumrice_correlation_computer_spike_cache , Fixture )
+{
+  BOOST_REQUIRE( visimpl::SpikeCache::write( CACHE_PATH , 1 , *data ));
+
+  visimpl::SpikeCache cache;
+  BOOST_REQUIRE( cache.open( CACHE_PATH , 1 ));
+  const visimpl::CompressedSpikes compressed( data->spikes( ));
+
+  // Windowed and compressed loads: the data holds the network, the spikes
+  // are only in the cache or compressed.
+  auto network = cache.networkData( );
+  BOOST_REQUIRE( network->spikes( ).empty( ));
+  BOOST_REQUIRE( dataset.writeSubsetEvents( EVENTS_PATH ));
+  network->subsetsEvents( )->loadJSON( EVENTS_PATH );
+  std::remove( EVENTS_PATH.c_str( ));
+
+  CountingComputer expected( data.get( ));
+  expected.correlateAll( subsets , events , 0.125f , 0.0f , 200.0f );
+  const auto names = expected.correlationNames( );
+  BOOST_REQUIRE( !names.empty( ));
+
+  for ( const bool fromCache: { true , false } )
+  {
+    CountingComputer windowed( network.get( ));
+    windowed.correlateAll( subsets , events , 0.125f , 0.0f , 200.0f );
+    if ( fromCache )
+      windowed.spikeCache( &cache );
+    else
+      windowed.compressedSpikes( &compressed );
+    BOOST_CHECK_EQUAL( windowed.cached( ) , 0 );
+    windowed.correlateAll( subsets , events , 0.125f , 0.0f , 200.0f );
+
+    for ( const auto& name: names )
+    {
+      const auto correlation = windowed.correlation( name );
+      BOOST_REQUIRE( correlation );
+      BOOST_CHECK( correlation->gids == expected.correlation( name )->gids );
+      BOOST_CHECK( correlation->values ==
+                   expected.correlation( name )->values );
+    }
+  }
+
+  cache.close( );
+  std::remove( CACHE_PATH.c_str( ));
+}
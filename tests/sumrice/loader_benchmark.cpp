@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Times every loader path on a dataset written by
+// generate_synthetic_dataset, and on a BlueConfig if given. Not registered
+// as a test, run it by hand:
+//
+//   ./benchmark_sumrice_loaders <dataset_dir> [--blueconfig <file> [--target <name>]]
+//                               [--report <file>]
+//
+// Each loader runs in its own child process, so the peak resident memory
+// of one isn't hidden by another. The results are printed and written as
+// JSON to the report file (loader_benchmark.json by default), to compare
+// loader performance between releases.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <sumrice/SpikeCache.h>
+
+namespace
+{
+  struct LoaderRun
+  {
+    std::string loader;
+    std::vector< std::string > inputs;
+    std::string status;
+    double seconds;
+    long peakKiB;
+    uint64_t spikes;
+    uint64_t neurons;
+    uint64_t inputBytes;
+  };
+
+  // What the child process reports back to the parent.
+  struct ChildResult
+  {
+    double seconds;
+    uint64_t spikes;
+    uint64_t neurons;
+  };
+
+  bool fileSize( const std::string& path , uint64_t& size )
+  {
+    struct stat info;
+    if ( stat( path.c_str( ) , &info ) != 0 ) return false;
+
+    size += static_cast< uint64_t >( info.st_size );
+    return true;
+  }
+
+  // Loads the data as LoaderThread does, returns its spikes and neurons.
+  ChildResult load( const LoaderRun& run )
+  {
+    const auto start = std::chrono::steady_clock::now( );
+    std::unique_ptr< simil::SpikeData > data;
+
+    if ( run.loader == "cache" )
+    {
+      const auto hash = visimpl::SpikeCache::sourceHash(
+        { run.inputs[ 1 ] , run.inputs[ 2 ] } , static_cast< int >( simil::TCSV ));
+
+      visimpl::SpikeCache cache;
+      if ( cache.open( run.inputs[ 0 ] , hash ))
+        data = cache.spikeData( );
+    }
+    else
+    {
+      const auto type = run.loader == "csv" ? simil::TCSV :
+                        run.loader == "hdf5" ? simil::THDF5 :
+                        simil::TBlueConfig;
+
+      data.reset( new simil::SpikeData( run.inputs[ 0 ] , type ,
+                                        run.inputs.size( ) > 1 ?
+                                        run.inputs[ 1 ] : std::string( )));
+      data->reduceDataToGIDS( );
+    }
+
+    const auto end = std::chrono::steady_clock::now( );
+    if ( !data ) throw std::runtime_error( "no data loaded" );
+
+    return ChildResult{ std::chrono::duration< double >( end - start ).count( ) ,
+                        data->spikes( ).size( ) , data->gids( ).size( ) };
+  }
+
+  void measure( LoaderRun& run )
+  {
+    int channel[ 2 ];
+    if ( pipe( channel ) != 0 )
+    {
+      run.status = "error";
+      return;
+    }
+
+    const pid_t child = fork( );
+    if ( child == 0 )
+    {
+      close( channel[ 0 ] );
+
+      int code = EXIT_SUCCESS;
+      try
+      {
+        const auto result = load( run );
+        if ( write( channel[ 1 ] , &result , sizeof( result )) != sizeof( result ))
+          code = EXIT_FAILURE;
+      }
+      catch ( const std::exception& e )
+      {
+        std::cerr << run.loader << ": " << e.what( ) << std::endl;
+        code = EXIT_FAILURE;
+      }
+
+      close( channel[ 1 ] );
+      _exit( code );
+    }
+
+    close( channel[ 1 ] );
+
+    ChildResult result{ 0.0 , 0 , 0 };
+    const bool received =
+      child > 0 && read( channel[ 0 ] , &result , sizeof( result )) == sizeof( result );
+    close( channel[ 0 ] );
+
+    int status = 0;
+    struct rusage usage;
+    if ( child > 0 && wait4( child , &status , 0 , &usage ) == child &&
+         received && WIFEXITED( status ) && WEXITSTATUS( status ) == 0 )
+    {
+      run.status = "ok";
+      run.seconds = result.seconds;
+      run.spikes = result.spikes;
+      run.neurons = result.neurons;
+      run.peakKiB = usage.ru_maxrss;
+    }
+    else
+    {
+      run.status = "error";
+    }
+  }
+
+  std::string jsonString( const std::string& text )
+  {
+    std::string quoted = "\"";
+    for ( const char c: text )
+    {
+      if ( c == '"' || c == '\\' ) quoted += '\\';
+      quoted += c;
+    }
+    return quoted + "\"";
+  }
+
+  void usage( const char* name )
+  {
+    std::cerr << "Usage: " << name << " <dataset_dir> [--blueconfig <file> "
+              << "[--target <name>]] [--report <file>]" << std::endl;
+    std::exit( EXIT_FAILURE );
+  }
+}
+
+int main( int argc , char** argv )
+{
+  if ( argc < 2 ) usage( argv[ 0 ] );
+
+  std::string directory = argv[ 1 ];
+  if ( directory.back( ) != '/' ) directory += '/';
+
+  std::string blueConfig;
+  std::string target;
+  std::string report = "loader_benchmark.json";
+
+  for ( int i = 2; i < argc; i += 2 )
+  {
+    if ( i + 1 == argc ) usage( argv[ 0 ] );
+
+    const std::string option = argv[ i ];
+    if ( option == "--blueconfig" ) blueConfig = argv[ i + 1 ];
+    else if ( option == "--target" ) target = argv[ i + 1 ];
+    else if ( option == "--report" ) report = argv[ i + 1 ];
+    else usage( argv[ 0 ] );
+  }
+
+  const auto csvNetwork = directory + "network.csv";
+  const auto csvActivity = directory + "activity.csv";
+
+  // The cache inputs are the cache file and the sources it was built from.
+  std::vector< LoaderRun > runs = {
+    { "csv" , { csvNetwork , csvActivity } , "" , 0.0 , 0 , 0 , 0 , 0 } ,
+    { "hdf5" , { directory + "network.h5" , directory + "activity.h5" } ,
+      "" , 0.0 , 0 , 0 , 0 , 0 } ,
+    { "cache" , { visimpl::SpikeCache::cachePath( csvNetwork ) , csvNetwork ,
+                  csvActivity } , "" , 0.0 , 0 , 0 , 0 , 0 } };
+
+  if ( !blueConfig.empty( ))
+    runs.push_back( { "blueconfig" , { blueConfig , target } , "" , 0.0 , 0 , 0 , 0 , 0 } );
+
+  for ( auto& run: runs )
+  {
+    bool found = true;
+    // Only the cache file is read on the cache path, the BlueConfig target
+    // isn't a file.
+    const size_t files = run.loader == "csv" || run.loader == "hdf5" ?
+                         run.inputs.size( ) : 1;
+    for ( size_t i = 0; i < files; ++i )
+      found = fileSize( run.inputs[ i ] , run.inputBytes ) && found;
+
+    if ( !found )
+    {
+      run.status = "missing";
+      std::cout << run.loader << ": input files not found" << std::endl;
+      continue;
+    }
+
+    measure( run );
+
+    std::cout << run.loader << ": " << run.status;
+    if ( run.status == "ok" )
+    {
+      std::cout << ", " << run.seconds << " s, " << run.peakKiB << " KiB peak, "
+                << run.spikes << " spikes, " << run.neurons << " neurons, "
+                << ( run.seconds > 0.0 ? run.spikes / run.seconds : 0.0 )
+                << " spikes/s";
+    }
+    std::cout << std::endl;
+  }
+
+  std::ofstream file( report );
+  file.imbue( std::locale::classic( ));
+  file << "{\n  \"dataset\": " << jsonString( directory ) << ",\n  \"loaders\": [";
+  for ( size_t i = 0; i < runs.size( ); ++i )
+  {
+    const auto& run = runs[ i ];
+    file << ( i == 0 ? "\n" : ",\n" )
+         << "    { \"loader\": " << jsonString( run.loader )
+         << ", \"status\": " << jsonString( run.status )
+         << ", \"input_bytes\": " << run.inputBytes
+         << ", \"seconds\": " << run.seconds
+         << ", \"peak_rss_kib\": " << run.peakKiB
+         << ", \"spikes\": " << run.spikes
+         << ", \"neurons\": " << run.neurons
+         << ", \"spikes_per_second\": "
+         << ( run.seconds > 0.0 ? run.spikes / run.seconds : 0.0 ) << " }";
+  }
+  file << "\n  ]\n}\n";
+  file.close( );
+
+  if ( file.fail( ))
+  {
+    std::cerr << "Unable to write the report " << report << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Report: " << report << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#define BOOST_TEST_MODULE sumrice_spike_cache
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/SpikeCache.h>
+
+#include "SyntheticDataset.h"
+
+namespace
+{
+  const std::string CACHE_PATH = "spike_cache_test.visimpl-cache";
+  const std::string CORRUPTED_PATH = "spike_cache_test_corrupted.visimpl-cache";
+  const uint64_t HASH = 1234;
+
+  // Byte offsets of the 64 bit fields of the cache header.
+  const size_t SPIKES_FIELD = 24;
+  const size_t NEURONS_FIELD = 32;
+  const size_t INDEX_SIZE_FIELD = 40;
+  const size_t TIMES_OFFSET_FIELD = 56;
+  const size_t GIDS_OFFSET_FIELD = 64;
+  const size_t NEURONS_OFFSET_FIELD = 72;
+  const size_t POSITIONS_OFFSET_FIELD = 80;
+  const size_t INDEX_OFFSET_FIELD = 88;
+  const size_t INDEX_TIMES_OFFSET_FIELD = 96;
+  const size_t FILE_SIZE_FIELD = 104;
+
+  visimpl::SyntheticDataset writeCache( )
+  {
+    visimpl::SyntheticDatasetConfig config;
+    config.neurons = 500;
+    config.duration = 200.0f;
+    config.meanRate = 0.05f;
+
+    visimpl::SyntheticDataset dataset( config );
+    BOOST_REQUIRE( visimpl::SpikeCache::write( CACHE_PATH , HASH ,
+                                               *dataset.spikeData( )));
+    return dataset;
+  }
+
+  std::string readFile( const std::string& path )
+  {
+    std::ifstream file( path , std::ios::binary );
+    return std::string( std::istreambuf_iterator< char >( file ) ,
+                        std::istreambuf_iterator< char >( ));
+  }
+
+  uint64_t field( const std::string& bytes , size_t offset )
+  {
+    uint64_t value;
+    std::memcpy( &value , bytes.data( ) + offset , sizeof( value ));
+    return value;
+  }
+
+  // Writes the cache with the 64 bit value at offset replaced and tries to
+  // open it.
+  bool openCorrupted( std::string bytes , size_t offset , uint64_t value )
+  {
+    std::memcpy( &bytes[ offset ] , &value , sizeof( value ));
+
+    {
+      std::ofstream file( CORRUPTED_PATH , std::ios::binary );
+      file.write( bytes.data( ) , bytes.size( ));
+    }
+
+    visimpl::SpikeCache cache;
+    const bool opened = cache.open( CORRUPTED_PATH , HASH );
+    cache.close( );
+
+    std::remove( CORRUPTED_PATH.c_str( ));
+    return opened;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_cache_roundtrip )
+{
+  const auto dataset = writeCache( );
+  const auto& spikes = dataset.spikes( );
+
+  visimpl::SpikeCache cache;
+  BOOST_CHECK( !cache.open( CACHE_PATH , HASH + 1 ));
+  BOOST_REQUIRE( cache.open( CACHE_PATH , HASH ));
+
+  BOOST_REQUIRE_EQUAL( cache.spikesNumber( ) , spikes.size( ));
+  BOOST_REQUIRE_EQUAL( cache.neuronsNumber( ) , dataset.config( ).neurons );
+  for ( size_t i = 0; i < spikes.size( ); ++i )
+  {
+    BOOST_REQUIRE_EQUAL( cache.times( )[ i ] , spikes[ i ].first );
+    BOOST_REQUIRE_EQUAL( cache.gids( )[ i ] , spikes[ i ].second );
+  }
+
+  BOOST_REQUIRE( cache.indexSize( ) > 0 );
+  BOOST_CHECK_EQUAL( cache.gidOffsets( )[ cache.indexSize( ) - 1 ] ,
+                     spikes.size( ));
+
+  cache.close( );
+  std::remove( CACHE_PATH.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_cache_corrupted )
+{
+  writeCache( );
+  const auto bytes = readFile( CACHE_PATH );
+  std::remove( CACHE_PATH.c_str( ));
+
+  BOOST_REQUIRE( bytes.size( ) > FILE_SIZE_FIELD + sizeof( uint64_t ));
+  BOOST_REQUIRE_EQUAL( field( bytes , FILE_SIZE_FIELD ) , bytes.size( ));
+
+  // The untouched copy opens.
+  BOOST_REQUIRE( openCorrupted( bytes , SPIKES_FIELD ,
+                                field( bytes , SPIKES_FIELD )));
+
+  const uint64_t huge = std::numeric_limits< uint64_t >::max( );
+
+  // Counts past the end of the file, or overflowing the section sizes.
+  BOOST_CHECK( !openCorrupted( bytes , SPIKES_FIELD ,
+                               field( bytes , SPIKES_FIELD ) + 1 ));
+  BOOST_CHECK( !openCorrupted( bytes , SPIKES_FIELD , huge / 2 ));
+  BOOST_CHECK( !openCorrupted( bytes , NEURONS_FIELD ,
+                               field( bytes , NEURONS_FIELD ) * 2 ));
+  BOOST_CHECK( !openCorrupted( bytes , NEURONS_FIELD , huge / 3 + 1 ));
+  BOOST_CHECK( !openCorrupted( bytes , INDEX_SIZE_FIELD ,
+                               field( bytes , INDEX_SIZE_FIELD ) + 1 ));
+  BOOST_CHECK( !openCorrupted( bytes , INDEX_SIZE_FIELD , huge ));
+
+  // Misaligned, overlapping and out of the file offsets.
+  BOOST_CHECK( !openCorrupted( bytes , TIMES_OFFSET_FIELD ,
+                               field( bytes , TIMES_OFFSET_FIELD ) + 4 ));
+  BOOST_CHECK( !openCorrupted( bytes , TIMES_OFFSET_FIELD , 0 ));
+  BOOST_CHECK( !openCorrupted( bytes , GIDS_OFFSET_FIELD ,
+                               field( bytes , TIMES_OFFSET_FIELD )));
+  BOOST_CHECK( !openCorrupted( bytes , NEURONS_OFFSET_FIELD ,
+                               field( bytes , GIDS_OFFSET_FIELD )));
+  BOOST_CHECK( !openCorrupted( bytes , POSITIONS_OFFSET_FIELD ,
+                               field( bytes , NEURONS_OFFSET_FIELD )));
+  BOOST_CHECK( !openCorrupted( bytes , INDEX_OFFSET_FIELD , huge - 7 ));
+  BOOST_CHECK( !openCorrupted( bytes , INDEX_TIMES_OFFSET_FIELD ,
+                               field( bytes , INDEX_TIMES_OFFSET_FIELD ) + 8 ));
+  BOOST_CHECK( !openCorrupted( bytes , FILE_SIZE_FIELD , bytes.size( ) + 8 ));
+
+  // An index that doesn't cover all the spikes.
+  const uint64_t lastOffset = field( bytes , INDEX_OFFSET_FIELD ) +
+    ( field( bytes , INDEX_SIZE_FIELD ) - 1 ) * sizeof( uint64_t );
+  BOOST_CHECK( !openCorrupted( bytes , lastOffset ,
+                               field( bytes , lastOffset ) - 1 ));
+}
+
+namespace
+{
+  // Writes the spikes with the writer, in runs of runSpikes, keeping the
+  // network GIDs below maxGid.
+  bool writeWithWriter( const visimpl::SyntheticDataset& dataset ,
+                        const simil::Spikes& spikes , size_t runSpikes ,
+                        uint32_t maxGid )
+  {
+    std::vector< uint32_t > gids;
+    std::vector< float > positions;
+    for ( uint32_t gid = 0; gid < maxGid; ++gid )
+    {
+      gids.push_back( gid );
+      positions.insert( positions.end( ) ,
+                        dataset.positions( ).begin( ) + gid * 3 ,
+                        dataset.positions( ).begin( ) + gid * 3 + 3 );
+    }
+
+    visimpl::SpikeCacheWriter writer( CACHE_PATH , HASH , runSpikes );
+    BOOST_REQUIRE( writer.open( ));
+    writer.setNetwork( gids , positions );
+
+    // Appended in uneven blocks, as a parser gives them.
+    for ( size_t first = 0; first < spikes.size( ); first += 777 )
+    {
+      const size_t count = std::min< size_t >( 777 , spikes.size( ) - first );
+      BOOST_REQUIRE( writer.append( spikes.data( ) + first , count ));
+    }
+
+    return writer.finish( );
+  }
+
+  // The cache holds exactly the expected spikes, network and index.
+  void checkCache( const simil::Spikes& expected , uint32_t neurons )
+  {
+    visimpl::SpikeCache cache;
+    BOOST_REQUIRE( cache.open( CACHE_PATH , HASH ));
+    BOOST_REQUIRE_EQUAL( cache.spikesNumber( ) , expected.size( ));
+    BOOST_REQUIRE_EQUAL( cache.neuronsNumber( ) , neurons );
+
+    for ( size_t i = 0; i < expected.size( ); ++i )
+    {
+      BOOST_REQUIRE_EQUAL( cache.times( )[ i ] , expected[ i ].first );
+      BOOST_REQUIRE_EQUAL( cache.gids( )[ i ] , expected[ i ].second );
+    }
+
+    if ( !expected.empty( ))
+    {
+      BOOST_CHECK_EQUAL( cache.startTime( ) , expected.front( ).first );
+      BOOST_CHECK_EQUAL( cache.endTime( ) , expected.back( ).first );
+    }
+
+    // Per-GID times in time order.
+    for ( size_t gid = 0; gid + 1 < cache.indexSize( ); ++gid )
+    {
+      const float* first = cache.gidTimes( ) + cache.gidOffsets( )[ gid ];
+      const float* last = cache.gidTimes( ) + cache.gidOffsets( )[ gid + 1 ];
+      BOOST_REQUIRE( std::is_sorted( first , last ));
+    }
+
+    cache.close( );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_cache_writer )
+{
+  visimpl::SyntheticDatasetConfig config;
+  config.neurons = 500;
+  config.duration = 200.0f;
+  config.meanRate = 0.05f;
+
+  const visimpl::SyntheticDataset dataset( config );
+  const auto& spikes = dataset.spikes( );
+  BOOST_REQUIRE( spikes.size( ) > 2000 );
+
+  // Spikes in time order, in memory and through runs.
+  for ( const size_t runSpikes: { size_t( 1 << 20 ) , size_t( 1000 ) } )
+  {
+    BOOST_REQUIRE( writeWithWriter( dataset , spikes , runSpikes ,
+                                    config.neurons ));
+    checkCache( spikes , config.neurons );
+  }
+
+  // Shuffled, the writer sorts them by time keeping the order they came in
+  // at the same time. GIDs out of the network are dropped.
+  simil::Spikes shuffled( spikes );
+  uint64_t state = 7;
+  for ( size_t i = shuffled.size( ) - 1; i > 0; --i )
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    std::swap( shuffled[ i ] , shuffled[ ( state >> 33 ) % ( i + 1 ) ] );
+  }
+
+  const uint32_t kept = config.neurons / 2;
+  simil::Spikes expected;
+  std::copy_if( shuffled.cbegin( ) , shuffled.cend( ) ,
+                std::back_inserter( expected ) ,
+                [ kept ]( const simil::Spike& spike )
+                { return spike.second < kept; } );
+  std::stable_sort( expected.begin( ) , expected.end( ) ,
+                    []( const simil::Spike& a , const simil::Spike& b )
+                    { return a.first < b.first; } );
+
+  for ( const size_t runSpikes: { size_t( 1 << 20 ) , size_t( 1000 ) } )
+  {
+    BOOST_REQUIRE( writeWithWriter( dataset , shuffled , runSpikes , kept ));
+    checkCache( expected , kept );
+  }
+
+  std::remove( CACHE_PATH.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_cache_writer_stopped )
+{
+  const auto dataset = writeCache( );
+  const auto& spikes = dataset.spikes( );
+
+  // Stopped while merging, the previous cache is untouched.
+  visimpl::SpikeCacheWriter writer( CACHE_PATH , HASH + 1 , 1000 );
+  BOOST_REQUIRE( writer.open( ));
+  writer.setNetwork( { 0 , 1 , 2 } , std::vector< float >( 9 , 0.0f ));
+  simil::Spikes spikesOf012;
+  for ( const auto& spike: spikes )
+    if ( spike.second < 3 ) spikesOf012.push_back( spike );
+  BOOST_REQUIRE( !spikesOf012.empty( ));
+  BOOST_REQUIRE( writer.append( spikesOf012.data( ) , spikesOf012.size( )));
+
+  struct Stop
+  {
+  };
+  BOOST_CHECK_THROW( writer.finish( []( uint64_t ){ throw Stop( ); } ) , Stop );
+
+  visimpl::SpikeCache cache;
+  BOOST_CHECK( !cache.open( CACHE_PATH , HASH + 1 ));
+  BOOST_REQUIRE( cache.open( CACHE_PATH , HASH ));
+  BOOST_CHECK_EQUAL( cache.spikesNumber( ) , spikes.size( ));
+  cache.close( );
+
+  std::remove( CACHE_PATH.c_str( ));
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_spike_chunk_queue
+
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/SpikeChunkQueue.h>
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_chunk_queue_bounds )
+{
+  visimpl::SpikeChunkQueue queue( 3 );
+  BOOST_CHECK_EQUAL( queue.capacity( ) , 4u );
+  BOOST_CHECK( queue.empty( ));
+
+  for ( uint32_t i = 0; i < 4; ++i )
+  {
+    simil::Spikes chunk;
+    chunk.push_back( std::make_pair( float( i ) , i ));
+    BOOST_CHECK( queue.push( chunk ));
+  }
+
+  simil::Spikes rejected;
+  rejected.push_back( std::make_pair( 4.0f , 4u ));
+  BOOST_CHECK( !queue.push( rejected ));
+  BOOST_CHECK_EQUAL( rejected.size( ) , 1u );
+
+  queue.close( );
+  BOOST_CHECK( !queue.finished( ));
+
+  simil::Spikes chunk;
+  for ( uint32_t i = 0; i < 4; ++i )
+  {
+    BOOST_REQUIRE( queue.pop( chunk ));
+    BOOST_REQUIRE_EQUAL( chunk.size( ) , 1u );
+    BOOST_CHECK_EQUAL( chunk.front( ).second , i );
+  }
+
+  BOOST_CHECK( !queue.pop( chunk ));
+  BOOST_CHECK( queue.finished( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_chunk_queue_threads )
+{
+  const uint32_t chunks = 10000;
+  const uint32_t spikesPerChunk = 16;
+
+  visimpl::SpikeChunkQueue queue( 8 );
+
+  std::thread producer( [ & ]( )
+  {
+    for ( uint32_t i = 0; i < chunks; ++i )
+    {
+      simil::Spikes chunk;
+      for ( uint32_t j = 0; j < spikesPerChunk; ++j )
+      {
+        const uint32_t value = i * spikesPerChunk + j;
+        chunk.push_back( std::make_pair( float( value ) , value ));
+      }
+
+      while ( !queue.push( chunk ))
+        std::this_thread::yield( );
+    }
+
+    queue.close( );
+  } );
+
+  uint32_t expected = 0;
+  bool ordered = true;
+  simil::Spikes chunk;
+  while ( !queue.finished( ))
+  {
+    if ( !queue.pop( chunk ))
+    {
+      std::this_thread::yield( );
+      continue;
+    }
+
+    for ( const auto& spike: chunk )
+      ordered &= spike.second == expected++;
+  }
+
+  producer.join( );
+
+  BOOST_CHECK( ordered );
+  BOOST_CHECK_EQUAL( expected , chunks * spikesPerChunk );
+}
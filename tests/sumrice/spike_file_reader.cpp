@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_spike_file_reader
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/SpikeFileReader.h>
+
+#include "SyntheticDataset.h"
+
+namespace
+{
+  const std::string NETWORK_CSV = "spike_file_reader_network.csv";
+  const std::string ACTIVITY_CSV = "spike_file_reader_activity.csv";
+  const std::string NETWORK_H5 = "spike_file_reader_network.h5";
+  const std::string ACTIVITY_H5 = "spike_file_reader_activity.h5";
+
+  visimpl::SyntheticDataset dataset( )
+  {
+    visimpl::SyntheticDatasetConfig config;
+    config.neurons = 500;
+    config.duration = 200.0f;
+    config.meanRate = 0.05f;
+    config.layout = visimpl::SpatialLayout::Random;
+
+    return visimpl::SyntheticDataset( config );
+  }
+
+  // Reads everything in small blocks and checks it against the dataset.
+  void checkReader( visimpl::SpikeFileReader& reader ,
+                    const visimpl::SyntheticDataset& data )
+  {
+    const size_t BLOCK = 100;
+
+    std::vector< uint32_t > gids( BLOCK );
+    std::vector< float > positions( BLOCK * 3 );
+    size_t neurons = 0;
+    while ( const size_t count = reader.readNeurons( gids.data( ) ,
+                                                     positions.data( ) ,
+                                                     BLOCK ))
+    {
+      for ( size_t i = 0; i < count; ++i , ++neurons )
+      {
+        BOOST_REQUIRE_EQUAL( gids[ i ] , neurons );
+        for ( size_t j = 0; j < 3; ++j )
+          BOOST_REQUIRE_EQUAL( positions[ i * 3 + j ] ,
+                               data.positions( )[ neurons * 3 + j ] );
+      }
+    }
+    BOOST_CHECK_EQUAL( neurons , data.config( ).neurons );
+
+    simil::Spikes spikes( BLOCK );
+    size_t spikesNumber = 0;
+    while ( const size_t count = reader.readSpikes( spikes.data( ) , BLOCK ))
+    {
+      for ( size_t i = 0; i < count; ++i , ++spikesNumber )
+      {
+        BOOST_REQUIRE( spikesNumber < data.spikes( ).size( ));
+        BOOST_REQUIRE_EQUAL( spikes[ i ].first ,
+                             data.spikes( )[ spikesNumber ].first );
+        BOOST_REQUIRE_EQUAL( spikes[ i ].second ,
+                             data.spikes( )[ spikesNumber ].second );
+      }
+    }
+    BOOST_CHECK_EQUAL( spikesNumber , data.spikes( ).size( ));
+
+    BOOST_CHECK( reader.totalBytes( ) > 0 );
+    BOOST_CHECK_EQUAL( reader.bytesRead( ) , reader.totalBytes( ));
+  }
+
+  void writeText( const std::string& path , const std::string& text )
+  {
+    std::ofstream file( path , std::ios::binary );
+    file << text;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_file_reader_csv )
+{
+  const auto data = dataset( );
+  BOOST_REQUIRE( data.writeCSV( NETWORK_CSV , ACTIVITY_CSV ));
+
+  auto reader = visimpl::SpikeFileReader::open( simil::TCSV , NETWORK_CSV ,
+                                                ACTIVITY_CSV );
+  BOOST_REQUIRE( reader );
+  checkReader( *reader , data );
+
+  // Headers, a type column, blanks and CRLF line ends, as the importers
+  // write them.
+  writeText( NETWORK_CSV , "gid,type,x,y,z\r\n"
+                           "3, PYR, 1.5, -2, 3e1\r\n"
+                           "\r\n"
+                           "7,INT,0.25,.5,-1.0E-1" );
+  writeText( ACTIVITY_CSV , "gid,time\n7, 0.125\n3,1e2\n" );
+
+  reader = visimpl::SpikeFileReader::open( simil::TCSV , NETWORK_CSV ,
+                                           ACTIVITY_CSV );
+  BOOST_REQUIRE( reader );
+
+  uint32_t gids[ 4 ];
+  float positions[ 12 ];
+  BOOST_REQUIRE_EQUAL( reader->readNeurons( gids , positions , 4 ) , 2 );
+  BOOST_CHECK_EQUAL( gids[ 0 ] , 3 );
+  BOOST_CHECK_EQUAL( positions[ 0 ] , 1.5f );
+  BOOST_CHECK_EQUAL( positions[ 1 ] , -2.0f );
+  BOOST_CHECK_EQUAL( positions[ 2 ] , 30.0f );
+  BOOST_CHECK_EQUAL( gids[ 1 ] , 7 );
+  BOOST_CHECK_EQUAL( positions[ 3 ] , 0.25f );
+  BOOST_CHECK_EQUAL( positions[ 4 ] , 0.5f );
+  BOOST_CHECK_EQUAL( positions[ 5 ] , -0.1f );
+  BOOST_CHECK_EQUAL( reader->readNeurons( gids , positions , 4 ) , 0 );
+
+  simil::Spike spikes[ 4 ];
+  BOOST_REQUIRE_EQUAL( reader->readSpikes( spikes , 4 ) , 2 );
+  BOOST_CHECK( spikes[ 0 ] == std::make_pair( 0.125f , 7u ));
+  BOOST_CHECK( spikes[ 1 ] == std::make_pair( 100.0f , 3u ));
+  BOOST_CHECK_EQUAL( reader->readSpikes( spikes , 4 ) , 0 );
+
+  // Malformed rows.
+  writeText( ACTIVITY_CSV , "1,0.5\n2,zero\n" );
+  reader = visimpl::SpikeFileReader::open( simil::TCSV , NETWORK_CSV ,
+                                           ACTIVITY_CSV );
+  BOOST_REQUIRE( reader );
+  BOOST_REQUIRE_EQUAL( reader->readNeurons( gids , positions , 4 ) , 2 );
+  BOOST_CHECK_THROW( reader->readSpikes( spikes , 4 ) , std::runtime_error );
+
+  writeText( NETWORK_CSV , "1,2,3\n" );
+  reader = visimpl::SpikeFileReader::open( simil::TCSV , NETWORK_CSV ,
+                                           ACTIVITY_CSV );
+  BOOST_REQUIRE( reader );
+  BOOST_CHECK_THROW( reader->readNeurons( gids , positions , 4 ) ,
+                     std::runtime_error );
+
+  std::remove( NETWORK_CSV.c_str( ));
+  std::remove( ACTIVITY_CSV.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_file_reader_hdf5 )
+{
+  const auto data = dataset( );
+  BOOST_REQUIRE( data.writeHDF5( NETWORK_H5 , ACTIVITY_H5 ));
+
+  auto reader = visimpl::SpikeFileReader::open( simil::THDF5 , NETWORK_H5 ,
+                                                ACTIVITY_H5 );
+  BOOST_REQUIRE( reader );
+  checkReader( *reader , data );
+
+  // Other layouts and sources are left to SimIL.
+  writeText( ACTIVITY_CSV , "1,0.5\n" );
+  BOOST_CHECK( !visimpl::SpikeFileReader::open( simil::THDF5 , NETWORK_H5 ,
+                                                ACTIVITY_CSV ));
+  BOOST_CHECK( !visimpl::SpikeFileReader::open( simil::THDF5 , ACTIVITY_H5 ,
+                                                ACTIVITY_H5 ));
+  BOOST_CHECK( !visimpl::SpikeFileReader::open( simil::TBlueConfig ,
+                                                NETWORK_H5 , ACTIVITY_H5 ));
+  BOOST_CHECK( !visimpl::SpikeFileReader::open( simil::TCSV , NETWORK_CSV ,
+                                                "" ));
+
+  std::remove( ACTIVITY_CSV.c_str( ));
+  std::remove( NETWORK_H5.c_str( ));
+  std::remove( ACTIVITY_H5.c_str( ));
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_spike_histogram
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/SpikeHistogram.h>
+#include <sumrice/CumulativeHistogram.h>
+#include <sumrice/SubsetHistogramEngine.h>
+
+namespace
+{
+  simil::Spikes randomSpikes( size_t amount , uint32_t gids , float endTime )
+  {
+    std::mt19937 generator( 42 );
+    std::uniform_real_distribution< float > time( 0.0f , endTime );
+    std::uniform_int_distribution< uint32_t > gid( 0 , gids - 1 );
+
+    std::vector< float > times( amount );
+    for ( auto& t: times ) t = time( generator );
+    std::sort( times.begin( ) , times.end( ));
+
+    simil::Spikes spikes;
+    spikes.reserve( amount );
+    for ( auto t: times )
+      spikes.push_back( std::make_pair( t , gid( generator )));
+
+    return spikes;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_histogram_bins )
+{
+  simil::Spikes spikes;
+  spikes.push_back( std::make_pair( -1.0f , 0u ));
+  spikes.push_back( std::make_pair( 0.0f , 1u ));
+  spikes.push_back( std::make_pair( 1.0f , 0u ));
+  spikes.push_back( std::make_pair( 1.5f , 1u ));
+  spikes.push_back( std::make_pair( 3.5f , 0u ));
+  spikes.push_back( std::make_pair( 5.0f , 1u ));
+
+  std::vector< unsigned int > local( 4 , 0 );
+  std::vector< unsigned int > global;
+
+  visimpl::buildSpikeHistogram( spikes , 0.0f , 4.0f , { 0 } ,
+                                local , global , 1 );
+
+  const std::vector< unsigned int > expectedLocal = { 2 , 0 , 0 , 1 };
+  const std::vector< unsigned int > expectedGlobal = { 3 , 1 , 0 , 1 };
+
+  BOOST_CHECK_EQUAL_COLLECTIONS( local.begin( ) , local.end( ) ,
+                                 expectedLocal.begin( ) ,
+                                 expectedLocal.end( ));
+  BOOST_CHECK_EQUAL_COLLECTIONS( global.begin( ) , global.end( ) ,
+                                 expectedGlobal.begin( ) ,
+                                 expectedGlobal.end( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_histogram_parallel )
+{
+  const auto spikes = randomSpikes( 1000000 , 1000 , 100.0f );
+
+  std::unordered_set< uint32_t > filter;
+  for ( uint32_t gid = 0; gid < 1000; gid += 3 )
+    filter.insert( gid );
+
+  for ( unsigned int bins: { 1u , 250u , 375u , 10000u } )
+  {
+    std::vector< unsigned int > serialLocal( bins , 0 );
+    std::vector< unsigned int > serialGlobal;
+    visimpl::buildSpikeHistogram( spikes , 0.0f , 100.0f , filter ,
+                                  serialLocal , serialGlobal , 1 );
+
+    std::vector< unsigned int > parallelLocal( bins , 0 );
+    std::vector< unsigned int > parallelGlobal;
+    visimpl::buildSpikeHistogram( spikes , 0.0f , 100.0f , filter ,
+                                  parallelLocal , parallelGlobal , 7 );
+
+    BOOST_CHECK( serialLocal == parallelLocal );
+    BOOST_CHECK( serialGlobal == parallelGlobal );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_histogram_cumulative )
+{
+  const auto spikes = randomSpikes( 200000 , 1000 , 100.0f );
+
+  std::unordered_set< uint32_t > filter;
+  for ( uint32_t gid = 0; gid < 1000; gid += 7 )
+    filter.insert( gid );
+  const std::unordered_set< uint32_t > noFilter;
+
+  for ( bool filtered: { true , false } )
+  {
+    const auto& currentFilter = filtered ? filter : noFilter;
+
+    visimpl::CumulativeHistogram cumulative;
+    BOOST_CHECK( cumulative.empty( ));
+
+    cumulative.build( spikes , 0.0f , 100.0f , currentFilter );
+    BOOST_CHECK( cumulative.isBuiltFor( spikes , 0.0f , 100.0f ));
+    BOOST_CHECK( !cumulative.isBuiltFor( spikes , 0.0f , 50.0f ));
+
+    // Whole range, zoomed windows and windows past the base bins.
+    const std::vector< std::pair< float , float >> windows =
+      {{ 0.0f , 100.0f } , { 12.3f , 45.6f } , { 99.0f , 120.0f } ,
+       { -10.0f , 3.0f }};
+
+    for ( const auto& window: windows )
+    {
+      for ( unsigned int bins: { 1u , 250u , 375u , 5000u } )
+      {
+        std::vector< unsigned int > directLocal( bins , 0 );
+        std::vector< unsigned int > directGlobal;
+        visimpl::buildSpikeHistogram( spikes , window.first , window.second ,
+                                      currentFilter ,
+                                      directLocal , directGlobal , 1 );
+
+        std::vector< unsigned int > local( bins , 0 );
+        std::vector< unsigned int > global;
+        cumulative.histogram( window.first , window.second , local , global );
+
+        BOOST_CHECK( local == directLocal );
+        BOOST_CHECK( global == directGlobal );
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_histogram_subsets )
+{
+  const auto spikes = randomSpikes( 500000 , 1000 , 100.0f );
+
+  // Overlapping subsets, one of them with GIDs that never spike.
+  std::vector< std::unordered_set< uint32_t >> subsets( 5 );
+  for ( uint32_t gid = 0; gid < 1000; ++gid )
+  {
+    if ( gid % 2 == 0 ) subsets[ 0 ].insert( gid );
+    if ( gid % 3 == 0 ) subsets[ 1 ].insert( gid );
+    if ( gid < 100 ) subsets[ 2 ].insert( gid );
+    subsets[ 3 ].insert( gid );
+  }
+  subsets[ 4 ] = { 5000 , 6000 };
+
+  std::vector< const visimpl::SubsetHistogramEngine::GIDSet* > pointers;
+  for ( const auto& subset: subsets )
+    pointers.push_back( &subset );
+
+  for ( unsigned int threads: { 1u , 5u } )
+  {
+    visimpl::SubsetHistogramEngine engine;
+    engine.compute( spikes , 10.0f , 90.0f , pointers , 375 , threads );
+
+    BOOST_CHECK_EQUAL( engine.subsetsNumber( ) , subsets.size( ));
+    BOOST_CHECK_EQUAL( engine.bins( ) , 375u );
+
+    for ( size_t i = 0; i < subsets.size( ); ++i )
+    {
+      std::vector< unsigned int > local( 375 , 0 );
+      std::vector< unsigned int > global;
+      visimpl::buildSpikeHistogram( spikes , 10.0f , 90.0f , subsets[ i ] ,
+                                    local , global , 1 );
+
+      BOOST_CHECK( engine.local( i ) == local );
+      BOOST_CHECK( engine.global( ) == global );
+    }
+  }
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Compares buildSpikeHistogram with the serial loop HistogramWidget used
+// before it, and times re-binning through CumulativeHistogram and the
+// histograms and decoding of CompressedSpikes. Not registered as a test,
+// run it by hand:
+//
+//   OMP_NUM_THREADS=8 ./benchmark_sumrice_spike_histogram [spikes] [bins]
+//
+// 10^8 spikes take about 800 MB.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <sumrice/SpikeHistogram.h>
+#include <sumrice/CumulativeHistogram.h>
+#include <sumrice/CompressedSpikes.h>
+
+namespace
+{
+  void legacyHistogram( const simil::Spikes& spikes ,
+                        float startTime ,
+                        float endTime ,
+                        const std::unordered_set< uint32_t >& filteredGIDs ,
+                        std::vector< unsigned int >& histogram ,
+                        std::vector< unsigned int >& globalHistogram )
+  {
+    const bool filter = !filteredGIDs.empty( );
+    const float deltaTime = ( endTime - startTime ) / histogram.size( );
+    float currentTime = startTime + deltaTime;
+
+    auto globalBin = globalHistogram.begin( );
+    auto spike = spikes.begin( );
+    for ( unsigned int& bin: histogram )
+    {
+      while ( spike != spikes.end( ) && spike->first <= currentTime )
+      {
+        if ( !filter || filteredGIDs.find( spike->second ) != filteredGIDs.end( ))
+        {
+          bin++;
+        }
+        spike++;
+        ( *globalBin )++;
+      }
+
+      currentTime += deltaTime;
+      ++globalBin;
+    }
+  }
+
+  template< typename F >
+  double measure( F function )
+  {
+    const auto start = std::chrono::steady_clock::now( );
+    function( );
+    const auto end = std::chrono::steady_clock::now( );
+    return std::chrono::duration< double , std::milli >( end - start ).count( );
+  }
+}
+
+int main( int argc , char** argv )
+{
+  const size_t amount = argc > 1 ? std::strtoull( argv[ 1 ] , nullptr , 10 ) :
+                        100000000ull;
+  const unsigned int bins = argc > 2 ? std::atoi( argv[ 2 ] ) : 250;
+  const uint32_t gids = 100000;
+  const float endTime = 1000.0f;
+
+  std::cout << "Generating " << amount << " spikes..." << std::endl;
+
+  std::mt19937 generator( 42 );
+  std::uniform_real_distribution< float > time( 0.0f , endTime );
+  std::uniform_int_distribution< uint32_t > gid( 0 , gids - 1 );
+
+  std::vector< float > times( amount );
+  for ( auto& t: times ) t = time( generator );
+  std::sort( times.begin( ) , times.end( ));
+
+  simil::Spikes spikes;
+  spikes.reserve( amount );
+  for ( auto t: times )
+    spikes.push_back( std::make_pair( t , gid( generator )));
+  times.clear( );
+  times.shrink_to_fit( );
+
+  std::unordered_set< uint32_t > filter;
+  for ( uint32_t i = 0; i < gids; i += 10 )
+    filter.insert( i );
+
+  const std::unordered_set< uint32_t > noFilter;
+
+  visimpl::CompressedSpikes compressed;
+  const double compression = measure( [ & ]( )
+  {
+    compressed.assign( spikes );
+  } );
+
+  size_t decoded = 0;
+  const double decoding = measure( [ & ]( )
+  {
+    for ( const auto& spike: compressed )
+      decoded += spike.second & 1;
+  } );
+
+  std::cout << "Compressed: " << compressed.bytes( ) / double( amount )
+            << " bytes per spike, compression " << compression
+            << " ms, decoding " << decoding << " ms ("
+            << amount / decoding / 1000.0 << " M spikes/ms, " << decoded
+            << " odd GIDs)" << std::endl;
+
+  for ( bool filtered: { true , false } )
+  {
+    const auto& f = filtered ? filter : noFilter;
+
+    std::vector< unsigned int > legacyLocal( bins , 0 );
+    std::vector< unsigned int > legacyGlobal( bins , 0 );
+    std::vector< unsigned int > serialLocal( bins , 0 );
+    std::vector< unsigned int > serialGlobal;
+    std::vector< unsigned int > parallelLocal( bins , 0 );
+    std::vector< unsigned int > parallelGlobal;
+
+    const double legacy = measure( [ & ]( )
+    {
+      legacyHistogram( spikes , 0.0f , endTime , f ,
+                       legacyLocal , legacyGlobal );
+    } );
+
+    const double serial = measure( [ & ]( )
+    {
+      visimpl::buildSpikeHistogram( spikes , 0.0f , endTime , f ,
+                                    serialLocal , serialGlobal , 1 );
+    } );
+
+    const double parallel = measure( [ & ]( )
+    {
+      visimpl::buildSpikeHistogram( spikes , 0.0f , endTime , f ,
+                                    parallelLocal , parallelGlobal );
+    } );
+
+    visimpl::CumulativeHistogram cumulative;
+    const double cumulativeBuild = measure( [ & ]( )
+    {
+      cumulative.build( spikes , 0.0f , endTime , f );
+    } );
+
+    std::vector< unsigned int > rebinLocal( bins , 0 );
+    std::vector< unsigned int > rebinGlobal;
+    const double rebin = measure( [ & ]( )
+    {
+      cumulative.histogram( 0.0f , endTime , rebinLocal , rebinGlobal );
+    } );
+
+    std::vector< unsigned int > compressedLocal( bins , 0 );
+    std::vector< unsigned int > compressedGlobal;
+    const double compressedHistogram = measure( [ & ]( )
+    {
+      visimpl::buildSpikeHistogram( compressed , 0.0f , endTime , f ,
+                                    compressedLocal , compressedGlobal );
+    } );
+
+    const bool equal = legacyLocal == serialLocal &&
+                       legacyLocal == compressedLocal &&
+                       legacyGlobal == compressedGlobal &&
+                       legacyLocal == rebinLocal &&
+                       legacyGlobal == rebinGlobal &&
+                       legacyLocal == parallelLocal &&
+                       legacyGlobal == serialGlobal &&
+                       legacyGlobal == parallelGlobal;
+
+    std::cout << ( filtered ? "Filtered" : "Unfiltered" ) << ", "
+              << bins << " bins:" << std::endl
+              << "  legacy:   " << legacy << " ms" << std::endl
+              << "  serial:   " << serial << " ms" << std::endl
+              << "  parallel: " << parallel << " ms ("
+              << legacy / parallel << "x)" << std::endl
+              << "  cumulative build: " << cumulativeBuild << " ms, "
+              << cumulative.baseBins( ) << " base bins" << std::endl
+              << "  cumulative rebin: " << rebin << " ms" << std::endl
+              << "  compressed: " << compressedHistogram << " ms" << std::endl
+              << "  results " << ( equal ? "match" : "DIFFER" ) << std::endl;
+
+    if ( !equal ) return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#define BOOST_TEST_MODULE sumrice_spike_index
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/SpikeIndex.h>
+
+namespace
+{
+  // Last spike of gid in ( startTime , endTime ] by a linear scan.
+  float bruteForceLastSpike( const simil::Spikes& spikes , uint32_t gid ,
+                             float startTime , float endTime )
+  {
+    float last = -std::numeric_limits< float >::infinity( );
+    for ( const auto& spike: spikes )
+    {
+      if ( spike.second == gid && spike.first > startTime &&
+           spike.first <= endTime )
+        last = std::max( last , spike.first );
+    }
+    return last;
+  }
+
+  simil::SpikesCRange range( const simil::Spikes& spikes )
+  {
+    return simil::SpikesCRange( spikes.cbegin( ) , spikes.cend( ));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_index_empty )
+{
+  visimpl::SpikeIndex index;
+  BOOST_CHECK( index.empty( ));
+  BOOST_CHECK( std::isinf( index.lastSpike( 0 , -1.0f , 1.0f )));
+
+  const simil::Spikes spikes;
+  index.build( range( spikes ));
+  BOOST_CHECK( index.empty( ));
+  BOOST_CHECK_EQUAL( index.size( ) , 0u );
+  BOOST_CHECK( index.spikesOf( 3 ).first == index.spikesOf( 3 ).second );
+  BOOST_CHECK( std::isinf( index.lastSpike( 3 , -1.0f , 1.0f )));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_index_interval_ends )
+{
+  // GID 2 spikes twice at 1.0, GID 4 has no spikes, GID 5 is the maximum.
+  const simil::Spikes spikes = {{ 0.5f , 2 } , { 1.0f , 2 } , { 1.0f , 2 } ,
+                                { 1.0f , 5 } , { 2.0f , 2 } , { 3.0f , 1 }};
+  visimpl::SpikeIndex index;
+  index.build( range( spikes ));
+  BOOST_CHECK_EQUAL( index.size( ) , spikes.size( ));
+
+  // The start is open, the end closed.
+  BOOST_CHECK_EQUAL( index.lastSpike( 2 , 0.5f , 1.0f ) , 1.0f );
+  BOOST_CHECK( std::isinf( index.lastSpike( 2 , 1.0f , 1.5f )));
+  BOOST_CHECK_EQUAL( index.lastSpike( 2 , 0.0f , 0.5f ) , 0.5f );
+  BOOST_CHECK( std::isinf( index.lastSpike( 2 , 0.0f , 0.4f )));
+  BOOST_CHECK_EQUAL( index.lastSpike( 2 , 0.0f , 10.0f ) , 2.0f );
+
+  // Empty and reversed intervals.
+  BOOST_CHECK( std::isinf( index.lastSpike( 2 , 1.0f , 1.0f )));
+  BOOST_CHECK( std::isinf( index.lastSpike( 2 , 2.0f , 0.0f )));
+
+  // Neurons without spikes, and past the largest GID.
+  BOOST_CHECK( std::isinf( index.lastSpike( 4 , -10.0f , 10.0f )));
+  BOOST_CHECK( std::isinf( index.lastSpike( 0 , -10.0f , 10.0f )));
+  BOOST_CHECK_EQUAL( index.lastSpike( 5 , -10.0f , 10.0f ) , 1.0f );
+  BOOST_CHECK( std::isinf( index.lastSpike( 6 , -10.0f , 10.0f )));
+  BOOST_CHECK( std::isinf( index.lastSpike(
+    std::numeric_limits< uint32_t >::max( ) , -10.0f , 10.0f )));
+
+  const auto times = index.spikesOf( 2 );
+  BOOST_CHECK_EQUAL( times.second - times.first , 4 );
+  BOOST_CHECK( std::is_sorted( times.first , times.second ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_index_brute_force )
+{
+  std::mt19937 generator( 5 );
+  std::uniform_int_distribution< uint32_t > gid( 0 , 200 );
+  // Times on a coarse grid, so that neurons repeat times and the interval
+  // ends often fall on spikes.
+  std::uniform_int_distribution< int > tick( 0 , 400 );
+
+  simil::Spikes spikes;
+  for ( int i = 0; i < 20000; ++i )
+    spikes.emplace_back( tick( generator ) * 0.25f , gid( generator ));
+  std::stable_sort( spikes.begin( ) , spikes.end( ) ,
+                    [ ]( const simil::Spike& a , const simil::Spike& b )
+                    {
+                      return a.first < b.first;
+                    } );
+
+  visimpl::SpikeIndex index;
+  index.build( range( spikes ));
+  BOOST_CHECK_EQUAL( index.size( ) , spikes.size( ));
+
+  for ( int i = 0; i < 2000; ++i )
+  {
+    const uint32_t neuron = gid( generator ) + ( i % 10 == 0 ? 10 : 0 );
+    const float start = tick( generator ) * 0.25f - 5.0f;
+    const float end = start + tick( generator ) * 0.05f;
+
+    const float expected = bruteForceLastSpike( spikes , neuron , start , end );
+    const float actual = index.lastSpike( neuron , start , end );
+    if ( std::isinf( expected ))
+      BOOST_CHECK( std::isinf( actual ) && actual < 0.0f );
+    else
+      BOOST_CHECK_EQUAL( actual , expected );
+  }
+}
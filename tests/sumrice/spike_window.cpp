@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_spike_window
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+#include <sumrice/SpikeHistogram.h>
+#include <sumrice/SpikeWindow.h>
+
+#include "SyntheticDataset.h"
+
+namespace
+{
+  const std::string CACHE_PATH = "spike_window_test.visimpl-cache";
+  const uint64_t HASH = 1234;
+
+  visimpl::SyntheticDataset writeCache( )
+  {
+    visimpl::SyntheticDatasetConfig config;
+    config.neurons = 1000;
+    config.duration = 1000.0f;
+    config.meanRate = 0.05f;
+
+    visimpl::SyntheticDataset dataset( config );
+    BOOST_REQUIRE( visimpl::SpikeCache::write( CACHE_PATH , HASH ,
+                                               *dataset.spikeData( )));
+    return dataset;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_window_resident )
+{
+  const auto dataset = writeCache( );
+  const auto& spikes = dataset.spikes( );
+
+  visimpl::SpikeWindow window;
+  BOOST_REQUIRE( !window.open( CACHE_PATH , HASH + 1 ));
+  BOOST_REQUIRE( window.open( CACHE_PATH , HASH , 100 ));
+  BOOST_CHECK_EQUAL( window.blocks( ) , 100u );
+
+  size_t total = 0;
+  for ( size_t block = 0; block < window.blocks( ); ++block )
+    total += window.blockSpikes( block );
+  BOOST_CHECK_EQUAL( total , spikes.size( ));
+
+  window.setMargin( 20.0f );
+  window.setDecay( 15.0f );
+  window.setReadAhead( 2 );
+
+  simil::Spikes resident;
+  unsigned int moves = 0;
+  for ( float time = 0.0f; time < 1000.0f; time += 3.0f )
+  {
+    if ( !window.update( time , resident ))
+      continue;
+
+    ++moves;
+
+    // Whole blocks around the time, copied as they are in the recording.
+    const auto& store = window.store( );
+    BOOST_REQUIRE( window.residentStartTime( ) <=
+                   std::max( store.startTime( ) , time - 35.0f ));
+    BOOST_REQUIRE( window.residentEndTime( ) >=
+                   std::min( store.endTime( ) - 1.0f , time + 20.0f ));
+
+    const auto first = std::lower_bound(
+      spikes.cbegin( ) , spikes.cend( ) ,
+      std::make_pair( window.residentStartTime( ) , 0u ));
+    BOOST_REQUIRE( static_cast< size_t >( spikes.cend( ) - first ) >= resident.size( ));
+    BOOST_REQUIRE( std::equal( resident.cbegin( ) , resident.cend( ) , first ));
+  }
+
+  // Read ahead moves the window every few blocks, not on every one.
+  BOOST_CHECK( moves > 10 && moves < 100 );
+
+  // A seek backwards moves it back.
+  BOOST_CHECK( window.update( 100.0f , resident ));
+  BOOST_CHECK( window.residentStartTime( ) <= 65.0f );
+  BOOST_CHECK( window.residentEndTime( ) >= 120.0f );
+
+  window.close( );
+  std::remove( CACHE_PATH.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_window_histogram )
+{
+  const auto dataset = writeCache( );
+  const auto& spikes = dataset.spikes( );
+
+  visimpl::SpikeWindow window;
+  BOOST_REQUIRE( window.open( CACHE_PATH , HASH ));
+
+  std::unordered_set< uint32_t > filter;
+  for ( uint32_t gid = 0; gid < 1000; gid += 7 )
+    filter.insert( gid );
+
+  const std::unordered_set< uint32_t > noFilter;
+
+  for ( const auto& f: { filter , noFilter } )
+  {
+    for ( size_t bins: { 1u , 50u , 333u } )
+    {
+      for ( const auto& range: { std::make_pair( 0.0f , 1000.0f ) ,
+                                 std::make_pair( 250.0f , 600.0f ) } )
+      {
+        std::vector< unsigned int > expectedLocal( bins , 0 );
+        std::vector< unsigned int > expectedGlobal;
+        visimpl::buildSpikeHistogram( spikes , range.first , range.second , f ,
+                                      expectedLocal , expectedGlobal , 1 );
+
+        std::vector< unsigned int > local( bins , 0 );
+        std::vector< unsigned int > global;
+        window.histogram( range.first , range.second , f , local , global );
+
+        BOOST_CHECK( local == expectedLocal );
+        BOOST_CHECK( global == expectedGlobal );
+      }
+    }
+  }
+
+  window.close( );
+  std::remove( CACHE_PATH.c_str( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_spike_window_compressed )
+{
+  const auto dataset = writeCache( );
+
+  visimpl::SpikeWindow cached;
+  BOOST_REQUIRE( cached.open( CACHE_PATH , HASH , 100 ));
+
+  auto spikes = std::make_shared< visimpl::CompressedSpikes >(
+    dataset.spikes( ));
+  visimpl::SpikeWindow compressed;
+  BOOST_REQUIRE( !compressed.open( nullptr , 0.0f , 1.0f ));
+  BOOST_REQUIRE( compressed.open( spikes , cached.store( ).startTime( ) ,
+                                  cached.store( ).endTime( ) , 100 ));
+  BOOST_CHECK( compressed.compressed( ) == spikes.get( ));
+  BOOST_CHECK( cached.compressed( ) == nullptr );
+  BOOST_CHECK_EQUAL( compressed.spikesNumber( ) , cached.spikesNumber( ));
+
+  // Same blocks, the same spikes resident at every time, either way.
+  BOOST_REQUIRE_EQUAL( compressed.blocks( ) , cached.blocks( ));
+  for ( size_t block = 0; block < cached.blocks( ); ++block )
+    BOOST_REQUIRE_EQUAL( compressed.blockSpikes( block ) ,
+                         cached.blockSpikes( block ));
+
+  for ( auto window: { &cached , &compressed } )
+  {
+    window->setMargin( 20.0f );
+    window->setDecay( 15.0f );
+  }
+
+  simil::Spikes expected;
+  simil::Spikes resident;
+  for ( float time: { 0.0f , 3.0f , 90.0f , 500.0f , 997.0f , 100.0f } )
+  {
+    BOOST_REQUIRE_EQUAL( cached.update( time , expected ) ,
+                         compressed.update( time , resident ));
+    BOOST_REQUIRE( resident == expected );
+  }
+
+  std::unordered_set< uint32_t > filter;
+  for ( uint32_t gid = 0; gid < 1000; gid += 7 )
+    filter.insert( gid );
+
+  for ( const auto& f: { filter , std::unordered_set< uint32_t >( ) } )
+  {
+    std::vector< unsigned int > expectedLocal( 50 , 0 );
+    std::vector< unsigned int > expectedGlobal;
+    cached.histogram( 250.0f , 600.0f , f , expectedLocal , expectedGlobal );
+
+    std::vector< unsigned int > local( 50 , 0 );
+    std::vector< unsigned int > global;
+    compressed.histogram( 250.0f , 600.0f , f , local , global );
+
+    BOOST_CHECK( local == expectedLocal );
+    BOOST_CHECK( global == expectedGlobal );
+  }
+
+  compressed.close( );
+  BOOST_CHECK( !compressed.isOpen( ));
+
+  cached.close( );
+  std::remove( CACHE_PATH.c_str( ));
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE sumrice_synthetic_dataset
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+#include "SyntheticDataset.h"
+
+BOOST_AUTO_TEST_CASE( sumrice_synthetic_dataset_deterministic )
+{
+  visimpl::SyntheticDatasetConfig config;
+  config.neurons = 500;
+  config.duration = 200.0f;
+  config.meanRate = 0.05f;
+  config.layout = visimpl::SpatialLayout::Random;
+
+  const visimpl::SyntheticDataset first( config );
+  const visimpl::SyntheticDataset second( config );
+
+  BOOST_CHECK( first.spikes( ) == second.spikes( ));
+  BOOST_CHECK( first.positions( ) == second.positions( ));
+
+  config.seed = 7;
+  const visimpl::SyntheticDataset other( config );
+  BOOST_CHECK( first.spikes( ) != other.spikes( ));
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_synthetic_dataset_spikes )
+{
+  for ( auto distribution: { visimpl::RateDistribution::Constant ,
+                             visimpl::RateDistribution::Uniform ,
+                             visimpl::RateDistribution::LogNormal } )
+  {
+    visimpl::SyntheticDatasetConfig config;
+    config.neurons = 2000;
+    config.duration = 500.0f;
+    config.meanRate = 0.02f;
+    config.rateDistribution = distribution;
+
+    const visimpl::SyntheticDataset dataset( config );
+    const auto& spikes = dataset.spikes( );
+
+    BOOST_CHECK( std::is_sorted( spikes.cbegin( ) , spikes.cend( )));
+    for ( const auto& spike: spikes )
+    {
+      BOOST_REQUIRE( spike.first >= 0.0f && spike.first < config.duration );
+      BOOST_REQUIRE( spike.second < config.neurons );
+    }
+
+    // 20000 spikes expected, the Poisson noise is well under 5%.
+    const double expected = config.meanRate * config.duration * config.neurons;
+    BOOST_CHECK_CLOSE( static_cast< double >( spikes.size( )) , expected , 5.0 );
+  }
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_synthetic_dataset_layout )
+{
+  visimpl::SyntheticDatasetConfig config;
+  config.neurons = 27;
+  config.meanRate = 0.0f;
+  config.subsets = 4;
+  config.events = 2;
+
+  const visimpl::SyntheticDataset grid( config );
+  BOOST_CHECK( grid.spikes( ).empty( ));
+  BOOST_REQUIRE_EQUAL( grid.positions( ).size( ) , 27u * 3 );
+
+  // 3x3x3 grid centered on the origin.
+  BOOST_CHECK_EQUAL( grid.positions( )[ 0 ] , -10.0f );
+  BOOST_CHECK_EQUAL( grid.positions( )[ 13 * 3 ] , 0.0f );
+  BOOST_CHECK_EQUAL( grid.positions( )[ 26 * 3 + 2 ] , 10.0f );
+
+  size_t subsetGids = 0;
+  for ( const auto& subset: grid.subsets( ))
+    subsetGids += subset.second.size( );
+  BOOST_CHECK_EQUAL( grid.subsets( ).size( ) , 4u );
+  BOOST_CHECK_EQUAL( subsetGids , 27u );
+
+  BOOST_REQUIRE_EQUAL( grid.events( ).size( ) , 2u );
+  BOOST_CHECK_EQUAL( grid.events( )[ 1 ].start , config.duration * 0.625f );
+  BOOST_CHECK_EQUAL( grid.events( )[ 1 ].end , config.duration * 0.875f );
+
+  config.layout = visimpl::SpatialLayout::Layers;
+  config.layers = 3;
+  const visimpl::SyntheticDataset layers( config );
+
+  // Each layer is below the previous one.
+  BOOST_CHECK( layers.positions( )[ 8 * 3 + 1 ] > layers.positions( )[ 9 * 3 + 1 ] );
+  BOOST_CHECK( layers.positions( )[ 17 * 3 + 1 ] > layers.positions( )[ 18 * 3 + 1 ] );
+}
+
+BOOST_AUTO_TEST_CASE( sumrice_synthetic_dataset_csv )
+{
+  visimpl::SyntheticDatasetConfig config;
+  config.neurons = 100;
+  config.duration = 100.0f;
+  config.meanRate = 0.1f;
+
+  const visimpl::SyntheticDataset dataset( config );
+
+  const std::string network = "synthetic_dataset_network.csv";
+  const std::string activity = "synthetic_dataset_activity.csv";
+  BOOST_REQUIRE( dataset.writeCSV( network , activity ));
+
+  std::ifstream file( activity );
+  size_t lines = 0;
+  unsigned int gid;
+  char comma;
+  float time;
+  while ( file >> gid >> comma >> time )
+  {
+    BOOST_REQUIRE( lines < dataset.spikes( ).size( ));
+    BOOST_CHECK_EQUAL( gid , dataset.spikes( )[ lines ].second );
+    BOOST_CHECK_EQUAL( time , dataset.spikes( )[ lines ].first );
+    ++lines;
+  }
+  BOOST_CHECK_EQUAL( lines , dataset.spikes( ).size( ));
+
+  std::remove( network.c_str( ));
+  std::remove( activity.c_str( ));
+}
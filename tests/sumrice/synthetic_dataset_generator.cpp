@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+// Writes a synthetic dataset for the loader benchmark, or to try the
+// applications at any scale without real data. Not a test, run it by hand:
+//
+//   ./generate_synthetic_dataset <output_dir> [options]
+//
+// Run without arguments for the options. Files already in the output
+// directory are replaced.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "SyntheticDataset.h"
+
+namespace
+{
+  void usage( const char* name )
+  {
+    std::cerr << "Usage: " << name << " <output_dir> [options]" << std::endl
+              << "  --neurons <n>                      (default 1000)" << std::endl
+              << "  --duration <time>                  (default 1000)" << std::endl
+              << "  --rate <spikes per unit of time>   (default 0.01)" << std::endl
+              << "  --rate-distribution <constant|uniform|lognormal> (default lognormal)" << std::endl
+              << "  --rate-spread <spread>             (default 0.5)" << std::endl
+              << "  --layout <grid|random|layers>      (default grid)" << std::endl
+              << "  --layers <n>                       (default 5)" << std::endl
+              << "  --subsets <n>                      (default 0)" << std::endl
+              << "  --events <n>                       (default 0)" << std::endl
+              << "  --seed <n>                         (default 42)" << std::endl
+              << "  --formats <csv,hdf5,cache>         (default all)" << std::endl;
+    std::exit( EXIT_FAILURE );
+  }
+
+  bool hasFormat( const std::string& formats , const std::string& format )
+  {
+    return ( "," + formats + "," ).find( "," + format + "," ) != std::string::npos;
+  }
+}
+
+int main( int argc , char** argv )
+{
+  if ( argc < 2 || argv[ 1 ][ 0 ] == '-' ) usage( argv[ 0 ] );
+
+  std::string directory = argv[ 1 ];
+  if ( directory.back( ) != '/' ) directory += '/';
+
+  visimpl::SyntheticDatasetConfig config;
+  std::string formats = "csv,hdf5,cache";
+
+  for ( int i = 2; i < argc; ++i )
+  {
+    if ( i + 1 == argc ) usage( argv[ 0 ] );
+
+    const std::string option = argv[ i ];
+    const char* value = argv[ ++i ];
+
+    if ( option == "--neurons" )
+      config.neurons = static_cast< uint32_t >( std::strtoul( value , nullptr , 10 ));
+    else if ( option == "--duration" )
+      config.duration = std::strtof( value , nullptr );
+    else if ( option == "--rate" )
+      config.meanRate = std::strtof( value , nullptr );
+    else if ( option == "--rate-spread" )
+      config.rateSpread = std::strtof( value , nullptr );
+    else if ( option == "--layers" )
+      config.layers = std::atoi( value );
+    else if ( option == "--subsets" )
+      config.subsets = std::atoi( value );
+    else if ( option == "--events" )
+      config.events = std::atoi( value );
+    else if ( option == "--seed" )
+      config.seed = std::strtoull( value , nullptr , 10 );
+    else if ( option == "--formats" )
+      formats = value;
+    else if ( option == "--rate-distribution" && std::strcmp( value , "constant" ) == 0 )
+      config.rateDistribution = visimpl::RateDistribution::Constant;
+    else if ( option == "--rate-distribution" && std::strcmp( value , "uniform" ) == 0 )
+      config.rateDistribution = visimpl::RateDistribution::Uniform;
+    else if ( option == "--rate-distribution" && std::strcmp( value , "lognormal" ) == 0 )
+      config.rateDistribution = visimpl::RateDistribution::LogNormal;
+    else if ( option == "--layout" && std::strcmp( value , "grid" ) == 0 )
+      config.layout = visimpl::SpatialLayout::Grid;
+    else if ( option == "--layout" && std::strcmp( value , "random" ) == 0 )
+      config.layout = visimpl::SpatialLayout::Random;
+    else if ( option == "--layout" && std::strcmp( value , "layers" ) == 0 )
+      config.layout = visimpl::SpatialLayout::Layers;
+    else
+      usage( argv[ 0 ] );
+  }
+
+  if ( config.neurons == 0 || !( config.duration > 0.0f )) usage( argv[ 0 ] );
+
+  std::cout << "Generating " << config.neurons << " neurons, "
+            << config.duration << " units of time..." << std::endl;
+
+  const visimpl::SyntheticDataset dataset( config );
+
+  std::cout << dataset.spikes( ).size( ) << " spikes" << std::endl;
+
+  const auto csvNetwork = directory + "network.csv";
+  const auto csvActivity = directory + "activity.csv";
+
+  bool ok = true;
+  if ( hasFormat( formats , "csv" ) || hasFormat( formats , "cache" ))
+  {
+    ok = dataset.writeCSV( csvNetwork , csvActivity );
+    std::cout << "CSV: " << csvNetwork << " " << csvActivity << std::endl;
+  }
+
+  if ( ok && hasFormat( formats , "cache" ))
+  {
+    ok = dataset.writeCache( csvNetwork , csvActivity );
+    std::cout << "Spike cache of the CSV files" << std::endl;
+  }
+
+  if ( ok && hasFormat( formats , "hdf5" ))
+  {
+    ok = dataset.writeHDF5( directory + "network.h5" , directory + "activity.h5" );
+    std::cout << "HDF5: " << directory << "network.h5 " << directory
+              << "activity.h5" << std::endl;
+  }
+
+  if ( ok && ( config.subsets > 0 || config.events > 0 ))
+  {
+    ok = dataset.writeSubsetEvents( directory + "subsets_events.json" );
+    std::cout << "Subsets and events: " << directory << "subsets_events.json"
+              << std::endl;
+  }
+
+  if ( !ok )
+  {
+    std::cerr << "Unable to write the dataset to " << directory << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
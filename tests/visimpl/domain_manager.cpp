@@ -121,6 +121,101 @@ BOOST_AUTO_TEST_CASE( visimpl_domain_manager_groups_init )
   test_utils::terminateOpenGLContext();
 }
 
+BOOST_AUTO_TEST_CASE( visimpl_domain_manager_lookup_tables )
+{
+  test_utils::initOpenGLContext( );
+  visimpl::DomainManager dManager;
+
+  auto camera = std::make_shared< visimpl::Camera >( );
+  dManager.initRenderers( nullptr , nullptr , camera );
+
+  const auto& model = dManager.getSelectionModel( );
+  const int last = visimpl::StaticGradientModel::LUT_SIZE - 1;
+
+  // Stops on samples: over [0, last] the i-th sample is at time i.
+  const float middle = 341.0f;
+  model->setGradient( {{ 0.0f , { 1.0f , 0.0f , 0.0f , 1.0f }} ,
+                       { middle , { 0.0f , 1.0f , 0.5f , 0.5f }} ,
+                       { float( last ) , { 0.0f , 0.0f , 1.0f , 0.0f }}} );
+  model->setParticleSize( {{ 0.0f , 2.0f } , { middle , 16.0f } ,
+                           { float( last ) , 4.0f }} );
+
+  const auto& colors = model->getGradientLut( );
+  const auto& sizes = model->getSizeLut( );
+  BOOST_REQUIRE_EQUAL( colors.size( ) , last + 1 );
+  BOOST_REQUIRE_EQUAL( sizes.size( ) , last + 1 );
+  BOOST_CHECK_EQUAL( model->getGradientRange( ).x , 0.0f );
+  BOOST_CHECK_EQUAL( model->getGradientRange( ).y , float( last ));
+  BOOST_CHECK_EQUAL( model->getSizeRange( ).y , float( last ));
+
+  // Endpoints, stops and samples between them.
+  for ( const int i: { 0 , 1 , 100 , 340 , 341 , 342 , 700 , last - 1 , last } )
+  {
+    const auto expected = model->gradientColor( float( i ));
+    for ( int c = 0; c < 4; ++c )
+      BOOST_CHECK_SMALL( colors[ i ][ c ] - expected[ c ] , 1e-5f );
+    BOOST_CHECK_SMALL( sizes[ i ] - model->particleSize( float( i )) , 1e-4f );
+  }
+  BOOST_CHECK_EQUAL( colors[ int( middle ) ].g , 1.0f );
+  BOOST_CHECK_EQUAL( sizes[ int( middle ) ] , 16.0f );
+  BOOST_CHECK_EQUAL( colors[ last ].b , 1.0f );
+
+  // Outside the range particles take the last value, as the last sample.
+  BOOST_CHECK_EQUAL( model->gradientColor( -1.0f ).b , colors[ last ].b );
+  BOOST_CHECK_EQUAL( model->gradientColor( last + 1.0f ).b , colors[ last ].b );
+  BOOST_CHECK_EQUAL( model->particleSize( -1.0f ) , sizes[ last ] );
+
+  test_utils::terminateOpenGLContext();
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_domain_manager_level_of_detail )
+{
+  test_utils::initOpenGLContext( );
+  visimpl::DomainManager dManager;
+
+  auto camera = std::make_shared< visimpl::Camera >( );
+  visimpl::TGIDSet gids;
+  visimpl::tGidPosMap positions;
+  for ( uint32_t gid = 0; gid < 1000; ++gid )
+  {
+    gids.insert( gid );
+    positions[ gid ] = { static_cast< float >( gid ) , 0.0f , 0.0f };
+  }
+
+  dManager.initRenderers( nullptr , nullptr , camera );
+  dManager.setSelection( gids , positions );
+
+  // Without culling, the level of detail covers every neuron once.
+  dManager.enableCulling( false );
+  dManager.enableLevelOfDetail( true );
+  for ( const auto aggregation: { visimpl::ParticleLod::Aggregation::Max ,
+                                  visimpl::ParticleLod::Aggregation::Mean } )
+  {
+    dManager.setLevelOfDetailAggregation( aggregation );
+    dManager.draw( );
+
+    const auto& stats = dManager.getLevelOfDetailStats( );
+    BOOST_CHECK_EQUAL( stats.particles + stats.aggregatedParticles ,
+                       gids.size( ));
+  }
+
+  // Groups share the same level of detail settings.
+  dManager.setMode( visimpl::VisualMode::Groups );
+  dManager.createGroup( { 0 , 1 , 2 } , positions , "test_group" );
+  dManager.draw( );
+  {
+    const auto& stats = dManager.getLevelOfDetailStats( );
+    BOOST_CHECK_EQUAL( stats.particles + stats.aggregatedParticles , 3 );
+  }
+
+  dManager.enableLevelOfDetail( false );
+  dManager.enableCulling( true );
+  dManager.draw( );
+  BOOST_CHECK_EQUAL( dManager.getLevelOfDetailStats( ).particles , 0 );
+
+  test_utils::terminateOpenGLContext();
+}
+
 BOOST_AUTO_TEST_CASE( visimpl_domain_manager_spikes )
 {
   test_utils::initOpenGLContext( );
@@ -139,19 +234,194 @@ BOOST_AUTO_TEST_CASE( visimpl_domain_manager_spikes )
   simil::SpikesCRange range( spikes.cbegin( ) , spikes.cend( ));
 
   dManager.processInput( range , false );
-  auto map = dManager.getSelectionCluster( )->mapData( );
-  BOOST_CHECK_EQUAL( map->timestamp , 1.0f );
-  dManager.getSelectionCluster( )->unmapData( );
+  BOOST_CHECK_EQUAL( dManager.getParticleStore( )->getTimestamp( 0 ) , 1.0f );
 
   dManager.setMode( visimpl::VisualMode::Groups );
   dManager.createGroup( testSet , testSetPositions , "test_group" );
   dManager.processInput( range , false );
+  BOOST_CHECK_EQUAL( dManager.getParticleStore( )->getTimestamp( 0 ) , 1.0f );
+  BOOST_CHECK_EQUAL(
+    dManager.getGroup( "test_group" )->getCluster( )->size( ) , 1 );
+
+  test_utils::terminateOpenGLContext();
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_domain_manager_overlapping_groups )
+{
+  test_utils::initOpenGLContext( );
+  visimpl::DomainManager dManager;
+
+  auto camera = std::make_shared< visimpl::Camera >( );
+  visimpl::tGidPosMap positions{{ 0 , { 0.0f , 0.0f , 0.0f }} ,
+                                { 1 , { 1.0f , 0.0f , 0.0f }} ,
+                                { 2 , { 2.0f , 0.0f , 0.0f }}};
+
+  dManager.initRenderers( nullptr , nullptr , camera );
+  dManager.setMode( visimpl::VisualMode::Groups );
+  dManager.createGroup( { 0 , 1 } , positions , "first" );
+  dManager.createGroup( { 1 , 2 } , positions , "second" );
+
+  // GID 1 belongs to both groups and spikes twice: the first spike wins.
+  simil::Spikes spikes;
+  spikes.emplace_back( 1.0f , 1 );
+  spikes.emplace_back( 2.0f , 1 );
+  spikes.emplace_back( 3.0f , 7 ); // Not in any group.
+  simil::SpikesCRange range( spikes.cbegin( ) , spikes.cend( ));
+
+  dManager.processInput( range , true );
+
+  // Both groups share the same particle store.
+  const auto store = dManager.getParticleStore( );
+  BOOST_CHECK_EQUAL( store->size( ) , 3 );
+  BOOST_CHECK_EQUAL( dManager.getGroup( "first" )->getCluster( )->size( ) , 2 );
+  BOOST_CHECK_EQUAL( dManager.getGroup( "second" )->getCluster( )->size( ) ,
+                     2 );
+
+  BOOST_CHECK_EQUAL( store->getTimestamp( 1 ) , 1.0f );
+  BOOST_CHECK_EQUAL( store->getTimestamp( 0 ) ,
+                     -std::numeric_limits< float >::infinity( ));
+  BOOST_CHECK_EQUAL( store->getTimestamp( 2 ) ,
+                     -std::numeric_limits< float >::infinity( ));
+
+  // Removing a group doesn't touch the shared data.
+  dManager.removeGroup( "first" );
+  BOOST_CHECK_EQUAL( store->size( ) , 3 );
+  BOOST_CHECK_EQUAL( store->getTimestamp( 1 ) , 1.0f );
+
+  test_utils::terminateOpenGLContext();
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_domain_manager_drawn_models )
+{
+  test_utils::initOpenGLContext( );
+  visimpl::DomainManager dManager;
+
+  auto camera = std::make_shared< visimpl::Camera >( );
+  visimpl::tGidPosMap positions{{ 0 , { 0.0f , 0.0f , 0.0f }} ,
+                                { 1 , { 1.0f , 0.0f , 0.0f }} ,
+                                { 2 , { 2.0f , 0.0f , 0.0f }}};
+
+  dManager.initRenderers( nullptr , nullptr , camera );
+  dManager.setSelection( visimpl::GIDUSet{ 0 } , positions );
+
+  auto models = dManager.getDrawnModels( );
+  BOOST_CHECK_EQUAL( models.size( ) , 1 );
+  BOOST_CHECK_EQUAL( models.at( 0 ) , dManager.getSelectionModel( ).get( ));
+
+  // Only the active groups are drawn.
+  dManager.setMode( visimpl::VisualMode::Groups );
+  const auto first = dManager.createGroup( { 1 } , positions , "first" );
+  const auto second = dManager.createGroup( { 2 } , positions , "second" );
+  second->active( false );
+
+  models = dManager.getDrawnModels( );
+  BOOST_CHECK_EQUAL( models.size( ) , 1 );
+  BOOST_CHECK_EQUAL( models.count( 0 ) , 0 );
+  BOOST_CHECK_EQUAL( models.at( 1 ) , first->getModel( ).get( ));
+
+  second->active( true );
+  models = dManager.getDrawnModels( );
+  BOOST_CHECK_EQUAL( models.size( ) , 2 );
+  BOOST_CHECK_EQUAL( models.at( 2 ) , second->getModel( ).get( ));
+
+  test_utils::terminateOpenGLContext();
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_domain_manager_sparse_upload )
+{
+  test_utils::initOpenGLContext( );
+  visimpl::DomainManager dManager;
+
+  auto camera = std::make_shared< visimpl::Camera >( );
+  visimpl::TGIDSet gids;
+  visimpl::tGidPosMap positions;
+  for ( uint32_t gid = 0; gid < 10000; ++gid )
   {
-    auto groupCluster = dManager.getGroup( "test_group" )->getCluster( );
-    map = groupCluster->mapData( );
-    BOOST_CHECK_EQUAL( map->timestamp , 1.0f );
-    groupCluster->unmapData( );
+    gids.insert( gid );
+    positions[ gid ] = { static_cast< float >( gid ) , 0.0f , 0.0f };
   }
 
+  dManager.initRenderers( nullptr , nullptr , camera );
+  dManager.setSelection( gids , positions );
+
+  // First step after a selection change uploads the whole buffer.
+  simil::Spikes spikes;
+  simil::SpikesCRange range( spikes.cbegin( ) , spikes.cend( ));
+  dManager.processInput( range , false );
+  BOOST_CHECK_EQUAL( dManager.getUploadedBytes( ) ,
+                     gids.size( ) * sizeof( float ));
+  dManager.processInput( range , false );
+  BOOST_CHECK_EQUAL( dManager.getUploadedBytes( ) , 0 );
+
+  // Killing the particles resets every timestamp.
+  dManager.processInput( range , true );
+  BOOST_CHECK_EQUAL( dManager.getUploadedBytes( ) ,
+                     gids.size( ) * sizeof( float ));
+
+  // A single spike only uploads its own timestamp.
+  spikes.emplace_back( 1.0f , 42 );
+  range = simil::SpikesCRange( spikes.cbegin( ) , spikes.cend( ));
+  dManager.processInput( range , false );
+  BOOST_CHECK_EQUAL( dManager.getUploadedBytes( ) , sizeof( float ));
+
+  // Neighbouring spikes are coalesced, distant ones are not.
+  spikes.emplace_back( 1.5f , 44 );
+  spikes.emplace_back( 2.0f , 9000 );
+  range = simil::SpikesCRange( spikes.cbegin( ) , spikes.cend( ));
+  dManager.processInput( range , false );
+  BOOST_CHECK_EQUAL(
+    dManager.getParticleStore( )->getTimestamps( ).getUploadedRanges( ) , 2 );
+  BOOST_CHECK_EQUAL( dManager.getUploadedBytes( ) , 4 * sizeof( float ));
+
+  test_utils::terminateOpenGLContext();
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_domain_manager_parallel_spikes )
+{
+  test_utils::initOpenGLContext( );
+  visimpl::DomainManager dManager;
+
+  auto camera = std::make_shared< visimpl::Camera >( );
+  constexpr uint32_t neurons = 10000;
+  visimpl::TGIDSet gids;
+  visimpl::tGidPosMap positions;
+  for ( uint32_t gid = 0; gid < neurons; ++gid )
+  {
+    gids.insert( gid );
+    positions[ gid ] = { static_cast< float >( gid ) , 0.0f , 0.0f };
+  }
+
+  dManager.initRenderers( nullptr , nullptr , camera );
+  dManager.setSelection( gids , positions );
+
+  // Most neurons spike several times. Some GIDs aren't stored.
+  simil::Spikes spikes;
+  for ( uint32_t i = 0; i < 8 * visimpl::DomainManager::PARALLEL_MIN_SPIKES;
+        ++i )
+  {
+    spikes.emplace_back( i * 0.001f , ( i * 7919 ) % ( neurons + 100 ));
+  }
+  simil::SpikesCRange range( spikes.cbegin( ) , spikes.cend( ));
+
+  dManager.setThreadCount( 1 );
+  dManager.processInput( range , true );
+  const auto serial = dManager.getParticleStore( )->getTimestamps( )
+    .getTimestamps( );
+
+  dManager.setThreadCount( 4 );
+  dManager.processInput( range , true );
+  const auto parallel = dManager.getParticleStore( )->getTimestamps( )
+    .getTimestamps( );
+
+  BOOST_CHECK_EQUAL_COLLECTIONS( serial.cbegin( ) , serial.cend( ) ,
+                                 parallel.cbegin( ) , parallel.cend( ));
+
+  // Without killing, only the new spikes must be applied.
+  spikes.emplace_back( 1000.0f , 3 );
+  range = simil::SpikesCRange( spikes.cend( ) - 1 , spikes.cend( ));
+  dManager.processInput( range , false );
+  BOOST_CHECK_EQUAL( dManager.getParticleStore( )->getTimestamp( 3 ) ,
+                     1000.0f );
+
   test_utils::terminateOpenGLContext();
-}
\ No newline at end of file
+}
@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE visimpl_neuron_octree
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+#include <glm/geometric.hpp>
+#include <visimpl/NeuronOctree.h>
+
+namespace
+{
+  typedef std::unordered_map< unsigned int , glm::vec3 > Positions;
+
+  // Uniform neurons plus a few dense clusters, some of them sharing the
+  // same position, so that the tree has both deep and degenerate nodes.
+  Positions randomPositions( size_t neurons )
+  {
+    std::mt19937 generator( 42 );
+    std::uniform_real_distribution< float > coordinate( -500.0f , 500.0f );
+    std::normal_distribution< float > cluster( 0.0f , 2.0f );
+
+    Positions positions;
+    for ( unsigned int gid = 0; gid < neurons; ++gid )
+    {
+      if ( gid % 10 == 0 )
+        positions[ gid * 3 ] = glm::vec3( 100.0f , 100.0f , 100.0f );
+      else if ( gid % 3 == 0 )
+        positions[ gid * 3 ] = glm::vec3( cluster( generator ) ,
+                                          cluster( generator ) ,
+                                          cluster( generator ));
+      else
+        positions[ gid * 3 ] = glm::vec3( coordinate( generator ) ,
+                                          coordinate( generator ) ,
+                                          coordinate( generator ));
+    }
+
+    return positions;
+  }
+
+  template< typename Contains >
+  std::vector< uint32_t > bruteForce( const Positions& positions ,
+                                      Contains contains )
+  {
+    std::vector< uint32_t > result;
+    for ( const auto& neuron: positions )
+      if ( contains( neuron.second ))
+        result.push_back( neuron.first );
+
+    std::sort( result.begin( ) , result.end( ));
+    return result;
+  }
+
+  std::vector< uint32_t > sorted( std::vector< uint32_t > gids )
+  {
+    std::sort( gids.begin( ) , gids.end( ));
+    return gids;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_neuron_octree_build )
+{
+  visimpl::NeuronOctree octree;
+  BOOST_CHECK( octree.empty( ));
+
+  std::vector< uint32_t > result;
+  octree.box( glm::vec3( -1.0f , -1.0f , -1.0f ) ,
+              glm::vec3( 1.0f , 1.0f , 1.0f ) , result );
+  BOOST_CHECK( result.empty( ));
+
+  const auto positions = randomPositions( 20000 );
+  octree.build( positions );
+  BOOST_CHECK_EQUAL( octree.size( ) , positions.size( ));
+  BOOST_CHECK_GT( octree.nodes( ) , 1 );
+
+  // Every neuron is returned exactly once.
+  octree.box( glm::vec3( -1000.0f , -1000.0f , -1000.0f ) ,
+              glm::vec3( 1000.0f , 1000.0f , 1000.0f ) , result );
+  BOOST_CHECK_EQUAL( result.size( ) , positions.size( ));
+  result = sorted( result );
+  BOOST_CHECK( std::adjacent_find( result.cbegin( ) , result.cend( )) ==
+               result.cend( ));
+
+  octree.clear( );
+  BOOST_CHECK( octree.empty( ));
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_neuron_octree_queries )
+{
+  const auto positions = randomPositions( 20000 );
+  visimpl::NeuronOctree octree;
+  octree.build( positions );
+
+  std::mt19937 generator( 7 );
+  std::uniform_real_distribution< float > coordinate( -600.0f , 600.0f );
+  std::uniform_real_distribution< float > unit( -1.0f , 1.0f );
+  std::uniform_real_distribution< float > length( 0.0f , 400.0f );
+
+  for ( int i = 0; i < 50; ++i )
+  {
+    const glm::vec3 point( coordinate( generator ) , coordinate( generator ) ,
+                           coordinate( generator ));
+    glm::vec3 normal( unit( generator ) , unit( generator ) ,
+                      unit( generator ));
+    normal = glm::normalize( normal );
+
+    // Slab between the clipping planes.
+    const float offset = glm::dot( normal , point );
+    const float width = length( generator );
+    std::vector< uint32_t > result;
+    octree.slab( normal , offset , width , result );
+    BOOST_CHECK( sorted( result ) == bruteForce( positions ,
+      [ & ]( const glm::vec3& position )
+      {
+        const float distance = offset - glm::dot( normal , position );
+        return distance > 0.0f && distance <= width;
+      } ));
+
+    // Box.
+    const glm::vec3 extent( length( generator ) , length( generator ) ,
+                            length( generator ));
+    result.clear( );
+    octree.box( point - extent , point + extent , result );
+    BOOST_CHECK( sorted( result ) == bruteForce( positions ,
+      [ & ]( const glm::vec3& position )
+      {
+        const glm::vec3 min = point - extent;
+        const glm::vec3 max = point + extent;
+        return position.x >= min.x && position.y >= min.y &&
+               position.z >= min.z && position.x <= max.x &&
+               position.y <= max.y && position.z <= max.z;
+      } ));
+
+    // Sphere.
+    const float radius = length( generator );
+    result.clear( );
+    octree.sphere( point , radius , result );
+    BOOST_CHECK( sorted( result ) == bruteForce( positions ,
+      [ & ]( const glm::vec3& position )
+      {
+        const glm::vec3 distance = position - point;
+        return glm::dot( distance , distance ) <= radius * radius;
+      } ));
+
+    // Frustum, as six planes through random points around the center.
+    std::array< glm::vec4 , 6 > planes;
+    for ( auto& plane: planes )
+    {
+      glm::vec3 direction( unit( generator ) , unit( generator ) ,
+                           unit( generator ));
+      direction = glm::normalize( direction );
+      const glm::vec3 origin = point - direction * length( generator );
+      plane = glm::vec4( direction , -glm::dot( direction , origin ));
+    }
+    result.clear( );
+    octree.frustum( planes , result );
+    BOOST_CHECK( sorted( result ) == bruteForce( positions ,
+      [ & ]( const glm::vec3& position )
+      {
+        for ( const auto& plane: planes )
+          if ( glm::dot( glm::vec3( plane.x , plane.y , plane.z ) ,
+                         position ) + plane.w < 0.0f )
+            return false;
+        return true;
+      } ));
+  }
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_neuron_octree_raycast )
+{
+  const auto positions = randomPositions( 20000 );
+  visimpl::NeuronOctree octree;
+  octree.build( positions );
+
+  // Radius depends on the GID, and a third of the neurons can't be picked.
+  const float maxRadius = 8.0f;
+  auto radius = [ & ]( uint32_t gid , const glm::vec3& )
+  {
+    return ( gid / 3 ) % 3 == 0 ? 0.0f : 2.0f + static_cast< float >( gid % 7 );
+  };
+
+  std::mt19937 generator( 11 );
+  std::uniform_real_distribution< float > coordinate( -600.0f , 600.0f );
+
+  unsigned int hits = 0;
+  for ( int i = 0; i < 200; ++i )
+  {
+    const glm::vec3 origin( coordinate( generator ) , coordinate( generator ) ,
+                            1000.0f );
+    // Aim at a neuron most of the times.
+    const auto target = positions.find( ( i * 37 % 20000 ) * 3 );
+    const glm::vec3 end = i % 4 == 0 ?
+      glm::vec3( coordinate( generator ) , coordinate( generator ) , -1000.0f ) :
+      target->second;
+    const glm::vec3 direction = end - origin;
+
+    uint32_t gid = 0;
+    float distance = 0.0f;
+    const bool found = octree.raycast( origin , direction , maxRadius ,
+                                       radius , gid , distance );
+
+    bool expectedFound = false;
+    uint32_t expectedGid = 0;
+    float expectedDistance = std::numeric_limits< float >::max( );
+    const glm::vec3 unit = glm::normalize( direction );
+    for ( const auto& neuron: positions )
+    {
+      const float r = radius( neuron.first , neuron.second );
+      if ( r <= 0.0f ) continue;
+
+      const glm::vec3 toCenter = neuron.second - origin;
+      const float along = glm::dot( toCenter , unit );
+      const float offAxis2 = glm::dot( toCenter , toCenter ) - along * along;
+      if ( offAxis2 > r * r ) continue;
+
+      const float half = std::sqrt( r * r - offAxis2 );
+      if ( along + half < 0.0f ) continue;
+
+      const float hit = std::max( along - half , 0.0f );
+      if ( hit < expectedDistance ||
+           ( hit == expectedDistance && neuron.first < expectedGid ))
+      {
+        expectedDistance = hit;
+        expectedGid = neuron.first;
+        expectedFound = true;
+      }
+    }
+
+    BOOST_CHECK_EQUAL( found , expectedFound );
+    if ( found && expectedFound )
+    {
+      BOOST_CHECK_EQUAL( distance , expectedDistance );
+      BOOST_CHECK_EQUAL( gid , expectedGid );
+      ++hits;
+    }
+  }
+
+  BOOST_CHECK_GT( hits , 100 );
+
+  // A ray pointing away from every neuron.
+  uint32_t gid = 0;
+  float distance = 0.0f;
+  BOOST_CHECK( !octree.raycast( glm::vec3( 0.0f , 0.0f , 1000.0f ) ,
+                                glm::vec3( 0.0f , 0.0f , 1.0f ) , maxRadius ,
+                                radius , gid , distance ));
+}
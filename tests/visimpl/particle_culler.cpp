@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE visimpl_particle_culler
+
+#include <algorithm>
+#include <random>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <visimpl/particlelab/ParticleCuller.h>
+
+namespace
+{
+  std::vector< glm::vec3 > randomPositions( size_t count )
+  {
+    std::mt19937 generator( 3 );
+    std::uniform_real_distribution< float > coordinate( -100.0f , 100.0f );
+
+    std::vector< glm::vec3 > positions;
+    for ( size_t i = 0; i < count; ++i )
+      positions.emplace_back( coordinate( generator ) ,
+                              coordinate( generator ) ,
+                              coordinate( generator ));
+    return positions;
+  }
+
+  // Every other slot, so slots and particle indices differ.
+  std::vector< visimpl::NeuronParticle > everyOther( size_t count )
+  {
+    std::vector< visimpl::NeuronParticle > particles;
+    for ( uint32_t slot = 0; slot < count; slot += 2 )
+      particles.push_back( visimpl::NeuronParticle{ slot } );
+    return particles;
+  }
+
+  std::set< uint32_t > slots( const std::vector< visimpl::NeuronParticle >& particles )
+  {
+    std::set< uint32_t > result;
+    for ( const auto& particle: particles )
+      result.insert( particle.index );
+    return result;
+  }
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_particle_culler_no_planes )
+{
+  const auto positions = randomPositions( 10000 );
+  const auto particles = everyOther( positions.size( ));
+
+  visimpl::ParticleCuller culler;
+  BOOST_CHECK( culler.visible( ).empty( ));
+
+  culler.setParticles( particles , positions );
+  BOOST_CHECK_EQUAL( culler.particles( ).size( ) , particles.size( ));
+  BOOST_CHECK( slots( culler.particles( )) == slots( particles ));
+  BOOST_CHECK_EQUAL( culler.visible( ).size( ) , particles.size( ));
+
+  // The first cull always reports the new particles, later ones only
+  // report changes.
+  BOOST_CHECK( culler.cull( { } , 0.0f ));
+  BOOST_CHECK( !culler.cull( { } , 0.0f ));
+  BOOST_CHECK_EQUAL( culler.visible( ).size( ) , particles.size( ));
+  BOOST_CHECK_EQUAL( culler.stats( ).visibleParticles , particles.size( ));
+  BOOST_CHECK_EQUAL( culler.stats( ).visibleCells , culler.stats( ).cells );
+  BOOST_CHECK_GT( culler.stats( ).cells , 1 );
+
+  culler.setParticles( { } , positions );
+  BOOST_CHECK( culler.cull( { } , 0.0f ));
+  BOOST_CHECK( culler.visible( ).empty( ));
+  BOOST_CHECK_EQUAL( culler.stats( ).cells , 0 );
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_particle_culler_planes )
+{
+  auto positions = randomPositions( 10000 );
+  const auto particles = everyOther( positions.size( ));
+
+  visimpl::ParticleCuller culler;
+  culler.setParticles( particles , positions );
+
+  // Half space x >= 50.
+  const std::vector< glm::vec4 > planes{ glm::vec4( 1.0f , 0.0f , 0.0f , -50.0f ) };
+  const float margin = 2.0f;
+  BOOST_CHECK( culler.cull( planes , margin ));
+
+  const auto visible = slots( culler.visible( ));
+  BOOST_CHECK_EQUAL( visible.size( ) , culler.stats( ).visibleParticles );
+  BOOST_CHECK_LT( culler.stats( ).visibleCells , culler.stats( ).cells );
+  BOOST_CHECK_LT( visible.size( ) , particles.size( ) / 2 );
+
+  // Conservative: nothing within the margin of the visible side is culled.
+  for ( const auto& particle: particles )
+  {
+    if ( positions[ particle.index ].x >= 50.0f - margin )
+      BOOST_CHECK( visible.count( particle.index ) == 1 );
+  }
+
+  BOOST_CHECK( !culler.cull( planes , margin ));
+
+  // Moving the particles buckets them again.
+  for ( auto& position: positions )
+    position.x += 200.0f;
+  culler.setPositions( positions );
+  BOOST_CHECK( culler.cull( planes , margin ));
+  BOOST_CHECK_EQUAL( culler.visible( ).size( ) , particles.size( ));
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_particle_culler_frustum )
+{
+  // Scaling by 1 / 20 sees the [-20, 20] cube.
+  glm::mat4 viewProjection( 1.0f );
+  viewProjection[ 0 ][ 0 ] = viewProjection[ 1 ][ 1 ] =
+  viewProjection[ 2 ][ 2 ] = 0.05f;
+  const auto planes = visimpl::ParticleCuller::frustumPlanes( viewProjection );
+  BOOST_CHECK_EQUAL( planes.size( ) , 6 );
+
+  auto inside = [ & ]( const glm::vec3& position )
+  {
+    for ( const auto& plane: planes )
+      if ( plane.x * position.x + plane.y * position.y +
+           plane.z * position.z + plane.w < 0.0f )
+        return false;
+    return true;
+  };
+
+  BOOST_CHECK( inside( glm::vec3( 0.0f , 0.0f , 0.0f )));
+  BOOST_CHECK( inside( glm::vec3( 19.0f , -19.0f , 10.0f )));
+  BOOST_CHECK( !inside( glm::vec3( 21.0f , 0.0f , 0.0f )));
+  BOOST_CHECK( !inside( glm::vec3( 0.0f , -21.0f , 0.0f )));
+  BOOST_CHECK( !inside( glm::vec3( 0.0f , 0.0f , 21.0f )));
+
+  const auto positions = randomPositions( 10000 );
+  const auto particles = everyOther( positions.size( ));
+  visimpl::ParticleCuller culler;
+  culler.setParticles( particles , positions );
+  culler.cull( planes , 0.0f );
+
+  // Only the cells around the origin survive.
+  const auto visible = slots( culler.visible( ));
+  BOOST_CHECK_GT( culler.stats( ).visibleCells , 0 );
+  BOOST_CHECK_LT( culler.stats( ).visibleParticles , particles.size( ) / 10 );
+  for ( const auto& particle: particles )
+  {
+    if ( inside( positions[ particle.index ] ))
+      BOOST_CHECK( visible.count( particle.index ) == 1 );
+  }
+}
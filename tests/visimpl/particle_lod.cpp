@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#define BOOST_TEST_MODULE visimpl_particle_lod
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+#include <visimpl/particlelab/ParticleLod.h>
+
+namespace
+{
+  std::vector< glm::vec3 > randomPositions( size_t count )
+  {
+    std::mt19937 generator( 5 );
+    std::uniform_real_distribution< float > coordinate( -100.0f , 100.0f );
+
+    std::vector< glm::vec3 > positions;
+    for ( size_t i = 0; i < count; ++i )
+      positions.emplace_back( coordinate( generator ) ,
+                              coordinate( generator ) ,
+                              coordinate( generator ));
+    return positions;
+  }
+
+  // Every other slot, so slots and particle indices differ.
+  std::vector< visimpl::NeuronParticle > everyOther( size_t count )
+  {
+    std::vector< visimpl::NeuronParticle > particles;
+    for ( uint32_t slot = 0; slot < count; slot += 2 )
+      particles.push_back( visimpl::NeuronParticle{ slot } );
+    return particles;
+  }
+
+  // Clip space w = z + 300: the particles are 200 to 400 units away.
+  glm::mat4 viewProjection( )
+  {
+    glm::mat4 matrix( 1.0f );
+    matrix[ 2 ][ 3 ] = 1.0f;
+    matrix[ 3 ][ 3 ] = 300.0f;
+    return matrix;
+  }
+
+  // Aggregates of a tree built from scratch over the same timestamps.
+  void checkAgainstRebuild( const visimpl::ParticleLod& lod ,
+                            const std::vector< visimpl::NeuronParticle >& particles ,
+                            const std::vector< glm::vec3 >& positions ,
+                            const visimpl::TimestampBuffer& timestamps ,
+                            float decay )
+  {
+    visimpl::ParticleLod reference;
+    reference.setAggregation( lod.getAggregation( ));
+    reference.setParticles( particles , positions );
+    reference.update( timestamps , decay );
+
+    BOOST_REQUIRE_EQUAL( reference.nodes( ) , lod.nodes( ));
+    for ( uint32_t node = 0; node < lod.nodes( ); ++node )
+    {
+      const float expected = reference.getAggregate( node );
+      const float actual = lod.getAggregate( node );
+      if ( std::isinf( expected ))
+        BOOST_CHECK_EQUAL( expected , actual );
+      else
+        BOOST_CHECK_CLOSE( expected , actual , 1e-3 );
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_particle_lod_select )
+{
+  const auto positions = randomPositions( 20000 );
+  const auto particles = everyOther( positions.size( ));
+
+  visimpl::ParticleLod lod;
+  lod.setParticles( particles , positions );
+  BOOST_CHECK_EQUAL( lod.size( ) , particles.size( ));
+  BOOST_CHECK_GT( lod.nodes( ) , particles.size( ) /
+                                 visimpl::ParticleLod::LEAF_SIZE );
+
+  // Never aggregating draws every particle once.
+  BOOST_CHECK( lod.select( viewProjection( ) , { } , 0.0f , 0.0f ));
+  BOOST_CHECK( !lod.select( viewProjection( ) , { } , 0.0f , 0.0f ));
+  std::set< uint32_t > slots;
+  for ( const auto& particle: lod.visible( ))
+  {
+    BOOST_CHECK_EQUAL( particle.index & visimpl::ParticleLod::AGGREGATE_BIT , 0 );
+    slots.insert( particle.index );
+  }
+  BOOST_CHECK_EQUAL( slots.size( ) , particles.size( ));
+  BOOST_CHECK_EQUAL( lod.visible( ).size( ) , particles.size( ));
+  BOOST_CHECK_EQUAL( lod.stats( ).aggregates , 0 );
+
+  // From far enough, the whole cluster is a single aggregate.
+  BOOST_CHECK( lod.select( viewProjection( ) , { } , 0.0f , 1.0f ));
+  BOOST_REQUIRE_EQUAL( lod.visible( ).size( ) , 1 );
+  BOOST_CHECK_EQUAL( lod.visible( ).front( ).index ,
+                     visimpl::ParticleLod::AGGREGATE_BIT );
+  BOOST_CHECK_EQUAL( lod.stats( ).aggregatedParticles , particles.size( ));
+
+  // In between, the nearer half (low z) is refined further.
+  BOOST_CHECK( lod.select( viewProjection( ) , { } , 0.0f , 0.15f ));
+  const auto& stats = lod.stats( );
+  BOOST_CHECK_GT( stats.aggregates , 1 );
+  BOOST_CHECK_EQUAL( stats.particles + stats.aggregatedParticles ,
+                     particles.size( ));
+  BOOST_CHECK_EQUAL( lod.visible( ).size( ) ,
+                     stats.particles + stats.aggregates );
+
+  // Planes skip whole nodes: half space x >= 50.
+  const std::vector< glm::vec4 > planes{
+    glm::vec4( 1.0f , 0.0f , 0.0f , -50.0f ) };
+  BOOST_CHECK( lod.select( viewProjection( ) , planes , 0.0f , 0.0f ));
+  BOOST_CHECK_LT( lod.visible( ).size( ) , particles.size( ) / 2 );
+  slots.clear( );
+  for ( const auto& particle: lod.visible( ))
+    slots.insert( particle.index );
+  for ( const auto& particle: particles )
+  {
+    if ( positions[ particle.index ].x >= 50.0f )
+      BOOST_CHECK( slots.count( particle.index ) == 1 );
+  }
+
+  lod.invalidate( );
+  BOOST_CHECK( lod.select( viewProjection( ) , planes , 0.0f , 0.0f ));
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_particle_lod_max )
+{
+  const auto positions = randomPositions( 20000 );
+  const auto particles = everyOther( positions.size( ));
+
+  visimpl::ParticleLod lod;
+  lod.setParticles( particles , positions );
+
+  visimpl::TimestampBuffer timestamps;
+  timestamps.resize( positions.size( ));
+  lod.update( timestamps , 1.0f );
+  BOOST_CHECK( std::isinf( lod.getAggregate( 0 )));
+
+  std::mt19937 generator( 7 );
+  std::uniform_int_distribution< uint32_t > slot( 0 , positions.size( ) - 1 );
+
+  // Dirty slots are never flushed here, so every update sees them all
+  // again: unchanged slots must be skipped.
+  float time = 0.0f;
+  for ( int step = 0; step < 20; ++step )
+  {
+    time += 0.5f;
+    for ( int i = 0; i < 100; ++i )
+      timestamps.set( slot( generator ) , time );
+    lod.update( timestamps , 1.0f );
+    BOOST_CHECK_EQUAL( lod.getAggregate( 0 ) , time );
+  }
+  checkAgainstRebuild( lod , particles , positions , timestamps , 1.0f );
+
+  // Moving spikes back in time, as a seek does, rescans the leaves.
+  for ( uint32_t i = 0; i < positions.size( ); i += 3 )
+    timestamps.set( i , 0.25f );
+  lod.update( timestamps , 1.0f );
+  checkAgainstRebuild( lod , particles , positions , timestamps , 1.0f );
+
+  float latest = -std::numeric_limits< float >::infinity( );
+  for ( const auto& particle: particles )
+    latest = std::max( latest , timestamps.get( particle.index ));
+  BOOST_CHECK_EQUAL( lod.getAggregate( 0 ) , latest );
+}
+
+BOOST_AUTO_TEST_CASE( visimpl_particle_lod_mean )
+{
+  const auto positions = randomPositions( 20000 );
+  const auto particles = everyOther( positions.size( ));
+  const float decay = 2.0f;
+
+  visimpl::ParticleLod lod;
+  lod.setAggregation( visimpl::ParticleLod::Aggregation::Mean );
+  lod.setParticles( particles , positions );
+
+  visimpl::TimestampBuffer timestamps;
+  timestamps.resize( positions.size( ));
+  lod.update( timestamps , decay );
+
+  std::mt19937 generator( 11 );
+  std::uniform_int_distribution< uint32_t > slot( 0 , positions.size( ) - 1 );
+
+  float time = 0.0f;
+  for ( int step = 0; step < 20; ++step )
+  {
+    time += 0.5f;
+    for ( int i = 0; i < 200; ++i )
+      timestamps.set( slot( generator ) , time );
+    lod.update( timestamps , decay );
+  }
+  checkAgainstRebuild( lod , particles , positions , timestamps , decay );
+
+  // The aggregate decays as the mean intensity of the neurons.
+  double mean = 0.0;
+  for ( const auto& particle: particles )
+    mean += std::exp( -( time - timestamps.get( particle.index )) / decay );
+  mean /= particles.size( );
+  BOOST_CHECK_CLOSE( std::exp( -( time - lod.getAggregate( 0 )) / decay ) ,
+                     mean , 1e-2 );
+
+  // Spikes far ahead move the reference instead of overflowing.
+  time += 1000.0f;
+  timestamps.set( particles.front( ).index , time );
+  lod.update( timestamps , decay );
+  BOOST_CHECK( std::isfinite( lod.getAggregate( 0 )));
+  checkAgainstRebuild( lod , particles , positions , timestamps , decay );
+
+  // A null decay is clamped instead of dividing by it.
+  lod.update( timestamps , 0.0f );
+  for ( uint32_t node = 0; node < lod.nodes( ); ++node )
+    BOOST_CHECK( !std::isnan( lod.getAggregate( node )));
+  BOOST_CHECK_EQUAL( lod.getAggregate( 0 ) , time );
+}
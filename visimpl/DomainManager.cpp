@@ -7,9 +7,18 @@
 
 #include <utility>
 
+#ifdef VISIMPL_USE_OPENMP
+
+#include <omp.h>
+
+#endif
+
 const visimpl::TSizeFunction DEFAULT_PARTICLE_SIZE{{ 0.0f , 50.0f },
                                                    { 1.0f , 15.0f }};
 
+// Distance from the center to the corners of a billboard of size 1.
+const float BILLBOARD_RADIUS = 0.71f;
+
 
 
 namespace visimpl
@@ -20,10 +29,23 @@ namespace visimpl
     , _camera( nullptr )
     , _selectionGids( )
     , _selectionCluster( nullptr )
+    , _selectionCuller( )
+    , _selectionLod( std::make_shared< ParticleLod >( ))
     , _groupClusters( )
     , _attributeClusters( )
     , _attributeNames( )
     , _attributeTypeGids( )
+    , _store( std::make_shared< ParticleStore >( ))
+    , _uploadedBytes( 0 )
+    , _culling( true )
+    , _cullingStats( )
+    , _levelOfDetail( false )
+    , _lodThreshold( ParticleLod::DEFAULT_THRESHOLD )
+    , _lodAggregation( ParticleLod::Aggregation::Max )
+    , _lodStats( )
+    , _threadCount( 1 )
+    , _spikeBuckets( )
+    , _dirtySlots( )
     , _selectionModel( nullptr )
     , _currentRenderer( nullptr )
     , _defaultRenderer( nullptr )
@@ -37,6 +59,8 @@ namespace visimpl
       glm::vec3 min( maxLimit , maxLimit , maxLimit );
       glm::vec3 max( minLimit , minLimit , minLimit );
       _boundingBox = std::make_pair( min , max );
+
+      setThreadCount( 0 );
   }
 
   void DomainManager::initRenderers(
@@ -89,6 +113,8 @@ namespace visimpl
     _solidAccRenderer = std::make_shared< plab::SimpleRenderer >(
       _solidAccProgram.program( ));
 
+    _selectionModel->setParticleStore( _store );
+    _selectionModel->setLevelOfDetail( _selectionLod );
     _selectionCluster->setModel( _selectionModel );
 
     refreshRenderer( );
@@ -186,6 +212,11 @@ namespace visimpl
     return _selectionCluster;
   }
 
+  size_t DomainManager::getSelectionSize( ) const
+  {
+    return _selectionGids.size( );
+  }
+
   const std::shared_ptr <StaticGradientModel>&
   DomainManager::getSelectionModel( ) const
   {
@@ -220,6 +251,44 @@ namespace visimpl
     return _mode;
   }
 
+  std::unordered_map< uint32_t , const StaticGradientModel* >
+  DomainManager::getDrawnModels( ) const
+  {
+    std::unordered_map< uint32_t , const StaticGradientModel* > models;
+
+    auto addGroups = [ & ]( const std::map< std::string ,
+                            std::shared_ptr< VisualGroup >>& groups )
+    {
+      for ( const auto& item: groups )
+      {
+        if ( !item.second->active( )) continue;
+
+        const auto model = item.second->getModel( ).get( );
+        for ( const auto gid: item.second->getGids( ))
+          models.emplace( gid , model );
+      }
+    };
+
+    switch ( _mode )
+    {
+      case VisualMode::Selection:
+        models.reserve( _selectionGids.size( ));
+        for ( const auto gid: _selectionGids )
+          models.emplace( gid , _selectionModel.get( ));
+        break;
+      case VisualMode::Groups:
+        addGroups( _groupClusters );
+        break;
+      case VisualMode::Attribute:
+        addGroups( _attributeClusters );
+        break;
+      default:
+        break;
+    }
+
+    return models;
+  }
+
   void DomainManager::setMode( VisualMode mode )
   {
     _mode = mode;
@@ -269,69 +338,124 @@ namespace visimpl
     return _boundingBox;
   }
 
-  void DomainManager::setSelection( const TGIDSet& gids ,
-                                    const tGidPosMap& positions )
+  void DomainManager::setPositions( const tGidPosMap& positions )
   {
-    _selectionGids.clear( );
-    std::copy(
-      gids.cbegin( ) , gids.cend( ) ,
-      std::back_inserter( _selectionGids )
-    );
+    if ( !_store->setPositions( positions ))
+    {
+      // Same slots, but the culling cells and the level of detail depend
+      // on the positions.
+      _selectionCuller.setPositions( _store->getPositions( ));
+      _selectionLod->setPositions( _store->getPositions( ));
+      if ( _selectionCluster != nullptr )
+        _selectionCluster->setParticles( _selectionCuller.visible( ));
+
+      for ( const auto& item: _groupClusters ) item.second->updatePositions( );
+      for ( const auto& item: _attributeClusters )
+        item.second->updatePositions( );
+      return;
+    }
 
-    float minLimit = std::numeric_limits< float >::min( );
-    float maxLimit = std::numeric_limits< float >::max( );
-    glm::vec3 min( maxLimit , maxLimit , maxLimit );
-    glm::vec3 max( minLimit , minLimit , minLimit );
+    // Slots changed: re-index every cluster from its GIDs.
+    std::vector< uint32_t > gids;
+    std::vector< NeuronParticle > particles;
 
-    std::vector <NeuronParticle> particles;
-    for ( const auto& gid: _selectionGids )
+    indexGids( _selectionGids , gids , particles );
+    _selectionGids = gids;
+    setSelectionParticles( particles );
+
+    auto reindex = [ & ]( const std::shared_ptr< VisualGroup >& group )
     {
-      NeuronParticle p;
-      p.position = positions.at( gid );
-      particles.push_back( p );
+      indexGids( group->getGids( ) , gids , particles );
+      group->setParticles( gids , particles );
+    };
 
-      min = glm::min( min , p.position );
-      max = glm::max( max , p.position );
-    }
+    for ( const auto& item: _groupClusters ) reindex( item.second );
+    for ( const auto& item: _attributeClusters ) reindex( item.second );
+  }
 
-    _boundingBox = std::make_pair( min , max );
+  const std::shared_ptr< ParticleStore >&
+  DomainManager::getParticleStore( ) const
+  {
+    return _store;
+  }
 
-    _selectionCluster->setParticles( particles );
+  void DomainManager::updateStore( const tGidPosMap& positions )
+  {
+    // Same assumption as OpenGLWidget: if the size doesn't change,
+    // the network didn't change. Use setPositions to force an update.
+    if ( positions.size( ) != _store->size( ))
+      setPositions( positions );
   }
 
-  void DomainManager::setSelection( const GIDUSet& gids ,
-                                    const tGidPosMap& positions )
+  template< typename TGids >
+  void DomainManager::indexGids( const TGids& candidates ,
+                                 std::vector< uint32_t >& gids ,
+                                 std::vector< NeuronParticle >& particles ) const
+  {
+    gids.clear( );
+    particles.clear( );
+    gids.reserve( candidates.size( ));
+    particles.reserve( candidates.size( ));
+
+    for ( const auto gid: candidates )
+    {
+      const auto slot = _store->getSlot( gid );
+      if ( slot == ParticleStore::INVALID_SLOT ) continue;
+
+      gids.push_back( gid );
+      particles.push_back( NeuronParticle{ slot } );
+    }
+  }
+
+  template< typename TGids >
+  void DomainManager::setSelectionGids( const TGids& gids ,
+                                        const tGidPosMap& positions )
   {
-    _selectionGids.clear( );
-    std::copy(
-      gids.cbegin( ) , gids.cend( ) ,
-      std::back_inserter( _selectionGids )
-    );
+    updateStore( positions );
+
+    std::vector< NeuronParticle > particles;
+    indexGids( gids , _selectionGids , particles );
 
     float minLimit = std::numeric_limits< float >::min( );
     float maxLimit = std::numeric_limits< float >::max( );
     glm::vec3 min( maxLimit , maxLimit , maxLimit );
     glm::vec3 max( minLimit , minLimit , minLimit );
 
-    std::vector <NeuronParticle> particles;
-    for ( const auto& gid: _selectionGids )
+    for ( const auto& particle: particles )
     {
-      NeuronParticle p;
-      p.position = positions.at( gid );
-      particles.push_back( p );
-
-      min = glm::min( min , p.position );
-      max = glm::max( max , p.position );
+      const auto& position = _store->getPosition( particle.index );
+      min = glm::min( min , position );
+      max = glm::max( max , position );
     }
 
     _boundingBox = std::make_pair( min , max );
 
-    _selectionCluster->setParticles( particles );
+    setSelectionParticles( particles );
   }
 
-  std::shared_ptr <VisualGroup> DomainManager::createGroup(
-    const GIDUSet& gids , const tGidPosMap& positions ,
-    const std::string& name )
+  void DomainManager::setSelectionParticles(
+    const std::vector< NeuronParticle >& particles )
+  {
+    _selectionCuller.setParticles( particles , _store->getPositions( ));
+    _selectionLod->setParticles( particles , _store->getPositions( ));
+    if ( _selectionCluster != nullptr )
+      _selectionCluster->setParticles( _selectionCuller.visible( ));
+  }
+
+  void DomainManager::setSelection( const TGIDSet& gids ,
+                                    const tGidPosMap& positions )
+  {
+    setSelectionGids( gids , positions );
+  }
+
+  void DomainManager::setSelection( const GIDUSet& gids ,
+                                    const tGidPosMap& positions )
+  {
+    setSelectionGids( gids , positions );
+  }
+
+  std::shared_ptr< VisualGroup >
+  DomainManager::createGroupCluster( const std::string& name )
   {
     auto group = std::make_shared< VisualGroup >(
       name , _camera ,
@@ -340,23 +464,26 @@ namespace visimpl
       _currentRenderer ,
       _selectionModel->isClippingEnabled( ));
 
-    group->getModel( )->setParticleSize( DEFAULT_PARTICLE_SIZE );
+    group->getModel( )->setParticleStore( _store );
     group->getModel( )->setAccumulativeMode( _accumulativeMode );
+    group->getLevelOfDetail( )->setAggregation( _lodAggregation );
+
+    return group;
+  }
+
+  std::shared_ptr <VisualGroup> DomainManager::createGroup(
+    const GIDUSet& gids , const tGidPosMap& positions ,
+    const std::string& name )
+  {
+    updateStore( positions );
+
+    auto group = createGroupCluster( name );
+    group->getModel( )->setParticleSize( DEFAULT_PARTICLE_SIZE );
     group->sizeFunction(DEFAULT_PARTICLE_SIZE);
 
     std::vector <uint32_t> ids;
     std::vector <NeuronParticle> particles;
-
-    for ( const auto& gid: gids )
-    {
-      if(positions.find(gid) != positions.end())
-      {
-        NeuronParticle p;
-        p.position = positions.at( gid );
-        particles.push_back( p );
-        ids.emplace_back(gid);
-      }
-    }
+    indexGids( gids , ids , particles );
 
     group->setParticles( ids , particles );
     _groupClusters[ name ] = group;
@@ -368,30 +495,15 @@ namespace visimpl
   DomainManager::createGroupFromSelection(
     const tGidPosMap& positions , const std::string& name )
   {
-    auto group = std::make_shared< VisualGroup >(
-      name , _camera ,
-      _selectionModel->getLeftPlane( ) ,
-      _selectionModel->getRightPlane( ) ,
-      _currentRenderer ,
-      _selectionModel->isClippingEnabled( ));
+    updateStore( positions );
 
+    auto group = createGroupCluster( name );
     group->getModel( )->setParticleSize( DEFAULT_PARTICLE_SIZE );
-    group->getModel( )->setAccumulativeMode( _accumulativeMode );
     group->sizeFunction(DEFAULT_PARTICLE_SIZE);
 
     std::vector <uint32_t> ids;
     std::vector <NeuronParticle> particles;
-
-    for ( const auto& gid: _selectionGids )
-    {
-      if(positions.find(gid) != positions.end())
-      {
-        NeuronParticle p;
-        p.position = positions.at( gid );
-        particles.push_back( p );
-        ids.emplace_back(gid);
-      }
-    }
+    indexGids( _selectionGids , ids , particles );
 
     group->setParticles( ids , particles );
     _groupClusters[ name ] = group;
@@ -414,6 +526,7 @@ namespace visimpl
     tNeuronAttributes attribute )
   {
     _attributeClusters.clear( );
+    updateStore( positions );
 
     auto& names = _attributeNames[ attribute ];
     auto& typeGids = _attributeTypeGids[ attribute ];
@@ -423,13 +536,7 @@ namespace visimpl
     {
       auto& gids = typeGids[ i ];
 
-      auto group = std::make_shared< VisualGroup >(
-        name , _camera ,
-        _selectionModel->getLeftPlane( ) ,
-        _selectionModel->getRightPlane( ) ,
-        _currentRenderer ,
-        _selectionModel->isClippingEnabled( ));
-      group->getModel( )->setAccumulativeMode( _accumulativeMode );
+      auto group = createGroupCluster( name );
 
       const auto currentIndex = i % colors.size( );
       const auto color = colors[ currentIndex ].toRgb( );
@@ -440,15 +547,11 @@ namespace visimpl
       colorVariation.push_back( std::make_pair( 1.0f , variations.second ));
       group->colorMapping( colorVariation );
 
+      std::vector <uint32_t> ids;
       std::vector <NeuronParticle> particles;
-      for ( const auto& gid: gids )
-      {
-        NeuronParticle p;
-        p.position = positions.at( gid );
-        particles.push_back( p );
-      }
+      indexGids( gids , ids , particles );
 
-      group->setParticles( gids , particles );
+      group->setParticles( ids , particles );
 
       _attributeClusters[ name ] = group;
 
@@ -484,31 +587,111 @@ namespace visimpl
       item.second->getModel( )->enableClipping( enabled );
   }
 
-  void DomainManager::draw( ) const
+  std::vector< glm::vec4 > DomainManager::cullingPlanes( ) const
+  {
+    std::vector< glm::vec4 > planes;
+    if ( _camera != nullptr )
+      planes = ParticleCuller::frustumPlanes(
+        _camera->iCameraViewProjectionMatrix( ));
+
+    if ( _selectionModel != nullptr && _selectionModel->isClippingEnabled( ))
+    {
+      for ( const auto& clippingPlane: { _selectionModel->getLeftPlane( ) ,
+                                         _selectionModel->getRightPlane( ) } )
+      {
+        if ( clippingPlane == nullptr ) continue;
+
+        const auto equation = clippingPlane->getEquation( );
+        glm::vec4 plane( equation[ 0 ] , equation[ 1 ] ,
+                         equation[ 2 ] , equation[ 3 ] );
+        const float length = glm::length( glm::vec3( plane ));
+        if ( length > 0.0f ) planes.push_back( plane / length );
+      }
+    }
+
+    return planes;
+  }
+
+  void DomainManager::draw( )
   {
+    // Timestamps are normally flushed by processInput. This only catches
+    // store changes since the last simulation step.
+    auto& timestamps = _store->getTimestamps( );
+    updateLevelOfDetail( );
+    if ( timestamps.isDirty( )) timestamps.flush( );
+
+    std::vector< glm::vec4 > planes;
+    if ( _culling ) planes = cullingPlanes( );
+    _cullingStats = ParticleCuller::Stats( );
+    _lodStats = ParticleLod::Stats( );
+
+    const bool levelOfDetail = _levelOfDetail && _camera != nullptr;
+    const glm::mat4 viewProjection = levelOfDetail ?
+      _camera->iCameraViewProjectionMatrix( ) : glm::mat4( 1.0f );
+
+    // Billboards are size wide squares facing the camera.
+    auto margin = [ ]( const std::shared_ptr< StaticGradientModel >& model )
+    {
+      return BILLBOARD_RADIUS * model->maxParticleSize( );
+    };
+
+    auto drawGroups = [ & ]( const std::map< std::string ,
+                             std::shared_ptr< VisualGroup >>& groups )
+    {
+      for ( const auto& item: groups )
+      {
+        if ( !item.second->active( )) continue;
+
+        const auto groupMargin = margin( item.second->getModel( ));
+        bool visible;
+        if ( levelOfDetail )
+        {
+          const auto& stats = item.second->selectLevelOfDetail(
+            viewProjection , planes , groupMargin , _lodThreshold );
+          _lodStats += stats;
+          visible = stats.aggregates + stats.particles > 0;
+        }
+        else
+        {
+          const auto& stats = item.second->cull( planes , groupMargin );
+          _cullingStats += stats;
+          visible = stats.visibleParticles > 0;
+        }
+
+        if ( visible ) item.second->getCluster( )->render( );
+      }
+    };
 
     switch ( _mode )
     {
       case VisualMode::Selection:
-        _selectionCluster->render( );
-        break;
-      case VisualMode::Groups:
-        for ( const auto& item: _groupClusters )
+      {
+        const std::vector< NeuronParticle >* visible;
+        if ( levelOfDetail )
         {
-          if ( item.second->active( ))
-          {
-            item.second->getCluster( )->render( );
-          }
+          if ( _selectionLod->select( viewProjection , planes ,
+                                      margin( _selectionModel ) ,
+                                      _lodThreshold ))
+            _selectionCluster->setParticles( _selectionLod->visible( ));
+          _lodStats += _selectionLod->stats( );
+          visible = &_selectionLod->visible( );
         }
-        break;
-      case VisualMode::Attribute:
-        for ( const auto& item: _attributeClusters )
+        else
         {
-          if ( item.second->active( ))
-          {
-            item.second->getCluster( )->render( );
-          }
+          if ( _selectionCuller.cull( planes , margin( _selectionModel )))
+            _selectionCluster->setParticles( _selectionCuller.visible( ));
+          _cullingStats += _selectionCuller.stats( );
+          visible = &_selectionCuller.visible( );
         }
+
+        if ( !visible->empty( )) _selectionCluster->render( );
+        break;
+      }
+      case VisualMode::Groups:
+        drawGroups( _groupClusters );
+        break;
+      case VisualMode::Attribute:
+        drawGroups( _attributeClusters );
         break;
       default:
         break;
@@ -528,121 +711,232 @@ namespace visimpl
     refreshRenderer( );
   }
 
+  unsigned int DomainManager::getThreadCount( ) const
+  {
+    return _threadCount;
+  }
+
+  void DomainManager::setThreadCount( unsigned int threads )
+  {
+#ifdef VISIMPL_USE_OPENMP
+    _threadCount = threads == 0 ?
+                   static_cast< unsigned int >( omp_get_max_threads( )) :
+                   threads;
+#else
+    ( void ) threads;
+    _threadCount = 1;
+#endif
+  }
+
   void DomainManager::processInput(
     const simil::SpikesCRange& spikes , bool killParticles )
   {
-    switch ( _mode )
-    {
-      case VisualMode::Selection:
-        processSelectionSpikes( spikes , killParticles );
-        break;
-      case VisualMode::Groups:
-        processGroupSpikes( spikes , killParticles );
-        break;
-      case VisualMode::Attribute:
-        processAttributeSpikes( spikes , killParticles );
-        break;
-      default:
-        break;
-    }
+    // Timestamps are shared by every cluster, so the visual mode doesn't
+    // matter here: each spike is written once, to its neuron's slot.
+    auto& timestamps = _store->getTimestamps( );
+
+    if ( killParticles )
+      timestamps.fill( -std::numeric_limits< float >::infinity( ));
+
+    const size_t spikeCount = std::distance( spikes.first , spikes.second );
+    if ( _threadCount > 1 && spikeCount >= PARALLEL_MIN_SPIKES )
+      processSpikesParallel( spikes );
+    else
+      processSpikesSerial( spikes );
+
+    // Uploads stay on this thread: it owns the GL context.
+    updateLevelOfDetail( );
+    _uploadedBytes = timestamps.isDirty( ) ? timestamps.flush( ) : 0;
+  }
+
+  void DomainManager::processLastSpikes( const SpikeIndex& index ,
+                                         float time )
+  {
+    auto& timestamps = _store->getTimestamps( );
+    float* data = timestamps.data( );
+    const auto& gids = _store->getGids( );
+    const float startTime = time - _decay;
+    const int size = static_cast< int >( gids.size( ));
+
+#ifdef VISIMPL_USE_OPENMP
+    #pragma omp parallel for schedule( static ) num_threads( _threadCount )
+#endif
+    for ( int slot = 0; slot < size; ++slot )
+      data[ slot ] = index.lastSpike( gids[ slot ] , startTime , time );
+
+    timestamps.invalidate( );
+    updateLevelOfDetail( );
+    _uploadedBytes = timestamps.flush( );
   }
 
-  std::unordered_map< uint32_t , float >
-  DomainManager::parseInput( const simil::SpikesCRange& spikes )
+  void DomainManager::processSpikesSerial( const simil::SpikesCRange& spikes )
   {
-    std::unordered_map< uint32_t , float > result;
+    auto& timestamps = _store->getTimestamps( );
 
-    for ( simil::SpikesCIter spike = spikes.first;
-          spike != spikes.second; ++spike )
+    // Spikes are sorted by time. Walking the range backwards leaves the
+    // first spike of each neuron in its slot, as the old parser did.
+    for ( simil::SpikesCIter spike = spikes.second; spike != spikes.first; )
     {
-      if ( result.count( spike->second ) == 0 )
-      {
-        result[ spike->second ] = spike->first;
-      }
+      --spike;
+      const auto slot = _store->getSlot( spike->second );
+      if ( slot != ParticleStore::INVALID_SLOT )
+        timestamps.set( slot , spike->first );
     }
-    return result;
   }
 
-  void DomainManager::processSelectionSpikes(
-    const simil::SpikesCRange& spikes , bool killParticles )
+  void DomainManager::processSpikesParallel( const simil::SpikesCRange& spikes )
   {
-    auto input = parseInput( spikes );
+    // The spike window is split in time-ordered chunks and the slots in
+    // contiguous ranges, both as many as tasks. Oversubscribing the threads
+    // lets the dynamic schedule balance uneven chunks.
+    const int tasks = static_cast< int >( _threadCount * 4 );
+    const size_t spikeCount = std::distance( spikes.first , spikes.second );
+    const size_t slotsPerTask = _store->size( ) / tasks + 1;
+
+    _spikeBuckets.resize( tasks * tasks );
+    _dirtySlots.resize( tasks );
 
-    auto map = _selectionCluster->mapData( );
-    const uint32_t size = _selectionCluster->size( );
-    for ( uint32_t i = 0; i < size; i++ )
+    // First pass: every chunk sorts its spikes into one bucket per range.
+#ifdef VISIMPL_USE_OPENMP
+    #pragma omp parallel for schedule( dynamic ) num_threads( _threadCount )
+#endif
+    for ( int chunk = 0; chunk < tasks; ++chunk )
     {
-      auto particle = map + i;
-      if ( killParticles )
-      {
-        particle->timestamp = -std::numeric_limits< float >::infinity( );
-      }
+      auto buckets = _spikeBuckets.begin( ) + chunk * tasks;
+      for ( int range = 0; range < tasks; ++range )
+        buckets[ range ].clear( );
 
-      auto gid = _selectionGids.at( i );
-      auto value = input.find( gid );
-      if ( value != input.cend( ))
+      const auto begin = spikes.first + spikeCount * chunk / tasks;
+      const auto end = spikes.first + spikeCount * ( chunk + 1 ) / tasks;
+      for ( auto spike = begin; spike != end; ++spike )
       {
-        particle->timestamp = value->second;
+        const auto slot = _store->getSlot( spike->second );
+        if ( slot != ParticleStore::INVALID_SLOT )
+          buckets[ slot / slotsPerTask ].emplace_back( slot , spike->first );
       }
     }
 
-    _selectionCluster->unmapData( );
-  }
+    // Second pass: every range is written by a single task, walking the
+    // chunks backwards so the first spike of each neuron wins, exactly as
+    // in the serial path.
+    float* timestamps = _store->getTimestamps( ).data( );
 
-  void DomainManager::processGroupSpikes( const simil::SpikesCRange& spikes ,
-                                          bool killParticles )
-  {
-    auto input = parseInput( spikes );
-    for ( const auto& item: _groupClusters )
+#ifdef VISIMPL_USE_OPENMP
+    #pragma omp parallel for schedule( dynamic ) num_threads( _threadCount )
+#endif
+    for ( int range = 0; range < tasks; ++range )
     {
-      auto cluster = item.second->getCluster( );
-      auto map = cluster->mapData( );
-      uint32_t size = cluster->size( );
-      for ( uint32_t i = 0; i < size; i++ )
+      auto& dirty = _dirtySlots[ range ];
+      dirty.clear( );
+
+      for ( int chunk = tasks - 1; chunk >= 0; --chunk )
       {
-        auto particle = map + i;
-        if ( killParticles )
+        const auto& bucket = _spikeBuckets[ chunk * tasks + range ];
+        for ( auto it = bucket.crbegin( ); it != bucket.crend( ); ++it )
         {
-          particle->timestamp = -std::numeric_limits< float >::infinity( );
-        }
-        auto gid = item.second->getGids( ).at( i );
-        auto value = input.find( gid );
-        if ( value != input.cend( ))
-        {
-          particle->timestamp = value->second;
+          timestamps[ it->first ] = it->second;
+          dirty.push_back( it->first );
         }
       }
-
-      cluster->unmapData( );
     }
+
+    for ( const auto& dirty: _dirtySlots )
+      _store->getTimestamps( ).addDirty( dirty );
   }
 
-  void
-  DomainManager::processAttributeSpikes( const simil::SpikesCRange& spikes ,
-                                         bool killParticles )
+  size_t DomainManager::getUploadedBytes( ) const
   {
-    auto input = parseInput( spikes );
-    for ( const auto& item: _attributeClusters )
+    return _uploadedBytes;
+  }
+
+  bool DomainManager::isCullingEnabled( ) const
+  {
+    return _culling;
+  }
+
+  void DomainManager::enableCulling( bool enabled )
+  {
+    _culling = enabled;
+  }
+
+  const ParticleCuller::Stats& DomainManager::getCullingStats( ) const
+  {
+    return _cullingStats;
+  }
+
+  void DomainManager::updateLevelOfDetail( )
+  {
+    if ( !_levelOfDetail ) return;
+
+    const auto& timestamps = _store->getTimestamps( );
+
+    _selectionLod->update( timestamps , _selectionModel != nullptr ?
+                                        _selectionModel->getDecay( ) : _decay );
+    _selectionLod->flush( );
+
+    auto updateGroups = [ & ]( const std::map< std::string ,
+                               std::shared_ptr< VisualGroup >>& groups )
     {
-      auto cluster = item.second->getCluster( );
-      auto map = cluster->mapData( );
-      const uint32_t size = cluster->size( );
-      for ( uint32_t i = 0; i < size; i++ )
+      for ( const auto& item: groups )
       {
-        auto particle = map + i;
-        if ( killParticles )
-        {
-          particle->timestamp = -std::numeric_limits< float >::infinity( );
-        }
-        auto gid = item.second->getGids( ).at( i );
-        auto value = input.find( gid );
-        if ( value != input.cend( ))
-        {
-          particle->timestamp = value->second;
-        }
+        const auto& lod = item.second->getLevelOfDetail( );
+        lod->update( timestamps , item.second->getModel( )->getDecay( ));
+        lod->flush( );
       }
+    };
 
-      cluster->unmapData( );
-    }
+    updateGroups( _groupClusters );
+    updateGroups( _attributeClusters );
+  }
+
+  bool DomainManager::isLevelOfDetailEnabled( ) const
+  {
+    return _levelOfDetail;
+  }
+
+  void DomainManager::enableLevelOfDetail( bool enabled )
+  {
+    if ( enabled == _levelOfDetail ) return;
+    _levelOfDetail = enabled;
+
+    // Updates were skipped while disabled, and the clusters hold the
+    // particles of the other path.
+    _selectionCuller.invalidate( );
+    _selectionLod->invalidate( );
+    for ( const auto& item: _groupClusters )
+      item.second->invalidateParticles( );
+    for ( const auto& item: _attributeClusters )
+      item.second->invalidateParticles( );
+  }
+
+  float DomainManager::getLevelOfDetailThreshold( ) const
+  {
+    return _lodThreshold;
+  }
+
+  void DomainManager::setLevelOfDetailThreshold( float threshold )
+  {
+    _lodThreshold = threshold;
+  }
+
+  ParticleLod::Aggregation DomainManager::getLevelOfDetailAggregation( ) const
+  {
+    return _lodAggregation;
+  }
+
+  void DomainManager::setLevelOfDetailAggregation(
+    ParticleLod::Aggregation aggregation )
+  {
+    _lodAggregation = aggregation;
+    _selectionLod->setAggregation( aggregation );
+    for ( const auto& item: _groupClusters )
+      item.second->getLevelOfDetail( )->setAggregation( aggregation );
+    for ( const auto& item: _attributeClusters )
+      item.second->getLevelOfDetail( )->setAggregation( aggregation );
+  }
+
+  const ParticleLod::Stats& DomainManager::getLevelOfDetailStats( ) const
+  {
+    return _lodStats;
   }
 }
@@ -6,11 +6,15 @@
 #define VISIMPL_DOMAINMANAGER_H
 
 #include <map>
+#include <unordered_map>
 
 // ParticleLab
 #include <plab/plab.h>
 
 #include "visimpl/particlelab/NeuronParticle.h"
+#include "visimpl/particlelab/ParticleCuller.h"
+#include "visimpl/particlelab/ParticleLod.h"
+#include "visimpl/particlelab/ParticleStore.h"
 #include "VisualGroup.h"
 
 #include "types.h"
@@ -28,12 +32,13 @@ namespace visimpl
 
   class DomainManager
   {
-
     VisualMode _mode;
     std::shared_ptr< plab::ICamera > _camera;
 
     std::vector< uint32_t > _selectionGids;
     std::shared_ptr< plab::Cluster< NeuronParticle > > _selectionCluster;
+    ParticleCuller _selectionCuller;
+    std::shared_ptr< ParticleLod > _selectionLod;
 
     std::map< std::string , std::shared_ptr< VisualGroup > > _groupClusters;
 
@@ -41,6 +46,29 @@ namespace visimpl
     std::map< tNeuronAttributes , std::vector< std::string>> _attributeNames;
     std::map< tNeuronAttributes , std::vector< std::vector< uint32_t>> > _attributeTypeGids;
 
+    // Positions and timestamps of every neuron. Clusters only hold slots.
+    std::shared_ptr< ParticleStore > _store;
+
+    // Bytes sent to the GPU by the last processInput call.
+    size_t _uploadedBytes;
+
+    // Culling of the clusters against the view frustum and clipping planes.
+    bool _culling;
+    ParticleCuller::Stats _cullingStats;
+
+    // Level of detail of the clusters, replaces culling when enabled.
+    bool _levelOfDetail;
+    float _lodThreshold;
+    ParticleLod::Aggregation _lodAggregation;
+    ParticleLod::Stats _lodStats;
+
+    // Threads used to apply spikes. 1 means serial processing.
+    unsigned int _threadCount;
+
+    // Scratch buffers of the parallel path, reused between frames.
+    std::vector< std::vector< std::pair< uint32_t , float >>> _spikeBuckets;
+    std::vector< std::vector< uint32_t >> _dirtySlots;
+
     // Models
     std::shared_ptr< StaticGradientModel > _selectionModel;
 
@@ -80,11 +108,19 @@ namespace visimpl
 
 #endif
 
+    /**
+     * Cluster of the selection. It only holds the particles submitted by
+     * the last draw, use getSelectionSize to count the selection.
+     */
     std::shared_ptr< plab::Cluster< NeuronParticle > >
     getSelectionCluster( ) const;
 
+    size_t getSelectionSize( ) const;
+
     const std::shared_ptr< StaticGradientModel >& getSelectionModel( ) const;
 
+    const std::shared_ptr< ParticleStore >& getParticleStore( ) const;
+
     int getGroupAmount( ) const;
 
     const std::map< std::string , std::shared_ptr< VisualGroup>>&
@@ -97,6 +133,14 @@ namespace visimpl
 
     VisualMode getMode( ) const;
 
+    /**
+     * Model drawing each GID in the current mode: the selection model or
+     * the model of the first active group holding it. GIDs missing from
+     * the map aren't drawn. The pointers live until the groups change.
+     */
+    std::unordered_map< uint32_t , const StaticGradientModel* >
+    getDrawnModels( ) const;
+
     void setMode( VisualMode mode );
 
     float getDecay( ) const;
@@ -109,6 +153,14 @@ namespace visimpl
 
     const tBoundingBox& getBoundingBox( ) const;
 
+    /**
+     * Sets the positions of the whole circuit. Must be called when the
+     * positions change without changing the amount of neurons (i.e. when
+     * the circuit is scaled). Otherwise the positions given to
+     * setSelection, createGroup and selectAttribute are used.
+     */
+    void setPositions( const tGidPosMap& positions );
+
     void setSelection( const TGIDSet& gids ,
                        const tGidPosMap& positions );
 
@@ -139,24 +191,113 @@ namespace visimpl
 
     void enableClipping( bool enabled );
 
-    void draw( ) const;
+    /**
+     * Draws the clusters of the current mode. Unless culling is disabled,
+     * only the grid cells of each cluster that may be inside the camera
+     * frustum and the enabled clipping planes are submitted. With level of
+     * detail enabled, the distant nodes of each cluster are drawn as their
+     * aggregated particle instead.
+     */
+    void draw( );
 
     void processInput(
       const simil::SpikesCRange& spikes , bool killParticles );
 
+    /**
+     * Resets every particle to the last spike of its neuron in
+     * ( time - decay , time ], using a per-neuron spike index. The cost
+     * depends on the amount of neurons, not on the spike density.
+     */
+    void processLastSpikes( const SpikeIndex& index , float time );
+
+    /**
+     * Spike windows smaller than this are always processed serially.
+     */
+    static constexpr size_t PARALLEL_MIN_SPIKES = 16384;
+
+    unsigned int getThreadCount( ) const;
+
+    /**
+     * Sets the amount of threads used to apply large spike windows.
+     * 0 uses the OpenMP default, 1 disables parallel processing.
+     * Without OpenMP support spikes are always processed serially.
+     */
+    void setThreadCount( unsigned int threads );
+
+    /**
+     * Amount of timestamp bytes uploaded to the GPU by the last
+     * processInput call. Only the coalesced ranges of particles that
+     * received spikes are uploaded, unless particles were killed.
+     */
+    size_t getUploadedBytes( ) const;
+
+    bool isCullingEnabled( ) const;
+
+    void enableCulling( bool enabled );
+
+    /**
+     * Cells and particles of the clusters drawn by the last draw call, and
+     * how many of them were submitted.
+     */
+    const ParticleCuller::Stats& getCullingStats( ) const;
+
+    bool isLevelOfDetailEnabled( ) const;
+
+    /**
+     * Draws distant groups of neurons as a single particle summarizing
+     * their activity. See ParticleLod.
+     */
+    void enableLevelOfDetail( bool enabled );
+
+    float getLevelOfDetailThreshold( ) const;
+
+    /**
+     * Nodes whose radius is below threshold times their distance to the
+     * camera are aggregated. Higher values aggregate more.
+     */
+    void setLevelOfDetailThreshold( float threshold );
+
+    ParticleLod::Aggregation getLevelOfDetailAggregation( ) const;
+
+    void setLevelOfDetailAggregation( ParticleLod::Aggregation aggregation );
+
+    /**
+     * Aggregated and individual particles drawn by the last draw call.
+     * Only gathered when level of detail is enabled.
+     */
+    const ParticleLod::Stats& getLevelOfDetailStats( ) const;
+
   protected:
 
-    std::unordered_map< uint32_t , float >
-    parseInput( const simil::SpikesCRange& spikes );
+    void setSelectionParticles( const std::vector< NeuronParticle >& particles );
 
-    void processSelectionSpikes(
-      const simil::SpikesCRange& spikes , bool killParticles );
+    /**
+     * Normalized planes of the camera frustum, plus the clipping planes
+     * if clipping is enabled.
+     */
+    std::vector< glm::vec4 > cullingPlanes( ) const;
 
-    void processGroupSpikes(
-      const simil::SpikesCRange& spikes , bool killParticles );
+    /**
+     * Updates the aggregates of every level of detail from the dirty store
+     * timestamps and uploads them. Must run before the store flushes.
+     */
+    void updateLevelOfDetail( );
 
-    void processAttributeSpikes(
-      const simil::SpikesCRange& spikes , bool killParticles );
+    void updateStore( const tGidPosMap& positions );
+
+    void processSpikesSerial( const simil::SpikesCRange& spikes );
+
+    void processSpikesParallel( const simil::SpikesCRange& spikes );
+
+    template< typename TGids >
+    void indexGids( const TGids& candidates ,
+                    std::vector< uint32_t >& gids ,
+                    std::vector< NeuronParticle >& particles ) const;
+
+    template< typename TGids >
+    void setSelectionGids( const TGids& gids , const tGidPosMap& positions );
+
+    std::shared_ptr< VisualGroup > createGroupCluster( const std::string& name );
 
   };
 
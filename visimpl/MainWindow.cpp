@@ -98,6 +98,9 @@ constexpr const char* POSITION_KEY_ = "positionData";
 constexpr const char* PLANES_COLOR_KEY_ = "clippingPlanesColor";
 constexpr const char* GROUP_NAME_ = "groupName";
 
+// Interval between refreshes of the views while the spikes stream in.
+constexpr int STREAMING_REFRESH_MS = 250;
+
 namespace visimpl
 {
   enum toolIndex
@@ -153,6 +156,8 @@ namespace visimpl
     , _selectionSizeLabel( nullptr )
     , _alphaNormalButton( nullptr )
     , _alphaAccumulativeButton( nullptr )
+    , _checkLevelOfDetail( nullptr )
+    , _comboLodAggregation( nullptr )
     , _labelGID( nullptr )
     , _labelPosition( nullptr )
     , _groupBoxAttrib( nullptr )
@@ -170,6 +175,9 @@ namespace visimpl
     , _recorder( nullptr )
     , m_loader{ nullptr }
     , m_loaderDialog{ nullptr }
+    , m_streamingLoad{ false }
+    , m_spikeWindowMargin{ -1.0f }
+    , m_compressedSpikes{ false }
 #ifdef SIMIL_WITH_REST_API
     , _restConnectionInformation( )
     , _alreadyConnected( false )
@@ -398,6 +406,8 @@ namespace visimpl
 #endif
     delete _ui;
 
+    // A running loader must stop before it is destroyed.
+    _stopLoader( );
     m_loader = nullptr;
     closeLoadingDialog( );
   }
@@ -707,6 +717,15 @@ namespace visimpl
       }
     }
 #endif
+    // The spikes still loading go away with the rest of the data.
+    if ( m_streamingLoad )
+    {
+      _stopLoader( );
+      m_streamingLoad = false;
+      _objectInspectorGB->setCheckUpdates( false );
+      closeLoadingDialog( );
+    }
+
     QApplication::setOverrideCursor( Qt::WaitCursor );
 
     Stop( );
@@ -725,6 +744,7 @@ namespace visimpl
     _objectInspectorGB->setSimPlayer( nullptr );
 
     _simSlider->setSliderPosition( 0 );
+    _summary->spikeWindow( nullptr );
     _summary->clear( );
     _simulationDock->setEnabled( false );
     _simConfigurationDock->setEnabled( false );
@@ -1280,6 +1300,14 @@ void MainWindow::_initSimControlDock(void)
   _alphaAccumulativeButton = new QRadioButton("Accumulative");
   _openGLWidget->SetAlphaBlendingAccumulative(false);
 
+  _checkLevelOfDetail = new QCheckBox(tr("Aggregate distant neurons"));
+  _comboLodAggregation = new QComboBox();
+  _comboLodAggregation->addItem(tr("Max"));
+  _comboLodAggregation->addItem(tr("Mean"));
+  _comboLodAggregation->setToolTip(
+      tr("Activity of the aggregated neurons: latest spike or mean decay"));
+  _comboLodAggregation->setEnabled(false);
+
   _buttonClearSelection = new QPushButton("Discard");
   _buttonClearSelection->setEnabled(false);
   _selectionSizeLabel = new QLabel("0");
@@ -1399,6 +1427,13 @@ void MainWindow::_initSimControlDock(void)
   rfLayout->addWidget(_alphaAccumulativeButton);
   rFunctionGB->setLayout(rfLayout);
 
+  QGroupBox *lodGB = new QGroupBox("Level of detail");
+  QHBoxLayout *lodLayout = new QHBoxLayout();
+  lodLayout->setAlignment(Qt::AlignTop);
+  lodLayout->addWidget(_checkLevelOfDetail);
+  lodLayout->addWidget(_comboLodAggregation);
+  lodGB->setLayout(lodLayout);
+
   // Visual Configuration Container
   QWidget *vcContainer = new QWidget();
   QVBoxLayout *vcLayout = new QVBoxLayout();
@@ -1407,6 +1442,7 @@ void MainWindow::_initSimControlDock(void)
   vcLayout->addWidget(shaderGB);
   vcLayout->addWidget(dFunctionGB);
   vcLayout->addWidget(rFunctionGB);
+  vcLayout->addWidget(lodGB);
   vcContainer->setLayout(vcLayout);
 
   QPushButton *buttonSelectionManager = new QPushButton("...");
@@ -1643,6 +1679,11 @@ void MainWindow::_initSimControlDock(void)
   connect(_alphaNormalButton, SIGNAL(toggled(bool)), this,
           SLOT(AlphaBlendingToggled(void)));
 
+  connect(_checkLevelOfDetail, SIGNAL(stateChanged(int)), this,
+          SLOT(levelOfDetailChanged(void)));
+  connect(_comboLodAggregation, SIGNAL(currentIndexChanged(int)), this,
+          SLOT(levelOfDetailChanged(void)));
+
   // Clipping planes
 
   _checkClipping->setChecked(true);
@@ -1862,6 +1903,20 @@ void MainWindow::_initSimControlDock(void)
     }
   }
 
+  void MainWindow::levelOfDetailChanged( void )
+  {
+    const bool enabled = _checkLevelOfDetail->isChecked( );
+    _comboLodAggregation->setEnabled( enabled );
+
+    if ( !_domainManager ) return;
+
+    _domainManager->setLevelOfDetailAggregation(
+      _comboLodAggregation->currentIndex( ) == 0 ?
+      ParticleLod::Aggregation::Max : ParticleLod::Aggregation::Mean );
+    _domainManager->enableLevelOfDetail( enabled );
+    _openGLWidget->update( );
+  }
+
   void MainWindow::updateAttributeStats( void )
   {
     if ( !_domainManager )
@@ -1922,17 +1977,16 @@ void MainWindow::_initSimControlDock(void)
     _layoutAttribGroups->update( );
   }
 
-  void MainWindow::updateSelectedStatsPickingSingle( unsigned int /*selected*/ )
+  void MainWindow::updateSelectedStatsPickingSingle( unsigned int selected )
   {
-    // TODO
-    /*
-    auto pickingInfo = _domainManager->pickingInfoSimple( selected );
-
-    _labelGID->setText(
-      QString::number( std::get< T_PART_GID >( pickingInfo )));
+    const auto& positions = _openGLWidget->getGidPositions( );
+    const auto it = positions.find( selected );
+    if ( it == positions.cend( ))
+      return;
 
-    auto position = std::get< T_PART_POSITION >( pickingInfo );
+    _labelGID->setText( QString::number( selected ));
 
+    const auto& position = it->second;
     QString posText = "( " + QString::number( position.x ) + ", " +
                       QString::number( position.y ) + ", " +
                       QString::number( position.z ) + " )";
@@ -1941,7 +1995,6 @@ void MainWindow::_initSimControlDock(void)
 
     _toolBoxOptions->setCurrentIndex(
       static_cast<unsigned int>( T_TOOL_Inpector ));
-    */
   }
 
   void MainWindow::clippingPlanesReset( void )
@@ -2067,11 +2120,11 @@ void MainWindow::_initSimControlDock(void)
 
   void MainWindow::_updateSelectionGUI( void )
   {
-    auto selection = _domainManager->getSelectionCluster( );
+    const auto selectionSize = _domainManager->getSelectionSize( );
 
-    _buttonAddGroup->setEnabled( selection->size( ) != 0 );
-    _buttonClearSelection->setEnabled( selection->size( ) != 0 );
-    _selectionSizeLabel->setText( QString::number( selection->size( )));
+    _buttonAddGroup->setEnabled( selectionSize != 0 );
+    _buttonClearSelection->setEnabled( selectionSize != 0 );
+    _selectionSizeLabel->setText( QString::number( selectionSize ));
     _selectionSizeLabel->update( );
   }
 
@@ -2378,7 +2431,7 @@ void MainWindow::_initSimControlDock(void)
 
     addGroupControls( group ,
                       _domainManager->getGroupAmount( ) - 1 ,
-                      _domainManager->getSelectionCluster( )->size( ));
+                      _domainManager->getSelectionSize( ));
 
     _openGLWidget->update( );
 
@@ -2662,6 +2715,16 @@ void MainWindow::_initSimControlDock(void)
     groups.at( name )->sizeFunction( s );
   }
 
+  void MainWindow::setSpikeWindowMargin( const float margin )
+  {
+    m_spikeWindowMargin = margin;
+  }
+
+  void MainWindow::setCompressedSpikes( const bool value )
+  {
+    m_compressedSpikes = value;
+  }
+
   void MainWindow::loadData( const simil::TDataType type ,
                              const std::string arg_1 , const std::string arg_2 ,
                              const simil::TSimulationType simType ,
@@ -2682,17 +2745,35 @@ void MainWindow::_initSimControlDock(void)
 
     QApplication::processEvents( );
 
+    // Sources SimIL parses are loaded whole, nothing to keep half way.
+    // Compressed spikes are paged in once they are all loaded.
+    const bool streaming = !m_compressedSpikes &&
+                           LoaderThread::canStream( type , arg_1 , arg_2 );
+    m_loaderDialog->setKeepPartialVisible( streaming );
+
     m_loader = std::make_shared< LoaderThread >( );
     m_loader->setData( type , arg_1 , arg_2 );
+    m_loader->setStreaming( streaming );
+    m_loader->setWindowed( m_spikeWindowMargin >= 0.0f ,
+                           std::max( 0.0f , m_spikeWindowMargin ));
+    m_loader->setCompressed( m_compressedSpikes );
 
     connect( m_loader.get( ) , SIGNAL( finished( )) ,
              this , SLOT( onDataLoaded( )));
+    connect( m_loader.get( ) , SIGNAL( networkLoaded( )) ,
+             this , SLOT( onNetworkLoaded( )));
+    connect( m_loader.get( ) , SIGNAL( spikeChunksReady( )) ,
+             this , SLOT( onSpikeChunksReady( )));
     connect( m_loader.get( ) , SIGNAL( progress( int )) ,
              m_loaderDialog , SLOT( setProgress( int )));
     connect( m_loader.get( ) , SIGNAL( network( unsigned int )) ,
              m_loaderDialog , SLOT( setNetwork( unsigned int )));
     connect( m_loader.get( ) , SIGNAL( spikes( unsigned int )) ,
              m_loaderDialog , SLOT( setSpikesValue( unsigned int )));
+    connect( m_loader.get( ) , SIGNAL( bytesRead( qulonglong , qulonglong )) ,
+             m_loaderDialog , SLOT( setBytesRead( qulonglong , qulonglong )));
+    connect( m_loaderDialog , SIGNAL( cancelRequested( bool )) ,
+             m_loader.get( ) , SLOT( cancel( bool )));
 
     _lastOpenedNetworkFileName = QString::fromStdString( arg_1 );
     _lastOpenedSubsetsFileName = QString::fromStdString( subsetEventFile );
@@ -2712,10 +2793,135 @@ void MainWindow::_initSimControlDock(void)
 
   void MainWindow::onDataLoaded( )
   {
-    setWindowTitle( "SimPart" );
+    if ( !m_loader ) return;
 
+    if ( m_loader->cancelled( ))
+    {
+      _finishCancelledLoad( );
+      return;
+    }
+
+    if ( m_streamingLoad )
+    {
+      _finishStreamingLoad( );
+      return;
+    }
+
+    if ( _setUpLoadedData( ))
+      m_loader = nullptr;
+  }
+
+  void MainWindow::onNetworkLoaded( )
+  {
     if ( !m_loader ) return;
 
+    // Correlating the spikes loaded so far would only see a prefix.
+    _stackViz->deferCorrelations( true );
+
+    if ( !_setUpLoadedData( )) return;
+
+    // The scene is already usable, the inspector polls the player while the
+    // spikes arrive and refreshes the views over the loaded prefix.
+    m_streamingLoad = true;
+    _objectInspectorGB->setCheckTimer( STREAMING_REFRESH_MS );
+    _objectInspectorGB->setCheckUpdates( true );
+  }
+
+  void MainWindow::onSpikeChunksReady( )
+  {
+    if ( !m_loader || !m_streamingLoad ) return;
+
+    auto spikeData = std::dynamic_pointer_cast< simil::SpikeData >(
+      m_loader->simulationData( ));
+    if ( !spikeData ) return;
+
+    auto& chunks = m_loader->spikeChunks( );
+    const float endTime = spikeData->endTime( );
+
+    simil::Spikes chunk;
+    while ( chunks.pop( chunk ))
+      spikeData->addSpikes( chunk , endTime );
+  }
+
+  void MainWindow::_finishStreamingLoad( )
+  {
+    onSpikeChunksReady( );
+
+    m_streamingLoad = false;
+    _objectInspectorGB->setCheckUpdates( false );
+
+    const auto error = m_loader->errors( );
+    m_loader = nullptr;
+
+    _openGLWidget->updateData( );
+    _summary->UpdateHistograms( );
+    _stackViz->updateHistograms( );
+    _stackViz->deferCorrelations( false );
+    configureComponents( );
+
+    closeLoadingDialog( );
+
+    if ( !error.empty( ))
+    {
+      const auto message = QString::fromStdString( error );
+      QMessageBox::critical( this , tr( "Error loading data" ) , message ,
+                             QMessageBox::Ok );
+    }
+  }
+
+  void MainWindow::_finishCancelledLoad( )
+  {
+    auto spikeData = std::dynamic_pointer_cast< simil::SpikeData >(
+      m_loader->simulationData( ));
+
+    // The time prefix streamed until the cancellation is a dataset on its
+    // own, ending at its last spike.
+    if ( m_streamingLoad && m_loader->partial( ) && spikeData &&
+         m_loader->loadedEndTime( ) > spikeData->startTime( ))
+    {
+      spikeData->setEndTime( m_loader->loadedEndTime( ));
+      _finishStreamingLoad( );
+
+      showStatusBarMessage( tr( "Loading cancelled, data truncated at %1." )
+                              .arg( spikeData->endTime( )));
+      return;
+    }
+
+    if ( m_streamingLoad )
+    {
+      // Published without spikes, goes away as any other data.
+      m_streamingLoad = false;
+      _objectInspectorGB->setCheckUpdates( false );
+      closeData( );
+    }
+    else
+    {
+      QApplication::restoreOverrideCursor( );
+    }
+
+    m_loader = nullptr;
+    closeLoadingDialog( );
+
+    showStatusBarMessage( tr( "Loading cancelled." ));
+  }
+
+  void MainWindow::_stopLoader( )
+  {
+    if ( !m_loader ) return;
+
+    m_loader->cancel( );
+    m_loader->wait( );
+
+    simil::Spikes chunk;
+    auto& chunks = m_loader->spikeChunks( );
+    while ( chunks.pop( chunk ))
+      chunk.clear( );
+  }
+
+  bool MainWindow::_setUpLoadedData( )
+  {
+    setWindowTitle( "SimPart" );
+
     const auto error = m_loader->errors( );
     const auto filename = QString::fromStdString( m_loader->filename( ));
     if ( !error.empty( ))
@@ -2728,7 +2934,7 @@ void MainWindow::_initSimControlDock(void)
                              QMessageBox::Ok );
 
       m_loader = nullptr;
-      return;
+      return false;
     }
 
     simil::SpikesPlayer* player = nullptr;
@@ -2746,8 +2952,6 @@ void MainWindow::_initSimControlDock(void)
         player->LoadData( spikeData );
 
         _subsetEvents = spikeData->subsetsEvents( );
-
-        m_loader = nullptr;
       }
         break;
       case simil::TREST:
@@ -2759,8 +2963,6 @@ void MainWindow::_initSimControlDock(void)
         player->LoadData( netData , simData );
 
         _subsetEvents = netData->subsetsEvents( );
-
-        m_loader = nullptr;
       }
         break;
       case simil::TDataUndefined:
@@ -2772,7 +2974,7 @@ void MainWindow::_initSimControlDock(void)
                                tr( "Data type is undefined after loading" ) ,
                                QMessageBox::Ok );
 
-        return;
+        return false;
       }
         break;
     }
@@ -2787,7 +2989,7 @@ void MainWindow::_initSimControlDock(void)
                              QMessageBox::Ok );
 
       m_loader = nullptr;
-      return;
+      return false;
     }
 
     if ( m_loaderDialog )
@@ -2802,6 +3004,12 @@ void MainWindow::_initSimControlDock(void)
     _openGLWidget->setPlayer( player , dataType );
     _modeSelectionWidget->setCurrentIndex( 0 );
 
+    // Windowed loads count the histograms from the spike cache.
+    const auto spikeWindow = m_loader->spikeWindow( );
+    _openGLWidget->setSpikeWindow( spikeWindow );
+    _summary->spikeWindow( spikeWindow );
+    _stackViz->spikeWindow( spikeWindow );
+
     _openGLWidget->subsetEventsManager( _subsetEvents );
     _openGLWidget->showEventsActivityLabels(
       _ui->actionShowEventsActivity->isChecked( ));
@@ -2845,7 +3053,9 @@ void MainWindow::_initSimControlDock(void)
         break;
     }
 
-    closeLoadingDialog( );
+    // Streaming loads keep showing their progress until the last spike.
+    if ( !m_loader->streaming( ))
+      closeLoadingDialog( );
 
     if ( !_lastOpenedSubsetsFileName.isEmpty( ))
     {
@@ -2853,6 +3063,8 @@ void MainWindow::_initSimControlDock(void)
     }
 
     QApplication::restoreOverrideCursor( );
+
+    return true;
   }
 
   void MainWindow::onGroupNameClicked( )
@@ -3764,6 +3976,8 @@ void MainWindow::_initSimControlDock(void)
              m_loaderDialog , SLOT( setNetwork( unsigned int )));
     connect( m_loader.get( ) , SIGNAL( spikes( unsigned int )) ,
              m_loaderDialog , SLOT( setSpikesValue( unsigned int )));
+    connect( m_loaderDialog , SIGNAL( cancelRequested( bool )) ,
+             m_loader.get( ) , SLOT( cancel( bool )));
 
     m_loader->start( );
   }
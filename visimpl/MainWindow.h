@@ -103,6 +103,22 @@ namespace visimpl
                    const simil::TSimulationType simType = simil::TSimulationType::TSimSpikes ,
                    const std::string& subsetEventFile = std::string( ));
 
+    /** \brief Sets the time kept in memory around the playback time when
+     * loading CSV or HDF5 data, the rest of the spikes stays in the spike
+     * cache. Negative to load every spike (the default).
+     * \param[in] margin Resident time around the playback time.
+     *
+     */
+    void setSpikeWindowMargin( const float margin );
+
+    /** \brief Keeps the spikes of the loaded data compressed in memory, the
+     * spikes around the playback time are decoded as they are needed, see
+     * setSpikeWindowMargin(). Spike windows take precedence.
+     * \param[in] value True to compress the spikes.
+     *
+     */
+    void setCompressedSpikes( const bool value );
+
 #ifdef SIMIL_WITH_REST_API
 
     /** \brief Connects and loads data using the given REST connection.
@@ -186,6 +202,8 @@ namespace visimpl
 
     void AlphaBlendingToggled( void );
 
+    void levelOfDetailChanged( void );
+
     void updateAttributeStats( void );
 
     void updateSelectedStatsPickingSingle( unsigned int selected );
@@ -283,6 +301,17 @@ namespace visimpl
      */
     void onDataLoaded( );
 
+    /** \brief Executed when a streaming load has published the network,
+     * before the spikes.
+     *
+     */
+    void onNetworkLoaded( );
+
+    /** \brief Appends the spike chunks streamed by the loader to the data.
+     *
+     */
+    void onSpikeChunksReady( );
+
     /** \brief Loads groups and its properties from a file on disk.
      *
      */
@@ -367,6 +396,29 @@ namespace visimpl
 
     void _configurePlayer( void );
 
+    /** \brief Sets up the player and the views with the loaded data.
+     * \return false if the data couldn't be loaded.
+     *
+     */
+    bool _setUpLoadedData( );
+
+    /** \brief Consumes the last spike chunks and refreshes the views.
+     *
+     */
+    void _finishStreamingLoad( );
+
+    /** \brief Cleans up after a cancelled load, keeping the spikes streamed
+     * until then if the user asked to.
+     *
+     */
+    void _finishCancelledLoad( );
+
+    /** \brief Cancels a running load and waits for the loader to stop,
+     * discarding the spike chunks not consumed yet.
+     *
+     */
+    void _stopLoader( );
+
     void _resetClippingParams( void );
 
     void _updateSelectionGUI( void );
@@ -479,6 +531,9 @@ namespace visimpl
     QRadioButton* _alphaNormalButton;
     QRadioButton* _alphaAccumulativeButton;
 
+    QCheckBox* _checkLevelOfDetail;
+    QComboBox* _comboLodAggregation;
+
     QLabel* _labelGID;
     QLabel* _labelPosition;
 
@@ -504,6 +559,9 @@ namespace visimpl
 
     std::shared_ptr< LoaderThread > m_loader; /** data loader thread. */
     LoadingDialog* m_loaderDialog;          /** data loader dialog. */
+    bool m_streamingLoad;                   /** spikes still streaming in. */
+    float m_spikeWindowMargin;              /** windowed loads margin, or negative. */
+    bool m_compressedSpikes;                /** keep the spikes compressed. */
 
 #ifdef SIMIL_WITH_REST_API
 
@@ -0,0 +1,446 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include "NeuronOctree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <utility>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace visimpl
+{
+  constexpr uint32_t NeuronOctree::LEAF_SIZE;
+  constexpr uint32_t NeuronOctree::MAX_DEPTH;
+
+  namespace
+  {
+    // Projection of the node box on the given direction: center and half
+    // length of the interval, plus a tolerance so that the per neuron tests
+    // decide the neurons lying on the boundary.
+    struct Interval
+    {
+      float center;
+      float radius;
+      float tolerance;
+    };
+
+    inline Interval project( const glm::vec3& direction ,
+                             const glm::vec3& min ,
+                             const glm::vec3& max ,
+                             float offset )
+    {
+      const glm::vec3 center = ( min + max ) * 0.5f;
+      const glm::vec3 extent = ( max - min ) * 0.5f;
+
+      Interval interval;
+      interval.center = glm::dot( direction , center ) + offset;
+      interval.radius = glm::dot( glm::abs( direction ) , extent );
+      interval.tolerance = 1e-5f * ( std::abs( interval.center ) +
+                                     interval.radius + std::abs( offset )) +
+                           std::numeric_limits< float >::min( );
+      return interval;
+    }
+
+    // Distance along the ray at which it enters the box, negative if it
+    // doesn't hit it. The ray starts inside the box at 0.
+    inline float enterDistance( const glm::vec3& origin ,
+                                const glm::vec3& direction ,
+                                const glm::vec3& min ,
+                                const glm::vec3& max )
+    {
+      float enter = 0.0f;
+      float exit = std::numeric_limits< float >::max( );
+      for ( int axis = 0; axis < 3; ++axis )
+      {
+        if ( direction[ axis ] == 0.0f )
+        {
+          if ( origin[ axis ] < min[ axis ] || origin[ axis ] > max[ axis ] )
+            return -1.0f;
+          continue;
+        }
+
+        const float inverse = 1.0f / direction[ axis ];
+        float near = ( min[ axis ] - origin[ axis ] ) * inverse;
+        float far = ( max[ axis ] - origin[ axis ] ) * inverse;
+        if ( near > far ) std::swap( near , far );
+
+        enter = std::max( enter , near );
+        exit = std::min( exit , far );
+        if ( enter > exit ) return -1.0f;
+      }
+
+      return enter;
+    }
+  }
+
+  NeuronOctree::NeuronOctree( )
+  { }
+
+  void NeuronOctree::build(
+    const std::unordered_map< unsigned int , glm::vec3 >& positions )
+  {
+    clear( );
+    if ( positions.empty( )) return;
+
+    // GID order keeps the tree, and the order of the results, independent
+    // of the iteration order of the map.
+    std::vector< std::pair< uint32_t , glm::vec3 >> neurons(
+      positions.cbegin( ) , positions.cend( ));
+    std::sort( neurons.begin( ) , neurons.end( ) ,
+               [ ]( const std::pair< uint32_t , glm::vec3 >& a ,
+                    const std::pair< uint32_t , glm::vec3 >& b )
+               {
+                 return a.first < b.first;
+               } );
+
+    _gids.reserve( neurons.size( ));
+    _positions.reserve( neurons.size( ));
+
+    Node root;
+    root.min = root.max = neurons.front( ).second;
+    for ( const auto& neuron: neurons )
+    {
+      _gids.push_back( neuron.first );
+      _positions.push_back( neuron.second );
+      root.min = glm::min( root.min , neuron.second );
+      root.max = glm::max( root.max , neuron.second );
+    }
+    root.first = 0;
+    root.count = static_cast< uint32_t >( neurons.size( ));
+    root.children = 0;
+    root.childCount = 0;
+
+    _nodes.push_back( root );
+    _split( 0 , 0 );
+  }
+
+  void NeuronOctree::_split( uint32_t node , uint32_t depth )
+  {
+    // _nodes grows while splitting, nodes are accessed by index.
+    const Node parent = _nodes[ node ];
+    if ( parent.count <= LEAF_SIZE || depth >= MAX_DEPTH ||
+         parent.min == parent.max )
+      return;
+
+    const glm::vec3 center = ( parent.min + parent.max ) * 0.5f;
+    auto octant = [ & ]( const glm::vec3& position )
+    {
+      return ( position.x > center.x ? 1u : 0u ) |
+             ( position.y > center.y ? 2u : 0u ) |
+             ( position.z > center.z ? 4u : 0u );
+    };
+
+    // Counting sort of the range by octant.
+    std::array< uint32_t , 9 > offsets;
+    offsets.fill( 0 );
+    const uint32_t end = parent.first + parent.count;
+    for ( uint32_t i = parent.first; i < end; ++i )
+      ++offsets[ octant( _positions[ i ] ) + 1 ];
+
+    for ( size_t i = 1; i < offsets.size( ); ++i )
+      offsets[ i ] += offsets[ i - 1 ];
+
+    std::vector< uint32_t > gids( parent.count );
+    std::vector< glm::vec3 > positions( parent.count );
+    auto cursor = offsets;
+    for ( uint32_t i = parent.first; i < end; ++i )
+    {
+      const auto target = cursor[ octant( _positions[ i ] ) ]++;
+      gids[ target ] = _gids[ i ];
+      positions[ target ] = _positions[ i ];
+    }
+    std::copy( gids.cbegin( ) , gids.cend( ) , _gids.begin( ) + parent.first );
+    std::copy( positions.cbegin( ) , positions.cend( ) ,
+               _positions.begin( ) + parent.first );
+
+    const auto children = static_cast< uint32_t >( _nodes.size( ));
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+      if ( offsets[ i ] == offsets[ i + 1 ] ) continue;
+
+      Node child;
+      child.first = parent.first + offsets[ i ];
+      child.count = offsets[ i + 1 ] - offsets[ i ];
+      child.children = 0;
+      child.childCount = 0;
+      child.min = child.max = _positions[ child.first ];
+      for ( uint32_t j = child.first; j < child.first + child.count; ++j )
+      {
+        child.min = glm::min( child.min , _positions[ j ] );
+        child.max = glm::max( child.max , _positions[ j ] );
+      }
+
+      _nodes.push_back( child );
+    }
+
+    _nodes[ node ].children = children;
+    _nodes[ node ].childCount =
+      static_cast< uint32_t >( _nodes.size( )) - children;
+
+    for ( uint32_t i = 0; i < _nodes[ node ].childCount; ++i )
+      _split( children + i , depth + 1 );
+  }
+
+  void NeuronOctree::clear( )
+  {
+    _nodes.clear( );
+    _gids.clear( );
+    _positions.clear( );
+  }
+
+  bool NeuronOctree::empty( ) const
+  {
+    return _gids.empty( );
+  }
+
+  size_t NeuronOctree::size( ) const
+  {
+    return _gids.size( );
+  }
+
+  size_t NeuronOctree::nodes( ) const
+  {
+    return _nodes.size( );
+  }
+
+  template< typename Classify , typename Contains >
+  void NeuronOctree::_query( Classify classify , Contains contains ,
+                             GIDs& result ) const
+  {
+    if ( _nodes.empty( )) return;
+
+    std::vector< uint32_t > pending( 1 , 0 );
+    while ( !pending.empty( ))
+    {
+      const Node& node = _nodes[ pending.back( ) ];
+      pending.pop_back( );
+
+      switch ( classify( node ))
+      {
+        case OUTSIDE:
+          break;
+        case INSIDE:
+          result.insert( result.end( ) , _gids.cbegin( ) + node.first ,
+                         _gids.cbegin( ) + node.first + node.count );
+          break;
+        case INTERSECTS:
+          if ( node.childCount == 0 )
+          {
+            for ( uint32_t i = node.first; i < node.first + node.count; ++i )
+              if ( contains( _positions[ i ] ))
+                result.push_back( _gids[ i ] );
+          }
+          else
+          {
+            for ( uint32_t i = 0; i < node.childCount; ++i )
+              pending.push_back( node.children + i );
+          }
+          break;
+      }
+    }
+  }
+
+  void NeuronOctree::slab( const glm::vec3& normal , float offset ,
+                           float width , GIDs& result ) const
+  {
+    // distance = offset - dot( normal , p ), kept in ( 0 , width ].
+    auto classify = [ & ]( const Node& node )
+    {
+      const auto interval = project( -normal , node.min , node.max , offset );
+      const float low = interval.center - interval.radius;
+      const float high = interval.center + interval.radius;
+
+      if ( high <= -interval.tolerance ||
+           low > width + interval.tolerance )
+        return OUTSIDE;
+      if ( low > interval.tolerance && high <= width - interval.tolerance )
+        return INSIDE;
+      return INTERSECTS;
+    };
+
+    auto contains = [ & ]( const glm::vec3& position )
+    {
+      const float distance = offset - glm::dot( normal , position );
+      return distance > 0.0f && distance <= width;
+    };
+
+    _query( classify , contains , result );
+  }
+
+  void NeuronOctree::box( const glm::vec3& min , const glm::vec3& max ,
+                          GIDs& result ) const
+  {
+    // Node bounds are neuron coordinates, the comparisons are exact.
+    auto classify = [ & ]( const Node& node )
+    {
+      if ( node.max.x < min.x || node.max.y < min.y || node.max.z < min.z ||
+           node.min.x > max.x || node.min.y > max.y || node.min.z > max.z )
+        return OUTSIDE;
+      if ( node.min.x >= min.x && node.min.y >= min.y && node.min.z >= min.z &&
+           node.max.x <= max.x && node.max.y <= max.y && node.max.z <= max.z )
+        return INSIDE;
+      return INTERSECTS;
+    };
+
+    auto contains = [ & ]( const glm::vec3& position )
+    {
+      return position.x >= min.x && position.y >= min.y &&
+             position.z >= min.z && position.x <= max.x &&
+             position.y <= max.y && position.z <= max.z;
+    };
+
+    _query( classify , contains , result );
+  }
+
+  void NeuronOctree::sphere( const glm::vec3& center , float radius ,
+                             GIDs& result ) const
+  {
+    const float radius2 = radius * radius;
+    const float tolerance = 1e-5f * radius2;
+
+    auto classify = [ & ]( const Node& node )
+    {
+      const glm::vec3 nearest =
+        glm::clamp( center , node.min , node.max ) - center;
+      if ( glm::dot( nearest , nearest ) > radius2 + tolerance )
+        return OUTSIDE;
+
+      const glm::vec3 farthest = glm::max( glm::abs( node.min - center ) ,
+                                           glm::abs( node.max - center ));
+      if ( glm::dot( farthest , farthest ) <= radius2 - tolerance )
+        return INSIDE;
+      return INTERSECTS;
+    };
+
+    auto contains = [ & ]( const glm::vec3& position )
+    {
+      const glm::vec3 distance = position - center;
+      return glm::dot( distance , distance ) <= radius2;
+    };
+
+    _query( classify , contains , result );
+  }
+
+  void NeuronOctree::frustum( const std::array< glm::vec4 , 6 >& planes ,
+                              GIDs& result ) const
+  {
+    auto classify = [ & ]( const Node& node )
+    {
+      auto containment = INSIDE;
+      for ( const auto& plane: planes )
+      {
+        const auto interval = project( glm::vec3( plane ) , node.min ,
+                                       node.max , plane.w );
+        if ( interval.center + interval.radius < -interval.tolerance )
+          return OUTSIDE;
+        if ( interval.center - interval.radius < interval.tolerance )
+          containment = INTERSECTS;
+      }
+      return containment;
+    };
+
+    auto contains = [ & ]( const glm::vec3& position )
+    {
+      for ( const auto& plane: planes )
+        if ( glm::dot( glm::vec3( plane ) , position ) + plane.w < 0.0f )
+          return false;
+      return true;
+    };
+
+    _query( classify , contains , result );
+  }
+
+  bool NeuronOctree::raycast( const glm::vec3& origin ,
+                              const glm::vec3& direction ,
+                              float maxRadius , const RadiusFunction& radius ,
+                              uint32_t& gid , float& distance ) const
+  {
+    if ( _nodes.empty( ) || glm::dot( direction , direction ) == 0.0f )
+      return false;
+
+    const glm::vec3 unit = glm::normalize( direction );
+    const glm::vec3 margin( maxRadius , maxRadius , maxRadius );
+
+    // Nodes pending to visit, nearest first.
+    typedef std::pair< float , uint32_t > Pending;
+    std::priority_queue< Pending , std::vector< Pending > ,
+                         std::greater< Pending >> pending;
+
+    auto push = [ & ]( uint32_t index )
+    {
+      const Node& node = _nodes[ index ];
+      const float enter = enterDistance( origin , unit ,
+                                         node.min - margin ,
+                                         node.max + margin );
+      if ( enter >= 0.0f ) pending.emplace( enter , index );
+    };
+
+    bool found = false;
+    distance = std::numeric_limits< float >::max( );
+
+    push( 0 );
+    while ( !pending.empty( ) && pending.top( ).first <= distance )
+    {
+      const Node& node = _nodes[ pending.top( ).second ];
+      pending.pop( );
+
+      if ( node.childCount > 0 )
+      {
+        for ( uint32_t i = 0; i < node.childCount; ++i )
+          push( node.children + i );
+        continue;
+      }
+
+      for ( uint32_t i = node.first; i < node.first + node.count; ++i )
+      {
+        const float r = radius ? radius( _gids[ i ] , _positions[ i ] ) :
+                                 maxRadius;
+        if ( r <= 0.0f ) continue;
+
+        const glm::vec3 toCenter = _positions[ i ] - origin;
+        const float along = glm::dot( toCenter , unit );
+        const float offAxis2 = glm::dot( toCenter , toCenter ) - along * along;
+        if ( offAxis2 > r * r ) continue;
+
+        const float half = std::sqrt( r * r - offAxis2 );
+        if ( along + half < 0.0f ) continue;
+
+        // A ray starting inside the sphere hits it at its origin. Ties go
+        // to the lowest GID.
+        const float hit = std::max( along - half , 0.0f );
+        if ( hit < distance || ( hit == distance && _gids[ i ] < gid ))
+        {
+          distance = hit;
+          gid = _gids[ i ];
+          found = true;
+        }
+      }
+    }
+
+    return found;
+  }
+
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#ifndef VISIMPL_NEURONOCTREE_H
+#define VISIMPL_NEURONOCTREE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace visimpl
+{
+
+  /**
+   * Static octree over the neuron positions, used to answer spatial
+   * selections without visiting every neuron.
+   *
+   * Neurons are reordered so that every node covers a contiguous range of
+   * the GID and position arrays. Nodes store the tight bounds of their
+   * neurons: a query rejects a node lying outside the region, appends the
+   * whole range of a node lying inside it and only tests the neurons of the
+   * nodes crossing its border.
+   *
+   * The tree is rebuilt when the positions change, queries don't modify it
+   * and can run from any thread.
+   */
+  class NeuronOctree
+  {
+  public:
+
+    /**
+     * Neurons below which a node is not split.
+     */
+    static constexpr uint32_t LEAF_SIZE = 64;
+
+    /**
+     * Depth after which nodes are not split, so that many neurons at the
+     * same position don't split forever.
+     */
+    static constexpr uint32_t MAX_DEPTH = 20;
+
+    typedef std::vector< uint32_t > GIDs;
+
+    /**
+     * Radius of the sphere of a neuron when picking, <= 0 if the neuron
+     * can't be picked.
+     */
+    typedef std::function< float( uint32_t gid , const glm::vec3& position ) >
+      RadiusFunction;
+
+    NeuronOctree( );
+
+    /**
+     * Rebuilds the tree over the given GID -> position map.
+     */
+    void build( const std::unordered_map< unsigned int , glm::vec3 >& positions );
+
+    void clear( );
+
+    bool empty( ) const;
+
+    size_t size( ) const;
+
+    size_t nodes( ) const;
+
+    /**
+     * Neurons with 0 < offset - dot( normal , position ) <= width, the
+     * slab between the clipping planes.
+     */
+    void slab( const glm::vec3& normal , float offset , float width ,
+               GIDs& result ) const;
+
+    /**
+     * Neurons inside the axis aligned box [ min , max ].
+     */
+    void box( const glm::vec3& min , const glm::vec3& max ,
+              GIDs& result ) const;
+
+    /**
+     * Neurons at distance <= radius of center.
+     */
+    void sphere( const glm::vec3& center , float radius ,
+                 GIDs& result ) const;
+
+    /**
+     * Neurons on the positive side ( dot( plane.xyz , p ) + plane.w >= 0 )
+     * of every plane, as the six planes of a view frustum.
+     */
+    void frustum( const std::array< glm::vec4 , 6 >& planes ,
+                  GIDs& result ) const;
+
+    /**
+     * Nearest neuron whose sphere is hit by the ray starting at origin.
+     * Spheres have radius( gid , position ), never above maxRadius. Nodes
+     * are visited in order of distance along the ray, so the search stops
+     * as soon as no node can hold a nearer hit.
+     *
+     * @return true if a sphere is hit, with its GID and its distance from
+     * the origin. Spheres hit at the same distance resolve to the lowest GID.
+     */
+    bool raycast( const glm::vec3& origin , const glm::vec3& direction ,
+                  float maxRadius , const RadiusFunction& radius ,
+                  uint32_t& gid , float& distance ) const;
+
+  protected:
+
+    enum Containment
+    {
+      OUTSIDE = 0 ,
+      INTERSECTS ,
+      INSIDE
+    };
+
+    struct Node
+    {
+      glm::vec3 min;
+      glm::vec3 max;
+      uint32_t first;
+      uint32_t count;
+      // Index of the first child, children are consecutive. 0 on leaves.
+      uint32_t children;
+      uint32_t childCount;
+    };
+
+    void _split( uint32_t node , uint32_t depth );
+
+    template< typename Classify , typename Contains >
+    void _query( Classify classify , Contains contains ,
+                 GIDs& result ) const;
+
+    std::vector< Node > _nodes;
+    std::vector< uint32_t > _gids;
+    std::vector< glm::vec3 > _positions;
+  };
+
+}
+
+#endif //VISIMPL_NEURONOCTREE_H
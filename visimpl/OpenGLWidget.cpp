@@ -115,6 +115,9 @@ namespace visimpl
     , _particleSystemInitialized( false )
     , _shaderClippingPlanes( nullptr )
     , _player( nullptr )
+    , _spikeIndex( )
+    , _spikeWindow( nullptr )
+    , _spikeWindowMargin( 0.0f )
     , _clippingPlaneLeft( std::make_shared< reto::ClippingPlane >( ))
     , _clippingPlaneRight( std::make_shared< reto::ClippingPlane >( ))
     , _planeHeight( 1 )
@@ -384,6 +387,8 @@ namespace visimpl
     if ( !_player || !_player->isPlaying( ))
       return;
 
+    _updateSpikeWindow( );
+
     if ( _backtrace )
     {
       _backtraceSimulation( );
@@ -496,19 +501,69 @@ namespace visimpl
   {
     if ( !_player ) return;
 
+    _updateSpikeWindow( );
+
     const float endTime = _player->currentTime( );
     const float startTime = std::max( 0.0f ,
                                       endTime - _domainManager.getDecay( ));
     if ( startTime < endTime )
     {
-      const auto context = _player->spikesBetween( startTime , endTime );
-
       _domainManager.setTime( endTime );
+
+      _updateSpikeIndex( );
+      if ( !_spikeIndex.empty( ))
+      {
+        _domainManager.processLastSpikes( _spikeIndex , endTime );
+        return;
+      }
+
+      const auto context = _player->spikesBetween( startTime , endTime );
       if ( context.first != context.second )
         _domainManager.processInput( context , true );
     }
   }
 
+  void OpenGLWidget::_updateSpikeIndex( void )
+  {
+    auto spikeData = _player ?
+                     dynamic_cast< simil::SpikeData* >( _player->data( ).get( )) :
+                     nullptr;
+    if ( !spikeData )
+    {
+      _spikeIndex.clear( );
+      return;
+    }
+
+    // Streamed data (REST) keeps growing, rebuild when it does.
+    const auto& spikes = spikeData->spikes( );
+    if ( spikes.size( ) != _spikeIndex.size( ))
+      _spikeIndex.build( std::make_pair( spikes.cbegin( ) , spikes.cend( )));
+  }
+
+  void OpenGLWidget::_updateSpikeWindow( void )
+  {
+    if ( !_spikeWindow || !_player ) return;
+
+    auto spikeData = dynamic_cast< simil::SpikeData* >( _player->data( ).get( ));
+    if ( !spikeData ) return;
+
+    // The window always covers the decay and the spikes of the next frame.
+    _spikeWindow->setDecay( _domainManager.getDecay( ));
+    _spikeWindow->setMargin( std::max< float >( _spikeWindowMargin ,
+                                                _player->deltaTime( )));
+
+    const float time = _player->currentTime( );
+    simil::Spikes resident;
+    if ( !_spikeWindow->update( time , resident ))
+      return;
+
+    spikeData->setSpikes( std::move( resident ));
+
+    // The player and the index point into the replaced spikes.
+    _spikeIndex.clear( );
+    _player->GoTo( time );
+  }
+
   void OpenGLWidget::changeShader( int shaderIndex )
   {
     if ( shaderIndex == 0 )
@@ -539,6 +594,7 @@ namespace visimpl
 
     if ( _player )
     {
+      _domainManager.setPositions( _gidPositions );
       _domainManager.setSelection( _player->gids( ) , _gidPositions );
 
 #ifdef SIMIL_USE_BRION
@@ -847,6 +903,7 @@ namespace visimpl
     if ( !_player )
     {
       _gidPositions.clear( );
+      _neuronOctree.clear( );
       _boundingBoxHome = tBoundingBox{ vec3{ 0 , 0 , 0 } , vec3{ 0 , 0 , 0 }};
       return false;
     }
@@ -890,6 +947,7 @@ namespace visimpl
     std::for_each( positions.cbegin( ) , positions.cend( ) , insertElement );
 
     _boundingBoxHome = tBoundingBox{ bbmin , bbmax };
+    _neuronOctree.build( _gidPositions );
 
     return true;
   }
@@ -898,6 +956,7 @@ namespace visimpl
   {
     _flagNewData = false;
     if ( !_updateData( )) return;
+    _domainManager.setPositions( _gidPositions );
     _domainManager.setSelection( _player->gids( ) , _gidPositions );
   }
 
@@ -991,6 +1050,7 @@ namespace visimpl
     if ( update && _player )
     {
       _updateData( true );
+      _domainManager.setPositions( _gidPositions );
       _domainManager.setSelection( _player->gids( ) , _gidPositions );
       _focusOn( _domainManager.getBoundingBox( ));
     }
@@ -1297,30 +1357,77 @@ namespace visimpl
   {
     GIDVec result;
 
-    // Project elements
+    // Elements in the slab between the planes, the octree only tests the
+    // elements of the nodes crossed by them.
     evec3 normal = -_planeNormalLeft;
     normal.normalize( );
 
-    auto positions = _gidPositions;
+    const float offset = normal.dot( _planeLeft.points( )[ 0 ] );
 
-    result.reserve( positions.size( ));
+    _neuronOctree.slab( vec3( normal.x( ) , normal.y( ) , normal.z( )) ,
+                        offset , _planeDistance , result );
 
-    float distance = 0.0f;
+    return result;
+  }
+
+  void OpenGLWidget::_pickSingle( void )
+  {
+    const auto& store = _domainManager.getParticleStore( );
+    if ( _neuronOctree.empty( ) || !store || width( ) <= 0 || height( ) <= 0 )
+      return;
 
-    for ( auto neuronPos: positions )
+    // The octree holds the whole circuit: only the neurons drawn in the
+    // current mode are hit, sized by the model drawing them.
+    const auto models = _domainManager.getDrawnModels( );
+    float maxSize = 0.0f;
+    for ( const auto& item: models )
+      maxSize = std::max( maxSize , item.second->maxParticleSize( ));
+    if ( maxSize <= 0.0f ) return;
+
+    // Click position (bottom-left origin) to a ray from the near to the
+    // far plane.
+    const float x = 2.0f * ( _pickingPosition.x( ) + 0.5f ) / width( ) - 1.0f;
+    const float y = 2.0f * ( _pickingPosition.y( ) + 0.5f ) / height( ) - 1.0f;
+    const glm::mat4 inverse =
+      glm::inverse( _camera->iCameraViewProjectionMatrix( ));
+
+    glm::vec4 nearPoint = inverse * glm::vec4( x , y , -1.0f , 1.0f );
+    glm::vec4 farPoint = inverse * glm::vec4( x , y , 1.0f , 1.0f );
+    if ( nearPoint.w == 0.0f || farPoint.w == 0.0f ) return;
+    nearPoint /= nearPoint.w;
+    farPoint /= farPoint.w;
+
+    // Billboards span [-0.5, 0.5] * size and their texture is a disc.
+    const evec4 leftPlane = _clippingPlaneLeft->getEquation( );
+    const evec4 rightPlane = _clippingPlaneRight->getEquation( );
+    auto clipped = [ ]( const evec4& plane , const glm::vec3& position )
     {
-      distance = normal.dot( _planeLeft.points( )[ 0 ] ) -
-                 normal.dot( glmToEigen( neuronPos.second ));
+      return plane.dot( evec4( position.x , position.y , position.z , 1.0f )) <
+             0.0f;
+    };
 
-      if ( distance > 0.0f && distance <= _planeDistance )
-      {
-        result.emplace_back( neuronPos.first );
-      }
-    }
+    auto radius = [ & ]( uint32_t gid , const glm::vec3& position )
+    {
+      if ( _clipping && ( clipped( leftPlane , position ) ||
+                          clipped( rightPlane , position )))
+        return 0.0f;
 
-    result.shrink_to_fit( );
+      const auto model = models.find( gid );
+      if ( model == models.end( )) return 0.0f;
 
-    return result;
+      return 0.5f * model->second->particleSize(
+        model->second->getTime( ) - store->getTimestamp( gid ));
+    };
+
+    uint32_t gid = 0;
+    float distance = 0.0f;
+    if ( _neuronOctree.raycast( vec3( nearPoint ) ,
+                                vec3( farPoint - nearPoint ) ,
+                                0.5f * maxSize , radius ,
+                                gid , distance ))
+    {
+      emit pickedSingle( gid );
+    }
   }
 
   void OpenGLWidget::mousePressEvent( QMouseEvent* event_ )
@@ -1366,7 +1473,9 @@ namespace visimpl
     {
       if ( _pickingPosition == event_->pos( ))
       {
-        _pickingPosition.setY( height( ) - _pickingPosition.y( ));
+        // Rows go from 0 at the top to height( ) - 1 at the bottom.
+        _pickingPosition.setY( height( ) - 1 - _pickingPosition.y( ));
+        _pickSingle( );
       }
 
       _translation = false;
@@ -1444,6 +1553,16 @@ namespace visimpl
     update( );
   }
 
+  void OpenGLWidget::setSpikeWindow(
+    std::shared_ptr< visimpl::SpikeWindow > window )
+  {
+    _spikeWindow = window;
+    _spikeWindowMargin = window ? window->margin( ) : 0.0f;
+    _spikeIndex.clear( );
+
+    _updateSpikeWindow( );
+  }
+
   void OpenGLWidget::setPlayer( simil::SpikesPlayer* p ,
                                 const simil::TDataType type )
   {
@@ -1458,6 +1577,7 @@ namespace visimpl
 
     _deltaTime = DEFAULT_DELTA_TIME;
     _player = p;
+    _spikeWindow = nullptr;
 
     InitialConfig config;
     switch ( type )
@@ -1492,6 +1612,9 @@ namespace visimpl
     createParticleSystem( );
     _initRenderToTexture( );
 
+    _spikeIndex.clear( );
+    _updateSpikeIndex( );
+
     simulationDeltaTime( std::get< T_DELTATIME >( config ));
     simulationStepsPerSecond( std::get< T_STEPS_PER_SEC >( config ));
     changeSimulationDecayValue( std::get< T_DECAY >( config ));
@@ -55,6 +55,7 @@
 #include "types.h"
 #include "render/Plane.h"
 #include "DomainManager.h"
+#include "NeuronOctree.h"
 
 class QLabel;
 
@@ -203,6 +204,14 @@ namespace visimpl
      */
     void setPlayer( simil::SpikesPlayer* p , const simil::TDataType type );
 
+    /** \brief Sets the spike window of a windowed load, its resident spikes
+     * replace those of the player data as the playback moves. Call after
+     * setPlayer().
+     * \param[in] window Spike window or nullptr.
+     *
+     */
+    void setSpikeWindow( std::shared_ptr< visimpl::SpikeWindow > window );
+
     const tGidPosMap& getGidPositions( ) const;
 
     void idleUpdate( bool idleUpdate_ = true );
@@ -391,6 +400,10 @@ namespace visimpl
 
     void _backtraceSimulation( void );
 
+    void _updateSpikeIndex( void );
+
+    void _updateSpikeWindow( void );
+
     void _initRenderToTexture( void );
 
     void _configureSimulationFrame( void );
@@ -413,6 +426,12 @@ namespace visimpl
 
     bool _updateData( bool force = false );
 
+    /** \brief Casts a ray from the camera through _pickingPosition and
+     * emits pickedSingle with the nearest neuron hit, if any.
+     *
+     */
+    void _pickSingle( void );
+
     void _createEventLabels( void );
 
     void _updateEventLabelsVisibility( void );
@@ -487,6 +506,9 @@ namespace visimpl
     bool _particleSystemInitialized;
     reto::ShaderProgram* _shaderClippingPlanes;
     simil::SpikesPlayer* _player;
+    SpikeIndex _spikeIndex;
+    std::shared_ptr< visimpl::SpikeWindow > _spikeWindow;
+    float _spikeWindowMargin;
 
     std::shared_ptr< reto::ClippingPlane > _clippingPlaneLeft;
     std::shared_ptr< reto::ClippingPlane > _clippingPlaneRight;
@@ -571,6 +593,7 @@ namespace visimpl
     QPoint _pickingPosition;
 
     tGidPosMap _gidPositions; // particle positions * scale.
+    NeuronOctree _neuronOctree; // spatial index of _gidPositions.
 
     // Render to texture
     reto::ShaderProgram* _screenPlaneShader;
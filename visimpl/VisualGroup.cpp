@@ -41,8 +41,10 @@ namespace visimpl
     , _model( std::make_shared< StaticGradientModel >(
       camera , leftPlane , rightPlane , TSizeFunction( ) , TColorVec( ) ,
       true , enableClipping , 0.0f, 1.0f ))
+    , _lod( std::make_shared< ParticleLod >( ))
     , _active( true )
   {
+    _model->setLevelOfDetail( _lod );
     _cluster->setModel( _model );
     _cluster->setRenderer( renderer );
   }
@@ -60,8 +62,11 @@ namespace visimpl
     , _model( std::make_shared< StaticGradientModel >(
       camera , leftPlane , rightPlane , TSizeFunction( ) ,
       TColorVec( ) , true , enableClipping , 0.0f, 1.5f ))
+    , _lod( std::make_shared< ParticleLod >( ))
     , _active( true )
   {
+    _model->setLevelOfDetail( _lod );
+
     TColorVec vec;
     vec.emplace_back( 0.0f , glm::vec4( 1.0f , 0.0f , 0.0f , 1.0f ));
     vec.emplace_back( 1.0f , glm::vec4( 0.4f , 0.0f , 0.0f , 1.0f ));
@@ -110,7 +115,49 @@ namespace visimpl
                                   const std::vector< NeuronParticle >& particles )
   {
     _gids = gids;
-    _cluster->setParticles( particles );
+    _culler.setParticles( particles ,
+                          _model->getParticleStore( )->getPositions( ));
+    _lod->setParticles( particles ,
+                        _model->getParticleStore( )->getPositions( ));
+    _cluster->setParticles( _culler.visible( ));
+  }
+
+  void VisualGroup::updatePositions( )
+  {
+    _culler.setPositions( _model->getParticleStore( )->getPositions( ));
+    _lod->setPositions( _model->getParticleStore( )->getPositions( ));
+    _cluster->setParticles( _culler.visible( ));
+  }
+
+  const ParticleCuller::Stats&
+  VisualGroup::cull( const std::vector< glm::vec4 >& planes , float margin )
+  {
+    if ( _culler.cull( planes , margin ))
+      _cluster->setParticles( _culler.visible( ));
+
+    return _culler.stats( );
+  }
+
+  const ParticleLod::Stats&
+  VisualGroup::selectLevelOfDetail( const glm::mat4& viewProjection ,
+                                    const std::vector< glm::vec4 >& planes ,
+                                    float margin , float threshold )
+  {
+    if ( _lod->select( viewProjection , planes , margin , threshold ))
+      _cluster->setParticles( _lod->visible( ));
+
+    return _lod->stats( );
+  }
+
+  void VisualGroup::invalidateParticles( )
+  {
+    _culler.invalidate( );
+    _lod->invalidate( );
+  }
+
+  const std::shared_ptr< ParticleLod >& VisualGroup::getLevelOfDetail( ) const
+  {
+    return _lod;
   }
 
   void
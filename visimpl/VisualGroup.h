@@ -32,6 +32,8 @@
 
 // Visimpl
 #include "visimpl/particlelab/NeuronParticle.h"
+#include "visimpl/particlelab/ParticleCuller.h"
+#include "visimpl/particlelab/ParticleLod.h"
 #include "visimpl/particlelab/StaticGradientModel.h"
 
 namespace visimpl
@@ -82,9 +84,42 @@ namespace visimpl
 
     bool active( ) const;
 
+    /**
+     * Sets the particles of the group. The model must already hold the
+     * particle store, whose positions bucket the particles for culling.
+     */
     void setParticles( const std::vector< uint32_t >& gids ,
                        const std::vector< NeuronParticle >& particles );
 
+    /**
+     * Buckets the particles again after the store positions changed.
+     */
+    void updatePositions( );
+
+    /**
+     * Culls the particles against the given planes, see ParticleCuller,
+     * uploading the visible ones to the cluster if they changed.
+     */
+    const ParticleCuller::Stats& cull( const std::vector< glm::vec4 >& planes ,
+                                       float margin );
+
+    /**
+     * Cuts the level of detail for the given camera, see ParticleLod,
+     * uploading the selected particles to the cluster if they changed.
+     */
+    const ParticleLod::Stats&
+    selectLevelOfDetail( const glm::mat4& viewProjection ,
+                         const std::vector< glm::vec4 >& planes ,
+                         float margin , float threshold );
+
+    /**
+     * Makes the next cull or selectLevelOfDetail upload the particles,
+     * after switching between them.
+     */
+    void invalidateParticles( );
+
+    const std::shared_ptr< ParticleLod >& getLevelOfDetail( ) const;
+
     void setRenderer( const std::shared_ptr< plab::Renderer >& renderer );
 
   protected:
@@ -97,6 +132,8 @@ namespace visimpl
     std::shared_ptr< StaticGradientModel > _model;
 
     std::vector< uint32_t > _gids;
+    ParticleCuller _culler;
+    std::shared_ptr< ParticleLod > _lod;
 
     bool _active;
   };
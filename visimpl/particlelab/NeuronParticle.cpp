@@ -12,16 +12,12 @@ namespace visimpl
   void NeuronParticle::enableVAOAttributes( )
   {
     glEnableVertexAttribArray( 1 );
-    glVertexAttribPointer( 1 , 3 , GL_FLOAT , GL_FALSE ,
-                           sizeof( NeuronParticle ) ,
-                           ( void* ) 0 );
+    glVertexAttribIPointer( 1 , 1 , GL_UNSIGNED_INT ,
+                            sizeof( NeuronParticle ) ,
+                            ( void* ) 0 );
     glVertexAttribDivisor( 1 , 1 );
 
-    glEnableVertexAttribArray( 2 );
-    glVertexAttribPointer( 2 , 1 , GL_FLOAT , GL_FALSE ,
-                           sizeof( NeuronParticle ) ,
-                           ( void* ) ( sizeof( float ) * 3 ));
-    glVertexAttribDivisor( 2 , 1 );
-
+    // Positions and timestamps are fetched by index. See ParticleStore,
+    // and ParticleLod for the aggregated particles.
   }
 }
\ No newline at end of file
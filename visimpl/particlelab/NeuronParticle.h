@@ -5,17 +5,16 @@
 #ifndef VISIMPL_NEURONPARTICLE_H
 #define VISIMPL_NEURONPARTICLE_H
 
-#include <limits>
-
-#include <glm/vec3.hpp>
+#include <cstdint>
 
 namespace visimpl
 {
 
   struct NeuronParticle
   {
-    glm::vec3 position;
-    float timestamp = -std::numeric_limits<float>::infinity();
+    // Slot of the neuron in the shared ParticleStore, or
+    // ParticleLod::AGGREGATE_BIT | node for an aggregated particle.
+    uint32_t index;
 
     static void enableVAOAttributes( );
 
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include "ParticleCuller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace visimpl
+{
+  constexpr uint32_t ParticleCuller::GRID_CELLS;
+
+  ParticleCuller::Stats&
+  ParticleCuller::Stats::operator+=( const Stats& other )
+  {
+    cells += other.cells;
+    visibleCells += other.visibleCells;
+    particles += other.particles;
+    visibleParticles += other.visibleParticles;
+    return *this;
+  }
+
+  ParticleCuller::ParticleCuller( )
+    : _particles( )
+    , _cells( )
+    , _visible( )
+    , _visibleCells( )
+    , _changed( true )
+    , _stats( )
+  { }
+
+  void ParticleCuller::setParticles(
+    const std::vector< NeuronParticle >& particles ,
+    const std::vector< glm::vec3 >& positions )
+  {
+    _particles.clear( );
+    _cells.clear( );
+
+    if ( !particles.empty( ))
+    {
+      glm::vec3 min = positions[ particles.front( ).index ];
+      glm::vec3 max = min;
+      for ( const auto& particle: particles )
+      {
+        min = glm::min( min , positions[ particle.index ] );
+        max = glm::max( max , positions[ particle.index ] );
+      }
+
+      const glm::vec3 extent = max - min;
+      const glm::vec3 scale(
+        extent.x > 0.0f ? GRID_CELLS / extent.x : 0.0f ,
+        extent.y > 0.0f ? GRID_CELLS / extent.y : 0.0f ,
+        extent.z > 0.0f ? GRID_CELLS / extent.z : 0.0f );
+
+      auto cellOf = [ & ]( const glm::vec3& position )
+      {
+        const glm::vec3 cell = ( position - min );
+        auto axis = [ ]( float value , float axisScale )
+        {
+          return std::min( static_cast< uint32_t >( value * axisScale ) ,
+                           GRID_CELLS - 1 );
+        };
+        return axis( cell.x , scale.x ) +
+               GRID_CELLS * ( axis( cell.y , scale.y ) +
+                              GRID_CELLS * axis( cell.z , scale.z ));
+      };
+
+      // Counting sort of the particles by cell.
+      std::vector< uint32_t > offsets( GRID_CELLS * GRID_CELLS * GRID_CELLS + 1 ,
+                                       0 );
+      for ( const auto& particle: particles )
+        ++offsets[ cellOf( positions[ particle.index ] ) + 1 ];
+
+      for ( size_t i = 1; i < offsets.size( ); ++i )
+        offsets[ i ] += offsets[ i - 1 ];
+
+      _particles.resize( particles.size( ));
+      auto cursor = offsets;
+      for ( const auto& particle: particles )
+        _particles[ cursor[ cellOf( positions[ particle.index ] ) ]++ ] =
+          particle;
+
+      for ( size_t i = 0; i + 1 < offsets.size( ); ++i )
+      {
+        if ( offsets[ i ] == offsets[ i + 1 ] ) continue;
+
+        Cell cell;
+        cell.first = offsets[ i ];
+        cell.count = offsets[ i + 1 ] - offsets[ i ];
+        cell.min = cell.max = positions[ _particles[ cell.first ].index ];
+        for ( uint32_t j = cell.first; j < cell.first + cell.count; ++j )
+        {
+          cell.min = glm::min( cell.min , positions[ _particles[ j ].index ] );
+          cell.max = glm::max( cell.max , positions[ _particles[ j ].index ] );
+        }
+
+        _cells.push_back( cell );
+      }
+    }
+
+    _visible = _particles;
+    _visibleCells.assign( _cells.size( ) , 1 );
+    _changed = true;
+
+    _stats.cells = _stats.visibleCells = _cells.size( );
+    _stats.particles = _stats.visibleParticles = _particles.size( );
+  }
+
+  void ParticleCuller::setPositions( const std::vector< glm::vec3 >& positions )
+  {
+    const auto particles = _particles;
+    setParticles( particles , positions );
+  }
+
+  const std::vector< NeuronParticle >& ParticleCuller::particles( ) const
+  {
+    return _particles;
+  }
+
+  bool ParticleCuller::cull( const std::vector< glm::vec4 >& planes ,
+                             float margin )
+  {
+    std::vector< char > visibleCells( _cells.size( ) , 1 );
+    for ( size_t i = 0; i < _cells.size( ); ++i )
+    {
+      const glm::vec3 center = ( _cells[ i ].min + _cells[ i ].max ) * 0.5f;
+      const glm::vec3 extent = ( _cells[ i ].max - _cells[ i ].min ) * 0.5f;
+
+      for ( const auto& plane: planes )
+      {
+        const glm::vec3 normal( plane.x , plane.y , plane.z );
+        const float distance = glm::dot( normal , center ) + plane.w;
+        const float radius = glm::dot( glm::abs( normal ) , extent );
+        if ( distance + radius < -margin )
+        {
+          visibleCells[ i ] = 0;
+          break;
+        }
+      }
+    }
+
+    if ( !_changed && visibleCells == _visibleCells ) return false;
+
+    _visibleCells.swap( visibleCells );
+    _changed = false;
+
+    _visible.clear( );
+    _stats.visibleCells = 0;
+    for ( size_t i = 0; i < _cells.size( ); ++i )
+    {
+      if ( !_visibleCells[ i ] ) continue;
+
+      const auto first = _particles.cbegin( ) + _cells[ i ].first;
+      _visible.insert( _visible.end( ) , first , first + _cells[ i ].count );
+      ++_stats.visibleCells;
+    }
+    _stats.visibleParticles = _visible.size( );
+
+    return true;
+  }
+
+  const std::vector< NeuronParticle >& ParticleCuller::visible( ) const
+  {
+    return _visible;
+  }
+
+  void ParticleCuller::invalidate( )
+  {
+    _changed = true;
+  }
+
+  const ParticleCuller::Stats& ParticleCuller::stats( ) const
+  {
+    return _stats;
+  }
+
+  std::vector< glm::vec4 >
+  ParticleCuller::frustumPlanes( const glm::mat4& viewProjection )
+  {
+    // Rows of the matrix, glm matrices are indexed by column.
+    glm::vec4 rows[ 4 ];
+    for ( int i = 0; i < 4; ++i )
+      rows[ i ] = glm::vec4( viewProjection[ 0 ][ i ] , viewProjection[ 1 ][ i ] ,
+                             viewProjection[ 2 ][ i ] , viewProjection[ 3 ][ i ] );
+
+    std::vector< glm::vec4 > planes;
+    planes.reserve( 6 );
+    for ( int i = 0; i < 3; ++i )
+    {
+      planes.push_back( rows[ 3 ] + rows[ i ] );
+      planes.push_back( rows[ 3 ] - rows[ i ] );
+    }
+
+    for ( auto& plane: planes )
+    {
+      const float length = glm::length( glm::vec3( plane.x , plane.y , plane.z ));
+      if ( length > 0.0f ) plane = plane / length;
+    }
+
+    return planes;
+  }
+
+}
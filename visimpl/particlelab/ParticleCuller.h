@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#ifndef VISIMPL_PARTICLECULLER_H
+#define VISIMPL_PARTICLECULLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "NeuronParticle.h"
+
+namespace visimpl
+{
+
+  /**
+   * Coarse CPU culling of the particles of a cluster.
+   *
+   * The particles are bucketed into a uniform grid over their bounds and
+   * kept in cell order, each cell storing the tight bounds of its
+   * particles. cull tests the cells against a set of planes and gathers the
+   * particles of the cells that may be visible, so the GPU doesn't process
+   * the particles the shader would clip anyway.
+   *
+   * Pure CPU, the caller uploads visible( ) when cull reports a change.
+   */
+  class ParticleCuller
+  {
+  public:
+
+    /**
+     * Grid cells per axis.
+     */
+    static constexpr uint32_t GRID_CELLS = 16;
+
+    struct Stats
+    {
+      size_t cells = 0;
+      size_t visibleCells = 0;
+      size_t particles = 0;
+      size_t visibleParticles = 0;
+
+      Stats& operator+=( const Stats& other );
+    };
+
+    ParticleCuller( );
+
+    /**
+     * Buckets the given particles. positions is indexed by particle slot,
+     * as ParticleStore::getPositions. Every particle is visible until the
+     * next cull.
+     */
+    void setParticles( const std::vector< NeuronParticle >& particles ,
+                       const std::vector< glm::vec3 >& positions );
+
+    /**
+     * Buckets the current particles again after their positions changed.
+     */
+    void setPositions( const std::vector< glm::vec3 >& positions );
+
+    /**
+     * Every particle, in cell order.
+     */
+    const std::vector< NeuronParticle >& particles( ) const;
+
+    /**
+     * Keeps the cells with some point at distance >= -margin on the
+     * positive side ( dot( plane.xyz , p ) + plane.w ) of every plane.
+     * Planes must be normalized. No planes keep every cell.
+     *
+     * @return true if the visible particles changed since the last call.
+     */
+    bool cull( const std::vector< glm::vec4 >& planes , float margin );
+
+    /**
+     * Particles of the cells kept by the last cull, in cell order.
+     */
+    const std::vector< NeuronParticle >& visible( ) const;
+
+    /**
+     * Forces the next cull to report a change.
+     */
+    void invalidate( );
+
+    /**
+     * Counts of the last cull.
+     */
+    const Stats& stats( ) const;
+
+    /**
+     * Normalized left, right, bottom, top, near and far planes of the view
+     * frustum of the given view projection matrix, pointing inwards.
+     */
+    static std::vector< glm::vec4 >
+    frustumPlanes( const glm::mat4& viewProjection );
+
+  protected:
+
+    struct Cell
+    {
+      glm::vec3 min;
+      glm::vec3 max;
+      uint32_t first;
+      uint32_t count;
+    };
+
+    std::vector< NeuronParticle > _particles;
+    std::vector< Cell > _cells;
+
+    std::vector< NeuronParticle > _visible;
+    std::vector< char > _visibleCells;
+    bool _changed;
+
+    Stats _stats;
+  };
+
+}
+
+#endif //VISIMPL_PARTICLECULLER_H
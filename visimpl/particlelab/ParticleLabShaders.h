@@ -38,70 +38,67 @@ uniform vec3 cameraRight;
 uniform float time;
 uniform float decay;
 
-uniform int gradientSize;
-uniform float gradientTimes[256];
-uniform vec4 gradientColors[256];
-
-uniform int sizeSize;
-uniform float sizeTimes[16];
-uniform float sizeValues[16];
+// Colour and size functions baked by StaticGradientModel, sampled over
+// [range.x, range.y). Outside the range particles take the last value.
+uniform sampler1D gradientLut;
+uniform vec2 gradientRange;
+uniform sampler1D sizeLut;
+uniform vec2 sizeRange;
 
 // Clipping planes
 uniform vec4 plane[2];
 out float gl_ClipDistance[2];
 
 layout(location = 0) in vec3 vertexPosition;
-layout(location = 1) in vec3 particlePosition;
-layout(location = 2) in float timestamp;
+layout(location = 1) in uint particleIndex;
+
+// Shared particle store, indexed by particleIndex.
+uniform samplerBuffer positions;
+uniform samplerBuffer timestamps;
+
+// Aggregated particles of the cluster level of detail, indexed by
+// particleIndex without AGGREGATE_BIT. See ParticleLod.
+const uint AGGREGATE_BIT = 0x80000000u;
+uniform samplerBuffer aggregatePositions;
+uniform samplerBuffer aggregateTimestamps;
 
 out vec4 color;
 out vec2 uvCoord;
 
-float sizeGradient (float t) {
-    if (sizeSize == 0) return 8.0f;
-    int first = sizeSize - 1;
-    for (int i = 0; i < sizeSize; i++) {
-        if (sizeTimes[i] > t) {
-            first = i - 1;
-            break;
-        }
+vec4 sampleLut (sampler1D lut, vec2 range, float t) {
+    int size = textureSize(lut, 0);
+    if (t >= range.x && t < range.y) {
+        // Texel centers, so that range.x and range.y hit the first and
+        // last samples.
+        float normalizedT = (t - range.x) / (range.y - range.x);
+        return texture(lut, (0.5 + normalizedT * float(size - 1)) / float(size));
     }
+    return texelFetch(lut, size - 1, 0);
+}
 
-    // Particles have the last value before they reach the first value.
-    if (first == -1 || first == sizeSize - 1)
-    return sizeValues[sizeSize - 1];
-
-    float start = sizeTimes[first];
-    float end = sizeTimes[first + 1];
-    float normalizedT = (t - start) / (end - start);
-
-    return mix(sizeValues[first], sizeValues[first + 1], normalizedT);
+float sizeGradient (float t) {
+    return sampleLut(sizeLut, sizeRange, t).r;
 }
 
 vec4 gradient (float t) {
-    if (gradientSize == 0) return vec4(1.0f, 0.0f, 1.0f, 1.0f);
-    int first = gradientSize - 1;
-    for (int i = 0; i < gradientSize; i++) {
-        if (gradientTimes[i] > t) {
-            first = i - 1;
-            break;
-        }
-    }
-
-    // Particles have the last value before they reach the first value.
-    if (first == -1 || first == gradientSize - 1)
-      return gradientColors[gradientSize - 1];
-
-    float start = gradientTimes[first];
-    float end = gradientTimes[first + 1];
-    float normalizedT = (t - start) / (end - start);
-
-    return mix(gradientColors[first], gradientColors[first + 1], normalizedT);
+    return sampleLut(gradientLut, gradientRange, t);
 }
 
 void main()
 {
-    float particleSize = sizeGradient(time - timestamp);
+    // w grows the billboard, aggregates cover their node.
+    vec4 particleData;
+    float timestamp;
+    if ((particleIndex & AGGREGATE_BIT) != 0u) {
+        int node = int(particleIndex & ~AGGREGATE_BIT);
+        particleData = texelFetch(aggregatePositions, node);
+        timestamp = texelFetch(aggregateTimestamps, node).r;
+    } else {
+        particleData = texelFetch(positions, int(particleIndex));
+        timestamp = texelFetch(timestamps, int(particleIndex)).r;
+    }
+    vec3 particlePosition = particleData.xyz;
+    float particleSize = sizeGradient(time - timestamp) + particleData.w;
     vec4 position =  vec4(
     (vertexPosition.x * particleSize * cameraRight)
     + (vertexPosition.y * particleSize * cameraUp)
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <GL/glew.h>
+
+#include "ParticleLod.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+namespace visimpl
+{
+  constexpr uint32_t ParticleLod::LEAF_SIZE;
+  constexpr uint32_t ParticleLod::MAX_DEPTH;
+  constexpr uint32_t ParticleLod::AGGREGATE_BIT;
+  constexpr float ParticleLod::DEFAULT_THRESHOLD;
+
+  namespace
+  {
+    constexpr uint32_t INVALID_INDEX = std::numeric_limits< uint32_t >::max( );
+
+    // Mean contributions are exp( ( timestamp - reference ) / decay ). The
+    // reference moves to the latest spike before they overflow a double.
+    constexpr float MEAN_REBASE_EXPONENT = 256.0f;
+
+    // Mean divides by the decay, a null one is taken as this instead.
+    constexpr float MIN_MEAN_DECAY = 1e-6f;
+  }
+
+  ParticleLod::Stats& ParticleLod::Stats::operator+=( const Stats& other )
+  {
+    nodes += other.nodes;
+    aggregates += other.aggregates;
+    particles += other.particles;
+    aggregatedParticles += other.aggregatedParticles;
+    return *this;
+  }
+
+  ParticleLod::ParticleLod( )
+    : _nodes( )
+    , _particles( )
+    , _indices( )
+    , _leaves( )
+    , _timestamps( )
+    , _aggregation( Aggregation::Max )
+    , _stale( true )
+    , _decay( 0.0f )
+    , _reference( 0.0f )
+    , _values( )
+    , _pending( )
+    , _rescan( )
+    , _pendingNodes( )
+    , _cut( )
+    , _visible( )
+    , _changed( true )
+    , _stats( )
+    , _aggregates( )
+    , _aggregatePositions( )
+    , _positionsDirty( false )
+    , _positionsBuffer( 0 )
+    , _positionsTexture( 0 )
+  { }
+
+  ParticleLod::~ParticleLod( )
+  {
+    if ( _positionsTexture != 0 ) glDeleteTextures( 1 , &_positionsTexture );
+    if ( _positionsBuffer != 0 ) glDeleteBuffers( 1 , &_positionsBuffer );
+  }
+
+  void ParticleLod::setParticles(
+    const std::vector< NeuronParticle >& particles ,
+    const std::vector< glm::vec3 >& positions )
+  {
+    _nodes.clear( );
+    _particles = particles;
+
+    std::vector< glm::vec3 > sorted;
+    sorted.reserve( _particles.size( ));
+    for ( const auto& particle: _particles )
+      sorted.push_back( positions[ particle.index ] );
+
+    if ( !_particles.empty( ))
+    {
+      Node root;
+      root.min = root.max = sorted.front( );
+      for ( const auto& position: sorted )
+      {
+        root.min = glm::min( root.min , position );
+        root.max = glm::max( root.max , position );
+      }
+      root.first = 0;
+      root.count = static_cast< uint32_t >( _particles.size( ));
+      root.children = 0;
+      root.childCount = 0;
+      root.parent = INVALID_INDEX;
+
+      _nodes.push_back( root );
+      _split( 0 , 0 , sorted );
+    }
+
+    uint32_t maxSlot = 0;
+    for ( const auto& particle: _particles )
+      maxSlot = std::max( maxSlot , particle.index );
+
+    _indices.assign( _particles.empty( ) ? 0 : maxSlot + 1 , INVALID_INDEX );
+    _leaves.resize( _particles.size( ));
+    for ( uint32_t node = 0; node < _nodes.size( ); ++node )
+    {
+      const auto& current = _nodes[ node ];
+      if ( current.childCount != 0 ) continue;
+
+      for ( uint32_t i = current.first; i < current.first + current.count; ++i )
+      {
+        _indices[ _particles[ i ].index ] = i;
+        _leaves[ i ] = node;
+      }
+    }
+
+    _aggregatePositions.clear( );
+    _aggregatePositions.reserve( _nodes.size( ));
+    for ( const auto& node: _nodes )
+    {
+      const glm::vec3 center = ( node.min + node.max ) * 0.5f;
+      const float radius = glm::length( node.max - node.min ) * 0.5f;
+      _aggregatePositions.emplace_back( center , radius );
+    }
+    _positionsDirty = true;
+
+    _timestamps.assign( _particles.size( ) ,
+                        -std::numeric_limits< float >::infinity( ));
+    _values.assign( _nodes.size( ) , 0.0 );
+    _pending.assign( _nodes.size( ) , 0 );
+    _rescan.assign( _nodes.size( ) , 0 );
+    _pendingNodes.clear( );
+    _aggregates.resize( _nodes.size( ));
+    _stale = true;
+
+    _cut.clear( );
+    _visible.clear( );
+    _changed = true;
+    _stats = Stats( );
+  }
+
+  void ParticleLod::setPositions( const std::vector< glm::vec3 >& positions )
+  {
+    const auto particles = _particles;
+    setParticles( particles , positions );
+  }
+
+  void ParticleLod::_split( uint32_t node , uint32_t depth ,
+                            std::vector< glm::vec3 >& positions )
+  {
+    // _nodes grows while splitting, nodes are accessed by index.
+    const Node parent = _nodes[ node ];
+    if ( parent.count <= LEAF_SIZE || depth >= MAX_DEPTH ||
+         parent.min == parent.max )
+      return;
+
+    const glm::vec3 center = ( parent.min + parent.max ) * 0.5f;
+    auto octant = [ & ]( const glm::vec3& position )
+    {
+      return ( position.x > center.x ? 1u : 0u ) |
+             ( position.y > center.y ? 2u : 0u ) |
+             ( position.z > center.z ? 4u : 0u );
+    };
+
+    // Counting sort of the range by octant.
+    std::array< uint32_t , 9 > offsets;
+    offsets.fill( 0 );
+    const uint32_t end = parent.first + parent.count;
+    for ( uint32_t i = parent.first; i < end; ++i )
+      ++offsets[ octant( positions[ i ] ) + 1 ];
+
+    for ( size_t i = 1; i < offsets.size( ); ++i )
+      offsets[ i ] += offsets[ i - 1 ];
+
+    std::vector< NeuronParticle > particles( parent.count );
+    std::vector< glm::vec3 > sorted( parent.count );
+    auto cursor = offsets;
+    for ( uint32_t i = parent.first; i < end; ++i )
+    {
+      const auto target = cursor[ octant( positions[ i ] ) ]++;
+      particles[ target ] = _particles[ i ];
+      sorted[ target ] = positions[ i ];
+    }
+    std::copy( particles.cbegin( ) , particles.cend( ) ,
+               _particles.begin( ) + parent.first );
+    std::copy( sorted.cbegin( ) , sorted.cend( ) ,
+               positions.begin( ) + parent.first );
+
+    const auto children = static_cast< uint32_t >( _nodes.size( ));
+    for ( uint32_t i = 0; i < 8; ++i )
+    {
+      if ( offsets[ i ] == offsets[ i + 1 ] ) continue;
+
+      Node child;
+      child.first = parent.first + offsets[ i ];
+      child.count = offsets[ i + 1 ] - offsets[ i ];
+      child.children = 0;
+      child.childCount = 0;
+      child.parent = node;
+      child.min = child.max = positions[ child.first ];
+      for ( uint32_t j = child.first; j < child.first + child.count; ++j )
+      {
+        child.min = glm::min( child.min , positions[ j ] );
+        child.max = glm::max( child.max , positions[ j ] );
+      }
+
+      _nodes.push_back( child );
+    }
+
+    _nodes[ node ].children = children;
+    _nodes[ node ].childCount =
+      static_cast< uint32_t >( _nodes.size( )) - children;
+
+    for ( uint32_t i = 0; i < _nodes[ node ].childCount; ++i )
+      _split( children + i , depth + 1 , positions );
+  }
+
+  ParticleLod::Aggregation ParticleLod::getAggregation( ) const
+  {
+    return _aggregation;
+  }
+
+  void ParticleLod::setAggregation( Aggregation aggregation )
+  {
+    if ( aggregation == _aggregation ) return;
+
+    _aggregation = aggregation;
+    _stale = true;
+  }
+
+  size_t ParticleLod::size( ) const
+  {
+    return _particles.size( );
+  }
+
+  size_t ParticleLod::nodes( ) const
+  {
+    return _nodes.size( );
+  }
+
+  double ParticleLod::_contribution( float timestamp ) const
+  {
+    if ( _aggregation == Aggregation::Max ) return timestamp;
+    if ( std::isinf( timestamp )) return 0.0;
+    return std::exp( static_cast< double >( timestamp - _reference ) / _decay );
+  }
+
+  float ParticleLod::_equivalentTimestamp( uint32_t node ) const
+  {
+    const double value = _values[ node ];
+    if ( _aggregation == Aggregation::Max )
+      return static_cast< float >( value );
+
+    // exp( -( time - t ) / decay ) equals the mean intensity for
+    // t = reference + decay * log( sum / count ), at any time.
+    if ( value <= 0.0 ) return -std::numeric_limits< float >::infinity( );
+    return _reference + _decay * static_cast< float >(
+      std::log( value / _nodes[ node ].count ));
+  }
+
+  void ParticleLod::_aggregate( uint32_t node )
+  {
+    const auto& current = _nodes[ node ];
+    double value = _aggregation == Aggregation::Max ?
+                   -std::numeric_limits< double >::infinity( ) : 0.0;
+
+    if ( current.childCount == 0 )
+    {
+      for ( uint32_t i = current.first; i < current.first + current.count; ++i )
+      {
+        const double contribution = _contribution( _timestamps[ i ] );
+        value = _aggregation == Aggregation::Max ?
+                std::max( value , contribution ) : value + contribution;
+      }
+    }
+    else
+    {
+      for ( uint32_t i = 0; i < current.childCount; ++i )
+      {
+        const double child = _values[ current.children + i ];
+        value = _aggregation == Aggregation::Max ?
+                std::max( value , child ) : value + child;
+      }
+    }
+
+    _values[ node ] = value;
+
+    const float timestamp = _equivalentTimestamp( node );
+    if ( timestamp != _aggregates.get( node ))
+      _aggregates.set( node , timestamp );
+  }
+
+  void ParticleLod::_recompute( const TimestampBuffer& timestamps ,
+                                float decay )
+  {
+    const auto& values = timestamps.getTimestamps( );
+    for ( uint32_t i = 0; i < _particles.size( ); ++i )
+      _timestamps[ i ] = _particles[ i ].index < values.size( ) ?
+                         values[ _particles[ i ].index ] :
+                         -std::numeric_limits< float >::infinity( );
+
+    _decay = decay;
+    _reference = 0.0f;
+    if ( !_timestamps.empty( ))
+    {
+      const float latest =
+        *std::max_element( _timestamps.cbegin( ) , _timestamps.cend( ));
+      if ( !std::isinf( latest )) _reference = latest;
+    }
+
+    // Children are stored after their parents.
+    for ( uint32_t node = static_cast< uint32_t >( _nodes.size( )); node > 0; )
+      _aggregate( --node );
+
+    std::fill( _rescan.begin( ) , _rescan.end( ) , 0 );
+    _stale = false;
+  }
+
+  void ParticleLod::update( const TimestampBuffer& timestamps , float decay )
+  {
+    if ( _nodes.empty( )) return;
+
+    decay = std::max( decay , MIN_MEAN_DECAY );
+    const bool meanDecayChanged =
+      _aggregation == Aggregation::Mean && decay != _decay;
+    if ( _stale || meanDecayChanged || timestamps.isFullyDirty( ))
+    {
+      _recompute( timestamps , decay );
+      return;
+    }
+
+    const auto& values = timestamps.getTimestamps( );
+    for ( const auto slot: timestamps.getDirty( ))
+    {
+      if ( slot >= _indices.size( ) || _indices[ slot ] == INVALID_INDEX )
+        continue;
+
+      const auto index = _indices[ slot ];
+      const float timestamp = values[ slot ];
+      const float previous = _timestamps[ index ];
+      if ( timestamp == previous ) continue;
+
+      const auto leaf = _leaves[ index ];
+      if ( _aggregation == Aggregation::Max )
+      {
+        // A later spike raises the leaf, losing its latest spike needs a
+        // rescan.
+        if ( timestamp >= _values[ leaf ] )
+          _values[ leaf ] = timestamp;
+        else if ( previous >= _values[ leaf ] )
+          _rescan[ leaf ] = 1;
+      }
+      else
+      {
+        if ( !std::isinf( timestamp ) &&
+             ( timestamp - _reference ) / _decay > MEAN_REBASE_EXPONENT )
+        {
+          _recompute( timestamps , decay );
+          return;
+        }
+
+        _values[ leaf ] = std::max( 0.0 , _values[ leaf ] +
+                                          _contribution( timestamp ) -
+                                          _contribution( previous ));
+      }
+      _timestamps[ index ] = timestamp;
+
+      for ( auto node = leaf; node != INVALID_INDEX && !_pending[ node ];
+            node = _nodes[ node ].parent )
+      {
+        _pending[ node ] = 1;
+        _pendingNodes.push_back( node );
+      }
+    }
+
+    // Children before parents.
+    std::sort( _pendingNodes.begin( ) , _pendingNodes.end( ) ,
+               std::greater< uint32_t >( ));
+    for ( const auto node: _pendingNodes )
+    {
+      if ( _nodes[ node ].childCount != 0 || _rescan[ node ] )
+      {
+        _aggregate( node );
+      }
+      else
+      {
+        const float timestamp = _equivalentTimestamp( node );
+        if ( timestamp != _aggregates.get( node ))
+          _aggregates.set( node , timestamp );
+      }
+      _pending[ node ] = 0;
+      _rescan[ node ] = 0;
+    }
+    _pendingNodes.clear( );
+  }
+
+  float ParticleLod::getAggregate( uint32_t node ) const
+  {
+    return _aggregates.get( node );
+  }
+
+  bool ParticleLod::select( const glm::mat4& viewProjection ,
+                            const std::vector< glm::vec4 >& planes ,
+                            float margin , float threshold )
+  {
+    // Last row of the matrix: the clip space w of a point.
+    const glm::vec4 row( viewProjection[ 0 ][ 3 ] , viewProjection[ 1 ][ 3 ] ,
+                         viewProjection[ 2 ][ 3 ] , viewProjection[ 3 ][ 3 ] );
+
+    std::vector< uint32_t > cut;
+    std::vector< uint32_t > stack;
+    if ( !_nodes.empty( )) stack.push_back( 0 );
+
+    while ( !stack.empty( ))
+    {
+      const auto node = stack.back( );
+      stack.pop_back( );
+
+      const auto& current = _nodes[ node ];
+      const glm::vec3 center = ( current.min + current.max ) * 0.5f;
+      const glm::vec3 extent = ( current.max - current.min ) * 0.5f;
+
+      bool outside = false;
+      for ( const auto& plane: planes )
+      {
+        const glm::vec3 normal( plane.x , plane.y , plane.z );
+        const float distance = glm::dot( normal , center ) + plane.w;
+        if ( distance + glm::dot( glm::abs( normal ) , extent ) < -margin )
+        {
+          outside = true;
+          break;
+        }
+      }
+      if ( outside ) continue;
+
+      const float radius = glm::length( extent );
+      const float w = glm::dot( glm::vec3( row.x , row.y , row.z ) , center ) +
+                      row.w;
+      if ( w > radius && radius < threshold * w )
+        cut.push_back( node | AGGREGATE_BIT );
+      else if ( current.childCount == 0 )
+        cut.push_back( node );
+      else
+        for ( uint32_t i = current.childCount; i > 0; --i )
+          stack.push_back( current.children + i - 1 );
+    }
+
+    if ( !_changed && cut == _cut ) return false;
+
+    _cut.swap( cut );
+    _changed = false;
+
+    _visible.clear( );
+    _stats = Stats( );
+    _stats.nodes = _nodes.size( );
+    for ( const auto entry: _cut )
+    {
+      const auto& node = _nodes[ entry & ~AGGREGATE_BIT ];
+      if ( entry & AGGREGATE_BIT )
+      {
+        _visible.push_back( NeuronParticle{ entry } );
+        ++_stats.aggregates;
+        _stats.aggregatedParticles += node.count;
+      }
+      else
+      {
+        const auto first = _particles.cbegin( ) + node.first;
+        _visible.insert( _visible.end( ) , first , first + node.count );
+        _stats.particles += node.count;
+      }
+    }
+
+    return true;
+  }
+
+  const std::vector< NeuronParticle >& ParticleLod::visible( ) const
+  {
+    return _visible;
+  }
+
+  const ParticleLod::Stats& ParticleLod::stats( ) const
+  {
+    return _stats;
+  }
+
+  void ParticleLod::invalidate( )
+  {
+    _stale = true;
+    _changed = true;
+  }
+
+  void ParticleLod::flush( )
+  {
+    if ( _positionsDirty )
+    {
+      if ( _positionsBuffer == 0 )
+      {
+        glGenBuffers( 1 , &_positionsBuffer );
+        glGenTextures( 1 , &_positionsTexture );
+      }
+
+      glBindBuffer( GL_TEXTURE_BUFFER , _positionsBuffer );
+      glBufferData( GL_TEXTURE_BUFFER ,
+                    _aggregatePositions.size( ) * sizeof( glm::vec4 ) ,
+                    _aggregatePositions.data( ) , GL_STATIC_DRAW );
+      glBindBuffer( GL_TEXTURE_BUFFER , 0 );
+
+      glBindTexture( GL_TEXTURE_BUFFER , _positionsTexture );
+      glTexBuffer( GL_TEXTURE_BUFFER , GL_RGBA32F , _positionsBuffer );
+      glBindTexture( GL_TEXTURE_BUFFER , 0 );
+
+      _positionsDirty = false;
+    }
+
+    if ( _aggregates.isDirty( )) _aggregates.flush( );
+  }
+
+  unsigned int ParticleLod::getPositionsTexture( ) const
+  {
+    return _positionsTexture;
+  }
+
+  unsigned int ParticleLod::getTimestampsTexture( ) const
+  {
+    return _aggregates.getTexture( );
+  }
+
+}
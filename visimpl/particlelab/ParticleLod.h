@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#ifndef VISIMPL_PARTICLELOD_H
+#define VISIMPL_PARTICLELOD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include "NeuronParticle.h"
+#include "TimestampBuffer.h"
+
+namespace visimpl
+{
+
+  /**
+   * Level of detail of the particles of a cluster.
+   *
+   * The particles are sorted into an octree. Every node has an aggregated
+   * particle at the center of its bounds whose timestamp summarizes the
+   * activity of its neurons, so the vertex shader colours and sizes it as
+   * any other particle. select cuts the tree: nodes that look small from
+   * the camera are drawn as their aggregated particle, the rest are refined
+   * down to the leaves, whose neurons are drawn one by one.
+   *
+   * Aggregates are updated from the dirty slots of the store timestamps,
+   * so a frame only pays for the leaves that received spikes and their
+   * ancestors.
+   *
+   * Aggregated particles are referenced by the selected NeuronParticles as
+   * AGGREGATE_BIT | node. Their positions and timestamps live in two texture
+   * buffers of their own, the xyz of a position is the node center and w
+   * the radius added to the size of the billboard.
+   */
+  class ParticleLod
+  {
+  public:
+
+    /**
+     * Particles below which a node is not split.
+     */
+    static constexpr uint32_t LEAF_SIZE = 32;
+
+    /**
+     * Depth after which nodes are not split.
+     */
+    static constexpr uint32_t MAX_DEPTH = 16;
+
+    /**
+     * Marks the particle indices that reference an aggregated particle.
+     */
+    static constexpr uint32_t AGGREGATE_BIT = 0x80000000u;
+
+    /**
+     * Nodes whose bounding radius is below this fraction of their clip
+     * space w are aggregated.
+     */
+    static constexpr float DEFAULT_THRESHOLD = 0.01f;
+
+    enum class Aggregation
+    {
+      // Latest spike of the node: the activity of its most active neuron.
+      Max = 0 ,
+      // Mean of the decayed intensities exp( -age / decay ) of the neurons.
+      Mean
+    };
+
+    struct Stats
+    {
+      size_t nodes = 0;
+      size_t aggregates = 0;
+      size_t particles = 0;
+      size_t aggregatedParticles = 0;
+
+      Stats& operator+=( const Stats& other );
+    };
+
+    ParticleLod( );
+
+    ~ParticleLod( );
+
+    ParticleLod( const ParticleLod& ) = delete;
+
+    ParticleLod& operator=( const ParticleLod& ) = delete;
+
+    /**
+     * Builds the tree over the given particles. positions is indexed by
+     * particle slot, as ParticleStore::getPositions. Aggregates are
+     * recomputed by the next update.
+     */
+    void setParticles( const std::vector< NeuronParticle >& particles ,
+                       const std::vector< glm::vec3 >& positions );
+
+    /**
+     * Builds the tree again after the positions of the particles changed.
+     */
+    void setPositions( const std::vector< glm::vec3 >& positions );
+
+    Aggregation getAggregation( ) const;
+
+    void setAggregation( Aggregation aggregation );
+
+    size_t size( ) const;
+
+    size_t nodes( ) const;
+
+    /**
+     * Updates the aggregates from the dirty slots of the store timestamps.
+     * Must be called before the store flushes them. Everything is
+     * recomputed if the whole buffer is dirty, the tree or the aggregation
+     * changed, or the decay used by Mean changed. Decays under a
+     * microsecond are clamped, Mean divides by them.
+     */
+    void update( const TimestampBuffer& timestamps , float decay );
+
+    /**
+     * Timestamp of the aggregated particle of the given node.
+     */
+    float getAggregate( uint32_t node ) const;
+
+    /**
+     * Cuts the tree for the given camera. Nodes fully outside some plane,
+     * as in ParticleCuller::cull, are skipped. A node is aggregated if its
+     * bounding radius is below threshold times its clip space w.
+     *
+     * @return true if the selected particles changed since the last call.
+     */
+    bool select( const glm::mat4& viewProjection ,
+                 const std::vector< glm::vec4 >& planes ,
+                 float margin , float threshold );
+
+    /**
+     * Particles and aggregated particles kept by the last select.
+     */
+    const std::vector< NeuronParticle >& visible( ) const;
+
+    const Stats& stats( ) const;
+
+    /**
+     * Forces the next update to recompute every aggregate and the next
+     * select to report a change, e.g. after updates were skipped.
+     */
+    void invalidate( );
+
+    /**
+     * Uploads the aggregate positions and the changed aggregate timestamps.
+     * A GL context must be current.
+     */
+    void flush( );
+
+    unsigned int getPositionsTexture( ) const;
+
+    unsigned int getTimestampsTexture( ) const;
+
+  protected:
+
+    struct Node
+    {
+      glm::vec3 min;
+      glm::vec3 max;
+      uint32_t first;
+      uint32_t count;
+      // Index of the first child, children are consecutive and always
+      // stored after their parent. 0 on leaves.
+      uint32_t children;
+      uint32_t childCount;
+      uint32_t parent;
+    };
+
+    void _split( uint32_t node , uint32_t depth ,
+                 std::vector< glm::vec3 >& positions );
+
+    void _recompute( const TimestampBuffer& timestamps , float decay );
+
+    void _aggregate( uint32_t node );
+
+    double _contribution( float timestamp ) const;
+
+    float _equivalentTimestamp( uint32_t node ) const;
+
+    std::vector< Node > _nodes;
+    std::vector< NeuronParticle > _particles;
+
+    // Slot -> index of the particle in _particles, INVALID_INDEX if the
+    // slot isn't in the cluster.
+    std::vector< uint32_t > _indices;
+    // Leaf of every particle, and the timestamp it was aggregated with.
+    std::vector< uint32_t > _leaves;
+    std::vector< float > _timestamps;
+
+    Aggregation _aggregation;
+    bool _stale;
+    float _decay;
+    // Mean sums exp( ( timestamp - _reference ) / decay ).
+    float _reference;
+
+    // Per node: latest timestamp (Max) or sum of contributions (Mean).
+    std::vector< double > _values;
+    std::vector< char > _pending;
+    std::vector< char > _rescan;
+    std::vector< uint32_t > _pendingNodes;
+
+    std::vector< uint32_t > _cut;
+    std::vector< NeuronParticle > _visible;
+    bool _changed;
+    Stats _stats;
+
+    TimestampBuffer _aggregates;
+    std::vector< glm::vec4 > _aggregatePositions;
+    bool _positionsDirty;
+    unsigned int _positionsBuffer;
+    unsigned int _positionsTexture;
+  };
+
+}
+
+#endif //VISIMPL_PARTICLELOD_H
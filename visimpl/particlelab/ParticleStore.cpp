@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <GL/glew.h>
+
+#include "ParticleStore.h"
+
+#include <algorithm>
+
+#include <glm/vec4.hpp>
+
+namespace visimpl
+{
+
+  ParticleStore::ParticleStore( )
+    : _gids( )
+    , _slots( )
+    , _positions( )
+    , _timestamps( )
+    , _positionsBuffer( 0 )
+    , _positionsTexture( 0 )
+  {
+  }
+
+  ParticleStore::~ParticleStore( )
+  {
+    if ( _positionsTexture != 0 ) glDeleteTextures( 1 , &_positionsTexture );
+    if ( _positionsBuffer != 0 ) glDeleteBuffers( 1 , &_positionsBuffer );
+  }
+
+  bool ParticleStore::setPositions(
+    const std::unordered_map< unsigned int , glm::vec3 >& positions )
+  {
+    std::vector< uint32_t > gids;
+    gids.reserve( positions.size( ));
+    for ( const auto& item: positions )
+      gids.push_back( item.first );
+    std::sort( gids.begin( ) , gids.end( ));
+
+    const bool changed = gids != _gids;
+    if ( changed )
+    {
+      _gids = std::move( gids );
+      _slots.assign( _gids.empty( ) ? 0 : _gids.back( ) + 1 , INVALID_SLOT );
+      for ( uint32_t slot = 0; slot < _gids.size( ); ++slot )
+        _slots[ _gids[ slot ]] = slot;
+
+      _timestamps.resize( _gids.size( ));
+    }
+
+    _positions.resize( _gids.size( ));
+    for ( uint32_t slot = 0; slot < _gids.size( ); ++slot )
+      _positions[ slot ] = positions.at( _gids[ slot ] );
+
+    uploadPositions( );
+
+    return changed;
+  }
+
+  void ParticleStore::uploadPositions( )
+  {
+    if ( _positionsBuffer == 0 )
+    {
+      glGenBuffers( 1 , &_positionsBuffer );
+      glGenTextures( 1 , &_positionsTexture );
+    }
+
+    // RGB32F texture buffers need GL 4.0, pad to RGBA to stay on 3.3.
+    // The shader adds w to the particle size, neurons don't grow.
+    std::vector< glm::vec4 > padded;
+    padded.reserve( _positions.size( ));
+    for ( const auto& position: _positions )
+      padded.emplace_back( position , 0.0f );
+
+    glBindBuffer( GL_TEXTURE_BUFFER , _positionsBuffer );
+    glBufferData( GL_TEXTURE_BUFFER , padded.size( ) * sizeof( glm::vec4 ) ,
+                  padded.data( ) , GL_STATIC_DRAW );
+    glBindBuffer( GL_TEXTURE_BUFFER , 0 );
+
+    glBindTexture( GL_TEXTURE_BUFFER , _positionsTexture );
+    glTexBuffer( GL_TEXTURE_BUFFER , GL_RGBA32F , _positionsBuffer );
+    glBindTexture( GL_TEXTURE_BUFFER , 0 );
+  }
+
+  size_t ParticleStore::size( ) const
+  {
+    return _gids.size( );
+  }
+
+  uint32_t ParticleStore::getGid( uint32_t slot ) const
+  {
+    return _gids.at( slot );
+  }
+
+  const std::vector< uint32_t >& ParticleStore::getGids( ) const
+  {
+    return _gids;
+  }
+
+  const glm::vec3& ParticleStore::getPosition( uint32_t slot ) const
+  {
+    return _positions.at( slot );
+  }
+
+  const std::vector< glm::vec3 >& ParticleStore::getPositions( ) const
+  {
+    return _positions;
+  }
+
+  float ParticleStore::getTimestamp( uint32_t gid ) const
+  {
+    const auto slot = getSlot( gid );
+    if ( slot == INVALID_SLOT )
+      return -std::numeric_limits< float >::infinity( );
+    return _timestamps.get( slot );
+  }
+
+  TimestampBuffer& ParticleStore::getTimestamps( )
+  {
+    return _timestamps;
+  }
+
+  const TimestampBuffer& ParticleStore::getTimestamps( ) const
+  {
+    return _timestamps;
+  }
+
+  unsigned int ParticleStore::getPositionsTexture( ) const
+  {
+    return _positionsTexture;
+  }
+
+  unsigned int ParticleStore::getTimestampsTexture( ) const
+  {
+    return _timestamps.getTexture( );
+  }
+
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#ifndef VISIMPL_PARTICLESTORE_H
+#define VISIMPL_PARTICLESTORE_H
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "TimestampBuffer.h"
+
+namespace visimpl
+{
+
+  /**
+   * Structure-of-arrays storage of every neuron of the circuit.
+   *
+   * Each neuron owns one slot. Positions and spike timestamps are kept in
+   * two separate arrays indexed by slot, both mirrored on the GPU as texture
+   * buffers. Clusters (selection, groups, attributes) only store the slots
+   * of their neurons, so overlapping clusters share the same data.
+   *
+   * Slots are assigned in ascending GID order, so they are stable as long
+   * as the set of GIDs doesn't change.
+   */
+  class ParticleStore
+  {
+  public:
+
+    static constexpr uint32_t INVALID_SLOT =
+      std::numeric_limits< uint32_t >::max( );
+
+    ParticleStore( );
+
+    ~ParticleStore( );
+
+    ParticleStore( const ParticleStore& ) = delete;
+
+    ParticleStore& operator=( const ParticleStore& ) = delete;
+
+    /**
+     * Rebuilds the store from the given positions and uploads them.
+     * Timestamps are reset only if the set of GIDs changes.
+     * A GL context must be current.
+     *
+     * @return true if the set of GIDs (and therefore the slots) changed.
+     */
+    bool setPositions(
+      const std::unordered_map< unsigned int , glm::vec3 >& positions );
+
+    size_t size( ) const;
+
+    uint32_t getSlot( uint32_t gid ) const
+    {
+      return gid < _slots.size( ) ? _slots[ gid ] : INVALID_SLOT;
+    }
+
+    uint32_t getGid( uint32_t slot ) const;
+
+    const std::vector< uint32_t >& getGids( ) const;
+
+    const glm::vec3& getPosition( uint32_t slot ) const;
+
+    const std::vector< glm::vec3 >& getPositions( ) const;
+
+    /**
+     * Timestamp of the given GID's last registered spike.
+     * -infinity if the neuron hasn't spiked or isn't stored.
+     */
+    float getTimestamp( uint32_t gid ) const;
+
+    TimestampBuffer& getTimestamps( );
+
+    const TimestampBuffer& getTimestamps( ) const;
+
+    unsigned int getPositionsTexture( ) const;
+
+    unsigned int getTimestampsTexture( ) const;
+
+  protected:
+
+    void uploadPositions( );
+
+    std::vector< uint32_t > _gids;
+    std::vector< uint32_t > _slots;
+    std::vector< glm::vec3 > _positions;
+
+    TimestampBuffer _timestamps;
+
+    unsigned int _positionsBuffer;
+    unsigned int _positionsTexture;
+  };
+
+}
+
+#endif //VISIMPL_PARTICLESTORE_H
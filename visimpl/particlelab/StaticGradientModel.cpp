@@ -10,10 +10,89 @@
 #include "StaticGradientModel.h"
 
 #include <QDebug>
+#include <algorithm>
 #include <cmath>
 
 namespace visimpl
 {
+  constexpr int StaticGradientModel::LUT_SIZE;
+
+  // Size of the particles if there is no size function.
+  constexpr float DEFAULT_SHADER_SIZE = 8.0f;
+
+  // Colour of the particles if there is no gradient.
+  const glm::vec4 DEFAULT_SHADER_COLOR( 1.0f , 0.0f , 1.0f , 1.0f );
+
+  namespace
+  {
+    // Piecewise linear function through the given points, sorted by time.
+    template< typename T >
+    T evaluate( const std::vector< std::pair< float , T >>& points , float t ,
+                const T& fallback )
+    {
+      const int count = static_cast< int >( points.size( ));
+      if ( count == 0 ) return fallback;
+
+      int first = count - 1;
+      for ( int i = 0; i < count; ++i )
+      {
+        if ( points[ i ].first > t )
+        {
+          first = i - 1;
+          break;
+        }
+      }
+
+      // Particles have the last value before they reach the first value.
+      if ( first == -1 || first == count - 1 )
+        return points[ count - 1 ].second;
+
+      const auto& start = points[ first ];
+      const auto& end = points[ first + 1 ];
+      const float normalized = ( t - start.first ) / ( end.first - start.first );
+
+      return start.second + ( end.second - start.second ) * normalized;
+    }
+
+    // Samples the function at LUT_SIZE evenly spaced times of its range.
+    // Outside the range the shader takes the last sample.
+    template< typename T >
+    glm::vec2 bake( const std::vector< std::pair< float , T >>& points ,
+                    const T& fallback , std::vector< T >& lut )
+    {
+      const int size = StaticGradientModel::LUT_SIZE;
+      glm::vec2 range( 0.0f , 0.0f );
+      if ( !points.empty( ))
+        range = glm::vec2( points.front( ).first , points.back( ).first );
+
+      lut.resize( size );
+      for ( int i = 0; i < size; ++i )
+      {
+        const float t = range.x + ( range.y - range.x ) * i / ( size - 1 );
+        lut[ i ] = evaluate( points , t , fallback );
+      }
+      // The end of the range is the last value, even if the function
+      // wouldn't reach it.
+      lut[ size - 1 ] = points.empty( ) ? fallback : points.back( ).second;
+
+      return range;
+    }
+
+    void uploadLut( unsigned int& texture , GLint internalFormat ,
+                    GLenum format , const float* data )
+    {
+      if ( texture == 0 ) glGenTextures( 1 , &texture );
+
+      glBindTexture( GL_TEXTURE_1D , texture );
+      glTexImage1D( GL_TEXTURE_1D , 0 , internalFormat ,
+                    StaticGradientModel::LUT_SIZE , 0 , format , GL_FLOAT ,
+                    data );
+      glTexParameteri( GL_TEXTURE_1D , GL_TEXTURE_MIN_FILTER , GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_1D , GL_TEXTURE_MAG_FILTER , GL_LINEAR );
+      glTexParameteri( GL_TEXTURE_1D , GL_TEXTURE_WRAP_S , GL_CLAMP_TO_EDGE );
+      glBindTexture( GL_TEXTURE_1D , 0 );
+    }
+  }
 
   StaticGradientModel::StaticGradientModel(
     const std::shared_ptr< plab::ICamera >& camera ,
@@ -34,8 +113,37 @@ namespace visimpl
     , _clippingEnabled( clippingEnabled )
     , _time( time )
     , _decay( decay )
+    , _store( nullptr )
+    , _lod( nullptr )
+    , _gradientLut( )
+    , _gradientRange( 0.0f , 0.0f )
+    , _sizeLut( )
+    , _sizeRange( 0.0f , 0.0f )
+    , _gradientTexture( 0 )
+    , _sizeTexture( 0 )
+    , _gradientDirty( true )
+    , _sizeDirty( true )
+  {
+    _bakeGradient( );
+    _bakeSizes( );
+  }
+
+  StaticGradientModel::~StaticGradientModel( )
   {
+    if ( _gradientTexture != 0 ) glDeleteTextures( 1 , &_gradientTexture );
+    if ( _sizeTexture != 0 ) glDeleteTextures( 1 , &_sizeTexture );
+  }
+
+  void StaticGradientModel::_bakeGradient( )
+  {
+    _gradientRange = bake( _gradient , DEFAULT_SHADER_COLOR , _gradientLut );
+    _gradientDirty = true;
+  }
 
+  void StaticGradientModel::_bakeSizes( )
+  {
+    _sizeRange = bake( _particleSize , DEFAULT_SHADER_SIZE , _sizeLut );
+    _sizeDirty = true;
   }
 
   const std::shared_ptr< reto::ClippingPlane >&
@@ -70,6 +178,23 @@ namespace visimpl
   void StaticGradientModel::setParticleSize( const TSizeFunction& particleSize )
   {
     _particleSize = particleSize;
+    _bakeSizes( );
+  }
+
+  float StaticGradientModel::particleSize( float age ) const
+  {
+    return evaluate( _particleSize , age , DEFAULT_SHADER_SIZE );
+  }
+
+  float StaticGradientModel::maxParticleSize( ) const
+  {
+    if ( _particleSize.empty( )) return DEFAULT_SHADER_SIZE;
+
+    float size = _particleSize.front( ).second;
+    for ( const auto& item: _particleSize )
+      size = std::max( size , item.second );
+
+    return size;
   }
 
   const TColorVec& StaticGradientModel::getGradient( ) const
@@ -77,9 +202,35 @@ namespace visimpl
     return _gradient;
   }
 
+  glm::vec4 StaticGradientModel::gradientColor( float t ) const
+  {
+    return evaluate( _gradient , t , DEFAULT_SHADER_COLOR );
+  }
+
   void StaticGradientModel::setGradient( const TColorVec& gradient )
   {
     _gradient = gradient;
+    _bakeGradient( );
+  }
+
+  const std::vector< glm::vec4 >& StaticGradientModel::getGradientLut( ) const
+  {
+    return _gradientLut;
+  }
+
+  const glm::vec2& StaticGradientModel::getGradientRange( ) const
+  {
+    return _gradientRange;
+  }
+
+  const std::vector< float >& StaticGradientModel::getSizeLut( ) const
+  {
+    return _sizeLut;
+  }
+
+  const glm::vec2& StaticGradientModel::getSizeRange( ) const
+  {
+    return _sizeRange;
   }
 
   bool StaticGradientModel::isParticleVisibility( ) const
@@ -127,58 +278,80 @@ namespace visimpl
     _decay = decay;
   }
 
+  const std::shared_ptr< ParticleStore >&
+  StaticGradientModel::getParticleStore( ) const
+  {
+    return _store;
+  }
+
+  void StaticGradientModel::setParticleStore(
+    const std::shared_ptr< ParticleStore >& store )
+  {
+    _store = store;
+  }
+
+  const std::shared_ptr< ParticleLod >&
+  StaticGradientModel::getLevelOfDetail( ) const
+  {
+    return _lod;
+  }
+
+  void StaticGradientModel::setLevelOfDetail(
+    const std::shared_ptr< ParticleLod >& lod )
+  {
+    _lod = lod;
+  }
+
   void
   StaticGradientModel::uploadDrawUniforms( plab::UniformCache& cache ) const
   {
-    constexpr int MAX_COLORS = 256;
-    constexpr int MAX_SIZES = 16;
-
     CameraModel::uploadDrawUniforms( cache );
 
     glUniform1f( cache.getLocation( "time" ) , _time );
     glUniform1f( cache.getLocation( "decay" ) , _decay );
 
-
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_BUFFER ,
+                   _store ? _store->getPositionsTexture( ) : 0 );
+    glUniform1i( cache.getLocation( "positions" ) , 0 );
+    glActiveTexture( GL_TEXTURE1 );
+    glBindTexture( GL_TEXTURE_BUFFER ,
+                   _store ? _store->getTimestampsTexture( ) : 0 );
+    glUniform1i( cache.getLocation( "timestamps" ) , 1 );
+    glActiveTexture( GL_TEXTURE2 );
+    glBindTexture( GL_TEXTURE_BUFFER ,
+                   _lod ? _lod->getPositionsTexture( ) : 0 );
+    glUniform1i( cache.getLocation( "aggregatePositions" ) , 2 );
+    glActiveTexture( GL_TEXTURE3 );
+    glBindTexture( GL_TEXTURE_BUFFER ,
+                   _lod ? _lod->getTimestampsTexture( ) : 0 );
+    glUniform1i( cache.getLocation( "aggregateTimestamps" ) , 3 );
+
+    // Lookup tables only go to the GPU after the functions change.
+    if ( _gradientDirty )
     {
-      int maxSize = std::min( MAX_SIZES ,
-                              static_cast<int>(_particleSize.size( )));
-      glUniform1i( cache.getLocation( "sizeSize" ) , maxSize );
-
-      float timeStamps[MAX_SIZES];
-      float values[MAX_SIZES];
-
-      for ( int i = 0; i < maxSize; i++ )
-      {
-        auto& item = _particleSize.at( i );
-        timeStamps[ i ] = item.first;
-        values[ i ] = item.second;
-      }
-
-      glUniform1fv( cache.getLocation( "sizeTimes" ) , maxSize ,
-                    timeStamps );
-      glUniform1fv( cache.getLocation( "sizeValues" ) , maxSize , values );
+      uploadLut( _gradientTexture , GL_RGBA32F , GL_RGBA ,
+                 reinterpret_cast< const float* >( _gradientLut.data( )));
+      _gradientDirty = false;
     }
-
+    if ( _sizeDirty )
     {
-      int maxSize = std::min( MAX_COLORS , static_cast<int>(_gradient.size( )));
-      glUniform1i( cache.getLocation( "gradientSize" ) , maxSize );
-
-      float timeStamps[MAX_COLORS];
-      glm::vec4 colors[MAX_COLORS];
-
-      for ( int i = 0; i < maxSize; i++ )
-      {
-        auto& item = _gradient.at( i );
-        timeStamps[ i ] = item.first;
-        colors[ i ] = item.second;
-      }
-
-      glUniform1fv( cache.getLocation( "gradientTimes" ) , maxSize ,
-                    timeStamps );
-      glUniform4fv( cache.getLocation( "gradientColors" ) , maxSize ,
-                    (float*)colors );
+      uploadLut( _sizeTexture , GL_R32F , GL_RED , _sizeLut.data( ));
+      _sizeDirty = false;
     }
 
+    glActiveTexture( GL_TEXTURE4 );
+    glBindTexture( GL_TEXTURE_1D , _gradientTexture );
+    glUniform1i( cache.getLocation( "gradientLut" ) , 4 );
+    glUniform2f( cache.getLocation( "gradientRange" ) ,
+                 _gradientRange.x , _gradientRange.y );
+    glActiveTexture( GL_TEXTURE5 );
+    glBindTexture( GL_TEXTURE_1D , _sizeTexture );
+    glUniform1i( cache.getLocation( "sizeLut" ) , 5 );
+    glUniform2f( cache.getLocation( "sizeRange" ) ,
+                 _sizeRange.x , _sizeRange.y );
+    glActiveTexture( GL_TEXTURE0 );
+
     glUniform1f( cache.getLocation( "particlePreVisibility" ) ,
                  _particleVisibility ? 1.0f : 0.0f );
 
@@ -7,8 +7,12 @@
 
 #include <sumrice/types.h>
 #include <reto/ClippingSystem.h>
+#include <glm/vec2.hpp>
 #include <glm/vec4.hpp>
 
+#include "ParticleLod.h"
+#include "ParticleStore.h"
+
 namespace visimpl
 {
 
@@ -25,8 +29,33 @@ namespace visimpl
     float _time;
     float _decay;
 
+    std::shared_ptr< ParticleStore > _store;
+    std::shared_ptr< ParticleLod > _lod;
+
+    // Gradient and size functions baked into lookup tables covering the
+    // range between their first and last times. Uploaded on the next draw
+    // after they change.
+    std::vector< glm::vec4 > _gradientLut;
+    glm::vec2 _gradientRange;
+    std::vector< float > _sizeLut;
+    glm::vec2 _sizeRange;
+
+    mutable unsigned int _gradientTexture;
+    mutable unsigned int _sizeTexture;
+    mutable bool _gradientDirty;
+    mutable bool _sizeDirty;
+
+    void _bakeGradient( );
+
+    void _bakeSizes( );
+
   public:
 
+    /**
+     * Samples of the gradient and size lookup tables.
+     */
+    static constexpr int LUT_SIZE = 1024;
+
     StaticGradientModel(
       const std::shared_ptr< plab::ICamera >& camera ,
       const std::shared_ptr< reto::ClippingPlane >& leftPlane ,
@@ -38,6 +67,12 @@ namespace visimpl
       float time,
       float decay);
 
+    ~StaticGradientModel( );
+
+    StaticGradientModel( const StaticGradientModel& ) = delete;
+
+    StaticGradientModel& operator=( const StaticGradientModel& ) = delete;
+
     const std::shared_ptr< reto::ClippingPlane >& getLeftPlane( ) const;
 
     void
@@ -52,10 +87,35 @@ namespace visimpl
 
     void setParticleSize( const TSizeFunction& particleSize );
 
+    /**
+     * Size of a particle whose last spike happened age time units ago.
+     * The vertex shader samples the same function from a lookup table.
+     */
+    float particleSize( float age ) const;
+
+    /**
+     * Largest size given by particleSize.
+     */
+    float maxParticleSize( ) const;
+
     const TColorVec& getGradient( ) const;
 
+    /**
+     * Colour of a particle whose last spike happened t decays ago.
+     */
+    glm::vec4 gradientColor( float t ) const;
+
     void setGradient( const TColorVec& gradient );
 
+    /**
+     * Lookup tables the shader samples, LUT_SIZE entries evenly spaced
+     * over the time range of their function.
+     */
+    const std::vector< glm::vec4 >& getGradientLut( ) const;
+    const glm::vec2& getGradientRange( ) const;
+    const std::vector< float >& getSizeLut( ) const;
+    const glm::vec2& getSizeRange( ) const;
+
     bool isParticleVisibility( ) const;
 
     void setParticleVisibility( bool particleVisibility );
@@ -74,6 +134,17 @@ namespace visimpl
 
     void setDecay( float decay );
 
+    const std::shared_ptr< ParticleStore >& getParticleStore( ) const;
+
+    void setParticleStore( const std::shared_ptr< ParticleStore >& store );
+
+    const std::shared_ptr< ParticleLod >& getLevelOfDetail( ) const;
+
+    /**
+     * Level of detail whose aggregated particles the cluster may draw.
+     */
+    void setLevelOfDetail( const std::shared_ptr< ParticleLod >& lod );
+
     void uploadDrawUniforms( plab::UniformCache& cache ) const override;
 
   };
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+
+#include <GL/glew.h>
+
+#include "TimestampBuffer.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace visimpl
+{
+
+  TimestampBuffer::TimestampBuffer( )
+    : _timestamps( )
+    , _dirty( )
+    , _fullyDirty( false )
+    , _buffer( 0 )
+    , _texture( 0 )
+    , _allocated( std::numeric_limits< size_t >::max( ))
+    , _uploadedBytes( 0 )
+    , _uploadedRanges( 0 )
+  {
+  }
+
+  TimestampBuffer::~TimestampBuffer( )
+  {
+    if ( _texture != 0 ) glDeleteTextures( 1 , &_texture );
+    if ( _buffer != 0 ) glDeleteBuffers( 1 , &_buffer );
+  }
+
+  void TimestampBuffer::resize( size_t size )
+  {
+    _timestamps.assign( size , -std::numeric_limits< float >::infinity( ));
+    _dirty.clear( );
+    _fullyDirty = true;
+  }
+
+  size_t TimestampBuffer::size( ) const
+  {
+    return _timestamps.size( );
+  }
+
+  float TimestampBuffer::get( uint32_t slot ) const
+  {
+    return _timestamps.at( slot );
+  }
+
+  const std::vector< float >& TimestampBuffer::getTimestamps( ) const
+  {
+    return _timestamps;
+  }
+
+  float* TimestampBuffer::data( )
+  {
+    return _timestamps.data( );
+  }
+
+  void TimestampBuffer::addDirty( const std::vector< uint32_t >& slots )
+  {
+    if ( !_fullyDirty )
+      _dirty.insert( _dirty.end( ) , slots.cbegin( ) , slots.cend( ));
+  }
+
+  void TimestampBuffer::invalidate( )
+  {
+    _dirty.clear( );
+    _fullyDirty = true;
+  }
+
+  void TimestampBuffer::fill( float timestamp )
+  {
+    std::fill( _timestamps.begin( ) , _timestamps.end( ) , timestamp );
+    _dirty.clear( );
+    _fullyDirty = true;
+  }
+
+  bool TimestampBuffer::isDirty( ) const
+  {
+    return _fullyDirty || !_dirty.empty( );
+  }
+
+  bool TimestampBuffer::isFullyDirty( ) const
+  {
+    return _fullyDirty;
+  }
+
+  const std::vector< uint32_t >& TimestampBuffer::getDirty( ) const
+  {
+    return _dirty;
+  }
+
+  size_t TimestampBuffer::flush( )
+  {
+    _uploadedBytes = 0;
+    _uploadedRanges = 0;
+
+    if ( _buffer == 0 )
+    {
+      glGenBuffers( 1 , &_buffer );
+      glGenTextures( 1 , &_texture );
+    }
+
+    glBindBuffer( GL_TEXTURE_BUFFER , _buffer );
+
+    if ( _allocated != _timestamps.size( ))
+    {
+      // Storage changed: reallocate and bind the new storage to the texture.
+      glBufferData( GL_TEXTURE_BUFFER ,
+                    _timestamps.size( ) * sizeof( float ) ,
+                    _timestamps.data( ) , GL_DYNAMIC_DRAW );
+      glBindTexture( GL_TEXTURE_BUFFER , _texture );
+      glTexBuffer( GL_TEXTURE_BUFFER , GL_R32F , _buffer );
+      glBindTexture( GL_TEXTURE_BUFFER , 0 );
+
+      _allocated = _timestamps.size( );
+      _uploadedBytes = _allocated * sizeof( float );
+      _uploadedRanges = 1;
+    }
+    else if ( _fullyDirty )
+    {
+      glBufferSubData( GL_TEXTURE_BUFFER , 0 ,
+                       _timestamps.size( ) * sizeof( float ) ,
+                       _timestamps.data( ));
+      _uploadedBytes = _timestamps.size( ) * sizeof( float );
+      _uploadedRanges = 1;
+    }
+    else if ( !_dirty.empty( ))
+    {
+      std::sort( _dirty.begin( ) , _dirty.end( ));
+
+      auto it = _dirty.cbegin( );
+      while ( it != _dirty.cend( ))
+      {
+        const uint32_t first = *it;
+        uint32_t last = first;
+        while ( ++it != _dirty.cend( ) && *it - last <= COALESCE_GAP )
+          last = *it;
+
+        const size_t count = last - first + 1;
+        glBufferSubData( GL_TEXTURE_BUFFER , first * sizeof( float ) ,
+                         count * sizeof( float ) , _timestamps.data( ) + first );
+        _uploadedBytes += count * sizeof( float );
+        ++_uploadedRanges;
+      }
+    }
+
+    glBindBuffer( GL_TEXTURE_BUFFER , 0 );
+
+    _dirty.clear( );
+    _fullyDirty = false;
+
+    return _uploadedBytes;
+  }
+
+  size_t TimestampBuffer::getUploadedBytes( ) const
+  {
+    return _uploadedBytes;
+  }
+
+  size_t TimestampBuffer::getUploadedRanges( ) const
+  {
+    return _uploadedRanges;
+  }
+
+  unsigned int TimestampBuffer::getTexture( ) const
+  {
+    return _texture;
+  }
+
+}
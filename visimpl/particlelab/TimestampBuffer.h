@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2015-2022 VG-Lab/URJC.
+ *
+ * This file is part of ViSimpl <https://github.com/vg-lab/visimpl>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef VISIMPL_TIMESTAMPBUFFER_H
+#define VISIMPL_TIMESTAMPBUFFER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace visimpl
+{
+
+  /**
+   * Spike timestamps of a set of particles, stored apart from their
+   * positions so they can be updated without touching the rest of the
+   * particle data.
+   *
+   * Writes go to a CPU-side mirror and are recorded as dirty slots. flush()
+   * coalesces the dirty slots into ranges and uploads only those ranges to a
+   * GL texture buffer, that the particle vertex shader reads by instance.
+   */
+  class TimestampBuffer
+  {
+    std::vector< float > _timestamps;
+    std::vector< uint32_t > _dirty;
+    bool _fullyDirty;
+
+    unsigned int _buffer;
+    unsigned int _texture;
+    size_t _allocated;
+
+    size_t _uploadedBytes;
+    size_t _uploadedRanges;
+
+  public:
+
+    /**
+     * Two dirty slots closer than this are uploaded as a single range.
+     * Overwriting a few clean values is cheaper than an extra GL call.
+     */
+    static constexpr uint32_t COALESCE_GAP = 16;
+
+    TimestampBuffer( );
+
+    ~TimestampBuffer( );
+
+    TimestampBuffer( const TimestampBuffer& ) = delete;
+
+    TimestampBuffer& operator=( const TimestampBuffer& ) = delete;
+
+    /**
+     * Resizes the buffer. Every slot is reset to -infinity.
+     */
+    void resize( size_t size );
+
+    size_t size( ) const;
+
+    float get( uint32_t slot ) const;
+
+    const std::vector< float >& getTimestamps( ) const;
+
+    void set( uint32_t slot , float timestamp )
+    {
+      _timestamps[ slot ] = timestamp;
+      if ( !_fullyDirty ) _dirty.push_back( slot );
+    }
+
+    /**
+     * Raw access to the CPU mirror. Writes through this pointer must be
+     * reported with addDirty.
+     */
+    float* data( );
+
+    void addDirty( const std::vector< uint32_t >& slots );
+
+    /**
+     * Marks the whole buffer for upload, after rewriting it through data().
+     */
+    void invalidate( );
+
+    /**
+     * Sets every slot to the given value. The next flush uploads the
+     * whole buffer.
+     */
+    void fill( float timestamp );
+
+    bool isDirty( ) const;
+
+    /**
+     * True if the next flush uploads the whole buffer. Dirty slots are not
+     * recorded in that case.
+     */
+    bool isFullyDirty( ) const;
+
+    /**
+     * Slots written since the last flush, unsorted and possibly repeated.
+     */
+    const std::vector< uint32_t >& getDirty( ) const;
+
+    /**
+     * Uploads the dirty ranges to the GPU. The GL objects are created on the
+     * first call, so a GL context must be current.
+     *
+     * @return the amount of bytes uploaded.
+     */
+    size_t flush( );
+
+    /**
+     * Bytes and ranges sent to the GPU by the last flush.
+     */
+    size_t getUploadedBytes( ) const;
+
+    size_t getUploadedRanges( ) const;
+
+    /**
+     * GL_TEXTURE_BUFFER texture holding the timestamps.
+     */
+    unsigned int getTexture( ) const;
+
+  };
+
+}
+
+#endif //VISIMPL_TIMESTAMPBUFFER_H
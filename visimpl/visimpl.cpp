@@ -27,6 +27,7 @@
 // C++
 #include <sys/stat.h>
 #include <locale>
+#include <algorithm>
 
 // Qt
 #include <QApplication>
@@ -90,6 +91,8 @@ int main( int argc, char** argv )
   bool zNull = false;
   std::string subsetEventFile;
   std::string scaleFactor;
+  float spikeWindowMargin = -1.0f;
+  bool compressSpikes = false;
 
   bool fullscreen = false, initWindowSize = false, initWindowMaximized = false;
   int initWindowWidth = 0, initWindowHeight = 0;
@@ -229,6 +232,23 @@ int main( int argc, char** argv )
         usageMessage( argv[0] );
     }
 
+    if( std::strcmp( argv[ i ], "-spike-window" ) == 0 )
+    {
+      if( ++i < argc )
+      {
+        spikeWindowMargin = std::max( 0.0f, static_cast< float >( atof( argv[ i ] )));
+        continue;
+      }
+      else
+        usageMessage( argv[0] );
+    }
+
+    if( std::strcmp( argv[ i ], "-compress-spikes" ) == 0 )
+    {
+      compressSpikes = true;
+      continue;
+    }
+
     if( std::strcmp( argv[ i ], "-spikes" ) == 0 )
     {
       simType = simil::TSimSpikes;
@@ -350,6 +370,9 @@ int main( int argc, char** argv )
     }
   }
 
+  mainWindow.setSpikeWindowMargin( spikeWindowMargin );
+  mainWindow.setCompressedSpikes( compressSpikes );
+
   switch(dataType)
   {
     case simil::TDataType::TREST:
@@ -400,6 +423,10 @@ void usageMessage( char* progName )
 //            << std::endl
             << "\t[ -scale <X,Y,Z> ]"
             << std::endl
+            << "\t[ -spike-window <margin> ]"
+            << std::endl
+            << "\t[ -compress-spikes ]"
+            << std::endl
 #ifdef VISIMPL_USE_ZEROEQ
             << "\t[ -zeq <session_name*> ]"
             << std::endl
@@ -419,6 +446,14 @@ void usageMessage( char* progName )
             << "\t[ --help | -h ]"
             << std::endl << std::endl
             << "* session_name: for example test://"
+            << std::endl
+            << "* margin: simulation time kept in memory around the playback time,"
+            << std::endl
+            << "  the rest of the spikes is read from the spike cache as needed."
+            << std::endl
+            << "* -compress-spikes: keeps the spikes compressed in memory, about"
+            << std::endl
+            << "  a third of their size, and decodes those around the playback time."
             << std::endl << std::endl;
   exit(-1);
 }